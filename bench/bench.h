@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2016-2025 by Joseph A. Marrero. http://www.joemarrero.com/
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef _NAMECOM_BENCH_H_
+#define _NAMECOM_BENCH_H_
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/*
+ * Helpers shared by the benchmarks.  The benchmarks that talk to name.com
+ * run against the development API with the credentials in
+ * NAMECOM_USERNAME and NAMECOM_API_TOKEN, and are skipped when those
+ * aren't set so that `make bench` still runs the offline ones.
+ */
+static inline double bench_now_ms( void )
+{
+	struct timespec ts;
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+static inline bool bench_credentials( const char* name, const char** username, const char** token )
+{
+	*username = getenv( "NAMECOM_USERNAME" );
+	*token    = getenv( "NAMECOM_API_TOKEN" );
+
+	if( !*username || !*token )
+	{
+		printf( "%s: skipped (NAMECOM_USERNAME and NAMECOM_API_TOKEN are not set).\n", name );
+		return false;
+	}
+
+	return true;
+}
+
+static inline int bench_arg( int argc, char* argv[], int index, int fallback )
+{
+	int value = argc > index ? atoi( argv[ index ] ) : 0;
+	return value > 0 ? value : fallback;
+}
+
+#endif /* _NAMECOM_BENCH_H_ */
@@ -0,0 +1,246 @@
+/*
+ * Copyright (C) 2016-2025 by Joseph A. Marrero. http://www.joemarrero.com/
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+/*
+ * Record listing decoding: peak memory and time to first record for the
+ * streaming decoder (handing records to a callback, or collecting them
+ * into a record set) against parsing the whole response with jansson and
+ * walking the tree, as the tools did before listings were streamed.
+ * Each run happens in its own process so their peak RSS can be compared;
+ * the listing is fed from memory in network sized chunks, so the times
+ * are the CPU cost alone.
+ *
+ *     bench_decoder [records]
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <jansson.h>
+#include "namecom_record_decoder.h"
+#include "namecom_record_set.h"
+#include "bench.h"
+
+#define BENCH_CHUNK  16384
+
+typedef enum bench_mode {
+	BENCH_MODE_STREAM = 0,
+	BENCH_MODE_COLLECT,
+	BENCH_MODE_JANSSON,
+} bench_mode_t;
+
+static const char* bench_mode_names[] = { "stream", "record set", "jansson" };
+
+static double bench_start_ms;
+static double bench_first_ms;
+
+static char* bench_listing( int records, size_t* len )
+{
+	size_t capacity = 64 + (size_t) records * 192;
+	char* text = malloc( capacity );
+	size_t n = 0;
+
+	if( !text )
+	{
+		return NULL;
+	}
+
+	n += sprintf( text + n, "{\"result\":{\"code\":100,\"message\":\"Command Successful\"},\"records\":[" );
+
+	for( int i = 0; i < records; i++ )
+	{
+		n += sprintf( text + n, "%s{\"record_id\":\"%d\",\"name\":\"host%d.example.com\",\"type\":\"%s\",\"content\":\"%s\",\"ttl\":\"300\",\"create_date\":\"2016-01-01 00:00:00\"}",
+		              i ? "," : "", 100000 + i, i, i % 4 ? "A" : "TXT", i % 4 ? "192.0.2.1" : "v=spf1 include:_spf.example.com ~all" );
+	}
+
+	n += sprintf( text + n, "]}" );
+	*len = n;
+
+	return text;
+}
+
+static long bench_rss_kb( void )
+{
+	long pages = 0;
+	FILE* statm = fopen( "/proc/self/statm", "r" );
+
+	if( statm )
+	{
+		if( fscanf( statm, "%*s %ld", &pages ) != 1 ) pages = 0;
+		fclose( statm );
+	}
+
+	return pages * (sysconf( _SC_PAGESIZE ) / 1024);
+}
+
+static bool bench_on_record( namecom_api_dns_record_t* record, void* user_data )
+{
+	if( bench_first_ms == 0.0 )
+	{
+		bench_first_ms = bench_now_ms( ) - bench_start_ms;
+	}
+
+	(*(size_t*) user_data)++;
+	namecom_api_dns_record_destroy( record );
+	return true;
+}
+
+static size_t bench_decode( bench_mode_t mode, const char* text, size_t len )
+{
+	size_t count = 0;
+
+	if( mode == BENCH_MODE_JANSSON )
+	{
+		json_error_t error;
+		char* body = malloc( len );
+
+		/* The body is accumulated before parsing, as it was downloaded. */
+		for( size_t i = 0; body && i < len; i += BENCH_CHUNK )
+		{
+			memcpy( body + i, text + i, len - i < BENCH_CHUNK ? len - i : BENCH_CHUNK );
+		}
+
+		json_t* root    = body ? json_loadb( body, len, 0, &error ) : NULL;
+		json_t* records = json_object_get( root, "records" );
+
+		for( size_t i = 0; i < json_array_size( records ); i++ )
+		{
+			json_t* object = json_array_get( records, i );
+			namecom_api_dns_record_t* record = namecom_api_dns_record_create(
+				atol( json_string_value( json_object_get( object, "record_id" ) ) ),
+				json_string_value( json_object_get( object, "name" ) ),
+				json_string_value( json_object_get( object, "type" ) ),
+				json_string_value( json_object_get( object, "content" ) ),
+				atoi( json_string_value( json_object_get( object, "ttl" ) ) ),
+				json_string_value( json_object_get( object, "create_date" ) )
+			);
+
+			if( record && bench_first_ms == 0.0 )
+			{
+				bench_first_ms = bench_now_ms( ) - bench_start_ms;
+			}
+
+			count += record ? 1 : 0;
+			namecom_api_dns_record_destroy( record );
+		}
+
+		json_decref( root );
+		free( body );
+		return count;
+	}
+
+	namecom_record_decoder_t* decoder = namecom_record_decoder_create( bench_on_record, &count );
+	namecom_record_set_t* set = mode == BENCH_MODE_COLLECT ? namecom_record_set_create( 0 ) : NULL;
+
+	if( !decoder || (mode == BENCH_MODE_COLLECT && !set) )
+	{
+		fprintf( stderr, "[ERROR] Out of memory.\n" );
+		exit( 1 );
+	}
+
+	if( set )
+	{
+		namecom_record_decoder_collect( decoder, set );
+	}
+
+	for( size_t i = 0; i < len; i += BENCH_CHUNK )
+	{
+		if( !namecom_record_decoder_feed( decoder, text + i, len - i < BENCH_CHUNK ? len - i : BENCH_CHUNK ) )
+		{
+			break;
+		}
+
+		if( set && bench_first_ms == 0.0 && namecom_record_set_count( set ) > 0 )
+		{
+			bench_first_ms = bench_now_ms( ) - bench_start_ms;
+		}
+	}
+
+	if( !namecom_record_decoder_finish( decoder ) )
+	{
+		fprintf( stderr, "[ERROR] %s\n", namecom_record_decoder_error_string( namecom_record_decoder_error( decoder ) ) );
+		exit( 1 );
+	}
+
+	count = namecom_record_decoder_count( decoder );
+	namecom_record_set_destroy( set );
+	namecom_record_decoder_destroy( decoder );
+
+	return count;
+}
+
+static void bench_run( bench_mode_t mode, const char* text, size_t len )
+{
+	fflush( stdout );
+
+	pid_t child = fork( );
+
+	if( child == 0 )
+	{
+		struct rusage usage;
+		long baseline_kb = bench_rss_kb( );
+
+		bench_start_ms = bench_now_ms( );
+		size_t count   = bench_decode( mode, text, len );
+		double total   = bench_now_ms( ) - bench_start_ms;
+
+		getrusage( RUSAGE_SELF, &usage );
+		printf( "%-10s  %8zu  %14.2f  %10.2f  %14ld\n", bench_mode_names[ mode ], count, bench_first_ms, total, usage.ru_maxrss - baseline_kb );
+		fflush( stdout );
+		_exit( 0 );
+	}
+	else if( child > 0 )
+	{
+		waitpid( child, NULL, 0 );
+	}
+}
+
+int main( int argc, char* argv[] )
+{
+	int records = bench_arg( argc, argv, 1, 100000 );
+	size_t len  = 0;
+	char* text  = bench_listing( records, &len );
+
+	if( !text )
+	{
+		fprintf( stderr, "[ERROR] Out of memory.\n" );
+		return 1;
+	}
+
+	/* Touch every page so the listing is part of each child's baseline. */
+	volatile char sum = 0;
+	for( size_t i = 0; i < len; i += 4096 ) sum += text[ i ];
+	(void) sum;
+
+	printf( "%d records, %zu bytes, fed %d bytes at a time.\n", records, len, BENCH_CHUNK );
+	printf( "%-10s  %8s  %14s  %10s  %14s\n", "decoder", "records", "first record ms", "total ms", "peak RSS +KiB" );
+
+	for( int mode = BENCH_MODE_STREAM; mode <= BENCH_MODE_JANSSON; mode++ )
+	{
+		bench_run( (bench_mode_t) mode, text, len );
+	}
+
+	free( text );
+	return 0;
+}
@@ -0,0 +1,177 @@
+/*
+ * Copyright (C) 2016-2025 by Joseph A. Marrero. http://www.joemarrero.com/
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+/*
+ * HTTP/1.1 vs HTTP/2: adds and removes records through the asynchronous
+ * interface, 16 in flight at a time, first over keep-alive HTTP/1.1
+ * connections and then multiplexed over HTTP/2.  It runs against the
+ * tests' stub of the API on the loopback interface (see tests/test_stub.h),
+ * served over TLS with a certificate the stub makes up, so it needs no
+ * credentials and measures the client and the protocol rather than
+ * name.com.  Half the calls of a round are adds and the other half remove
+ * the records added; the time per round, the rate and how many
+ * connections each protocol needed are reported.  The stub answers a
+ * connection's requests one at a time, so the single HTTP/2 connection
+ * gets no more from the server than each HTTP/1.1 connection does.
+ *
+ *     bench_http2 [calls per round] [rounds]
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <stdio.h>
+#include <curl/curl.h>
+#include "namecom_api.h"
+#include "test_stub.h"
+#include "bench.h"
+
+#define BENCH_CONCURRENCY  16
+
+static int compare_ms( const void* l, const void* r )
+{
+	double a = *(const double*) l;
+	double b = *(const double*) r;
+	return a < b ? -1 : a > b;
+}
+
+/*
+ * Submits the requests, waits for all of them and counts the failures.
+ * The ids of added records are kept in ids.
+ */
+static unsigned long bench_wait( namecom_api_t* api, namecom_api_request_t** requests, int count, long* ids )
+{
+	unsigned long failures = 0;
+
+	for( int i = 0; i < count; i++ )
+	{
+		if( !requests[ i ] || !namecom_api_wait( api, requests[ i ] ) )
+		{
+			failures++;
+		}
+		else if( ids )
+		{
+			ids[ i ] = namecom_api_request_record_id( requests[ i ] );
+		}
+
+		namecom_api_request_destroy( requests[ i ] );
+	}
+
+	return failures;
+}
+
+static bool bench_run( bool http2, int calls, int rounds )
+{
+	bool result = false;
+	unsigned long failures = 0;
+	int adds = calls / 2;
+	double* times = malloc( sizeof(double) * rounds );
+	long* ids = malloc( sizeof(long) * adds );
+	namecom_api_request_t** requests = malloc( sizeof(namecom_api_request_t*) * adds );
+	namecom_api_t* api = namecom_api_create( "user", "token", true, false );
+
+	if( !api || !times || !ids || !requests )
+	{
+		fprintf( stderr, "[ERROR] Out of memory.\n" );
+		goto done;
+	}
+
+	if( !namecom_api_set_ca_bundle( api, test_stub_certificate( ) ) )
+	{
+		fprintf( stderr, "[ERROR] Out of memory.\n" );
+		goto done;
+	}
+
+	namecom_api_set_max_concurrency( api, BENCH_CONCURRENCY );
+	namecom_api_set_http2( api, http2, 100 );
+
+	if( !namecom_api_login( api ) )
+	{
+		fprintf( stderr, "[ERROR] Unable to login.\n" );
+		goto done;
+	}
+
+	for( int round = 0; round < rounds; round++ )
+	{
+		double start = bench_now_ms( );
+
+		for( int i = 0; i < adds; i++ )
+		{
+			requests[ i ] = namecom_api_submit_dns_record_add( api, TEST_STUB_DOMAIN, "bench", "A", "10.0.5.1", 300, 10, NULL, NULL );
+		}
+
+		failures += bench_wait( api, requests, adds, ids );
+
+		for( int i = 0; i < adds; i++ )
+		{
+			requests[ i ] = namecom_api_submit_dns_record_remove( api, TEST_STUB_DOMAIN, ids[ i ], NULL, NULL );
+		}
+
+		failures += bench_wait( api, requests, adds, NULL );
+		times[ round ] = bench_now_ms( ) - start;
+	}
+
+	namecom_api_connection_stats_t stats;
+	namecom_api_connection_stats( api, &stats );
+	qsort( times, rounds, sizeof(double), compare_ms );
+
+	printf( "%-9s  %9.1f  %9.1f  %9.0f  %11lu  %8lu  %8lu  %8lu\n",
+	        http2 ? "HTTP/2" : "HTTP/1.1",
+	        times[ 0 ], times[ rounds / 2 ],
+	        adds * 2 * 1000.0 / times[ rounds / 2 ],
+	        stats.connections_created, stats.connections_reused, stats.http2_requests, failures );
+
+	namecom_api_logout( api );
+	result = failures == 0 && (!http2 || stats.http2_requests > 0);
+
+	if( http2 && stats.http2_requests == 0 )
+	{
+		fprintf( stderr, "[ERROR] No request was made over HTTP/2.\n" );
+	}
+
+done:
+	if( api ) namecom_api_destroy( api );
+	free( requests );
+	free( ids );
+	free( times );
+	return result;
+}
+
+int main( int argc, char* argv[] )
+{
+	int calls  = bench_arg( argc, argv, 1, 1000 );
+	int rounds = bench_arg( argc, argv, 2, 5 );
+
+	curl_global_init( CURL_GLOBAL_DEFAULT );
+
+	if( calls < 2 || !test_stub_start( ) )
+	{
+		return 1;
+	}
+
+	printf( "%d add and remove calls per round against a local stub, %d rounds, %d in flight.\n", calls / 2 * 2, rounds, BENCH_CONCURRENCY );
+	printf( "%-9s  %9s  %9s  %9s  %11s  %8s  %8s  %8s\n", "protocol", "best ms", "median ms", "calls/s", "connections", "reused", "http2", "failed" );
+
+	bool h1 = bench_run( false, calls, rounds );
+	bool h2 = bench_run( true, calls, rounds );
+
+	remove( test_stub_certificate( ) );
+	curl_global_cleanup( );
+	return h1 && h2 ? 0 : 1;
+}
@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2016-2025 by Joseph A. Marrero. http://www.joemarrero.com/
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+/*
+ * Startup cost vs request count: runs n hello requests on one handle,
+ * which parses the CA bundle once and keeps its connection, and on a
+ * fresh handle per request, which pays for the CA bundle, the connection
+ * and the TLS handshake every time (as each run of the tools does).  The
+ * first request on the shared handle is reported separately so that the
+ * startup cost can be read off against the steady state.
+ *
+ *     bench_startup [max requests]
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <stdio.h>
+#include <curl/curl.h>
+#include "namecom_api.h"
+#include "bench.h"
+
+static bool bench_shared( const char* username, const char* token, int requests, double* first_ms, double* total_ms )
+{
+	bool result = false;
+	double start = bench_now_ms( );
+	namecom_api_t* api = namecom_api_create_with_auth( username, token, true, false, NAMECOM_API_AUTH_STATELESS );
+
+	if( !api )
+	{
+		fprintf( stderr, "[ERROR] Out of memory.\n" );
+		goto done;
+	}
+
+	for( int i = 0; i < requests; i++ )
+	{
+		if( !namecom_api_hello( api ) )
+		{
+			fprintf( stderr, "[ERROR] Hello failed.\n" );
+			goto done;
+		}
+
+		if( i == 0 )
+		{
+			*first_ms = bench_now_ms( ) - start;
+		}
+	}
+
+	*total_ms = bench_now_ms( ) - start;
+	result = true;
+
+done:
+	if( api ) namecom_api_destroy( api );
+	return result;
+}
+
+static bool bench_fresh( const char* username, const char* token, int requests, double* total_ms )
+{
+	double start = bench_now_ms( );
+
+	for( int i = 0; i < requests; i++ )
+	{
+		namecom_api_t* api = namecom_api_create_with_auth( username, token, true, false, NAMECOM_API_AUTH_STATELESS );
+		bool ok = api && namecom_api_hello( api );
+
+		if( api ) namecom_api_destroy( api );
+
+		if( !ok )
+		{
+			fprintf( stderr, "[ERROR] Hello failed.\n" );
+			return false;
+		}
+	}
+
+	*total_ms = bench_now_ms( ) - start;
+	return true;
+}
+
+int main( int argc, char* argv[] )
+{
+	const char* username;
+	const char* token;
+	int max_requests = bench_arg( argc, argv, 1, 32 );
+	bool result = true;
+
+	if( !bench_credentials( "bench_startup", &username, &token ) )
+	{
+		return 0;
+	}
+
+	curl_global_init( CURL_GLOBAL_DEFAULT );
+
+	printf( "%8s  %12s  %12s  %12s  %12s  %12s\n", "requests", "first ms", "shared ms", "ms/request", "fresh ms", "ms/request" );
+
+	for( int requests = 1; result && requests <= max_requests; requests *= 2 )
+	{
+		double first = 0.0, shared = 0.0, fresh = 0.0;
+
+		result = bench_shared( username, token, requests, &first, &shared ) &&
+		         bench_fresh( username, token, requests, &fresh );
+
+		if( result )
+		{
+			printf( "%8d  %12.1f  %12.1f  %12.1f  %12.1f  %12.1f\n",
+			        requests, first, shared, shared / requests, fresh, fresh / requests );
+		}
+	}
+
+	curl_global_cleanup( );
+	return result ? 0 : 1;
+}
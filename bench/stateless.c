@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2016-2025 by Joseph A. Marrero. http://www.joemarrero.com/
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+/*
+ * Session vs stateless authentication: times whole runs of the tools,
+ * each a fresh handle that does n hello requests.  A session run logs in
+ * first and logs out afterwards; a stateless run sends the credentials
+ * with every request and skips both round trips.  With n = 1 this is the
+ * dyndns check that finds the address up to date.  Each row is averaged
+ * over several runs.
+ *
+ *     bench_stateless [max requests] [runs]
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <stdio.h>
+#include <curl/curl.h>
+#include "namecom_api.h"
+#include "bench.h"
+
+static bool bench_run( const char* username, const char* token, namecom_api_auth_mode_t auth_mode, int requests, double* total_ms )
+{
+	bool result = false;
+	double start = bench_now_ms( );
+	namecom_api_t* api = namecom_api_create_with_auth( username, token, true, false, auth_mode );
+
+	if( !api )
+	{
+		fprintf( stderr, "[ERROR] Out of memory.\n" );
+		goto done;
+	}
+
+	if( !namecom_api_login( api ) )
+	{
+		fprintf( stderr, "[ERROR] Login failed.\n" );
+		goto done;
+	}
+
+	for( int i = 0; i < requests; i++ )
+	{
+		if( !namecom_api_hello( api ) )
+		{
+			fprintf( stderr, "[ERROR] Hello failed.\n" );
+			goto done;
+		}
+	}
+
+	if( !namecom_api_logout( api ) )
+	{
+		fprintf( stderr, "[ERROR] Logout failed.\n" );
+		goto done;
+	}
+
+	*total_ms = bench_now_ms( ) - start;
+	result = true;
+
+done:
+	if( api ) namecom_api_destroy( api );
+	return result;
+}
+
+int main( int argc, char* argv[] )
+{
+	const char* username;
+	const char* token;
+	int max_requests = bench_arg( argc, argv, 1, 8 );
+	int runs = bench_arg( argc, argv, 2, 5 );
+	bool result = true;
+
+	if( !bench_credentials( "bench_stateless", &username, &token ) )
+	{
+		return 0;
+	}
+
+	curl_global_init( CURL_GLOBAL_DEFAULT );
+
+	printf( "%8s  %12s  %12s  %8s\n", "requests", "session ms", "stateless ms", "speedup" );
+
+	for( int requests = 1; result && requests <= max_requests; requests *= 2 )
+	{
+		double session = 0.0, stateless = 0.0;
+
+		for( int run = 0; result && run < runs; run++ )
+		{
+			double session_ms = 0.0, stateless_ms = 0.0;
+
+			result = bench_run( username, token, NAMECOM_API_AUTH_SESSION, requests, &session_ms ) &&
+			         bench_run( username, token, NAMECOM_API_AUTH_STATELESS, requests, &stateless_ms );
+
+			session   += session_ms;
+			stateless += stateless_ms;
+		}
+
+		if( result )
+		{
+			printf( "%8d  %12.1f  %12.1f  %7.2fx\n",
+			        requests, session / runs, stateless / runs, stateless > 0.0 ? session / stateless : 0.0 );
+		}
+	}
+
+	curl_global_cleanup( );
+	return result ? 0 : 1;
+}
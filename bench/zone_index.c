@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2016-2025 by Joseph A. Marrero. http://www.joemarrero.com/
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+/*
+ * Zone lookups: builds an index over zones of 1k, 10k and 100k records
+ * and times looking names up in it against scanning the listing for the
+ * last record with the name, which is what the tools did before.
+ *
+ *     bench_zone_index [lookups]
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "namecom_record_set.h"
+#include "namecom_zone_index.h"
+#include "bench.h"
+
+static long bench_scan( const namecom_record_set_t* set, const char* fqdn )
+{
+	long last = -1;
+
+	for( size_t i = 0; i < namecom_record_set_count( set ); i++ )
+	{
+		const char* name = namecom_record_set_fqdn( set, i );
+
+		if( name && strcmp( name, fqdn ) == 0 )
+		{
+			last = (long) i;
+		}
+	}
+
+	return last;
+}
+
+int main( int argc, char* argv[] )
+{
+	static const size_t sizes[] = { 1000, 10000, 100000 };
+	int lookups = bench_arg( argc, argv, 1, 1000 );
+	char fqdn[ 64 ];
+	bool result = true;
+
+	printf( "%d lookups per zone, half of them for names that aren't there.\n", lookups );
+	printf( "%8s  %10s  %14s  %14s  %10s\n", "records", "build ms", "index ns/find", "scan ns/find", "speedup" );
+
+	for( size_t s = 0; result && s < sizeof(sizes) / sizeof(sizes[0]); s++ )
+	{
+		size_t count = sizes[ s ];
+		namecom_record_set_t* set = namecom_record_set_create( count );
+
+		for( size_t i = 0; set && i < count; i++ )
+		{
+			/* A few names carry more than one record, as with MX and TXT. */
+			snprintf( fqdn, sizeof(fqdn), "host%zu.example.com", i % 8 == 7 ? i - 1 : i );
+			if( !namecom_record_set_append( set, (long) i, fqdn, i % 8 == 7 ? "TXT" : "A", "192.0.2.1", 300, "2016-01-01 00:00:00" ) )
+			{
+				namecom_record_set_destroy( set );
+				set = NULL;
+			}
+		}
+
+		double start = bench_now_ms( );
+		namecom_zone_index_t* index = set ? namecom_zone_index_build( set ) : NULL;
+		double build = bench_now_ms( ) - start;
+
+		if( !index )
+		{
+			fprintf( stderr, "[ERROR] Out of memory.\n" );
+			namecom_record_set_destroy( set );
+			result = false;
+			break;
+		}
+
+		unsigned long seed = 12345;
+		long found[ 2 ] = { 0, 0 };
+		double elapsed[ 2 ];
+
+		for( int method = 0; method < 2; method++ )
+		{
+			seed  = 12345;
+			start = bench_now_ms( );
+
+			for( int i = 0; i < lookups; i++ )
+			{
+				seed = seed * 6364136223846793005UL + 1442695040888963407UL;
+				snprintf( fqdn, sizeof(fqdn), "host%lu.example.com", (unsigned long) ((seed >> 33) % (count * 2)) );
+
+				long record = method == 0 ? namecom_zone_index_find_last( index, fqdn, NAMECOM_RECORD_TYPE_UNKNOWN ) : bench_scan( set, fqdn );
+				found[ method ] += record;
+			}
+
+			elapsed[ method ] = bench_now_ms( ) - start;
+		}
+
+		if( found[ 0 ] != found[ 1 ] )
+		{
+			fprintf( stderr, "[ERROR] The index and the scan disagree.\n" );
+			result = false;
+		}
+
+		printf( "%8zu  %10.2f  %14.0f  %14.0f  %9.0fx\n", count, build,
+		        elapsed[ 0 ] * 1e6 / lookups, elapsed[ 1 ] * 1e6 / lookups, elapsed[ 1 ] / (elapsed[ 0 ] > 0.0 ? elapsed[ 0 ] : 1e-6) );
+
+		namecom_zone_index_destroy( index );
+		namecom_record_set_destroy( set );
+	}
+
+	return result ? 0 : 1;
+}
@@ -22,18 +22,25 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 #include <curl/curl.h>
 #include <xtd/string.h>
 #include <xtd/console.h>
 #include <collections/vector.h>
 #include "namecom_api.h"
+#include "namecom_record_set.h"
+#include "namecom_zone_index.h"
+#include "namecom_zone_snapshot.h"
+#include "namecom_label_trie.h"
 
 #define VERSION  "1.0"
 
 static void banner( void );
 static void about( int argc, char* argv[] );
 static bool separate_fqdn( const char* fqdn, char** host, char** domain );
+static bool select_record( size_t record, void* user_data );
+static int compare_records( const void* l, const void* r );
 
 typedef enum {
 	COMMAND_NOT_SET = 0,
@@ -52,11 +59,24 @@ typedef struct {
 	const char* username;
 	const char* token;
 	bool verbose;
+	bool cache;
+	bool reuse_session;
+	bool stateless;
+	const char* filter;
+	bool delete_matching;
+	long snapshot_age;
+	double rate;
+	double host_quota;
+	long hedge_delay;
 } app_args_t;
 
 int main( int argc, char* argv[] )
 {
 	int result = 0;
+	namecom_transport_cache_t* cache = NULL;
+	char snapshot_directory[ 1024 ];
+	bool snapshots = false;
+	bool timed_out = false;
 
 	app_args_t args = {
 		.host       = NULL,
@@ -67,7 +87,16 @@ int main( int argc, char* argv[] )
 		.command    = COMMAND_NOT_SET,
 		.username   = getenv( "NAMECOM_USERNAME" ),
 		.token      = getenv( "NAMECOM_API_TOKEN" ),
-		.verbose    = false
+		.verbose    = false,
+		.cache      = false,
+		.reuse_session = false,
+		.stateless  = false,
+		.filter     = NULL,
+		.delete_matching = false,
+		.snapshot_age = 0,
+		.rate       = 0.0,
+		.host_quota = 0.0,
+		.hedge_delay = 0
 	};
 
 
@@ -125,11 +154,13 @@ int main( int argc, char* argv[] )
 						goto done;
 					}
 
-					if( strcmp(args.type, "A") != 0 &&
-					    strcmp(args.type, "CNAME") != 0 &&
-					    strcmp(args.type, "MX") != 0 &&
-					    strcmp(args.type, "NS") != 0 &&
-					    strcmp(args.type, "TXT") != 0)
+					namecom_record_type_t type = namecom_record_type_parse( args.type );
+
+					if( type != NAMECOM_RECORD_TYPE_A &&
+					    type != NAMECOM_RECORD_TYPE_CNAME &&
+					    type != NAMECOM_RECORD_TYPE_MX &&
+					    type != NAMECOM_RECORD_TYPE_NS &&
+					    type != NAMECOM_RECORD_TYPE_TXT )
 					{
 						fprintf( stderr, "[ERROR] The record type must be either a A, CNAME, MX, NS, or TXT.\n" );
 						result = -1;
@@ -217,6 +248,137 @@ int main( int argc, char* argv[] )
 					goto done;
 				}
 			}
+			else if( strcmp( "-v", argv[arg] ) == 0 || strcmp( "--verbose", argv[arg] ) == 0 )
+			{
+				args.verbose = true;
+				arg += 1;
+			}
+			else if( strcmp( "-c", argv[arg] ) == 0 || strcmp( "--cache", argv[arg] ) == 0 )
+			{
+				args.cache = true;
+				arg += 1;
+			}
+			else if( strcmp( "-r", argv[arg] ) == 0 || strcmp( "--reuse-session", argv[arg] ) == 0 )
+			{
+				args.reuse_session = true;
+				arg += 1;
+			}
+			else if( strcmp( "-n", argv[arg] ) == 0 || strcmp( "--stateless", argv[arg] ) == 0 )
+			{
+				args.stateless = true;
+				arg += 1;
+			}
+			else if( strcmp( "-f", argv[arg] ) == 0 || strcmp( "--filter", argv[arg] ) == 0 )
+			{
+				if( (arg + 1) < argc )
+				{
+					args.filter = argv[ arg + 1 ];
+					arg += 2;
+				}
+				else
+				{
+					fprintf( stderr, "[ERROR] Missing required parameter for filter option.\n" );
+					result = -1;
+					goto done;
+				}
+			}
+			else if( strcmp( "-x", argv[arg] ) == 0 || strcmp( "--delete-matching", argv[arg] ) == 0 )
+			{
+				args.delete_matching = true;
+				arg += 1;
+			}
+			else if( strcmp( "-z", argv[arg] ) == 0 || strcmp( "--snapshot-age", argv[arg] ) == 0 )
+			{
+				if( (arg + 1) < argc )
+				{
+					char *age_bad_char = NULL;
+					args.snapshot_age = strtol( argv[arg + 1], &age_bad_char, 10 );
+
+					if( *age_bad_char || args.snapshot_age <= 0 )
+					{
+						fprintf( stderr, "[ERROR] Malformed snapshot age (it must be a positive number of seconds).\n" );
+						result = -1;
+						goto done;
+					}
+
+					arg += 2;
+				}
+				else
+				{
+					fprintf( stderr, "[ERROR] Missing required parameter for snapshot age option.\n" );
+					result = -1;
+					goto done;
+				}
+			}
+			else if( strcmp( "-p", argv[arg] ) == 0 || strcmp( "--rate", argv[arg] ) == 0 )
+			{
+				if( (arg + 1) < argc )
+				{
+					char *rate_bad_char = NULL;
+					args.rate = strtod( argv[arg + 1], &rate_bad_char );
+
+					if( *rate_bad_char || args.rate <= 0.0 )
+					{
+						fprintf( stderr, "[ERROR] Malformed rate (it must be a positive number of requests per second).\n" );
+						result = -1;
+						goto done;
+					}
+
+					arg += 2;
+				}
+				else
+				{
+					fprintf( stderr, "[ERROR] Missing required parameter for rate option.\n" );
+					result = -1;
+					goto done;
+				}
+			}
+			else if( strcmp( "-q", argv[arg] ) == 0 || strcmp( "--host-quota", argv[arg] ) == 0 )
+			{
+				if( (arg + 1) < argc )
+				{
+					char *quota_bad_char = NULL;
+					args.host_quota = strtod( argv[arg + 1], &quota_bad_char );
+
+					if( *quota_bad_char || args.host_quota <= 0.0 )
+					{
+						fprintf( stderr, "[ERROR] Malformed host quota (it must be a positive number of requests per second).\n" );
+						result = -1;
+						goto done;
+					}
+
+					arg += 2;
+				}
+				else
+				{
+					fprintf( stderr, "[ERROR] Missing required parameter for host quota option.\n" );
+					result = -1;
+					goto done;
+				}
+			}
+			else if( strcmp( "-e", argv[arg] ) == 0 || strcmp( "--hedge", argv[arg] ) == 0 )
+			{
+				if( (arg + 1) < argc )
+				{
+					char *hedge_bad_char = NULL;
+					args.hedge_delay = strtol( argv[arg + 1], &hedge_bad_char, 10 );
+
+					if( *hedge_bad_char || args.hedge_delay <= 0 )
+					{
+						fprintf( stderr, "[ERROR] Malformed hedge delay (it must be a positive number of milliseconds).\n" );
+						result = -1;
+						goto done;
+					}
+
+					arg += 2;
+				}
+				else
+				{
+					fprintf( stderr, "[ERROR] Missing required parameter for hedge option.\n" );
+					result = -1;
+					goto done;
+				}
+			}
 			else
 			{
 				console_fg_color_8( stderr, CONSOLE_COLOR8_RED );
@@ -239,6 +401,22 @@ int main( int argc, char* argv[] )
 		goto done;
 	}
 
+	if( args.filter && args.command != COMMAND_LIST )
+	{
+		fprintf( stderr, "[ERROR] The filter option can only be used when listing records.\n" );
+		about( argc, argv );
+		result = -2;
+		goto done;
+	}
+
+	if( args.delete_matching && !args.filter )
+	{
+		fprintf( stderr, "[ERROR] Deleting matching records requires a filter.\n" );
+		about( argc, argv );
+		result = -2;
+		goto done;
+	}
+
 	if( !args.username || *args.username == '\0' )
 	{
         fprintf( stderr, "[ERROR] The name.com username was not set.\n" );
@@ -247,6 +425,14 @@ int main( int argc, char* argv[] )
 		goto done;
 	}
 
+	if( args.stateless && args.reuse_session )
+	{
+		fprintf( stderr, "[ERROR] There is no session to reuse in stateless mode.\n" );
+		about( argc, argv );
+		result = -2;
+		goto done;
+	}
+
 	if( !args.token || *args.token == '\0' )
 	{
         fprintf( stderr, "[ERROR] The name.com API token was not set.\n" );
@@ -264,43 +450,206 @@ int main( int argc, char* argv[] )
 
 	curl_global_init(CURL_GLOBAL_DEFAULT);
 
+	if( args.cache )
+	{
+		cache = namecom_transport_cache_open( NULL, 0 );
+
+		if( !cache )
+		{
+			fprintf( stderr, "[WARNING] The transport cache is unavailable.\n" );
+		}
+	}
+
+	if( args.cache || args.snapshot_age > 0 )
+	{
+		snapshots = namecom_transport_cache_default_directory( snapshot_directory, sizeof(snapshot_directory) );
+
+		if( !snapshots )
+		{
+			fprintf( stderr, "[WARNING] Zone snapshots are unavailable.\n" );
+		}
+	}
+
+	namecom_api_auth_mode_t auth_mode = args.stateless ? NAMECOM_API_AUTH_STATELESS : NAMECOM_API_AUTH_SESSION;
+
 #if 1
-	namecom_api_t* api = namecom_api_create( args.username,  args.token, false, args.verbose );
+	namecom_api_t* api = namecom_api_create_with_auth( args.username,  args.token, false, args.verbose, auth_mode );
 #else
-	namecom_api_t* api = namecom_api_create( args.username, args.token, true, args.verbose );
+	namecom_api_t* api = namecom_api_create_with_auth( args.username, args.token, true, args.verbose, auth_mode );
 #endif
 
 	if( api )
 	{
-		if( !namecom_api_login( api ) )
+		if( cache )
 		{
-			fprintf( stderr, "[ERROR] Failed to login to name.com.\n" );
-			result = -4;
-			goto done;
+			namecom_api_set_transport_cache( api, cache );
+		}
+
+		if( snapshots )
+		{
+			namecom_api_set_zone_snapshots( api, snapshot_directory );
+		}
+
+		if( args.rate > 0.0 )
+		{
+			/* Pace bulk changes and let the server's responses set the concurrency. */
+			namecom_api_set_rate_limit( api, args.rate, args.rate );
+			namecom_api_set_adaptive_concurrency( api, true, 1 );
+		}
+
+		if( args.host_quota > 0.0 )
+		{
+			/* Every process of this user on this machine draws from the same budget. */
+			if( !namecom_api_set_host_quota( api, args.host_quota, args.host_quota ) )
+			{
+				fprintf( stderr, "[WARNING] The host-wide quota is unavailable.\n" );
+			}
+		}
+
+		if( args.hedge_delay > 0 )
+		{
+			/* Race a second listing against one slower than nearly all recent ones. */
+			namecom_api_set_hedging( api, 95.0, args.hedge_delay );
+		}
+
+		if( args.reuse_session )
+		{
+			char session_directory[ 1024 ];
+
+			if( !namecom_transport_cache_default_directory( session_directory, sizeof(session_directory) ) ||
+			    !namecom_api_set_session_cache( api, session_directory ) )
+			{
+				fprintf( stderr, "[WARNING] The session cache is unavailable.\n" );
+			}
+		}
+
+		/*
+		 * A recent enough snapshot from an earlier run stands in for
+		 * the listing; otherwise the listing refreshes it.  Commands that
+		 * change or delete records by id always work from a fresh
+		 * listing, as a snapshot may be out of date.
+		 */
+		namecom_zone_snapshot_t* snapshot = NULL;
+		namecom_record_set_t* fetched = NULL;
+		const namecom_record_set_t* records = NULL;
+
+		if( snapshots && args.snapshot_age > 0 && args.command == COMMAND_LIST && !args.delete_matching )
+		{
+			snapshot = namecom_zone_snapshot_open( snapshot_directory, args.domain, args.snapshot_age, time(NULL) );
+		}
+
+		/* Listing from a snapshot never talks to name.com, so it needs no login. */
+		bool logged_in = false;
+
+		if( !snapshot )
+		{
+			if( !namecom_api_login( api ) )
+			{
+				fprintf( stderr, "[ERROR] Failed to login to name.com.\n" );
+				timed_out = namecom_api_last_error( api ) == NAMECOM_API_ERROR_TIMEOUT;
+				namecom_zone_snapshot_close( snapshot );
+				namecom_api_destroy( api );
+				result = -4;
+				goto done;
+			}
+
+			logged_in = true;
 		}
 
+		if( snapshot )
+		{
+			records = namecom_zone_snapshot_records( snapshot );
 
-		namecom_api_dns_record_t** records = namecom_api_dns_record_list( api, args.domain );
+			if( args.verbose )
+			{
+				printf( "Using the snapshot of %s from %ld seconds ago.\n", args.domain, (long) (time(NULL) - namecom_zone_snapshot_created( snapshot )) );
+			}
+		}
+		else
+		{
+			fetched = namecom_api_dns_record_set( api, args.domain );
+			records = fetched;
+		}
 
 		if( !records )
 		{
 			fprintf( stderr, "[ERROR] Failed to retrieve records for %s.\n", args.domain );
+			timed_out = namecom_api_last_error( api ) == NAMECOM_API_ERROR_TIMEOUT;
+			namecom_api_destroy( api );
 			result = -2;
 			goto done;
 		}
 
 
+		namecom_zone_index_t* index = namecom_zone_index_build( records );
+
+		if( !index )
+		{
+			fprintf( stderr, "[ERROR] Out of memory!\n" );
+			namecom_record_set_destroy( fetched );
+			namecom_zone_snapshot_close( snapshot );
+			namecom_api_destroy( api );
+			result = -2;
+			goto done;
+		}
+
 		switch(args.command)
 		{
 			case COMMAND_LIST:
 			{
+				size_t* selection = NULL;
+				size_t selection_count = namecom_record_set_count( records );
+
+				if( args.filter )
+				{
+					/*
+					 * Patterns are relative to the domain unless they
+					 * already end with it.
+					 */
+					char pattern[ 512 ];
+					size_t filter_len = strlen( args.filter );
+					size_t domain_len = strlen( args.domain );
+
+					if( filter_len >= domain_len &&
+					    strcmp( args.filter + filter_len - domain_len, args.domain ) == 0 &&
+					    (filter_len == domain_len || args.filter[ filter_len - domain_len - 1 ] == '.') )
+					{
+						snprintf( pattern, sizeof(pattern), "%s", args.filter );
+					}
+					else
+					{
+						snprintf( pattern, sizeof(pattern), "%s.%s", args.filter, args.domain );
+					}
+
+					namecom_label_trie_t* trie = namecom_label_trie_build( records );
+					lc_vector_create( selection, 16 );
+
+					if( !trie || !selection )
+					{
+						fprintf( stderr, "[ERROR] Out of memory!\n" );
+						namecom_label_trie_destroy( trie );
+						if( selection ) lc_vector_destroy( selection );
+						result = -2;
+						break;
+					}
+
+					namecom_label_trie_subtree( trie, pattern, select_record, &selection );
+					namecom_label_trie_destroy( trie );
+
+					/* Show the matches in listing order. */
+					selection_count = lc_vector_size( selection );
+					qsort( selection, selection_count, sizeof(size_t), compare_records );
+				}
+
 				int max_fqdn_len = 8;
 				int max_content_len = 8;
-				for( int i = 0; i < lc_vector_size(records); i++ )
+				for( size_t i = 0; i < selection_count; i++ )
 				{
-					namecom_api_dns_record_t* r = records[ i ];
-					int fqdn_len = strlen(r->fqdn);
-					int content_len = strlen(r->content);
+					size_t r = selection ? selection[ i ] : i;
+					const char* fqdn    = namecom_record_set_fqdn( records, r );
+					const char* content = namecom_record_set_content( records, r );
+					int fqdn_len = fqdn ? strlen(fqdn) : 0;
+					int content_len = content ? strlen(content) : 0;
 
 					if( fqdn_len > max_fqdn_len )
 					{
@@ -330,10 +679,15 @@ int main( int argc, char* argv[] )
 				}
 				printf("\u2524\n");
 
-				for( int i = 0; i < lc_vector_size(records); i++ )
+				for( size_t i = 0; i < selection_count; i++ )
 				{
-					namecom_api_dns_record_t* r = records[ i ];
-					printf("\u2502 %5s  %-*s  %-*s  %5d  %-19s \u2502\n", r->type, max_fqdn_len, r->fqdn, max_content_len, r->content, r->ttl, r->create_date);
+					size_t r = selection ? selection[ i ] : i;
+					printf("\u2502 %5s  %-*s  %-*s  %5d  %-19s \u2502\n",
+					       namecom_record_set_type_name( records, r ),
+					       max_fqdn_len, namecom_record_set_fqdn( records, r ),
+					       max_content_len, namecom_record_set_content( records, r ),
+					       namecom_record_set_ttl( records, r ),
+					       namecom_record_set_create_date( records, r ));
 				}
 
 				// footer
@@ -355,13 +709,60 @@ int main( int argc, char* argv[] )
 				printf("+-%5s--%-*s--%-*s--%5s--%19s-+\n", "-----", max_fqdn_len, fqdn_border, max_content_len, content_border, "-----", "-------------------");
 				printf("| %5s  %-*s  %-*s  %5s  %-19s |\n", "Type", max_fqdn_len, "Host", max_content_len, "Answer", "TTL", "Created");
 				printf("+-%5s--%-*s--%-*s--%5s--%19s-+\n", "-----", max_fqdn_len, fqdn_border, max_content_len, content_border, "-----", "-------------------");
-				for( int i = 0; i < lc_vector_size(records); i++ )
+				for( size_t i = 0; i < selection_count; i++ )
 				{
-					namecom_api_dns_record_t* r = records[ i ];
-					printf("| %5s  %-*s  %-*s  %5d  %-19s |\n", r->type, max_fqdn_len, r->fqdn, max_content_len, r->content, r->ttl, r->create_date);
+					size_t r = selection ? selection[ i ] : i;
+					printf("| %5s  %-*s  %-*s  %5d  %-19s |\n",
+					       namecom_record_set_type_name( records, r ),
+					       max_fqdn_len, namecom_record_set_fqdn( records, r ),
+					       max_content_len, namecom_record_set_content( records, r ),
+					       namecom_record_set_ttl( records, r ),
+					       namecom_record_set_create_date( records, r ));
 				}
 				printf("+-%5s--%-*s--%-*s--%5s--%19s-+\n", "-----", max_fqdn_len, fqdn_border, max_content_len, content_border, "-----", "-------------------");
 #endif
+
+				if( args.delete_matching )
+				{
+					/* Queue all of the deletions and let them run concurrently. */
+					namecom_api_request_t** requests = malloc( (selection_count > 0 ? selection_count : 1) * sizeof(namecom_api_request_t*) );
+					size_t deleted = 0;
+
+					if( requests )
+					{
+						for( size_t i = 0; i < selection_count; i++ )
+						{
+							requests[ i ] = namecom_api_submit_dns_record_remove( api, args.domain, namecom_record_set_id( records, selection[ i ] ), NULL, NULL );
+						}
+
+						namecom_api_wait( api, NULL );
+
+						for( size_t i = 0; i < selection_count; i++ )
+						{
+							if( requests[ i ] && namecom_api_request_succeeded( requests[ i ] ) )
+							{
+								deleted += 1;
+							}
+							else
+							{
+								fprintf( stderr, "[ERROR] Failed to delete record (%s).\n", namecom_record_set_fqdn( records, selection[ i ] ) );
+								timed_out = timed_out || (requests[ i ] && namecom_api_request_error( requests[ i ] ) == NAMECOM_API_ERROR_TIMEOUT);
+							}
+
+							namecom_api_request_destroy( requests[ i ] );
+						}
+
+						free( requests );
+					}
+					else
+					{
+						fprintf( stderr, "[ERROR] Out of memory!\n" );
+					}
+
+					printf( "Deleted %zu of %zu records.\n", deleted, selection_count );
+				}
+
+				if( selection ) lc_vector_destroy( selection );
 				break;
 			}
 			case COMMAND_SET:
@@ -369,30 +770,32 @@ int main( int argc, char* argv[] )
 				long record_id = -1;
 				bool record_exists = false;
 
-				for( int i = 0; i < lc_vector_size(records); i++ )
-				{
-					namecom_api_dns_record_t* r = records[ i ];
-					char record_fqdn[ 256 ];
-					snprintf( record_fqdn, sizeof(record_fqdn), "%s.%s", args.host, args.domain );
-					record_fqdn[ sizeof(record_fqdn) - 1 ] = '\0';
+				char record_fqdn[ 256 ];
+				snprintf( record_fqdn, sizeof(record_fqdn), "%s.%s", args.host, args.domain );
+				record_fqdn[ sizeof(record_fqdn) - 1 ] = '\0';
 
-					if( strcmp(r->fqdn, record_fqdn) == 0 )
-					{
-						record_id = r->id;
-						record_exists = true;
-					}
+				long record = namecom_zone_index_find_last( index, record_fqdn, NAMECOM_RECORD_TYPE_UNKNOWN );
+
+				if( record >= 0 )
+				{
+					record_id = namecom_record_set_id( records, record );
+					record_exists = true;
 				}
 
 				if( record_exists )
 				{
-					if( namecom_api_dns_record_remove( api, args.domain, record_id ) &&
-						namecom_api_dns_record_add( api, args.domain, args.host, args.type, args.answer, args.ttl, 10, &record_id ) )
+					/* Update in place; removing and adding is only for servers without the update command. */
+					if( namecom_api_dns_record_update( api, args.domain, record_id, args.host, args.type, args.answer, args.ttl, 10 ) ||
+					    (namecom_api_last_error( api ) == NAMECOM_API_ERROR_UNSUPPORTED &&
+					     namecom_api_dns_record_remove( api, args.domain, record_id ) &&
+					     namecom_api_dns_record_add( api, args.domain, args.host, args.type, args.answer, args.ttl, 10, &record_id )) )
 					{
 						printf( "Record updated.\n" );
 					}
 					else
 					{
 						fprintf( stderr, "[ERROR] Failed to update record.\n" );
+						timed_out = namecom_api_last_error( api ) == NAMECOM_API_ERROR_TIMEOUT;
 					}
 				}
 				else
@@ -404,6 +807,7 @@ int main( int argc, char* argv[] )
 					else
 					{
 						fprintf( stderr, "[ERROR] Failed to create record (%s.%s --> %s).\n", args.host, args.domain, args.answer );
+						timed_out = namecom_api_last_error( api ) == NAMECOM_API_ERROR_TIMEOUT;
 					}
 				}
 
@@ -414,18 +818,16 @@ int main( int argc, char* argv[] )
 				long record_id = -1;
 				bool record_exists = false;
 
-				for( int i = 0; i < lc_vector_size(records); i++ )
-				{
-					namecom_api_dns_record_t* r = records[ i ];
-					char record_fqdn[ 256 ];
-					snprintf( record_fqdn, sizeof(record_fqdn), "%s.%s", args.host, args.domain );
-					record_fqdn[ sizeof(record_fqdn) - 1 ] = '\0';
+				char record_fqdn[ 256 ];
+				snprintf( record_fqdn, sizeof(record_fqdn), "%s.%s", args.host, args.domain );
+				record_fqdn[ sizeof(record_fqdn) - 1 ] = '\0';
 
-					if( strcmp(r->fqdn, record_fqdn) == 0 )
-					{
-						record_id = r->id;
-						record_exists = true;
-					}
+				long record = namecom_zone_index_find_last( index, record_fqdn, NAMECOM_RECORD_TYPE_UNKNOWN );
+
+				if( record >= 0 )
+				{
+					record_id = namecom_record_set_id( records, record );
+					record_exists = true;
 				}
 
 				if( record_exists )
@@ -440,6 +842,7 @@ int main( int argc, char* argv[] )
 					else
 					{
 						fprintf( stderr, "[ERROR] Failed to delete record (%s.%s).\n", args.host, args.domain );
+						timed_out = namecom_api_last_error( api ) == NAMECOM_API_ERROR_TIMEOUT;
 					}
 
 				}
@@ -455,14 +858,86 @@ int main( int argc, char* argv[] )
 				break;
 		}
 
-		if( records ) lc_vector_destroy( records );
-		namecom_api_logout( api );
+		namecom_zone_index_destroy( index );
+		namecom_record_set_destroy( fetched );
+		namecom_zone_snapshot_close( snapshot );
+
+		if( logged_in )
+		{
+			namecom_api_logout( api );
+		}
+
+		if( args.verbose )
+		{
+			namecom_api_connection_stats_t stats;
+			namecom_api_connection_stats( api, &stats );
+			printf( "Requests: %lu (connections created: %lu, connections reused: %lu)\n", stats.requests, stats.connections_created, stats.connections_reused );
+
+			if( stats.retries > 0 || stats.retries_denied > 0 )
+			{
+				printf( "Retries: %lu (%lu more refused by the retry budget)\n", stats.retries, stats.retries_denied );
+			}
+
+			if( stats.hedges > 0 )
+			{
+				printf( "Hedges: %lu sent, %lu answered first\n", stats.hedges, stats.hedges_won );
+			}
+
+			namecom_api_breaker_stats_t breaker;
+			namecom_api_breaker_stats( api, &breaker );
+
+			if( breaker.opened > 0 )
+			{
+				printf( "Circuit breaker: %s (opened %lu times, %lu probes answered, %lu requests refused)\n",
+				        breaker.state == NAMECOM_API_BREAKER_CLOSED ? "closed" : breaker.state == NAMECOM_API_BREAKER_OPEN ? "open" : "half-open",
+				        breaker.opened, breaker.closed, breaker.rejected );
+			}
+
+			if( args.rate > 0.0 || args.host_quota > 0.0 )
+			{
+				namecom_api_limiter_stats_t limiter;
+				namecom_api_limiter_stats( api, &limiter );
+				printf( "Limiter: %.1f requests/s, concurrency %zu (raised %lu, halved %lu times), held back %lu times waiting for the rate and %lu for concurrency\n",
+				        limiter.rate, limiter.concurrency_limit, limiter.increases, limiter.decreases, limiter.throttled, limiter.capped );
+
+				if( limiter.host_quota )
+				{
+					printf( "Host quota: %.1f requests available, held back %lu times\n", limiter.host_tokens, limiter.host_throttled );
+				}
+			}
+		}
+
 		namecom_api_destroy( api );
 	}
 
+	if( cache )
+	{
+		if( args.verbose )
+		{
+			namecom_transport_cache_stats_t stats;
+			namecom_transport_cache_stats( cache, &stats );
+			printf( "Transport cache: %u addresses, %u TLS sessions loaded (cached address used: %s, TLS resumption attempted: %s)\n",
+			        stats.dns_entries_loaded, stats.tls_sessions_loaded,
+			        stats.dns_cache_used ? "yes" : "no",
+			        stats.tls_resumption_attempted ? "yes" : "no" );
+		}
+
+		namecom_transport_cache_save( cache );
+		namecom_transport_cache_close( cache );
+		cache = NULL;
+	}
+
 	curl_global_cleanup();
 
 done:
+	if( timed_out )
+	{
+		/* The handle only prints timeouts when verbose, so they are reported here. */
+		fprintf( stderr, "[ERROR] A request timed out.\n" );
+		result = -5;
+	}
+
+	if( cache ) namecom_transport_cache_close( cache );
 	if( args.host )   free( args.host );
 	if( args.domain ) free( args.domain );
 	if( args.type )   free( args.type );
@@ -470,6 +945,20 @@ done:
 	return result;
 }
 
+bool select_record( size_t record, void* user_data )
+{
+	size_t** selection = user_data;
+	lc_vector_push( *selection, record );
+	return true;
+}
+
+int compare_records( const void* l, const void* r )
+{
+	size_t left  = *(const size_t*) l;
+	size_t right = *(const size_t*) r;
+	return (left > right) - (left < right);
+}
+
 void banner( void )
 {
 	console_fg_color_8( stdout, CONSOLE_COLOR8_BRIGHT_GREEN );
@@ -520,9 +1009,19 @@ void about( int argc, char* argv[] )
 	printf( "Command Line Options:\n" );
 	printf( "    %-2s, %-12s   %-50s\n", "-u", "--username", "The name.com username." );
 	printf( "    %-2s, %-12s   %-50s\n", "-t", "--token", "The name.com API token." );
+	printf( "    %-2s, %-12s   %-50s\n", "-v", "--verbose", "Print verbose diagnostics." );
+	printf( "    %-2s, %-12s   %-50s\n", "-c", "--cache", "Reuse addresses and TLS sessions and save zone snapshots across runs." );
+	printf( "    %-2s, %-12s   %-50s\n", "-r", "--reuse-session", "Keep the session open and reuse it on the next run." );
+	printf( "    %-2s, %-12s   %-50s\n", "-n", "--stateless", "Authenticate each request instead of logging in and out." );
 	printf( "    %-2s, %-12s   %-50s\n", "-l", "--list", "List DNS records for domain." );
 	printf( "    %-2s, %-12s   %-50s\n", "-s", "--set", "Set a DNS record." );
 	printf( "    %-2s, %-12s   %-50s\n", "-d", "--delete", "Delete a DNS record." );
+	printf( "    %-2s, %-12s   %-50s\n", "-f", "--filter", "Only list records at or below names matching a pattern (e.g. pop-*.edge)." );
+	printf( "    %-2s, %-12s   %-50s\n", "-x", "--delete-matching", "Delete the records selected by the filter." );
+	printf( "    %-2s, %-12s   %-50s\n", "-z", "--snapshot-age", "Reuse a zone listing saved by another run within this many seconds (plain listings only)." );
+	printf( "    %-2s, %-12s   %-50s\n", "-p", "--rate", "Send at most this many requests per second and adapt concurrency to the server." );
+	printf( "    %-2s, %-12s   %-50s\n", "-q", "--host-quota", "Share a budget of this many requests per second with every process on this host." );
+	printf( "    %-2s, %-12s   %-50s\n", "-e", "--hedge", "Send a second listing if the first takes longer than this many milliseconds." );
 	printf( "\n\n" );
 
 	printf( "If you don't already have a Name.com API token, then you may apply for\n" );
@@ -30,6 +30,8 @@
 #include <collections/vector.h>
 #include "ipify.h"
 #include "namecom_api.h"
+#include "namecom_record_set.h"
+#include "namecom_zone_index.h"
 
 #define VERSION  "1.0"
 
@@ -45,12 +47,18 @@ typedef struct {
 	const char* username;
 	const char* token;
 	bool verbose;
+	bool cache;
+	bool reuse_session;
+	bool stateless;
+	double host_quota;
+	double timeout;
 } app_args_t;
 
 
 int main( int argc, char* argv[] )
 {
 	int result = 0;
+	namecom_transport_cache_t* cache = NULL;
 
 	app_args_t args = {
 		.host       = NULL,
@@ -58,8 +66,15 @@ int main( int argc, char* argv[] )
 		.ip_address = NULL,
 		.username   = getenv( "NAMECOM_USERNAME" ),
 		.token      = getenv( "NAMECOM_API_TOKEN" ),
-		.verbose    = false
+		.verbose    = false,
+		.cache      = false,
+		.reuse_session = false,
+		.stateless  = false,
+		.host_quota = 0.0,
+		.timeout    = 0.0
 	};
+	long long deadline_ms = 0;
+	bool timed_out = false;
 
 	const char* fqdn = getenv( "NAMECOM_HOST" );
 
@@ -153,6 +168,68 @@ int main( int argc, char* argv[] )
 					goto done;
 				}
 			}
+			else if( strcmp( "-v", argv[arg] ) == 0 || strcmp( "--verbose", argv[arg] ) == 0 )
+			{
+				args.verbose = true;
+			}
+			else if( strcmp( "-c", argv[arg] ) == 0 || strcmp( "--cache", argv[arg] ) == 0 )
+			{
+				args.cache = true;
+			}
+			else if( strcmp( "-r", argv[arg] ) == 0 || strcmp( "--reuse-session", argv[arg] ) == 0 )
+			{
+				args.reuse_session = true;
+			}
+			else if( strcmp( "-n", argv[arg] ) == 0 || strcmp( "--stateless", argv[arg] ) == 0 )
+			{
+				args.stateless = true;
+			}
+			else if( strcmp( "-q", argv[arg] ) == 0 || strcmp( "--host-quota", argv[arg] ) == 0 )
+			{
+				if( (arg + 1) < argc )
+				{
+					char *quota_bad_char = NULL;
+					args.host_quota = strtod( argv[arg + 1], &quota_bad_char );
+
+					if( *quota_bad_char || args.host_quota <= 0.0 )
+					{
+						fprintf( stderr, "[ERROR] Malformed host quota (it must be a positive number of requests per second).\n" );
+						result = -1;
+						goto done;
+					}
+
+					arg++;
+				}
+				else
+				{
+					fprintf( stderr, "[ERROR] The host quota argument is missing.\n" );
+					result = -1;
+					goto done;
+				}
+			}
+			else if( strcmp( "-T", argv[arg] ) == 0 || strcmp( "--timeout", argv[arg] ) == 0 )
+			{
+				if( (arg + 1) < argc )
+				{
+					char *timeout_bad_char = NULL;
+					args.timeout = strtod( argv[arg + 1], &timeout_bad_char );
+
+					if( *timeout_bad_char || args.timeout <= 0.0 )
+					{
+						fprintf( stderr, "[ERROR] Malformed timeout (it must be a positive number of seconds).\n" );
+						result = -1;
+						goto done;
+					}
+
+					arg++;
+				}
+				else
+				{
+					fprintf( stderr, "[ERROR] The timeout argument is missing.\n" );
+					result = -1;
+					goto done;
+				}
+			}
 			else
 			{
 				console_fg_color_8( stderr, CONSOLE_COLOR8_RED );
@@ -183,6 +260,14 @@ int main( int argc, char* argv[] )
 		goto done;
 	}
 
+	if( args.stateless && args.reuse_session )
+	{
+		fprintf( stderr, "[ERROR] There is no session to reuse in stateless mode.\n" );
+		about( argc, argv );
+		result = -2;
+		goto done;
+	}
+
 	if( !args.token || *args.token == '\0' )
 	{
         fprintf( stderr, "[ERROR] The name.com API token was not set.\n" );
@@ -197,32 +282,94 @@ int main( int argc, char* argv[] )
 
 	curl_global_init(CURL_GLOBAL_DEFAULT);
 
+	if( args.timeout > 0.0 )
+	{
+		/* One budget for the whole run, from finding our address to logging out. */
+		deadline_ms = namecom_api_clock_ms() + (long long) (args.timeout * 1000.0);
+	}
+
+	if( args.cache )
+	{
+		cache = namecom_transport_cache_open( NULL, 0 );
+
+		if( !cache )
+		{
+			fprintf( stderr, "[WARNING] The transport cache is unavailable.\n" );
+		}
+	}
+
 	if( !args.ip_address )
 	{
 		// If no IP address is passed then try to figure out the
 		// public IP address.
-		args.ip_address = ipify_public_ip();
+		long timeout_ms = 0;
+
+		if( deadline_ms > 0 )
+		{
+			long long remaining_ms = deadline_ms - namecom_api_clock_ms();
+			timeout_ms = remaining_ms > 0 ? (long) remaining_ms : 1;
+		}
+
+		args.ip_address = ipify_public_ip( cache, timeout_ms, &timed_out );
 
 		if( !args.ip_address )
 		{
 			fprintf( stderr, "[ERROR] Failed to determine public IP address.\n" );
-			result = -3;
+			result = timed_out ? -5 : -3;
 			goto done;
 		}
 	}
 
+	namecom_api_auth_mode_t auth_mode = args.stateless ? NAMECOM_API_AUTH_STATELESS : NAMECOM_API_AUTH_SESSION;
+
 #if 1
-	namecom_api_t* api = namecom_api_create( args.username,  args.token, false, args.verbose );
+	namecom_api_t* api = namecom_api_create_with_auth( args.username,  args.token, false, args.verbose, auth_mode );
 #else
-	namecom_api_t* api = namecom_api_create( args.username, args.token, true, args.verbose );
+	namecom_api_t* api = namecom_api_create_with_auth( args.username, args.token, true, args.verbose, auth_mode );
 #endif
 
 	if( api )
 	{
+		namecom_api_set_deadline( api, deadline_ms );
+
+		if( cache )
+		{
+			char snapshot_directory[ 1024 ];
+
+			namecom_api_set_transport_cache( api, cache );
+
+			/* Share what this run lists with the dns tool's --snapshot-age. */
+			if( namecom_transport_cache_default_directory( snapshot_directory, sizeof(snapshot_directory) ) )
+			{
+				namecom_api_set_zone_snapshots( api, snapshot_directory );
+			}
+		}
+
+		if( args.host_quota > 0.0 )
+		{
+			/* Keep many dyndns jobs on one machine under a single budget. */
+			if( !namecom_api_set_host_quota( api, args.host_quota, args.host_quota ) )
+			{
+				fprintf( stderr, "[WARNING] The host-wide quota is unavailable.\n" );
+			}
+		}
+
+		if( args.reuse_session )
+		{
+			char session_directory[ 1024 ];
+
+			if( !namecom_transport_cache_default_directory( session_directory, sizeof(session_directory) ) ||
+			    !namecom_api_set_session_cache( api, session_directory ) )
+			{
+				fprintf( stderr, "[WARNING] The session cache is unavailable.\n" );
+			}
+		}
+
 		if( !namecom_api_login( api ) )
 		{
 			fprintf( stderr, "[ERROR] Failed to login to name.com.\n" );
-			result = -4;
+			result = namecom_api_last_error( api ) == NAMECOM_API_ERROR_TIMEOUT ? -5 : -4;
+			namecom_api_destroy( api );
 			goto done;
 		}
 
@@ -230,46 +377,53 @@ int main( int argc, char* argv[] )
 		bool record_exists = false;
 		bool record_needs_update = false;
 
-		namecom_api_dns_record_t** records = namecom_api_dns_record_list( api, args.domain );
+		namecom_record_set_t* records = namecom_api_dns_record_set( api, args.domain );
 
 		if( records )
 		{
-			for( int i = 0; i < lc_vector_size(records); i++ )
+			namecom_zone_index_t* index = namecom_zone_index_build( records );
+			char record_fqdn[ 256 ];
+			snprintf( record_fqdn, sizeof(record_fqdn), "%s.%s", args.host, args.domain );
+			record_fqdn[ sizeof(record_fqdn) - 1 ] = '\0';
+
+			long record = index ? namecom_zone_index_find_last( index, record_fqdn, NAMECOM_RECORD_TYPE_UNKNOWN ) : -1;
+
+			if( record >= 0 )
 			{
-				namecom_api_dns_record_t* r = records[ i ];
-				char record_fqdn[ 256 ];
-				snprintf( record_fqdn, sizeof(record_fqdn), "%s.%s", args.host, args.domain );
-				record_fqdn[ sizeof(record_fqdn) - 1 ] = '\0';
+				const char* content = namecom_record_set_content( records, record );
 
-				if( strcmp(r->fqdn, record_fqdn) == 0 )
-				{
-					record_id = r->id;
-					record_exists = true;
+				record_id = namecom_record_set_id( records, record );
+				record_exists = true;
 
-					if( strcmp(r->content, args.ip_address) != 0 )
-					{
-						record_needs_update = true;
-					}
+				if( !content || strcmp(content, args.ip_address) != 0 )
+				{
+					record_needs_update = true;
 				}
 			}
 
-			lc_vector_destroy( records );
+			namecom_zone_index_destroy( index );
+			namecom_record_set_destroy( records );
 		}
 		else
 		{
 			fprintf( stderr, "[ERROR] Failed to list records.\n" );
+			timed_out = namecom_api_last_error( api ) == NAMECOM_API_ERROR_TIMEOUT;
 		}
 
 		if( record_needs_update )
 		{
-			if( namecom_api_dns_record_remove( api, args.domain, record_id ) &&
-				namecom_api_dns_record_add( api, args.domain, args.host, "A", args.ip_address, 60, 10, &record_id ) )
+			/* Update in place; removing and adding is only for servers without the update command. */
+			if( namecom_api_dns_record_update( api, args.domain, record_id, args.host, "A", args.ip_address, 60, 10 ) ||
+			    (namecom_api_last_error( api ) == NAMECOM_API_ERROR_UNSUPPORTED &&
+			     namecom_api_dns_record_remove( api, args.domain, record_id ) &&
+			     namecom_api_dns_record_add( api, args.domain, args.host, "A", args.ip_address, 60, 10, &record_id )) )
 			{
 				printf( "Record updated.\n" );
 			}
 			else
 			{
 				fprintf( stderr, "[ERROR] Failed to update record.\n" );
+				timed_out = namecom_api_last_error( api ) == NAMECOM_API_ERROR_TIMEOUT;
 			}
 		}
 		else if( !record_exists )
@@ -281,6 +435,7 @@ int main( int argc, char* argv[] )
 			else
 			{
 				fprintf( stderr, "[ERROR] Failed to create record (%s.%s --> %s).\n", args.host, args.domain, args.ip_address );
+				timed_out = namecom_api_last_error( api ) == NAMECOM_API_ERROR_TIMEOUT;
 			}
 		}
 		else
@@ -289,12 +444,68 @@ int main( int argc, char* argv[] )
 		}
 
 		namecom_api_logout( api );
+
+		if( args.verbose )
+		{
+			namecom_api_connection_stats_t stats;
+			namecom_api_connection_stats( api, &stats );
+			printf( "Requests: %lu (connections created: %lu, connections reused: %lu)\n", stats.requests, stats.connections_created, stats.connections_reused );
+
+			if( stats.retries > 0 || stats.retries_denied > 0 )
+			{
+				printf( "Retries: %lu (%lu more refused by the retry budget)\n", stats.retries, stats.retries_denied );
+			}
+
+			namecom_api_breaker_stats_t breaker;
+			namecom_api_breaker_stats( api, &breaker );
+
+			if( breaker.opened > 0 )
+			{
+				printf( "Circuit breaker: %s (opened %lu times, %lu probes answered, %lu requests refused)\n",
+				        breaker.state == NAMECOM_API_BREAKER_CLOSED ? "closed" : breaker.state == NAMECOM_API_BREAKER_OPEN ? "open" : "half-open",
+				        breaker.opened, breaker.closed, breaker.rejected );
+			}
+		}
+
 		namecom_api_destroy( api );
+
+		if( timed_out )
+		{
+			/* Without -T, a request ran into the handle's own timeout. */
+			if( args.timeout > 0.0 )
+			{
+				fprintf( stderr, "[ERROR] Ran out of time after %g seconds.\n", args.timeout );
+			}
+			else
+			{
+				fprintf( stderr, "[ERROR] A request timed out.\n" );
+			}
+
+			result = -5;
+		}
+	}
+
+	if( cache )
+	{
+		if( args.verbose )
+		{
+			namecom_transport_cache_stats_t stats;
+			namecom_transport_cache_stats( cache, &stats );
+			printf( "Transport cache: %u addresses, %u TLS sessions loaded (cached address used: %s, TLS resumption attempted: %s)\n",
+			        stats.dns_entries_loaded, stats.tls_sessions_loaded,
+			        stats.dns_cache_used ? "yes" : "no",
+			        stats.tls_resumption_attempted ? "yes" : "no" );
+		}
+
+		namecom_transport_cache_save( cache );
+		namecom_transport_cache_close( cache );
+		cache = NULL;
 	}
 
 	curl_global_cleanup();
 
 done:
+	if( cache ) namecom_transport_cache_close( cache );
 	if( args.host )       free( args.host );
 	if( args.domain )     free( args.domain );
 	if( args.ip_address ) free( args.ip_address );
@@ -349,6 +560,12 @@ void about( int argc, char* argv[] )
 	printf( "Command Line Options:\n" );
 	printf( "    %-2s, %-12s   %-50s\n", "-u", "--username", "The name.com username." );
 	printf( "    %-2s, %-12s   %-50s\n", "-t", "--token", "The name.com API token." );
+	printf( "    %-2s, %-12s   %-50s\n", "-v", "--verbose", "Print verbose diagnostics." );
+	printf( "    %-2s, %-12s   %-50s\n", "-c", "--cache", "Reuse addresses and TLS sessions and save zone snapshots across runs." );
+	printf( "    %-2s, %-12s   %-50s\n", "-r", "--reuse-session", "Keep the session open and reuse it on the next run." );
+	printf( "    %-2s, %-12s   %-50s\n", "-n", "--stateless", "Authenticate each request instead of logging in and out." );
+	printf( "    %-2s, %-12s   %-50s\n", "-q", "--host-quota", "Share a budget of this many requests per second with every process on this host." );
+	printf( "    %-2s, %-12s   %-50s\n", "-T", "--timeout", "Give up if the whole update takes longer than this many seconds." );
 	printf( "    %-2s, %-12s   %-50s\n", "-h", "--host", "The DNS record's hostname to update." );
 	//printf( "    %-2s, %-12s   %-50s\n", "-d", "--domain", "The domain name." );
 	printf( "    %-2s, %-12s   %-50s\n", "-a", "--ip-address", "An optional IP address to use." );
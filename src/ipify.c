@@ -23,6 +23,10 @@
 #include <stdio.h>
 #include <string.h>
 #include <curl/curl.h>
+#include "ipify.h"
+
+#define IPIFY_CONNECT_TIMEOUT_MS  10000
+#define IPIFY_DEFAULT_TIMEOUT_MS  30000   /* so that a peer that stalls can't hang a run */
 
 typedef struct response_body {
 	size_t len;
@@ -49,14 +53,19 @@ static size_t ipify_writefunc( void *ptr, size_t size, size_t nmemb, void* userd
 	return size * nmemb;
 }
 
-char* ipify_public_ip( void )
+char* ipify_public_ip( namecom_transport_cache_t* cache, long timeout_ms, bool* timed_out )
 {
 	char* result = NULL;
 	CURL* curl = curl_easy_init();
 
+	if( timed_out )
+	{
+		*timed_out = false;
+	}
+
 	if( curl )
 	{
-		curl_easy_setopt( curl, CURLOPT_URL, "http://api.ipify.org?format=text" );
+		curl_easy_setopt( curl, CURLOPT_URL, "https://api.ipify.org?format=text" );
 
 		//char header_user_agent[ 256 ];
 		//snprintf( header_user_agent, sizeof(header_user_agent), "User-Agent: %s v%s", NAMECOM_API_USERAGENT, NAMECOM_API_VERSION );
@@ -72,6 +81,14 @@ char* ipify_public_ip( void )
 		curl_easy_setopt( curl, CURLOPT_WRITEFUNCTION, ipify_writefunc );
 		curl_easy_setopt( curl, CURLOPT_WRITEDATA, &response_body );
 
+		/*
+		 * The answer decides where our DNS records point, so it is fetched
+		 * over verified TLS rather than plain HTTP.
+		 */
+		curl_easy_setopt( curl, CURLOPT_SSL_VERIFYPEER, 1L );
+		curl_easy_setopt( curl, CURLOPT_SSL_VERIFYHOST, 2L );
+
+		#ifdef SKIP_PEER_VERIFICATION
 		/*
 		 * If you want to connect to a site who isn't using a certificate that is
 		 * signed by one of the certs in the CA bundle you have, you can skip the
@@ -83,7 +100,9 @@ char* ipify_public_ip( void )
 		 * you.
 		 */
 		curl_easy_setopt( curl, CURLOPT_SSL_VERIFYPEER, 0L );
+		#endif
 
+		#ifdef SKIP_HOSTNAME_VERIFICATION
 		/*
 		 * If the site you're connecting to uses a different host name that what
 		 * they have mentioned in their server certificate's commonName (or
@@ -91,16 +110,49 @@ char* ipify_public_ip( void )
 		 * this check, but this will make the connection less secure.
 		 */
 		curl_easy_setopt( curl, CURLOPT_SSL_VERIFYHOST, 0L );
+		#endif
+
+		/* Connecting includes the TLS handshake. */
+		long connect_timeout_ms = IPIFY_CONNECT_TIMEOUT_MS;
+
+		if( timeout_ms <= 0 )
+		{
+			timeout_ms = IPIFY_DEFAULT_TIMEOUT_MS;
+		}
+
+		if( timeout_ms > 0 && timeout_ms < connect_timeout_ms )
+		{
+			connect_timeout_ms = timeout_ms;
+		}
+
+		curl_easy_setopt( curl, CURLOPT_CONNECTTIMEOUT_MS, connect_timeout_ms );
+		curl_easy_setopt( curl, CURLOPT_TIMEOUT_MS, timeout_ms );
+
+		if( cache )
+		{
+			namecom_transport_cache_attach( cache, curl );
+		}
 
 		CURLcode res = curl_easy_perform( curl );
 
 		if( res == CURLE_OK )
 		{
 			result = response_body.text;
+
+			if( cache )
+			{
+				namecom_transport_cache_observe( cache, curl );
+			}
 		}
 		else
 		{
 			fprintf(stderr, "[ERROR] %s\n", curl_easy_strerror(res));
+			free( response_body.text );
+
+			if( timed_out )
+			{
+				*timed_out = res == CURLE_OPERATION_TIMEDOUT;
+			}
 		}
 
 		/* always cleanup */
@@ -22,6 +22,15 @@
 #ifndef _IPIFY_H_
 #define _IPIFY_H_
 
-char* ipify_public_ip( void );
+#include "namecom_transport_cache.h"
+
+#include <stdbool.h>
+
+/*
+ * Asks ipify for our public address.  timeout_ms bounds the whole lookup
+ * (0 bounds it by a default of 30 seconds), and *timed_out, if given,
+ * tells whether a failure was down to it.
+ */
+char* ipify_public_ip( namecom_transport_cache_t* cache, long timeout_ms, bool* timed_out );
 
 #endif /* _IPIFY_H_ */
@@ -19,18 +19,38 @@
  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
  * THE SOFTWARE.
  */
+#define _POSIX_C_SOURCE 200809L
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <errno.h>
+#include <stdarg.h>
 #include <signal.h>
+#include <pthread.h>
 #include <curl/curl.h>
 #include "namecom_api.h"
+#include "namecom_record_decoder.h"
+#include "namecom_record_set.h"
+#include "namecom_session_cache.h"
+#include "namecom_host_quota.h"
+#include "namecom_zone_cache.h"
+#include "namecom_zone_snapshot.h"
 #include <jansson.h>
 #include <xtd/string.h>
 #include <collections/vector.h>
 
+/* The tests build the library against a local server instead. */
+#ifndef NAMECOM_API_SCHEME
+#define NAMECOM_API_SCHEME        "https"
+#endif
+#ifndef NAMECOM_API_SERVER_DEV
 #define NAMECOM_API_SERVER_DEV    "api.dev.name.com"
+#endif
+#ifndef NAMECOM_API_SERVER_REL
 #define NAMECOM_API_SERVER_REL    "api.name.com"
+#endif
 #define NAMECOM_API_USERAGENT     "Name.com Dynamic DNS Client"
 
 #define NAMECOM_API_RESPONSE_CODE_COMMAND_SUCCESSFUL         100
@@ -44,41 +64,583 @@
 #define NAMECOM_API_RESPONSE_CODE_INSUFFICIENT_FUNDS         260
 #define NAMECOM_API_RESPONSE_CODE_UNABLE_TO_AUTHORIZE_FUNDS  261
 
+#define NAMECOM_API_DEFAULT_MAX_CONCURRENCY  8
+#define NAMECOM_API_LIMITER_POLL_MS          10    /* how often a transport held back by another's requests looks again */
+#define NAMECOM_API_LIMITER_LATENCY_SLACK_MS 25.0  /* latency below baseline plus this never counts as slow */
+#define NAMECOM_API_DEFAULT_MAX_STREAMS      100
+#define NAMECOM_API_DEFAULT_RETRY_ATTEMPTS   3
+#define NAMECOM_API_DEFAULT_RETRY_BASE_MS    200
+#define NAMECOM_API_DEFAULT_RETRY_MAX_MS     10000
+#define NAMECOM_API_DEFAULT_RETRY_BUDGET     10.0
+#define NAMECOM_API_DEFAULT_RETRY_RATIO      0.1
+#define NAMECOM_API_DEFAULT_BREAKER_FAILURES 5
+#define NAMECOM_API_DEFAULT_BREAKER_RATE     0.5
+#define NAMECOM_API_DEFAULT_BREAKER_WINDOW   20
+#define NAMECOM_API_DEFAULT_BREAKER_OPEN_MS  30000
+#define NAMECOM_API_BREAKER_MAX_WINDOW       64    /* outcomes are kept as the bits of a word */
+#define NAMECOM_API_DEFAULT_CONNECT_TIMEOUT_MS  10000
+#define NAMECOM_API_DEFAULT_TIMEOUT_MS          60000
+#define NAMECOM_API_HEDGE_SAMPLES            64    /* read latencies the hedge delay is taken from */
+#define NAMECOM_API_HEDGE_MIN_SAMPLES        16    /* until then the minimum delay is used */
+#define NAMECOM_API_HEDGE_UPDATE_INTERVAL    8     /* samples between recomputing the delay */
+#define NAMECOM_API_CA_CACHE_TIMEOUT         (24L * 60L * 60L)
+#define NAMECOM_API_SCRATCH_MIN_CAPACITY     256
+#define NAMECOM_API_SCRATCH_RETAIN_CAPACITY  (1024 * 1024)
+#define NAMECOM_API_MAX_FREE_REQUESTS        64
+
+typedef enum namecom_api_endpoint {
+	NAMECOM_API_ENDPOINT_LOGIN = 0,
+	NAMECOM_API_ENDPOINT_LOGOUT,
+	NAMECOM_API_ENDPOINT_HELLO,
+	NAMECOM_API_ENDPOINT_DOMAINS_LIST,
+	NAMECOM_API_ENDPOINT_DNS_RECORD_LIST,
+	NAMECOM_API_ENDPOINT_DNS_RECORD_ADD,
+	NAMECOM_API_ENDPOINT_DNS_RECORD_REMOVE,
+	NAMECOM_API_ENDPOINT_DNS_RECORD_UPDATE,
+	NAMECOM_API_ENDPOINT_COUNT
+} namecom_api_endpoint_t;
+
+typedef enum namecom_api_request_state {
+	NAMECOM_API_REQUEST_QUEUED = 0,
+	NAMECOM_API_REQUEST_ACTIVE,
+	NAMECOM_API_REQUEST_AUTHENTICATING,   /* waiting for a new session before running again */
+	NAMECOM_API_REQUEST_BACKING_OFF,      /* waiting out a backoff before running again */
+	NAMECOM_API_REQUEST_DONE,
+} namecom_api_request_state_t;
+
+/*
+ * The latencies of an endpoint's recent responses, from which its hedge
+ * delay is taken.
+ */
+typedef struct namecom_api_latency_window {
+	double samples[ NAMECOM_API_HEDGE_SAMPLES ];
+	size_t count;
+	size_t next;
+	size_t pending;                    /* samples since the delay was last computed */
+	long delay_ms;
+} namecom_api_latency_window_t;
+
+/*
+ * A growable buffer that keeps its storage when it is reset, so that a
+ * recycled request can format its body and receive its response without
+ * going back to the heap.
+ */
+typedef struct scratch_buffer {
+	char* data;
+	size_t len;
+	size_t capacity;
+} scratch_buffer_t;
+
+/*
+ * Requests hold a reference to the header list they were started with,
+ * so a new session token can swap in a new list while older requests
+ * are still in flight.
+ */
+typedef struct namecom_api_headers {
+	struct curl_slist* list;
+	size_t refs;
+} namecom_api_headers_t;
+
+struct namecom_api_transport;
+
+struct namecom_api_request {
+	namecom_api_t* api;
+	struct namecom_api_transport* transport;
+	namecom_api_endpoint_t endpoint;
+	namecom_api_request_state_t state;
+	char url[ 256 ];
+	char domain[ 256 ];
+	unsigned long zone_epoch;
+	bool is_post;
+	scratch_buffer_t post_body;
+	scratch_buffer_t response_body;
+	namecom_record_decoder_t* decoder;
+	namecom_record_set_t* record_set;
+	CURL* curl;
+	namecom_api_headers_t* headers;
+	bool internal;                     /* started by the handle itself, not owned by a caller */
+
+	bool result;
+	int code;                          /* result code of the response, -1 if there wasn't one */
+	long record_id;
+	namecom_api_dns_record_t** records;
+
+	/* The session the request was last sent with. */
+	bool with_session;
+	unsigned long session_epoch;
+	bool reauthenticated;
+
+	unsigned int retries;
+	long long retry_at_ms;             /* when a request that is backing off runs again */
+	long long deadline_ms;             /* 0 if the request has none */
+	bool timed_out;
+	bool rejected;                     /* refused by the circuit breaker */
+	bool unsupported;                  /* the server doesn't know the command */
+	bool probe;                        /* the circuit breaker's half-open probe */
+
+	/* A slow read and the duplicate sent to race it point at each other. */
+	long long hedge_at_ms;             /* when to send a duplicate, 0 if it won't be hedged */
+	struct namecom_api_request* hedge;
+	struct namecom_api_request* hedge_of;
+
+	namecom_api_completion_fxn_t on_complete;
+	void* user_data;
+
+	struct namecom_api_request* prev;
+	struct namecom_api_request* next;
+};
+
+typedef struct namecom_api_request_list {
+	namecom_api_request_t* head;
+	namecom_api_request_t* tail;
+	size_t count;
+} namecom_api_request_list_t;
+
+/*
+ * A multi handle with its own queue, idle easy handles and recycled
+ * requests.  A transport is driven by one thread at a time, which holds
+ * its mutex while it does.  The handle's own transport serves the
+ * asynchronous interface and the synchronous calls of the thread that
+ * created the handle; other threads making synchronous calls take a
+ * transport from a pool.
+ */
+typedef struct namecom_api_transport {
+	namecom_api_t* api;
+	pthread_mutex_t mutex;             /* recursive, so callbacks can call back in */
+	size_t depth;                      /* nesting of synchronous calls on a pooled transport */
+	CURLM* multi;
+	CURL** idle_handles;
+	size_t idle_handles_count;
+	size_t idle_handles_capacity;
+	namecom_api_request_list_t queued;
+	namecom_api_request_list_t active;
+	namecom_api_request_list_t free_requests;
+	namecom_api_request_list_t authenticating;
+	namecom_api_request_list_t retrying;
+	long admit_delay_ms;               /* when the limiter will next admit a request, 0 if it isn't holding any back */
+	long retry_delay_ms;               /* when the next retry is due, 0 if none is waiting */
+	long hedge_delay_ms;               /* when the next read is due to be hedged, 0 if none is */
+	struct namecom_api_transport* next;        /* every pooled transport */
+	struct namecom_api_transport* next_idle;   /* pooled transports not in use */
+} namecom_api_transport_t;
+
+/*
+ * What a thread's synchronous calls share: the deadline they run under
+ * and the outcome of the last one.
+ */
+typedef struct namecom_api_thread_state {
+	long long deadline_ms;
+	namecom_api_error_t last_error;
+} namecom_api_thread_state_t;
+
+/*
+ * A synchronous listing in flight.  Identical listings made meanwhile on
+ * other threads wait for it and share its record set rather than sending
+ * requests of their own.  Guarded by the handle's lock.
+ */
+typedef struct namecom_api_flight {
+	char domain[ 256 ];
+	unsigned long zone_epoch;
+	bool landed;
+	namecom_record_set_t* set;         /* a reference to the result, NULL if the listing failed */
+	size_t refs;                       /* the caller that sent it and those waiting on it */
+	struct namecom_api_flight* next;
+} namecom_api_flight_t;
+
 struct namecom_api {
 	char* username;
 	char* api_token;
 	char* api_server;
-	char* session_token;
+	namecom_api_auth_mode_t auth_mode;
 	bool verbose;
+
+	/*
+	 * The transport is owned by the API handle. Requests are queued
+	 * and handed to a multi handle, which keeps the connections to
+	 * the API server alive and shares them between easy handles.
+	 * Idle easy handles are kept around so that they can be reused
+	 * by later requests.
+	 */
+	namecom_api_transport_t transport;
+	namecom_api_transport_t* transports;
+	namecom_api_transport_t* idle_transports;
+	pthread_key_t current_transport;
+	pthread_key_t thread_state;
+	pthread_t owner;                   /* the thread that created the handle */
+	size_t max_concurrency;
+	bool http2;
+	size_t max_streams;
+	char* ca_bundle;
+	long connect_timeout_ms;
+	long timeout_ms;
+
+	/*
+	 * State shared by every transport is guarded by the lock, which is
+	 * never held while a request callback runs.  A new session token
+	 * and the header list that carries it are swapped in together.
+	 */
+	pthread_mutex_t lock;
+	pthread_cond_t session_changed;
+	char* session_token;
+	namecom_api_headers_t* headers;
+	unsigned long session_epoch;       /* bumped whenever the session token changes */
+	bool login_in_flight;
+	const namecom_api_transport_t* login_transport; /* the transport driving that login */
+	namecom_api_connection_stats_t connection_stats;
+	namecom_transport_cache_t* transport_cache;
+	namecom_zone_cache_t* zone_cache;
+	char* zone_snapshot_directory;
+	unsigned long zone_epoch;          /* bumped whenever a record is added or removed */
+	bool update_unsupported;           /* the server turned down an update as an unknown command */
+	char* session_cache_directory;
+	namecom_api_flight_t* flights;
+	pthread_cond_t flight_landed;
+
+	/*
+	 * Pacing shared by every transport: a token bucket that each request
+	 * draws from as it starts, and an optional AIMD controller for the
+	 * number of requests in flight.
+	 */
+	double rate;
+	double burst;
+	double tokens;
+	long long refilled_ms;
+	bool adaptive;
+	size_t min_concurrency;
+	double concurrency_limit;
+	size_t in_flight;
+	double latency_ms;
+	double baseline_latency_ms;
+	long long decreased_ms;
+	bool held_back;
+	namecom_host_quota_t* host_quota;
+	namecom_api_limiter_stats_t limiter_stats;
+
+	/* Retries of transient failures, and what is left of their budget. */
+	namecom_api_retry_policy_t retry_policy;
+	double retry_tokens;
+	unsigned long long jitter;         /* state of the generator that spreads out backoffs */
+
+	/* Hedging of slow reads, with delays taken from recent latencies. */
+	double hedge_percentile;
+	long hedge_min_delay_ms;
+	namecom_api_latency_window_t latencies[ NAMECOM_API_ENDPOINT_COUNT ];
+
+	/* The circuit breaker, with the outcomes of recent attempts as bits, newest lowest. */
+	namecom_api_breaker_policy_t breaker_policy;
+	namecom_api_breaker_stats_t breaker_stats;
+	unsigned long long breaker_outcomes;
+	unsigned int breaker_samples;
+	unsigned int breaker_failures;
+	long long breaker_opened_ms;
+
+	/*
+	 * When a host event loop drives the transport, libcurl reports
+	 * which sockets to watch and when to time out through these.
+	 */
+	namecom_api_socket_fxn_t socket_fxn;
+	namecom_api_timer_fxn_t timer_fxn;
+	void* event_user_data;
+	long long curl_timer_at_ms;        /* libcurl's own deadline, -1 if it has none */
 };
 
 
 static const char* namecom_api_code_string( int code );
+static bool namecom_api_set_session_token( namecom_api_t* api, const char* session_token );
+static size_t namecom_api_writefunc( void *ptr, size_t size, size_t nmemb, void* userdata );
+static void namecom_api_request_complete( namecom_api_request_t* request, CURLcode res );
+static void namecom_api_request_free( namecom_api_request_t* request );
+static void namecom_api_request_submit( namecom_api_request_t* request );
+static void namecom_api_request_finish( namecom_api_request_t* request );
+
+static bool namecom_api_transport_init( namecom_api_t* api, namecom_api_transport_t* transport )
+{
+	pthread_mutexattr_t attributes;
+	bool result = false;
+
+	memset( transport, 0, sizeof(namecom_api_transport_t) );
+	transport->api = api;
+
+	if( pthread_mutexattr_init( &attributes ) != 0 )
+	{
+		return false;
+	}
+
+	if( pthread_mutexattr_settype( &attributes, PTHREAD_MUTEX_RECURSIVE ) == 0 &&
+	    pthread_mutex_init( &transport->mutex, &attributes ) == 0 )
+	{
+		transport->multi = curl_multi_init();
+
+		if( transport->multi )
+		{
+			curl_multi_setopt( transport->multi, CURLMOPT_MAXCONNECTS, (long) api->max_concurrency );
+
+			if( api->http2 )
+			{
+				curl_multi_setopt( transport->multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX );
+				curl_multi_setopt( transport->multi, CURLMOPT_MAX_CONCURRENT_STREAMS, (long) api->max_streams );
+			}
+
+			result = true;
+		}
+		else
+		{
+			pthread_mutex_destroy( &transport->mutex );
+		}
+	}
+
+	pthread_mutexattr_destroy( &attributes );
+
+	return result;
+}
 
 namecom_api_t* namecom_api_create( const char* username, const char* api_token, bool is_dev, bool verbose )
+{
+	return namecom_api_create_with_auth( username, api_token, is_dev, verbose, NAMECOM_API_AUTH_SESSION );
+}
+
+namecom_api_t* namecom_api_create_with_auth( const char* username, const char* api_token, bool is_dev, bool verbose, namecom_api_auth_mode_t auth_mode )
 {
 	namecom_api_t* api = malloc( sizeof(namecom_api_t) );
 
 	if( api )
 	{
-		api->username      = string_dup( username );
-		api->api_token     = string_dup( api_token );
-		api->api_server    = is_dev ? NAMECOM_API_SERVER_DEV : NAMECOM_API_SERVER_REL;
-		api->session_token = NULL;
-		api->verbose       = verbose;
+		memset( api, 0, sizeof(namecom_api_t) );
+
+		api->username        = string_dup( username );
+		api->api_token       = string_dup( api_token );
+		api->api_server      = is_dev ? NAMECOM_API_SERVER_DEV : NAMECOM_API_SERVER_REL;
+		api->session_token   = NULL;
+		api->auth_mode       = auth_mode;
+		api->verbose         = verbose;
+		api->max_concurrency = NAMECOM_API_DEFAULT_MAX_CONCURRENCY;
+		api->http2           = false;
+		api->max_streams     = NAMECOM_API_DEFAULT_MAX_STREAMS;
+		api->connect_timeout_ms = NAMECOM_API_DEFAULT_CONNECT_TIMEOUT_MS;
+		api->timeout_ms      = NAMECOM_API_DEFAULT_TIMEOUT_MS;
+		api->owner           = pthread_self();
+		api->curl_timer_at_ms = -1;
+		api->jitter          = (unsigned long long) time(NULL) ^ ((unsigned long long) (uintptr_t) api << 16) ^ 0x9e3779b97f4a7c15ULL;
+
+		bool locked = pthread_mutex_init( &api->lock, NULL ) == 0;
+		bool signalled = locked && pthread_cond_init( &api->session_changed, NULL ) == 0;
+		bool landed = signalled && pthread_cond_init( &api->flight_landed, NULL ) == 0;
+		bool keyed = landed && pthread_key_create( &api->current_transport, NULL ) == 0;
+		bool stated = keyed && pthread_key_create( &api->thread_state, free ) == 0;
+
+		if( !stated || !namecom_api_transport_init( api, &api->transport ) )
+		{
+			if( stated ) pthread_key_delete( api->thread_state );
+			if( keyed ) pthread_key_delete( api->current_transport );
+			if( landed ) pthread_cond_destroy( &api->flight_landed );
+			if( signalled ) pthread_cond_destroy( &api->session_changed );
+			if( locked ) pthread_mutex_destroy( &api->lock );
+			free( api->username );
+			free( api->api_token );
+			free( api );
+			return NULL;
+		}
+
+		namecom_api_set_retry_policy( api, NULL );
+		namecom_api_set_breaker_policy( api, NULL );
+
+		if( !namecom_api_set_session_token( api, NULL ) )
+		{
+			namecom_api_destroy( api );
+			api = NULL;
+		}
 	}
 
 	return api;
 }
 
+static void namecom_api_request_list_append( namecom_api_request_list_t* list, namecom_api_request_t* request )
+{
+	request->prev = list->tail;
+	request->next = NULL;
+
+	if( list->tail )
+	{
+		list->tail->next = request;
+	}
+	else
+	{
+		list->head = request;
+	}
+
+	list->tail = request;
+	list->count += 1;
+}
+
+static void namecom_api_request_list_prepend( namecom_api_request_list_t* list, namecom_api_request_t* request )
+{
+	request->prev = NULL;
+	request->next = list->head;
+
+	if( list->head )
+	{
+		list->head->prev = request;
+	}
+	else
+	{
+		list->tail = request;
+	}
+
+	list->head = request;
+	list->count += 1;
+}
+
+static void namecom_api_request_list_unlink( namecom_api_request_list_t* list, namecom_api_request_t* request )
+{
+	if( request->prev )
+	{
+		request->prev->next = request->next;
+	}
+	else
+	{
+		list->head = request->next;
+	}
+
+	if( request->next )
+	{
+		request->next->prev = request->prev;
+	}
+	else
+	{
+		list->tail = request->prev;
+	}
+
+	request->prev = NULL;
+	request->next = NULL;
+	list->count -= 1;
+}
+
+/*
+ * Called with the lock held.
+ */
+static void namecom_api_headers_release( namecom_api_headers_t* headers )
+{
+	if( headers && --headers->refs == 0 )
+	{
+		curl_slist_free_all( headers->list );
+		free( headers );
+	}
+}
+
+/*
+ * Requests are owned by the caller, so outstanding ones are cancelled
+ * and detached rather than freed.  The exception is a login that the
+ * handle started on its own.
+ */
+static void namecom_api_transport_cleanup( namecom_api_transport_t* transport )
+{
+	while( transport->active.head )
+	{
+		namecom_api_request_t* request = transport->active.head;
+		namecom_api_request_list_unlink( &transport->active, request );
+		curl_multi_remove_handle( transport->multi, request->curl );
+		curl_easy_cleanup( request->curl );
+		namecom_api_headers_release( request->headers );
+		request->curl    = NULL;
+		request->headers = NULL;
+		request->state   = NAMECOM_API_REQUEST_DONE;
+		request->result  = false;
+		request->api     = NULL;
+
+		if( request->internal )
+		{
+			namecom_api_request_free( request );
+		}
+	}
+
+	while( transport->queued.head )
+	{
+		namecom_api_request_t* request = transport->queued.head;
+		namecom_api_request_list_unlink( &transport->queued, request );
+		request->state  = NAMECOM_API_REQUEST_DONE;
+		request->result = false;
+		request->api    = NULL;
+
+		if( request->internal )
+		{
+			namecom_api_request_free( request );
+		}
+	}
+
+	while( transport->authenticating.head )
+	{
+		namecom_api_request_t* request = transport->authenticating.head;
+		namecom_api_request_list_unlink( &transport->authenticating, request );
+		request->state  = NAMECOM_API_REQUEST_DONE;
+		request->result = false;
+		request->api    = NULL;
+
+		if( request->internal )
+		{
+			namecom_api_request_free( request );
+		}
+	}
+
+	while( transport->retrying.head )
+	{
+		namecom_api_request_t* request = transport->retrying.head;
+		namecom_api_request_list_unlink( &transport->retrying, request );
+		request->state  = NAMECOM_API_REQUEST_DONE;
+		request->result = false;
+		request->api    = NULL;
+
+		if( request->internal )
+		{
+			namecom_api_request_free( request );
+		}
+	}
+
+	while( transport->free_requests.head )
+	{
+		namecom_api_request_t* request = transport->free_requests.head;
+		namecom_api_request_list_unlink( &transport->free_requests, request );
+		namecom_api_request_free( request );
+	}
+
+	for( size_t i = 0; i < transport->idle_handles_count; i++ )
+	{
+		curl_easy_cleanup( transport->idle_handles[ i ] );
+	}
+
+	if( transport->multi ) curl_multi_cleanup( transport->multi );
+	free( transport->idle_handles );
+	pthread_mutex_destroy( &transport->mutex );
+}
 
 void namecom_api_destroy( namecom_api_t* api )
 {
 	if( api )
 	{
+		namecom_api_transport_cleanup( &api->transport );
+
+		while( api->transports )
+		{
+			namecom_api_transport_t* transport = api->transports;
+			api->transports = transport->next;
+			namecom_api_transport_cleanup( transport );
+			free( transport );
+		}
+
 		free( api->username );
 		free( api->api_token );
 		if( api->session_token ) free( api->session_token );
+		if( api->ca_bundle ) free( api->ca_bundle );
+		namecom_zone_cache_destroy( api->zone_cache );
+		namecom_host_quota_close( api->host_quota );
+		if( api->zone_snapshot_directory ) free( api->zone_snapshot_directory );
+		if( api->session_cache_directory ) free( api->session_cache_directory );
+		namecom_api_headers_release( api->headers );
+		free( pthread_getspecific( api->thread_state ) );
+		pthread_key_delete( api->thread_state );
+		pthread_key_delete( api->current_transport );
+		pthread_cond_destroy( &api->flight_landed );
+		pthread_cond_destroy( &api->session_changed );
+		pthread_mutex_destroy( &api->lock );
 
 		free( api );
 	}
@@ -104,932 +666,3614 @@ const char* namecom_api_session_token( const namecom_api_t* api )
 	return api->session_token;
 }
 
-static void namecom_api_set_authentication_headers( namecom_api_t* api, struct curl_slist* headers_list )
+namecom_api_auth_mode_t namecom_api_auth_mode( const namecom_api_t* api )
 {
-	if( api->session_token )
-	{
-		char header_api_session_token[ 512 ];
-		snprintf( header_api_session_token, sizeof(header_api_session_token), "Api-Session-Token: %s", api->session_token );
-		header_api_session_token[ sizeof(header_api_session_token) - 1 ] = '\0';
+	return api->auth_mode;
+}
 
-		headers_list = curl_slist_append( headers_list, header_api_session_token );
-	}
-	else
-	{
-		char header_api_username[ 64 ];
-		snprintf( header_api_username, sizeof(header_api_username), "Api-Username: %s", api->username );
-		header_api_username[ sizeof(header_api_username) - 1 ] = '\0';
+void namecom_api_connection_stats( const namecom_api_t* api, namecom_api_connection_stats_t* stats )
+{
+	namecom_api_t* shared = (namecom_api_t*) api;
 
-		headers_list = curl_slist_append( headers_list, header_api_username );
+	pthread_mutex_lock( &shared->lock );
+	*stats = api->connection_stats;
+	pthread_mutex_unlock( &shared->lock );
+}
 
-		char header_api_token[ 512 ];
-		snprintf( header_api_token, sizeof(header_api_token), "Api-Token: %s", api->api_token );
-		header_api_token[ sizeof(header_api_token) - 1 ] = '\0';
+/*
+ * Walks the handle's own transport followed by the pooled ones.
+ */
+static namecom_api_transport_t* namecom_api_next_transport( namecom_api_t* api, namecom_api_transport_t* transport )
+{
+	return transport == &api->transport ? api->transports : transport->next;
+}
 
-		headers_list = curl_slist_append( headers_list, header_api_token );
+void namecom_api_set_max_concurrency( namecom_api_t* api, size_t max_concurrency )
+{
+	api->max_concurrency = max_concurrency > 0 ? max_concurrency : 1;
+
+	for( namecom_api_transport_t* transport = &api->transport; transport; transport = namecom_api_next_transport( api, transport ) )
+	{
+		curl_multi_setopt( transport->multi, CURLMOPT_MAXCONNECTS, (long) api->max_concurrency );
 	}
 }
 
-typedef struct response_body {
-	size_t len;
-	char* text;
-} response_body_t;
-
-static size_t namecom_api_writefunc( void *ptr, size_t size, size_t nmemb, void* userdata )
+size_t namecom_api_max_concurrency( const namecom_api_t* api )
 {
-	response_body_t* res_body = userdata;
-	size_t new_len = res_body->len + size * nmemb;
+	return api->max_concurrency;
+}
 
-	res_body->text = realloc( res_body->text, new_len + 1 );
+void namecom_api_set_http2( namecom_api_t* api, bool enabled, size_t max_streams )
+{
+	api->http2       = enabled;
+	api->max_streams = max_streams > 0 ? max_streams : NAMECOM_API_DEFAULT_MAX_STREAMS;
 
-	if( res_body->text == NULL )
+	for( namecom_api_transport_t* transport = &api->transport; transport; transport = namecom_api_next_transport( api, transport ) )
 	{
-		fprintf(stderr, "[ERROR] Out of memory!\n");
-		exit(EXIT_FAILURE);
+		curl_multi_setopt( transport->multi, CURLMOPT_PIPELINING, enabled ? CURLPIPE_MULTIPLEX : CURLPIPE_NOTHING );
+		curl_multi_setopt( transport->multi, CURLMOPT_MAX_CONCURRENT_STREAMS, (long) api->max_streams );
 	}
+}
 
-	memcpy( res_body->text + res_body->len, ptr, size * nmemb );
-	res_body->text[ new_len ] = '\0';
-	res_body->len = new_len;
-
-	return size * nmemb;
+bool namecom_api_http2( const namecom_api_t* api )
+{
+	return api->http2;
 }
 
-bool namecom_api_login( namecom_api_t* api )
+/*
+ * Uses the given PEM bundle instead of the system's CA store.  Only
+ * connections opened after the call are affected.
+ */
+bool namecom_api_set_ca_bundle( namecom_api_t* api, const char* path )
 {
-	bool result = true;
-	CURL* curl = curl_easy_init();
+	char* ca_bundle = path ? string_dup( path ) : NULL;
 
-	if( curl )
+	if( path && !ca_bundle )
 	{
-		char url[ 256 ];
-		snprintf( url, sizeof(url), "https://%s/api/login", api->api_server );
-
-		curl_easy_setopt( curl, CURLOPT_URL, url );
+		return false;
+	}
 
-		char header_content_type[ 256 ];
-		snprintf( header_content_type, sizeof(header_content_type), "Content-Type: application/json" );
+	if( api->ca_bundle ) free( api->ca_bundle );
+	api->ca_bundle = ca_bundle;
 
-		char header_user_agent[ 256 ];
-		snprintf( header_user_agent, sizeof(header_user_agent), "User-Agent: %s v%s", NAMECOM_API_USERAGENT, NAMECOM_API_VERSION );
+	/* Idle handles are recreated so that they pick up the new store. */
+	for( namecom_api_transport_t* transport = &api->transport; transport; transport = namecom_api_next_transport( api, transport ) )
+	{
+		for( size_t i = 0; i < transport->idle_handles_count; i++ )
+		{
+			curl_easy_cleanup( transport->idle_handles[ i ] );
+		}
 
+		transport->idle_handles_count = 0;
+	}
 
-		struct curl_slist* headers_list = NULL;
-		headers_list = curl_slist_append( headers_list, header_content_type );
-		headers_list = curl_slist_append( headers_list, header_user_agent );
-		namecom_api_set_authentication_headers( api, headers_list );
+	return true;
+}
 
-		curl_easy_setopt( curl, CURLOPT_HTTPHEADER, headers_list );
+static long long namecom_api_now_ms( void )
+{
+	struct timespec now;
+	clock_gettime( CLOCK_MONOTONIC, &now );
+	return (long long) now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
 
-		char post_body[ 512 ];
-		snprintf( post_body, sizeof(post_body), "{\"username\": \"%s\", \"api_token\": \"%s\"}", api->username, api->api_token );
+void namecom_api_set_rate_limit( namecom_api_t* api, double rate, double burst )
+{
+	pthread_mutex_lock( &api->lock );
+	api->rate        = rate > 0.0 ? rate : 0.0;
+	api->burst       = burst >= 1.0 ? burst : (rate > 1.0 ? rate : 1.0);
+	api->tokens      = api->burst;
+	api->refilled_ms = namecom_api_now_ms();
+	pthread_mutex_unlock( &api->lock );
+}
 
-		//printf( "DEBUG: %s\n", post_body );
+void namecom_api_set_adaptive_concurrency( namecom_api_t* api, bool enabled, size_t min_concurrency )
+{
+	pthread_mutex_lock( &api->lock );
+	api->adaptive          = enabled;
+	api->min_concurrency   = min_concurrency > 0 ? min_concurrency : 1;
+	api->concurrency_limit = (double) api->min_concurrency;
+	pthread_mutex_unlock( &api->lock );
+}
 
-		curl_easy_setopt( curl, CURLOPT_POSTFIELDS, post_body );
+bool namecom_api_set_host_quota( namecom_api_t* api, double rate, double burst )
+{
+	namecom_host_quota_t* quota = NULL;
 
+	if( rate > 0.0 )
+	{
+		quota = namecom_host_quota_open( api->username, api->api_server, rate, burst );
 
-		response_body_t response_body = { .text = NULL, .len = 0 };
+		if( !quota )
+		{
+			return false;
+		}
+	}
 
-		curl_easy_setopt( curl, CURLOPT_WRITEFUNCTION, namecom_api_writefunc );
-		curl_easy_setopt( curl, CURLOPT_WRITEDATA, &response_body );
+	pthread_mutex_lock( &api->lock );
+	namecom_host_quota_close( api->host_quota );
+	api->host_quota = quota;
+	pthread_mutex_unlock( &api->lock );
 
-		curl_easy_setopt( curl, CURLOPT_VERBOSE, NAMECOM_API_VERBOSE );
+	return true;
+}
 
+void namecom_api_set_retry_policy( namecom_api_t* api, const namecom_api_retry_policy_t* policy )
+{
+	namecom_api_retry_policy_t defaults = {
+		.max_attempts  = NAMECOM_API_DEFAULT_RETRY_ATTEMPTS,
+		.base_delay_ms = NAMECOM_API_DEFAULT_RETRY_BASE_MS,
+		.max_delay_ms  = NAMECOM_API_DEFAULT_RETRY_MAX_MS,
+		.budget        = NAMECOM_API_DEFAULT_RETRY_BUDGET,
+		.budget_ratio  = NAMECOM_API_DEFAULT_RETRY_RATIO
+	};
+
+	if( !policy )
+	{
+		policy = &defaults;
+	}
 
-		/*
-		 * If you want to connect to a site who isn't using a certificate that is
-		 * signed by one of the certs in the CA bundle you have, you can skip the
-		 * verification of the server's certificate. This makes the connection
-		 * A LOT LESS SECURE.
-		 *
-		 * If you have a CA cert for the server stored someplace else than in the
-		 * default bundle, then the CURLOPT_CAPATH option might come handy for
-		 * you.
-		 */
-		curl_easy_setopt( curl, CURLOPT_SSL_VERIFYPEER, 0L );
+	pthread_mutex_lock( &api->lock );
+	api->retry_policy = *policy;
 
-		/*
-		 * If the site you're connecting to uses a different host name that what
-		 * they have mentioned in their server certificate's commonName (or
-		 * subjectAltName) fields, libcurl will refuse to connect. You can skip
-		 * this check, but this will make the connection less secure.
-		 */
-		curl_easy_setopt( curl, CURLOPT_SSL_VERIFYHOST, 0L );
+	if( api->retry_policy.max_attempts < 1 )   api->retry_policy.max_attempts  = 1;
+	if( api->retry_policy.base_delay_ms < 0 )  api->retry_policy.base_delay_ms = 0;
+	if( api->retry_policy.max_delay_ms < api->retry_policy.base_delay_ms ) api->retry_policy.max_delay_ms = api->retry_policy.base_delay_ms;
+	if( api->retry_policy.budget < 0.0 )       api->retry_policy.budget        = 0.0;
+	if( api->retry_policy.budget_ratio < 0.0 ) api->retry_policy.budget_ratio  = 0.0;
 
-		/* Perform the request, res will get the return code */
-		CURLcode res = curl_easy_perform( curl );
+	api->retry_tokens = api->retry_policy.budget;
+	pthread_mutex_unlock( &api->lock );
+}
 
-		int status_code = 0;
-		curl_easy_getinfo( curl, CURLINFO_HTTP_CODE, &status_code );
-		//printf( "DEBUG: %d\n", status_code );
+void namecom_api_retry_policy( const namecom_api_t* api, namecom_api_retry_policy_t* policy )
+{
+	namecom_api_t* shared = (namecom_api_t*) api;
 
-		if( res == CURLE_OK )
-		{
-		    //printf( "DEBUG: %s\n", response_body.text );
+	pthread_mutex_lock( &shared->lock );
+	*policy = api->retry_policy;
+	pthread_mutex_unlock( &shared->lock );
+}
 
-			json_error_t error;
-			json_t* root = json_loads( response_body.text, 0, &error );
+/*
+ * Starts over from a closed breaker and an empty window, keeping the
+ * transition counts.
+ */
+void namecom_api_set_breaker_policy( namecom_api_t* api, const namecom_api_breaker_policy_t* policy )
+{
+	namecom_api_breaker_policy_t defaults = {
+		.consecutive_failures = NAMECOM_API_DEFAULT_BREAKER_FAILURES,
+		.error_rate           = NAMECOM_API_DEFAULT_BREAKER_RATE,
+		.window               = NAMECOM_API_DEFAULT_BREAKER_WINDOW,
+		.open_ms              = NAMECOM_API_DEFAULT_BREAKER_OPEN_MS
+	};
+
+	if( !policy )
+	{
+		policy = &defaults;
+	}
 
-			if( root )
-			{
-				json_t* session_token_obj = json_object_get( root, "session_token" );
+	pthread_mutex_lock( &api->lock );
+	api->breaker_policy = *policy;
 
-				if( json_is_string(session_token_obj) )
-				{
-					api->session_token = string_dup( json_string_value(session_token_obj) );
-				}
-				else
-				{
-					if( api->verbose )
-					{
-						json_t* result_obj = json_object_get( root, "result" );
-
-						if( json_is_object(result_obj) )
-						{
-							json_t* code_obj = json_object_get( result_obj, "code" );
-
-							if( json_is_integer(code_obj) )
-							{
-								json_int_t code = json_integer_value( code_obj );
-								fprintf( stderr, "[ERROR] %s\n", namecom_api_code_string( code ) );
-							}
-						}
-					}
-					result = false;
-				}
-			}
-			else
-			{
-				result = false;
-			}
+	if( api->breaker_policy.error_rate < 0.0 ) api->breaker_policy.error_rate = 0.0;
+	if( api->breaker_policy.window < 1 )       api->breaker_policy.window     = 1;
+	if( api->breaker_policy.window > NAMECOM_API_BREAKER_MAX_WINDOW ) api->breaker_policy.window = NAMECOM_API_BREAKER_MAX_WINDOW;
+	if( api->breaker_policy.open_ms < 0 )      api->breaker_policy.open_ms    = 0;
 
-			json_decref( root );
-		}
-		else
-		{
-			fprintf(stderr, "[ERROR] %s\n", curl_easy_strerror(res));
+	api->breaker_stats.state                = NAMECOM_API_BREAKER_CLOSED;
+	api->breaker_stats.consecutive_failures = 0;
+	api->breaker_outcomes = 0;
+	api->breaker_samples  = 0;
+	api->breaker_failures = 0;
+	pthread_mutex_unlock( &api->lock );
+}
 
-			result = false;
-		}
+namecom_api_breaker_state_t namecom_api_breaker_state( const namecom_api_t* api )
+{
+	namecom_api_t* shared = (namecom_api_t*) api;
 
-		/* always cleanup */
-		curl_easy_cleanup(curl);
-	}
+	pthread_mutex_lock( &shared->lock );
+	namecom_api_breaker_state_t state = api->breaker_stats.state;
+	pthread_mutex_unlock( &shared->lock );
 
-	return result;
+	return state;
 }
 
-bool namecom_api_logout( namecom_api_t* api )
+void namecom_api_breaker_stats( const namecom_api_t* api, namecom_api_breaker_stats_t* stats )
 {
-	bool result = true;
-	CURL* curl = curl_easy_init();
+	namecom_api_t* shared = (namecom_api_t*) api;
 
-	if( curl )
+	pthread_mutex_lock( &shared->lock );
+	*stats = api->breaker_stats;
+	stats->error_rate  = api->breaker_samples > 0 ? (double) api->breaker_failures / api->breaker_samples : 0.0;
+	stats->probe_in_ms = 0;
+
+	if( api->breaker_stats.state == NAMECOM_API_BREAKER_OPEN )
 	{
-		char url[ 256 ];
-		snprintf( url, sizeof(url), "https://%s/api/logout", api->api_server );
+		long long remaining_ms = api->breaker_opened_ms + api->breaker_policy.open_ms - namecom_api_now_ms();
+		stats->probe_in_ms = remaining_ms > 0 ? (long) remaining_ms : 0;
+	}
+	pthread_mutex_unlock( &shared->lock );
+}
 
-		curl_easy_setopt( curl, CURLOPT_URL, url );
+/*
+ * Called with the lock held.
+ */
+static void namecom_api_breaker_open( namecom_api_t* api )
+{
+	api->breaker_stats.state = NAMECOM_API_BREAKER_OPEN;
+	api->breaker_stats.opened += 1;
+	api->breaker_opened_ms = namecom_api_now_ms();
+
+	/* Always reported, as the refusals that follow are only printed when verbose. */
+	fprintf( stderr, "[WARNING] The service looks unavailable; requests are refused for %ld ms.\n", api->breaker_policy.open_ms );
+}
+
+/*
+ * Counts the outcome of an attempt.  Attempts that finish after the
+ * breaker has opened were started before it did and are ignored, all
+ * but the probe.
+ */
+static void namecom_api_breaker_record( namecom_api_request_t* request, bool failed )
+{
+	namecom_api_t* api = request->api;
+	const namecom_api_breaker_policy_t* policy = &api->breaker_policy;
+
+	pthread_mutex_lock( &api->lock );
+
+	if( request->probe && api->breaker_stats.state == NAMECOM_API_BREAKER_HALF_OPEN )
+	{
+		if( failed )
+		{
+			namecom_api_breaker_open( api );
+		}
+		else
+		{
+			api->breaker_stats.state                = NAMECOM_API_BREAKER_CLOSED;
+			api->breaker_stats.closed              += 1;
+			api->breaker_stats.consecutive_failures = 0;
+			api->breaker_outcomes = 0;
+			api->breaker_samples  = 0;
+			api->breaker_failures = 0;
+		}
+	}
+	else if( api->breaker_stats.state == NAMECOM_API_BREAKER_CLOSED )
+	{
+		/* The outcome falling out of the window makes room for this one. */
+		if( api->breaker_samples == policy->window )
+		{
+			api->breaker_failures -= (unsigned int) ((api->breaker_outcomes >> (policy->window - 1)) & 1);
+		}
+		else
+		{
+			api->breaker_samples += 1;
+		}
+
+		api->breaker_outcomes = (api->breaker_outcomes << 1) | (failed ? 1 : 0);
+		api->breaker_failures += failed ? 1 : 0;
+		api->breaker_stats.consecutive_failures = failed ? api->breaker_stats.consecutive_failures + 1 : 0;
+
+		if( (policy->consecutive_failures > 0 && api->breaker_stats.consecutive_failures >= policy->consecutive_failures) ||
+		    (policy->error_rate > 0.0 && api->breaker_samples == policy->window &&
+		     api->breaker_failures >= policy->error_rate * policy->window) )
+		{
+			namecom_api_breaker_open( api );
+		}
+	}
+
+	pthread_mutex_unlock( &api->lock );
+}
+
+typedef enum namecom_api_breaker_verdict {
+	NAMECOM_API_BREAKER_PASS,
+	NAMECOM_API_BREAKER_REJECT,
+	NAMECOM_API_BREAKER_HOLD,          /* wait for the probe */
+	NAMECOM_API_BREAKER_PROBE,         /* send the probe first */
+} namecom_api_breaker_verdict_t;
+
+static namecom_api_breaker_verdict_t namecom_api_breaker_admit( namecom_api_t* api )
+{
+	namecom_api_breaker_verdict_t verdict = NAMECOM_API_BREAKER_PASS;
+
+	pthread_mutex_lock( &api->lock );
+
+	if( api->breaker_stats.state == NAMECOM_API_BREAKER_HALF_OPEN )
+	{
+		verdict = NAMECOM_API_BREAKER_HOLD;
+	}
+	else if( api->breaker_stats.state == NAMECOM_API_BREAKER_OPEN )
+	{
+		if( namecom_api_now_ms() - api->breaker_opened_ms >= api->breaker_policy.open_ms )
+		{
+			api->breaker_stats.state = NAMECOM_API_BREAKER_HALF_OPEN;
+			api->breaker_stats.half_opened += 1;
+			verdict = NAMECOM_API_BREAKER_PROBE;
+		}
+		else
+		{
+			api->breaker_stats.rejected += 1;
+			verdict = NAMECOM_API_BREAKER_REJECT;
+		}
+	}
+
+	pthread_mutex_unlock( &api->lock );
+
+	return verdict;
+}
+
+void namecom_api_set_hedging( namecom_api_t* api, double percentile, long min_delay_ms )
+{
+	pthread_mutex_lock( &api->lock );
+	api->hedge_percentile   = percentile > 0.0 ? (percentile < 100.0 ? percentile : 100.0) : 0.0;
+	api->hedge_min_delay_ms = min_delay_ms > 0 ? min_delay_ms : 1;
+
+	for( size_t i = 0; i < NAMECOM_API_ENDPOINT_COUNT; i++ )
+	{
+		memset( &api->latencies[ i ], 0, sizeof(namecom_api_latency_window_t) );
+		api->latencies[ i ].delay_ms = api->hedge_min_delay_ms;
+	}
+	pthread_mutex_unlock( &api->lock );
+}
+
+/*
+ * The delay currently applied to listings.
+ */
+long namecom_api_hedge_delay( const namecom_api_t* api )
+{
+	namecom_api_t* shared = (namecom_api_t*) api;
+
+	pthread_mutex_lock( &shared->lock );
+	long delay_ms = api->hedge_percentile > 0.0 ? api->latencies[ NAMECOM_API_ENDPOINT_DNS_RECORD_LIST ].delay_ms : 0;
+	pthread_mutex_unlock( &shared->lock );
+
+	return delay_ms;
+}
+
+void namecom_api_set_timeouts( namecom_api_t* api, long connect_timeout_ms, long timeout_ms )
+{
+	pthread_mutex_lock( &api->lock );
+	api->connect_timeout_ms = connect_timeout_ms > 0 ? connect_timeout_ms : 0;
+	api->timeout_ms         = timeout_ms > 0 ? timeout_ms : 0;
+	pthread_mutex_unlock( &api->lock );
+}
+
+long long namecom_api_clock_ms( void )
+{
+	return namecom_api_now_ms();
+}
+
+/*
+ * The calling thread's state, created the first time it is needed.
+ */
+static namecom_api_thread_state_t* namecom_api_thread_state( const namecom_api_t* api, bool create )
+{
+	namecom_api_thread_state_t* state = pthread_getspecific( api->thread_state );
+
+	if( !state && create )
+	{
+		state = malloc( sizeof(namecom_api_thread_state_t) );
+
+		if( state )
+		{
+			state->deadline_ms = 0;
+			state->last_error  = NAMECOM_API_ERROR_NONE;
+			pthread_setspecific( api->thread_state, state );
+		}
+	}
+
+	return state;
+}
+
+void namecom_api_set_deadline( namecom_api_t* api, long long deadline_ms )
+{
+	namecom_api_thread_state_t* state = namecom_api_thread_state( api, deadline_ms > 0 );
+
+	if( state )
+	{
+		state->deadline_ms = deadline_ms > 0 ? deadline_ms : 0;
+	}
+}
+
+long long namecom_api_deadline( const namecom_api_t* api )
+{
+	namecom_api_thread_state_t* state = namecom_api_thread_state( api, false );
+	return state ? state->deadline_ms : 0;
+}
+
+namecom_api_error_t namecom_api_last_error( const namecom_api_t* api )
+{
+	namecom_api_thread_state_t* state = namecom_api_thread_state( api, false );
+	return state ? state->last_error : NAMECOM_API_ERROR_NONE;
+}
+
+static void namecom_api_set_last_error( namecom_api_t* api, namecom_api_error_t error )
+{
+	namecom_api_thread_state_t* state = namecom_api_thread_state( api, error != NAMECOM_API_ERROR_NONE );
+
+	if( state )
+	{
+		state->last_error = error;
+	}
+}
+
+/*
+ * Reads that can be sent twice and whose answer can be moved from one
+ * request to another.  A listing streamed to the caller's callback can't
+ * be: both copies would deliver records.
+ */
+static bool namecom_api_request_can_hedge( const namecom_api_request_t* request )
+{
+	switch( request->endpoint )
+	{
+		case NAMECOM_API_ENDPOINT_HELLO:
+		case NAMECOM_API_ENDPOINT_DOMAINS_LIST:
+			return true;
+		case NAMECOM_API_ENDPOINT_DNS_RECORD_LIST:
+			return request->record_set || request->records;
+		default:
+			return false;
+	}
+}
+
+static int namecom_api_compare_latency( const void* left, const void* right )
+{
+	double a = *(const double*) left;
+	double b = *(const double*) right;
+	return (a > b) - (a < b);
+}
+
+/*
+ * Adds the latency of a read to its endpoint's window and, every few
+ * samples, takes the hedge delay from it again.  Called with the lock
+ * held.
+ */
+static void namecom_api_sample_latency( namecom_api_t* api, namecom_api_endpoint_t endpoint, double latency_ms )
+{
+	namecom_api_latency_window_t* window = &api->latencies[ endpoint ];
+
+	window->samples[ window->next ] = latency_ms;
+	window->next = (window->next + 1) % NAMECOM_API_HEDGE_SAMPLES;
+
+	if( window->count < NAMECOM_API_HEDGE_SAMPLES )
+	{
+		window->count += 1;
+	}
+
+	window->pending += 1;
+
+	if( window->count >= NAMECOM_API_HEDGE_MIN_SAMPLES && window->pending >= NAMECOM_API_HEDGE_UPDATE_INTERVAL )
+	{
+		double sorted[ NAMECOM_API_HEDGE_SAMPLES ];
+		size_t count = window->count;
+
+		memcpy( sorted, window->samples, sizeof(double) * count );
+		qsort( sorted, count, sizeof(double), namecom_api_compare_latency );
+
+		/* The nearest rank, rounding up. */
+		double position = api->hedge_percentile / 100.0 * (double) count;
+		size_t rank = (size_t) position;
+
+		if( (double) rank < position )
+		{
+			rank += 1;
+		}
+
+		long delay_ms = (long) sorted[ rank > 0 ? rank - 1 : 0 ] + 1;
+
+		window->delay_ms = delay_ms > api->hedge_min_delay_ms ? delay_ms : api->hedge_min_delay_ms;
+		window->pending  = 0;
+	}
+}
+
+/*
+ * Called with the lock held.
+ */
+static void namecom_api_refill( namecom_api_t* api, long long now_ms )
+{
+	if( api->rate > 0.0 )
+	{
+		api->tokens += (double) (now_ms - api->refilled_ms) * api->rate / 1000.0;
+
+		if( api->tokens > api->burst )
+		{
+			api->tokens = api->burst;
+		}
+	}
+
+	api->refilled_ms = now_ms;
+}
+
+static size_t namecom_api_concurrency_limit( const namecom_api_t* api )
+{
+	size_t limit = (size_t) api->concurrency_limit;
+	return limit < api->max_concurrency ? limit : api->max_concurrency;
+}
+
+void namecom_api_limiter_stats( const namecom_api_t* api, namecom_api_limiter_stats_t* stats )
+{
+	namecom_api_t* shared = (namecom_api_t*) api;
+
+	pthread_mutex_lock( &shared->lock );
+	namecom_api_refill( shared, namecom_api_now_ms() );
+
+	*stats = api->limiter_stats;
+	stats->rate                = api->rate;
+	stats->burst               = api->burst;
+	stats->tokens              = api->rate > 0.0 ? api->tokens : 0.0;
+	stats->concurrency_limit   = api->adaptive ? namecom_api_concurrency_limit( api ) : api->max_concurrency;
+	stats->in_flight           = api->in_flight;
+	stats->latency_ms          = api->latency_ms;
+	stats->baseline_latency_ms = api->baseline_latency_ms;
+	stats->at_cap              = api->held_back;
+
+	if( api->host_quota )
+	{
+		namecom_host_quota_stats_t host_stats;
+		namecom_host_quota_stats( api->host_quota, &host_stats );
+		stats->host_quota  = true;
+		stats->host_tokens = host_stats.tokens;
+	}
+	pthread_mutex_unlock( &shared->lock );
+}
+
+/*
+ * Lets a request start, returning 0, or returns how many milliseconds to
+ * wait before asking again.
+ */
+static long namecom_api_admit( namecom_api_t* api )
+{
+	long delay_ms = 0;
+
+	pthread_mutex_lock( &api->lock );
+
+	if( api->adaptive && api->in_flight >= namecom_api_concurrency_limit( api ) )
+	{
+		/* A completion frees a slot; this is for those on other transports. */
+		if( !api->held_back ) api->limiter_stats.capped += 1;
+		delay_ms = NAMECOM_API_LIMITER_POLL_MS;
+	}
+	else if( api->rate > 0.0 )
+	{
+		namecom_api_refill( api, namecom_api_now_ms() );
+
+		if( api->tokens < 1.0 )
+		{
+			if( !api->held_back ) api->limiter_stats.throttled += 1;
+			delay_ms = (long) ((1.0 - api->tokens) * 1000.0 / api->rate) + 1;
+		}
+		else
+		{
+			api->tokens -= 1.0;
+		}
+	}
+
+	if( delay_ms == 0 && api->host_quota )
+	{
+		long host_delay_ms = namecom_host_quota_take( api->host_quota );
+
+		if( host_delay_ms > 0 )
+		{
+			/* The handle's own token goes back unused. */
+			if( api->rate > 0.0 ) api->tokens += 1.0;
+			if( !api->held_back ) api->limiter_stats.host_throttled += 1;
+			delay_ms = host_delay_ms;
+		}
+	}
+
+	api->held_back = delay_ms > 0;
+
+	if( delay_ms == 0 )
+	{
+		api->in_flight += 1;
+	}
+
+	pthread_mutex_unlock( &api->lock );
+
+	return delay_ms;
+}
+
+/*
+ * The AIMD controller.  Latency is compared against a baseline that
+ * follows the lowest smoothed latency seen and drifts slowly upwards, so
+ * that a lasting change in the network is eventually accepted as normal.
+ * Called with the lock held.
+ */
+static void namecom_api_adapt( namecom_api_t* api, CURLcode res, long http_status, double latency_ms )
+{
+	if( res == CURLE_OK && latency_ms > 0.0 )
+	{
+		api->latency_ms = api->latency_ms > 0.0 ? 0.8 * api->latency_ms + 0.2 * latency_ms : latency_ms;
+
+		if( api->baseline_latency_ms <= 0.0 || api->latency_ms < api->baseline_latency_ms )
+		{
+			api->baseline_latency_ms = api->latency_ms;
+		}
+		else
+		{
+			api->baseline_latency_ms += 0.01 * (api->latency_ms - api->baseline_latency_ms);
+		}
+	}
+
+	if( !api->adaptive )
+	{
+		return;
+	}
+
+	bool overloaded = http_status == 429 || http_status == 503;
+	bool slow = api->baseline_latency_ms > 0.0 && api->latency_ms > 2.0 * api->baseline_latency_ms &&
+	            api->latency_ms > api->baseline_latency_ms + NAMECOM_API_LIMITER_LATENCY_SLACK_MS;
+	long long now_ms = namecom_api_now_ms();
+
+	if( overloaded || slow )
+	{
+		/* Requests that were in flight together only count once. */
+		if( now_ms - api->decreased_ms > (long long) api->latency_ms && api->concurrency_limit > (double) api->min_concurrency )
+		{
+			double limit = api->concurrency_limit / 2.0;
+			api->concurrency_limit = limit > (double) api->min_concurrency ? limit : (double) api->min_concurrency;
+			api->decreased_ms = now_ms;
+			api->limiter_stats.decreases += 1;
+		}
+	}
+	else if( res == CURLE_OK && http_status < 500 && api->concurrency_limit < (double) api->max_concurrency )
+	{
+		size_t before = (size_t) api->concurrency_limit;
+		api->concurrency_limit += 1.0 / api->concurrency_limit;
+
+		if( (size_t) api->concurrency_limit > before )
+		{
+			api->limiter_stats.increases += 1;
+		}
+	}
+}
+
+/*
+ * Shares resolved addresses and TLS sessions with the given cache.  The
+ * cache must outlive the API handle.
+ */
+void namecom_api_set_transport_cache( namecom_api_t* api, namecom_transport_cache_t* cache )
+{
+	api->transport_cache = cache;
+
+	for( namecom_api_transport_t* transport = &api->transport; cache && transport; transport = namecom_api_next_transport( api, transport ) )
+	{
+		for( size_t i = 0; i < transport->idle_handles_count; i++ )
+		{
+			namecom_transport_cache_attach( cache, transport->idle_handles[ i ] );
+		}
+	}
+}
+
+bool namecom_api_set_zone_cache( namecom_api_t* api, long ttl, size_t max_bytes )
+{
+	namecom_zone_cache_t* cache = NULL;
+
+	if( ttl > 0 && max_bytes > 0 )
+	{
+		cache = namecom_zone_cache_create( ttl, max_bytes );
+
+		if( !cache )
+		{
+			return false;
+		}
+	}
+
+	pthread_mutex_lock( &api->lock );
+	namecom_zone_cache_t* previous = api->zone_cache;
+	api->zone_cache = cache;
+	pthread_mutex_unlock( &api->lock );
+
+	namecom_zone_cache_destroy( previous );
+
+	return true;
+}
+
+bool namecom_api_zone_cache_stats( const namecom_api_t* api, namecom_zone_cache_stats_t* stats )
+{
+	namecom_api_t* shared = (namecom_api_t*) api;
+	bool result = false;
+
+	pthread_mutex_lock( &shared->lock );
+
+	if( api->zone_cache )
+	{
+		namecom_zone_cache_stats( api->zone_cache, stats );
+		result = true;
+	}
+
+	pthread_mutex_unlock( &shared->lock );
+
+	return result;
+}
+
+bool namecom_api_set_zone_snapshots( namecom_api_t* api, const char* directory )
+{
+	char* copy = NULL;
+
+	if( directory )
+	{
+		copy = string_dup( directory );
+
+		if( !copy )
+		{
+			return false;
+		}
+	}
+
+	if( api->zone_snapshot_directory ) free( api->zone_snapshot_directory );
+	api->zone_snapshot_directory = copy;
+
+	return true;
+}
+
+bool namecom_api_set_session_cache( namecom_api_t* api, const char* directory )
+{
+	char* copy = NULL;
+
+	if( directory )
+	{
+		copy = string_dup( directory );
+
+		if( !copy )
+		{
+			return false;
+		}
+	}
+
+	if( api->session_cache_directory ) free( api->session_cache_directory );
+	api->session_cache_directory = copy;
+
+	return true;
+}
+
+/*
+ * The transport the calling thread is working with: the one it holds for
+ * a synchronous call, otherwise the handle's own.
+ */
+static namecom_api_transport_t* namecom_api_current_transport( const namecom_api_t* api )
+{
+	namecom_api_transport_t* transport = pthread_getspecific( api->current_transport );
+	return transport ? transport : (namecom_api_transport_t*) &api->transport;
+}
+
+static size_t namecom_api_transport_pending( const namecom_api_transport_t* transport )
+{
+	return transport->queued.count + transport->active.count + transport->authenticating.count + transport->retrying.count;
+}
+
+size_t namecom_api_pending( const namecom_api_t* api )
+{
+	namecom_api_transport_t* transport = namecom_api_current_transport( api );
+
+	pthread_mutex_lock( &transport->mutex );
+	size_t pending = namecom_api_transport_pending( transport );
+	pthread_mutex_unlock( &transport->mutex );
+
+	return pending;
+}
+
+/*
+ * Builds the header list that is sent with every request and swaps it
+ * in along with the session token.  This only needs to happen when the
+ * handle is created and whenever the session token changes (i.e. after a
+ * login or logout).  Called with the lock held.
+ */
+static bool namecom_api_swap_session_token( namecom_api_t* api, const char* session_token )
+{
+	struct curl_slist* headers_list = NULL;
+	char* token = NULL;
+
+	if( session_token )
+	{
+		token = string_dup( session_token );
+
+		if( !token )
+		{
+			return false;
+		}
+	}
+
+	char header_content_type[ 256 ];
+	snprintf( header_content_type, sizeof(header_content_type), "Content-Type: application/json" );
+
+	char header_user_agent[ 256 ];
+	snprintf( header_user_agent, sizeof(header_user_agent), "User-Agent: %s v%s", NAMECOM_API_USERAGENT, NAMECOM_API_VERSION );
+
+	headers_list = curl_slist_append( headers_list, header_content_type );
+	headers_list = curl_slist_append( headers_list, header_user_agent );
+
+	if( token )
+	{
+		char header_api_session_token[ 512 ];
+		snprintf( header_api_session_token, sizeof(header_api_session_token), "Api-Session-Token: %s", token );
+		header_api_session_token[ sizeof(header_api_session_token) - 1 ] = '\0';
+
+		headers_list = curl_slist_append( headers_list, header_api_session_token );
+	}
+	else
+	{
+		char header_api_username[ 64 ];
+		snprintf( header_api_username, sizeof(header_api_username), "Api-Username: %s", api->username );
+		header_api_username[ sizeof(header_api_username) - 1 ] = '\0';
+
+		headers_list = curl_slist_append( headers_list, header_api_username );
+
+		char header_api_token[ 512 ];
+		snprintf( header_api_token, sizeof(header_api_token), "Api-Token: %s", api->api_token );
+		header_api_token[ sizeof(header_api_token) - 1 ] = '\0';
+
+		headers_list = curl_slist_append( headers_list, header_api_token );
+	}
+
+	namecom_api_headers_t* headers = headers_list ? malloc( sizeof(namecom_api_headers_t) ) : NULL;
+
+	if( !headers )
+	{
+		if( headers_list ) curl_slist_free_all( headers_list );
+		if( token ) free( token );
+		return false;
+	}
+
+	headers->list = headers_list;
+	headers->refs = 1;
+
+	/* Requests in flight keep their references to the old list. */
+	namecom_api_headers_release( api->headers );
+	api->headers = headers;
+
+	if( api->session_token ) free( api->session_token );
+	api->session_token  = token;
+	api->session_epoch += 1;
+
+	return true;
+}
+
+static bool namecom_api_set_session_token( namecom_api_t* api, const char* session_token )
+{
+	pthread_mutex_lock( &api->lock );
+	bool result = namecom_api_swap_session_token( api, session_token );
+	pthread_mutex_unlock( &api->lock );
+
+	return result;
+}
+
+/*
+ * Allocations are rare, so they are counted under the lock.
+ */
+static void namecom_api_count_allocation( namecom_api_t* api )
+{
+	pthread_mutex_lock( &api->lock );
+	api->connection_stats.transport_allocations += 1;
+	pthread_mutex_unlock( &api->lock );
+}
+
+static bool scratch_buffer_reserve( namecom_api_t* api, scratch_buffer_t* buffer, size_t needed )
+{
+	if( needed > buffer->capacity )
+	{
+		size_t capacity = buffer->capacity ? buffer->capacity : NAMECOM_API_SCRATCH_MIN_CAPACITY;
+
+		while( capacity < needed )
+		{
+			capacity *= 2;
+		}
+
+		char* data = realloc( buffer->data, capacity );
+
+		if( !data )
+		{
+			return false;
+		}
+
+		buffer->data     = data;
+		buffer->capacity = capacity;
+		namecom_api_count_allocation( api );
+	}
+
+	return true;
+}
+
+static void scratch_buffer_reset( scratch_buffer_t* buffer )
+{
+	buffer->len = 0;
+
+	if( buffer->data )
+	{
+		buffer->data[ 0 ] = '\0';
+	}
+}
+
+static void scratch_buffer_release( scratch_buffer_t* buffer )
+{
+	free( buffer->data );
+	buffer->data     = NULL;
+	buffer->len      = 0;
+	buffer->capacity = 0;
+}
+
+static size_t namecom_api_writefunc( void *ptr, size_t size, size_t nmemb, void* userdata )
+{
+	namecom_api_request_t* request = userdata;
+
+	if( request->endpoint == NAMECOM_API_ENDPOINT_DNS_RECORD_LIST )
+	{
+		/* Returning short aborts the transfer. */
+		return namecom_record_decoder_feed( request->decoder, ptr, size * nmemb ) ? size * nmemb : 0;
+	}
+
+	scratch_buffer_t* res_body = &request->response_body;
+	size_t new_len = res_body->len + size * nmemb;
+
+	if( !scratch_buffer_reserve( request->api, res_body, new_len + 1 ) )
+	{
+		fprintf(stderr, "[ERROR] Out of memory!\n");
+		return 0;
+	}
+
+	memcpy( res_body->data + res_body->len, ptr, size * nmemb );
+	res_body->data[ new_len ] = '\0';
+	res_body->len = new_len;
+
+	return size * nmemb;
+}
+
+/*
+ * Returns an idle easy handle, or creates a new one with the options
+ * that are common to every request.
+ */
+static CURL* namecom_api_acquire_handle( namecom_api_transport_t* transport )
+{
+	namecom_api_t* api = transport->api;
+
+	if( transport->idle_handles_count > 0 )
+	{
+		return transport->idle_handles[ --transport->idle_handles_count ];
+	}
+
+	CURL* curl = curl_easy_init();
+
+	if( curl )
+	{
+		curl_easy_setopt( curl, CURLOPT_WRITEFUNCTION, namecom_api_writefunc );
+		curl_easy_setopt( curl, CURLOPT_VERBOSE, NAMECOM_API_VERBOSE );
+
+		/*
+		 * Keep connections to the API server alive between calls so
+		 * that a login, list, update and logout sequence only pays
+		 * for one TCP and TLS handshake.
+		 */
+		curl_easy_setopt( curl, CURLOPT_TCP_KEEPALIVE, 1L );
+		curl_easy_setopt( curl, CURLOPT_TCP_KEEPIDLE, 30L );
+		curl_easy_setopt( curl, CURLOPT_TCP_KEEPINTVL, 15L );
+
+		/*
+		 * Certificates are verified.  The CA store is parsed by the first
+		 * connection and then cached by the multi handle, so every easy
+		 * handle of this API handle shares it instead of re-reading the
+		 * bundle per connection.
+		 */
+		curl_easy_setopt( curl, CURLOPT_SSL_VERIFYPEER, 1L );
+		curl_easy_setopt( curl, CURLOPT_SSL_VERIFYHOST, 2L );
+		curl_easy_setopt( curl, CURLOPT_CA_CACHE_TIMEOUT, NAMECOM_API_CA_CACHE_TIMEOUT );
+
+		if( api->ca_bundle )
+		{
+			curl_easy_setopt( curl, CURLOPT_CAINFO, api->ca_bundle );
+		}
+
+		#ifdef SKIP_PEER_VERIFICATION
+		/*
+		 * If you want to connect to a site who isn't using a certificate that is
+		 * signed by one of the certs in the CA bundle you have, you can skip the
+		 * verification of the server's certificate. This makes the connection
+		 * A LOT LESS SECURE.
+		 *
+		 * If you have a CA cert for the server stored someplace else than in the
+		 * default bundle, then the CURLOPT_CAPATH option might come handy for
+		 * you.
+		 */
+		curl_easy_setopt( curl, CURLOPT_SSL_VERIFYPEER, 0L );
+		#endif
+
+		#ifdef SKIP_HOSTNAME_VERIFICATION
+		/*
+		 * If the site you're connecting to uses a different host name that what
+		 * they have mentioned in their server certificate's commonName (or
+		 * subjectAltName) fields, libcurl will refuse to connect. You can skip
+		 * this check, but this will make the connection less secure.
+		 */
+		curl_easy_setopt( curl, CURLOPT_SSL_VERIFYHOST, 0L );
+		#endif
+
+		if( api->transport_cache )
+		{
+			pthread_mutex_lock( &api->lock );
+			namecom_transport_cache_attach( api->transport_cache, curl );
+			pthread_mutex_unlock( &api->lock );
+		}
+	}
+
+	return curl;
+}
+
+static void namecom_api_release_handle( namecom_api_transport_t* transport, CURL* curl )
+{
+	if( transport->idle_handles_count == transport->idle_handles_capacity )
+	{
+		size_t capacity = transport->idle_handles_capacity ? 2 * transport->idle_handles_capacity : 4;
+		CURL** idle_handles = realloc( transport->idle_handles, sizeof(CURL*) * capacity );
+
+		if( !idle_handles )
+		{
+			curl_easy_cleanup( curl );
+			return;
+		}
+
+		transport->idle_handles          = idle_handles;
+		transport->idle_handles_capacity = capacity;
+	}
+
+	transport->idle_handles[ transport->idle_handles_count++ ] = curl;
+}
+
+static void namecom_api_request_rewind( namecom_api_request_t* request );
+static void namecom_api_request_hedge( namecom_api_request_t* request );
+static bool namecom_api_request_can_hedge( const namecom_api_request_t* request );
+static namecom_api_request_t* namecom_api_transport_request_create( namecom_api_transport_t* transport, namecom_api_endpoint_t endpoint, namecom_api_completion_fxn_t on_complete, void* user_data );
+
+/*
+ * Queues the retries whose backoff is over and returns how long until the
+ * next one is due, or 0 if none are waiting.
+ */
+static long namecom_api_release_retries( namecom_api_transport_t* transport )
+{
+	long long now_ms = namecom_api_now_ms();
+	long next_ms = 0;
+	namecom_api_request_t* request = transport->retrying.head;
+
+	while( request )
+	{
+		namecom_api_request_t* next = request->next;
+
+		if( request->retry_at_ms <= now_ms )
+		{
+			namecom_api_request_list_unlink( &transport->retrying, request );
+			namecom_api_request_rewind( request );
+			request->state = NAMECOM_API_REQUEST_QUEUED;
+			namecom_api_request_list_append( &transport->queued, request );
+		}
+		else if( next_ms == 0 || request->retry_at_ms - now_ms < next_ms )
+		{
+			next_ms = (long) (request->retry_at_ms - now_ms);
+		}
+
+		request = next;
+	}
+
+	return next_ms;
+}
+
+/*
+ * Sends duplicates of the reads that have waited past their hedge delay,
+ * or when not sending just looks, and returns how long until the next
+ * one is due (0 if none is).  Hedges only go out while nothing is queued,
+ * so that they use spare capacity.
+ */
+static long namecom_api_hedge_due( namecom_api_transport_t* transport, bool send )
+{
+	long long now_ms = namecom_api_now_ms();
+	bool spare = transport->queued.head == NULL;
+	long next_ms = 0;
+
+	for( namecom_api_request_t* request = transport->active.head; request; request = request->next )
+	{
+		if( request->hedge_at_ms == 0 )
+		{
+			continue;
+		}
+
+		long due_ms = NAMECOM_API_LIMITER_POLL_MS;
+
+		if( request->hedge_at_ms <= now_ms )
+		{
+			if( send && spare )
+			{
+				request->hedge_at_ms = 0;
+				namecom_api_request_hedge( request );
+				continue;
+			}
+
+			/* Overdue, so look again soon in case the queue has drained. */
+		}
+		else
+		{
+			due_ms = (long) (request->hedge_at_ms - now_ms);
+		}
+
+		if( next_ms == 0 || due_ms < next_ms )
+		{
+			next_ms = due_ms;
+		}
+	}
+
+	return next_ms;
+}
+
+/*
+ * How long until the limiter, a backoff or a hedge has something more to
+ * start, 0 if none of them is waiting.
+ */
+static long namecom_api_transport_wake_ms( const namecom_api_transport_t* transport )
+{
+	long delays[] = { transport->admit_delay_ms, transport->retry_delay_ms, transport->hedge_delay_ms };
+	long wake_ms = 0;
+
+	for( size_t i = 0; i < sizeof(delays) / sizeof(delays[0]); i++ )
+	{
+		if( delays[ i ] > 0 && (wake_ms == 0 || delays[ i ] < wake_ms) )
+		{
+			wake_ms = delays[ i ];
+		}
+	}
+
+	return wake_ms;
+}
+
+/*
+ * The host's timer serves both libcurl and the handle's own deadlines, so
+ * it is set to whichever is sooner.  Called with the transport's mutex
+ * held.
+ */
+static void namecom_api_arm_timer( namecom_api_t* api )
+{
+	long timeout_ms = -1;
+	long wake_ms = namecom_api_transport_wake_ms( &api->transport );
+
+	if( api->curl_timer_at_ms >= 0 )
+	{
+		long long remaining_ms = api->curl_timer_at_ms - namecom_api_now_ms();
+		timeout_ms = remaining_ms > 0 ? (long) remaining_ms : 0;
+	}
+
+	if( wake_ms > 0 && (timeout_ms < 0 || wake_ms < timeout_ms) )
+	{
+		timeout_ms = wake_ms;
+	}
+
+	api->timer_fxn( api, timeout_ms, api->event_user_data );
+}
+
+static void namecom_api_breaker_probed( namecom_api_t* api, namecom_api_request_t* request, void* user_data )
+{
+	namecom_api_request_destroy( request );
+}
+
+/*
+ * Puts a hello at the front of the queue to find out whether the service
+ * is back.  Called with the transport's mutex held.
+ */
+static void namecom_api_breaker_probe( namecom_api_transport_t* transport )
+{
+	namecom_api_t* api = transport->api;
+	namecom_api_request_t* probe = namecom_api_transport_request_create( transport, NAMECOM_API_ENDPOINT_HELLO, namecom_api_breaker_probed, NULL );
+
+	if( !probe )
+	{
+		/* Stay open and try again later. */
+		pthread_mutex_lock( &api->lock );
+		api->breaker_stats.state = NAMECOM_API_BREAKER_OPEN;
+		api->breaker_opened_ms   = namecom_api_now_ms();
+		pthread_mutex_unlock( &api->lock );
+		return;
+	}
+
+	if( api->verbose )
+	{
+		fprintf( stderr, "[WARNING] Probing whether the service is back.\n" );
+	}
+
+	snprintf( probe->url, sizeof(probe->url), NAMECOM_API_SCHEME "://%s/api/hello", api->api_server );
+	probe->internal    = true;
+	probe->probe       = true;
+	probe->deadline_ms = 0;
+	probe->state       = NAMECOM_API_REQUEST_QUEUED;
+	namecom_api_request_list_prepend( &transport->queued, probe );
+}
+
+/*
+ * Moves queued requests onto the multi handle until the concurrency
+ * cap is reached.
+ */
+static void namecom_api_start_queued( namecom_api_transport_t* transport )
+{
+	namecom_api_t* api = transport->api;
+
+	transport->admit_delay_ms = 0;
+	transport->retry_delay_ms = transport->retrying.head ? namecom_api_release_retries( transport ) : 0;
+
+	if( transport->active.head )
+	{
+		namecom_api_hedge_due( transport, true );
+	}
+
+	while( transport->queued.head && transport->active.count < api->max_concurrency )
+	{
+		namecom_api_request_t* next = transport->queued.head;
+
+		if( next->deadline_ms > 0 && next->deadline_ms <= namecom_api_now_ms() )
+		{
+			/* Too late to be worth sending. */
+			namecom_api_request_list_unlink( &transport->queued, next );
+
+			if( api->verbose )
+			{
+				fprintf( stderr, "[ERROR] The deadline passed before the request could be sent.\n" );
+			}
+
+			next->timed_out = true;
+			next->result    = false;
+			namecom_api_request_finish( next );
+			continue;
+		}
+
+		namecom_api_breaker_verdict_t verdict = next->probe ? NAMECOM_API_BREAKER_PASS : namecom_api_breaker_admit( api );
+
+		if( verdict == NAMECOM_API_BREAKER_PROBE )
+		{
+			namecom_api_breaker_probe( transport );
+			continue;
+		}
+		else if( verdict == NAMECOM_API_BREAKER_HOLD )
+		{
+			transport->admit_delay_ms = NAMECOM_API_LIMITER_POLL_MS;
+			break;
+		}
+		else if( verdict == NAMECOM_API_BREAKER_REJECT )
+		{
+			/* Fail fast rather than wait out a timeout against a service that is down. */
+			namecom_api_request_list_unlink( &transport->queued, next );
+
+			if( api->verbose )
+			{
+				fprintf( stderr, "[ERROR] The service is unavailable; the request was not sent.\n" );
+			}
+
+			next->rejected = true;
+			next->result   = false;
+			namecom_api_request_finish( next );
+			continue;
+		}
+
+		long delay_ms = namecom_api_admit( api );
+
+		if( delay_ms > 0 )
+		{
+			transport->admit_delay_ms = delay_ms;
+			break;
+		}
+
+		namecom_api_request_t* request = transport->queued.head;
+		namecom_api_request_list_unlink( &transport->queued, request );
+
+		request->curl = namecom_api_acquire_handle( transport );
+
+		if( !request->curl )
+		{
+			namecom_api_request_list_append( &transport->active, request );
+			namecom_api_request_complete( request, CURLE_OUT_OF_MEMORY );
+			continue;
+		}
+
+		request->hedge_at_ms = 0;
+		request->timed_out   = false;
+		request->rejected    = false;
+
+		long long now_ms = namecom_api_now_ms();
+
+		pthread_mutex_lock( &api->lock );
+		request->headers       = api->headers;
+		request->with_session  = api->session_token != NULL;
+		request->session_epoch = api->session_epoch;
+		request->headers->refs += 1;
+
+		long connect_timeout_ms = api->connect_timeout_ms;
+		long timeout_ms         = api->timeout_ms;
+
+		if( api->hedge_percentile > 0.0 && !request->hedge_of && namecom_api_request_can_hedge( request ) )
+		{
+			request->hedge_at_ms = now_ms + api->latencies[ request->endpoint ].delay_ms;
+		}
+		pthread_mutex_unlock( &api->lock );
+
+		/*
+		 * What is left before the deadline bounds the whole request, and
+		 * connecting (with the TLS handshake) gets no more than its own
+		 * share of that.
+		 */
+		if( request->deadline_ms > 0 )
+		{
+			long long remaining_ms = request->deadline_ms > now_ms ? request->deadline_ms - now_ms : 1;
+
+			if( timeout_ms == 0 || remaining_ms < timeout_ms )
+			{
+				timeout_ms = (long) remaining_ms;
+			}
+		}
+
+		if( timeout_ms > 0 && (connect_timeout_ms == 0 || connect_timeout_ms > timeout_ms) )
+		{
+			connect_timeout_ms = timeout_ms;
+		}
+
+		curl_easy_setopt( request->curl, CURLOPT_CONNECTTIMEOUT_MS, connect_timeout_ms );
+		curl_easy_setopt( request->curl, CURLOPT_TIMEOUT_MS, timeout_ms );
+
+		curl_easy_setopt( request->curl, CURLOPT_URL, request->url );
+		curl_easy_setopt( request->curl, CURLOPT_HTTPHEADER, request->headers->list );
+		curl_easy_setopt( request->curl, CURLOPT_WRITEDATA, request );
+		curl_easy_setopt( request->curl, CURLOPT_PRIVATE, request );
+
+		if( api->http2 )
+		{
+			/*
+			 * Offer HTTP/2 through ALPN and fall back to HTTP/1.1 if the
+			 * server doesn't negotiate it.  Waiting for the pipe lets new
+			 * requests become streams on an existing connection rather
+			 * than opening connections of their own.
+			 */
+			curl_easy_setopt( request->curl, CURLOPT_HTTP_VERSION, (long) CURL_HTTP_VERSION_2TLS );
+			curl_easy_setopt( request->curl, CURLOPT_PIPEWAIT, 1L );
+		}
+		else
+		{
+			curl_easy_setopt( request->curl, CURLOPT_HTTP_VERSION, (long) CURL_HTTP_VERSION_1_1 );
+			curl_easy_setopt( request->curl, CURLOPT_PIPEWAIT, 0L );
+		}
+
+		if( request->is_post )
+		{
+			curl_easy_setopt( request->curl, CURLOPT_POSTFIELDSIZE, (long) request->post_body.len );
+			curl_easy_setopt( request->curl, CURLOPT_POSTFIELDS, request->post_body.data );
+		}
+		else
+		{
+			curl_easy_setopt( request->curl, CURLOPT_HTTPGET, 1L );
+		}
+
+		request->state = NAMECOM_API_REQUEST_ACTIVE;
+		namecom_api_request_list_append( &transport->active, request );
+
+		CURLMcode mres = curl_multi_add_handle( transport->multi, request->curl );
+
+		if( mres != CURLM_OK )
+		{
+			fprintf( stderr, "[ERROR] %s\n", curl_multi_strerror(mres) );
+			namecom_api_request_complete( request, CURLE_FAILED_INIT );
+		}
+	}
+
+	transport->hedge_delay_ms = transport->active.head ? namecom_api_hedge_due( transport, false ) : 0;
+
+	if( transport == &api->transport && api->timer_fxn )
+	{
+		namecom_api_arm_timer( api );
+	}
+}
+
+static void namecom_api_release_parked( namecom_api_transport_t* transport, bool block );
+
+/*
+ * Hands finished transfers to their requests.
+ */
+static void namecom_api_process_completions( namecom_api_transport_t* transport )
+{
+	CURLMsg* msg;
+	int msgs_in_queue;
+
+	while( (msg = curl_multi_info_read( transport->multi, &msgs_in_queue )) )
+	{
+		if( msg->msg == CURLMSG_DONE )
+		{
+			namecom_api_request_t* request = NULL;
+			curl_easy_getinfo( msg->easy_handle, CURLINFO_PRIVATE, (char**) &request );
+
+			if( request )
+			{
+				namecom_api_request_complete( request, msg->data.result );
+			}
+		}
+	}
+
+	namecom_api_release_parked( transport, false );
+	namecom_api_start_queued( transport );
+}
+
+static size_t namecom_api_transport_run( namecom_api_transport_t* transport, int timeout_ms )
+{
+	int running = 0;
+
+	/* With nothing else to do, wait for another thread's login to finish. */
+	namecom_api_release_parked( transport, transport->active.count == 0 && transport->queued.count == 0 );
+	namecom_api_start_queued( transport );
+
+	long wake_ms = namecom_api_transport_wake_ms( transport );
+
+	if( wake_ms > 0 && wake_ms < timeout_ms )
+	{
+		/* Wake up in time to start what the limiter or a backoff is holding back. */
+		timeout_ms = (int) wake_ms;
+	}
+
+	if( transport->active.count > 0 )
+	{
+		CURLMcode mres = curl_multi_perform( transport->multi, &running );
+
+		if( mres == CURLM_OK && running > 0 && timeout_ms > 0 )
+		{
+			mres = curl_multi_poll( transport->multi, NULL, 0, timeout_ms, NULL );
+
+			if( mres == CURLM_OK )
+			{
+				mres = curl_multi_perform( transport->multi, &running );
+			}
+		}
+
+		if( mres != CURLM_OK )
+		{
+			fprintf( stderr, "[ERROR] %s\n", curl_multi_strerror(mres) );
+		}
+
+		namecom_api_process_completions( transport );
+	}
+	else if( wake_ms > 0 && timeout_ms > 0 )
+	{
+		/* Everything left is waiting for the limiter or a backoff. */
+		curl_multi_poll( transport->multi, NULL, 0, timeout_ms, NULL );
+		namecom_api_start_queued( transport );
+	}
+
+	return namecom_api_transport_pending( transport );
+}
+
+size_t namecom_api_run( namecom_api_t* api, int timeout_ms )
+{
+	namecom_api_transport_t* transport = namecom_api_current_transport( api );
+	size_t pending = 0;
+
+	pthread_mutex_lock( &transport->mutex );
+
+	if( transport == &api->transport && namecom_api_is_event_driven( api ) )
+	{
+		/* Transfers are driven by the host's event loop. */
+		pending = namecom_api_transport_pending( transport );
+	}
+	else
+	{
+		pending = namecom_api_transport_run( transport, timeout_ms );
+	}
+
+	pthread_mutex_unlock( &transport->mutex );
+
+	return pending;
+}
+
+static bool namecom_api_transport_wait( namecom_api_transport_t* transport, namecom_api_request_t* request )
+{
+	if( request )
+	{
+		while( request->state != NAMECOM_API_REQUEST_DONE )
+		{
+			namecom_api_transport_run( transport, 1000 );
+		}
+
+		return request->result;
+	}
+	else
+	{
+		while( namecom_api_transport_run( transport, 1000 ) > 0 )
+		{
+		}
+
+		return true;
+	}
+}
+
+bool namecom_api_wait( namecom_api_t* api, namecom_api_request_t* request )
+{
+	namecom_api_transport_t* transport = request ? request->transport : namecom_api_current_transport( api );
+	bool result = false;
+
+	pthread_mutex_lock( &transport->mutex );
+
+	if( transport == &api->transport && namecom_api_is_event_driven( api ) && namecom_api_transport_pending( transport ) > 0 )
+	{
+		fprintf( stderr, "[ERROR] Blocking calls are not available when the transport is driven by an event loop.\n" );
+		result = request ? request->state == NAMECOM_API_REQUEST_DONE && request->result : false;
+	}
+	else
+	{
+		result = namecom_api_transport_wait( transport, request );
+	}
+
+	pthread_mutex_unlock( &transport->mutex );
+
+	if( request )
+	{
+		namecom_api_set_last_error( api, result ? NAMECOM_API_ERROR_NONE : namecom_api_request_error( request ) );
+	}
+
+	return result;
+}
+
+static int namecom_api_socket_callback( CURL* curl, curl_socket_t fd, int what, void* userp, void* socketp )
+{
+	namecom_api_t* api = userp;
+	int events = NAMECOM_API_EVENT_NONE;
+
+	switch( what )
+	{
+		case CURL_POLL_IN:
+			events = NAMECOM_API_EVENT_IN;
+			break;
+		case CURL_POLL_OUT:
+			events = NAMECOM_API_EVENT_OUT;
+			break;
+		case CURL_POLL_INOUT:
+			events = NAMECOM_API_EVENT_IN | NAMECOM_API_EVENT_OUT;
+			break;
+		case CURL_POLL_REMOVE:
+		default:
+			events = NAMECOM_API_EVENT_REMOVE;
+			break;
+	}
+
+	api->socket_fxn( api, fd, events, api->event_user_data );
+
+	return 0;
+}
+
+static int namecom_api_timer_callback( CURLM* multi, long timeout_ms, void* userp )
+{
+	namecom_api_t* api = userp;
+
+	api->curl_timer_at_ms = timeout_ms >= 0 ? namecom_api_now_ms() + timeout_ms : -1;
+	namecom_api_arm_timer( api );
+
+	return 0;
+}
+
+bool namecom_api_set_event_callbacks( namecom_api_t* api, namecom_api_socket_fxn_t socket_fxn, namecom_api_timer_fxn_t timer_fxn, void* user_data )
+{
+	if( namecom_api_transport_pending( &api->transport ) > 0 || (socket_fxn == NULL) != (timer_fxn == NULL) )
+	{
+		/* Switching drivers with transfers in flight isn't supported. */
+		return false;
+	}
+
+	/* Only the default transport is handed to the host's event loop. */
+
+	api->socket_fxn      = socket_fxn;
+	api->timer_fxn       = timer_fxn;
+	api->event_user_data = user_data;
+	api->curl_timer_at_ms = -1;
+
+	if( socket_fxn )
+	{
+		curl_multi_setopt( api->transport.multi, CURLMOPT_SOCKETFUNCTION, namecom_api_socket_callback );
+		curl_multi_setopt( api->transport.multi, CURLMOPT_SOCKETDATA, api );
+		curl_multi_setopt( api->transport.multi, CURLMOPT_TIMERFUNCTION, namecom_api_timer_callback );
+		curl_multi_setopt( api->transport.multi, CURLMOPT_TIMERDATA, api );
+	}
+	else
+	{
+		curl_multi_setopt( api->transport.multi, CURLMOPT_SOCKETFUNCTION, NULL );
+		curl_multi_setopt( api->transport.multi, CURLMOPT_SOCKETDATA, NULL );
+		curl_multi_setopt( api->transport.multi, CURLMOPT_TIMERFUNCTION, NULL );
+		curl_multi_setopt( api->transport.multi, CURLMOPT_TIMERDATA, NULL );
+	}
+
+	return true;
+}
+
+bool namecom_api_is_event_driven( const namecom_api_t* api )
+{
+	return api->socket_fxn != NULL;
+}
+
+size_t namecom_api_on_socket_event( namecom_api_t* api, curl_socket_t fd, int events )
+{
+	int running = 0;
+	int mask = 0;
+
+	if( events & NAMECOM_API_EVENT_IN )    mask |= CURL_CSELECT_IN;
+	if( events & NAMECOM_API_EVENT_OUT )   mask |= CURL_CSELECT_OUT;
+	if( events & NAMECOM_API_EVENT_ERROR ) mask |= CURL_CSELECT_ERR;
+
+	pthread_mutex_lock( &api->transport.mutex );
+
+	CURLMcode mres = curl_multi_socket_action( api->transport.multi, fd, mask, &running );
+
+	if( mres != CURLM_OK )
+	{
+		fprintf( stderr, "[ERROR] %s\n", curl_multi_strerror(mres) );
+	}
+
+	namecom_api_process_completions( &api->transport );
+
+	size_t pending = namecom_api_transport_pending( &api->transport );
+
+	pthread_mutex_unlock( &api->transport.mutex );
+
+	return pending;
+}
+
+size_t namecom_api_on_timeout( namecom_api_t* api )
+{
+	pthread_mutex_lock( &api->transport.mutex );
+
+	if( api->curl_timer_at_ms >= 0 && api->curl_timer_at_ms <= namecom_api_now_ms() )
+	{
+		/* libcurl reports its next deadline, if it has one, as it handles this one. */
+		api->curl_timer_at_ms = -1;
+	}
+
+	pthread_mutex_unlock( &api->transport.mutex );
+
+	return namecom_api_on_socket_event( api, CURL_SOCKET_TIMEOUT, NAMECOM_API_EVENT_NONE );
+}
+
+/*
+ * Requests are recycled through a free list so that, in steady state, a
+ * request and its scratch buffers are reused rather than allocated.
+ */
+static namecom_api_request_t* namecom_api_transport_request_create( namecom_api_transport_t* transport, namecom_api_endpoint_t endpoint, namecom_api_completion_fxn_t on_complete, void* user_data )
+{
+	namecom_api_t* api = transport->api;
+	scratch_buffer_t post_body     = { .data = NULL, .len = 0, .capacity = 0 };
+	scratch_buffer_t response_body = { .data = NULL, .len = 0, .capacity = 0 };
+	namecom_record_decoder_t* decoder = NULL;
+
+	pthread_mutex_lock( &transport->mutex );
+	namecom_api_request_t* request = transport->free_requests.head;
+
+	if( request )
+	{
+		namecom_api_request_list_unlink( &transport->free_requests, request );
+	}
+	pthread_mutex_unlock( &transport->mutex );
+
+	if( request )
+	{
+		post_body     = request->post_body;
+		response_body = request->response_body;
+		decoder       = request->decoder;
+	}
+	else
+	{
+		request = malloc( sizeof(namecom_api_request_t) );
+
+		if( !request )
+		{
+			return NULL;
+		}
+
+		namecom_api_count_allocation( api );
+	}
+
+	memset( request, 0, sizeof(namecom_api_request_t) );
+
+	request->api           = api;
+	request->transport     = transport;
+	request->endpoint      = endpoint;
+	request->state         = NAMECOM_API_REQUEST_DONE;
+	request->code          = -1;
+	request->record_id     = -1;
+	request->on_complete   = on_complete;
+	request->user_data     = user_data;
+	request->post_body     = post_body;
+	request->response_body = response_body;
+	request->decoder       = decoder;
+	request->deadline_ms   = namecom_api_deadline( api );
+
+	scratch_buffer_reset( &request->post_body );
+	scratch_buffer_reset( &request->response_body );
+
+	return request;
+}
+
+static namecom_api_request_t* namecom_api_request_create( namecom_api_t* api, namecom_api_endpoint_t endpoint, namecom_api_completion_fxn_t on_complete, void* user_data )
+{
+	return namecom_api_transport_request_create( namecom_api_current_transport( api ), endpoint, on_complete, user_data );
+}
+
+static bool namecom_api_request_set_post_body( namecom_api_request_t* request, const char* format, ... )
+{
+	scratch_buffer_t* buffer = &request->post_body;
+	va_list args;
+
+	va_start( args, format );
+	int len = vsnprintf( buffer->data, buffer->capacity, format, args );
+	va_end( args );
+
+	if( len < 0 )
+	{
+		return false;
+	}
+
+	if( (size_t) len >= buffer->capacity )
+	{
+		if( !scratch_buffer_reserve( request->api, buffer, (size_t) len + 1 ) )
+		{
+			return false;
+		}
+
+		va_start( args, format );
+		vsnprintf( buffer->data, buffer->capacity, format, args );
+		va_end( args );
+	}
+
+	buffer->len      = (size_t) len;
+	request->is_post = true;
+
+	return true;
+}
+
+/*
+ * Sets the body to a JSON value, which is released.  Unlike a format
+ * string, this escapes quotes and backslashes in values such as TXT
+ * answers.
+ */
+static bool namecom_api_request_set_post_json( namecom_api_request_t* request, json_t* body )
+{
+	char* text = body ? json_dumps( body, JSON_COMPACT ) : NULL;
+	bool result = text && namecom_api_request_set_post_body( request, "%s", text );
+
+	free( text );
+	json_decref( body );
+
+	return result;
+}
+
+static void namecom_api_request_free( namecom_api_request_t* request )
+{
+	scratch_buffer_release( &request->post_body );
+	scratch_buffer_release( &request->response_body );
+	namecom_record_decoder_destroy( request->decoder );
+	free( request );
+}
+
+static void namecom_api_request_submit( namecom_api_request_t* request )
+{
+	namecom_api_transport_t* transport = request->transport;
+
+	pthread_mutex_lock( &transport->mutex );
+	request->state = NAMECOM_API_REQUEST_QUEUED;
+	namecom_api_request_list_append( &transport->queued, request );
+	namecom_api_start_queued( transport );
+	pthread_mutex_unlock( &transport->mutex );
+}
+
+/*
+ * Even a failed or cancelled change may have been applied, so the zone
+ * is treated as changed either way.
+ */
+static void namecom_api_zone_changed( namecom_api_request_t* request )
+{
+	namecom_api_t* api = request->api;
+
+	if( request->endpoint == NAMECOM_API_ENDPOINT_DNS_RECORD_ADD || request->endpoint == NAMECOM_API_ENDPOINT_DNS_RECORD_REMOVE ||
+	    request->endpoint == NAMECOM_API_ENDPOINT_DNS_RECORD_UPDATE )
+	{
+		pthread_mutex_lock( &api->lock );
+		api->zone_epoch += 1;
+
+		if( api->zone_cache )
+		{
+			namecom_zone_cache_invalidate( api->zone_cache, request->domain );
+		}
+
+		if( api->zone_snapshot_directory )
+		{
+			namecom_zone_snapshot_remove( api->zone_snapshot_directory, request->domain );
+		}
+		pthread_mutex_unlock( &api->lock );
+	}
+}
+
+static void namecom_api_dns_records_destroy( namecom_api_dns_record_t** records )
+{
+	for( size_t i = 0; i < lc_vector_size(records); i++ )
+	{
+		namecom_api_dns_record_destroy( records[ i ] );
+	}
+
+	lc_vector_destroy( records );
+}
+
+/*
+ * Stops the transfer of an active request.
+ */
+static void namecom_api_request_abort( namecom_api_request_t* request )
+{
+	namecom_api_t* api = request->api;
+	namecom_api_transport_t* transport = request->transport;
+
+	curl_multi_remove_handle( transport->multi, request->curl );
+	namecom_api_request_list_unlink( &transport->active, request );
+	namecom_api_release_handle( transport, request->curl );
+	request->curl = NULL;
+
+	pthread_mutex_lock( &api->lock );
+	if( api->in_flight > 0 ) api->in_flight -= 1;
+	namecom_api_headers_release( request->headers );
+	request->headers = NULL;
+	pthread_mutex_unlock( &api->lock );
+}
+
+void namecom_api_request_destroy( namecom_api_request_t* request )
+{
+	if( request )
+	{
+		namecom_api_t* api = request->api;
+		namecom_api_transport_t* transport = request->transport;
+
+		if( !api )
+		{
+			/* Detached when its handle was destroyed. */
+			if( request->records ) namecom_api_dns_records_destroy( request->records );
+			if( request->record_set ) namecom_record_set_destroy( request->record_set );
+			namecom_api_request_free( request );
+			return;
+		}
+
+		pthread_mutex_lock( &transport->mutex );
+
+		if( request->hedge )
+		{
+			/* A duplicate racing this request has nothing left to answer for. */
+			namecom_api_request_t* hedge = request->hedge;
+			request->hedge  = NULL;
+			hedge->hedge_of = NULL;
+			namecom_api_request_destroy( hedge );
+		}
+		else if( request->hedge_of )
+		{
+			request->hedge_of->hedge = NULL;
+			request->hedge_of = NULL;
+		}
+
+		if( request->state == NAMECOM_API_REQUEST_ACTIVE )
+		{
+			namecom_api_request_abort( request );
+			namecom_api_zone_changed( request );
+			namecom_api_start_queued( transport );
+		}
+		else if( request->state == NAMECOM_API_REQUEST_QUEUED )
+		{
+			namecom_api_request_list_unlink( &transport->queued, request );
+		}
+		else if( request->state == NAMECOM_API_REQUEST_AUTHENTICATING )
+		{
+			namecom_api_request_list_unlink( &transport->authenticating, request );
+		}
+		else if( request->state == NAMECOM_API_REQUEST_BACKING_OFF )
+		{
+			namecom_api_request_list_unlink( &transport->retrying, request );
+		}
+
+		if( request->headers )
+		{
+			pthread_mutex_lock( &api->lock );
+			namecom_api_headers_release( request->headers );
+			pthread_mutex_unlock( &api->lock );
+			request->headers = NULL;
+		}
+
+		if( request->records ) namecom_api_dns_records_destroy( request->records );
+		if( request->record_set ) namecom_record_set_destroy( request->record_set );
+
+		if( transport->free_requests.count < NAMECOM_API_MAX_FREE_REQUESTS )
+		{
+			/* Don't hang on to the occasional huge response. */
+			if( request->response_body.capacity > NAMECOM_API_SCRATCH_RETAIN_CAPACITY )
+			{
+				scratch_buffer_release( &request->response_body );
+			}
+
+			request->state = NAMECOM_API_REQUEST_DONE;
+			namecom_api_request_list_append( &transport->free_requests, request );
+		}
+		else
+		{
+			namecom_api_request_free( request );
+		}
+
+		pthread_mutex_unlock( &transport->mutex );
+	}
+}
+
+namecom_api_error_t namecom_api_request_error( const namecom_api_request_t* request )
+{
+	if( request->result )
+	{
+		return NAMECOM_API_ERROR_NONE;
+	}
+
+	if( request->rejected )
+	{
+		return NAMECOM_API_ERROR_UNAVAILABLE;
+	}
+
+	if( request->unsupported )
+	{
+		return NAMECOM_API_ERROR_UNSUPPORTED;
+	}
+
+	if( request->endpoint == NAMECOM_API_ENDPOINT_DNS_RECORD_LIST && request->decoder )
+	{
+		switch( namecom_record_decoder_error( request->decoder ) )
+		{
+			case NAMECOM_RECORD_DECODER_ERROR_MALFORMED:
+			case NAMECOM_RECORD_DECODER_ERROR_TRUNCATED:
+				return NAMECOM_API_ERROR_MALFORMED;
+			case NAMECOM_RECORD_DECODER_ERROR_OUT_OF_MEMORY:
+				return NAMECOM_API_ERROR_OUT_OF_MEMORY;
+			default:
+				break;
+		}
+	}
+
+	return request->timed_out ? NAMECOM_API_ERROR_TIMEOUT : NAMECOM_API_ERROR_FAILED;
+}
+
+bool namecom_api_request_is_done( const namecom_api_request_t* request )
+{
+	return request->state == NAMECOM_API_REQUEST_DONE;
+}
+
+bool namecom_api_request_succeeded( const namecom_api_request_t* request )
+{
+	return request->state == NAMECOM_API_REQUEST_DONE && request->result;
+}
+
+long namecom_api_request_record_id( const namecom_api_request_t* request )
+{
+	return request->record_id;
+}
+
+namecom_api_dns_record_t** namecom_api_request_take_records( namecom_api_request_t* request )
+{
+	namecom_api_dns_record_t** records = request->records;
+	request->records = NULL;
+	return records;
+}
+
+namecom_record_set_t* namecom_api_request_take_record_set( namecom_api_request_t* request )
+{
+	namecom_record_set_t* set = request->record_set;
+	request->record_set = NULL;
+	return set;
+}
+
+/*
+ * Parses the common {"result": {"code": ...}} envelope and reports
+ * whether the command was successful.
+ */
+static int namecom_api_result_code( json_t* root )
+{
+	json_t* result_obj = json_object_get( root, "result" );
+
+	if( json_is_object(result_obj) )
+	{
+		json_t* code_obj = json_object_get( result_obj, "code" );
+
+		if( json_is_integer(code_obj) )
+		{
+			return (int) json_integer_value( code_obj );
+		}
+	}
+
+	return -1;
+}
+
+static bool namecom_api_check_result( namecom_api_t* api, json_t* root )
+{
+	bool result = false;
+
+	if( root )
+	{
+		int code = namecom_api_result_code( root );
+		result = code == NAMECOM_API_RESPONSE_CODE_COMMAND_SUCCESSFUL;
+
+		if( !result && code >= 0 && api->verbose )
+		{
+			fprintf( stderr, "[ERROR] %s\n", namecom_api_code_string(code) );
+		}
+	}
+
+	return result;
+}
+
+static bool namecom_api_parse_login( namecom_api_request_t* request, json_t* root )
+{
+	namecom_api_t* api = request->api;
+	bool result = true;
+
+	json_t* session_token_obj = json_object_get( root, "session_token" );
+
+	if( json_is_string(session_token_obj) )
+	{
+		const char* session_token = json_string_value( session_token_obj );
+
+		pthread_mutex_lock( &api->lock );
+		result = namecom_api_swap_session_token( api, session_token );
+
+		if( result && api->session_cache_directory &&
+		    !namecom_session_cache_save( api->session_cache_directory, api->username, api->api_server, session_token ) )
+		{
+			fprintf( stderr, "[WARNING] Unable to save the session for reuse.\n" );
+		}
+		pthread_mutex_unlock( &api->lock );
+	}
+	else
+	{
+		if( api->verbose )
+		{
+			json_t* result_obj = json_object_get( root, "result" );
+
+			if( json_is_object(result_obj) )
+			{
+				json_t* code_obj = json_object_get( result_obj, "code" );
+
+				if( json_is_integer(code_obj) )
+				{
+					json_int_t code = json_integer_value( code_obj );
+					fprintf( stderr, "[ERROR] %s\n", namecom_api_code_string( code ) );
+				}
+			}
+		}
+		result = false;
+	}
+
+	return result;
+}
+
+static bool namecom_api_parse_logout( namecom_api_request_t* request, json_t* root )
+{
+	namecom_api_t* api = request->api;
+	bool result = namecom_api_check_result( api, root );
+
+	if( result )
+	{
+		namecom_api_set_session_token( api, NULL );
+	}
+
+	return result;
+}
+
+static bool namecom_api_collect_dns_record( namecom_api_dns_record_t* record, void* user_data )
+{
+	namecom_api_request_t* request = user_data;
+	lc_vector_push( request->records, record );
+	return true;
+}
+
+/*
+ * Record listings are decoded while they download, so by the time the
+ * transfer completes only the outcome is left to check.
+ */
+static bool namecom_api_finish_dns_record_list( namecom_api_request_t* request )
+{
+	bool result = namecom_record_decoder_finish( request->decoder );
+
+	if( result )
+	{
+		int code = namecom_record_decoder_result_code( request->decoder );
+		result = code == NAMECOM_API_RESPONSE_CODE_COMMAND_SUCCESSFUL;
+		request->code = code;
+
+		if( !result && request->api->verbose )
+		{
+			fprintf( stderr, "[ERROR] %s\n", namecom_api_code_string(code) );
+		}
+	}
+
+	/*
+	 * A listing that was in flight while a record changed may already be
+	 * stale, so it isn't cached.  Neither is a duplicate whose original
+	 * is no longer racing it, as the original's own answer will be.
+	 */
+	namecom_api_t* api = request->api;
+	bool loser = request->hedge_of && request->hedge_of->state != NAMECOM_API_REQUEST_ACTIVE;
+	bool snapshot = false;
+
+	pthread_mutex_lock( &api->lock );
+
+	if( result && !loser && request->record_set && request->zone_epoch == api->zone_epoch )
+	{
+		if( api->zone_cache )
+		{
+			namecom_zone_cache_put( api->zone_cache, request->domain, namecom_record_set_retain( request->record_set ), time(NULL) );
+		}
+
+		snapshot = api->zone_snapshot_directory != NULL;
+	}
+
+	pthread_mutex_unlock( &api->lock );
+
+	/*
+	 * The snapshot is written without holding the lock.  A change made in
+	 * the meantime may have removed the snapshot before it landed, in
+	 * which case it is removed again.
+	 */
+	if( snapshot )
+	{
+		if( !namecom_zone_snapshot_write( api->zone_snapshot_directory, request->domain, request->record_set, time(NULL) ) )
+		{
+			fprintf( stderr, "[WARNING] Unable to save a snapshot of %s.\n", request->domain );
+		}
+
+		pthread_mutex_lock( &api->lock );
+
+		if( request->zone_epoch != api->zone_epoch )
+		{
+			namecom_zone_snapshot_remove( api->zone_snapshot_directory, request->domain );
+		}
+
+		pthread_mutex_unlock( &api->lock );
+	}
+
+	return result;
+}
+
+/*
+ * Also used for updates, which answer with the id the record kept.
+ */
+static bool namecom_api_parse_dns_record_add( namecom_api_request_t* request, json_t* root )
+{
+	bool result = namecom_api_check_result( request->api, root );
+
+	if( result )
+	{
+		json_t* record_id_obj = json_object_get( root, "record_id" );
+
+		if( json_is_integer(record_id_obj) )
+		{
+			request->record_id = json_integer_value(record_id_obj);
+		}
+	}
+
+	return result;
+}
+
+static bool namecom_api_request_parse( namecom_api_request_t* request )
+{
+	bool result = false;
+
+	if( request->endpoint == NAMECOM_API_ENDPOINT_DNS_RECORD_LIST )
+	{
+		return namecom_api_finish_dns_record_list( request );
+	}
+
+	json_error_t error;
+	json_t* root = request->response_body.data ? json_loadb( request->response_body.data, request->response_body.len, 0, &error ) : NULL;
+
+	if( root )
+	{
+		request->code = namecom_api_result_code( root );
+
+		switch( request->endpoint )
+		{
+			case NAMECOM_API_ENDPOINT_LOGIN:
+				result = namecom_api_parse_login( request, root );
+				break;
+			case NAMECOM_API_ENDPOINT_LOGOUT:
+				result = namecom_api_parse_logout( request, root );
+				break;
+			case NAMECOM_API_ENDPOINT_DNS_RECORD_ADD:
+			case NAMECOM_API_ENDPOINT_DNS_RECORD_UPDATE:
+				result = namecom_api_parse_dns_record_add( request, root );
+				break;
+			case NAMECOM_API_ENDPOINT_HELLO:
+			case NAMECOM_API_ENDPOINT_DOMAINS_LIST:
+			case NAMECOM_API_ENDPOINT_DNS_RECORD_LIST:
+			case NAMECOM_API_ENDPOINT_DNS_RECORD_REMOVE:
+			default:
+				result = namecom_api_check_result( request->api, root );
+				break;
+		}
+	}
+
+	json_decref( root );
+
+	return result;
+}
+
+static void namecom_api_request_finish( namecom_api_request_t* request )
+{
+	namecom_api_t* api = request->api;
+
+	if( !request->result && request->records )
+	{
+		namecom_api_dns_records_destroy( request->records );
+		request->records = NULL;
+	}
+
+	if( !request->result && request->record_set )
+	{
+		namecom_record_set_destroy( request->record_set );
+		request->record_set = NULL;
+	}
+
+	namecom_api_zone_changed( request );
+
+	request->state = NAMECOM_API_REQUEST_DONE;
+
+	/* The callback may destroy the request, so it must be the last thing to touch it. */
+	if( request->on_complete )
+	{
+		request->on_complete( api, request, request->user_data );
+	}
+}
+
+/*
+ * Clears the response of a request that is about to be sent again.
+ */
+static void namecom_api_request_rewind( namecom_api_request_t* request )
+{
+	scratch_buffer_reset( &request->response_body );
+
+	if( request->endpoint == NAMECOM_API_ENDPOINT_DNS_RECORD_LIST )
+	{
+		namecom_record_decoder_rewind( request->decoder );
+	}
+
+	request->result = false;
+	request->code   = -1;
+}
+
+/*
+ * Sends a request that was turned away with a stale session again,
+ * starting over on a clean response.
+ */
+static void namecom_api_request_resubmit( namecom_api_request_t* request )
+{
+	namecom_api_request_rewind( request );
+	namecom_api_request_submit( request );
+}
+
+static namecom_api_request_t* namecom_api_transport_submit_login( namecom_api_transport_t* transport, bool internal, namecom_api_completion_fxn_t on_complete, void* user_data );
+
+/*
+ * Once no login is in flight, requests parked on the transport run again
+ * with the new session, or fail if there isn't one.  When blocking, this
+ * waits for a login that another thread is driving.  Called with the
+ * transport's mutex held.
+ */
+static void namecom_api_release_parked( namecom_api_transport_t* transport, bool block )
+{
+	namecom_api_t* api = transport->api;
+
+	if( !transport->authenticating.head )
+	{
+		return;
+	}
+
+	pthread_mutex_lock( &api->lock );
+
+	/* A login queued on this transport only makes progress while it runs. */
+	while( block && api->login_in_flight && api->login_transport != transport )
+	{
+		pthread_cond_wait( &api->session_changed, &api->lock );
+	}
+
+	bool in_flight   = api->login_in_flight;
+	bool has_session = api->session_token != NULL;
+
+	pthread_mutex_unlock( &api->lock );
+
+	if( in_flight )
+	{
+		return;
+	}
+
+	while( transport->authenticating.head )
+	{
+		namecom_api_request_t* request = transport->authenticating.head;
+		namecom_api_request_list_unlink( &transport->authenticating, request );
+
+		if( has_session )
+		{
+			namecom_api_request_resubmit( request );
+		}
+		else
+		{
+			namecom_api_request_finish( request );
+		}
+	}
+}
+
+static void namecom_api_relogin_complete( namecom_api_t* api, namecom_api_request_t* relogin, void* user_data )
+{
+	namecom_api_transport_t* transport = relogin->transport;
+	bool result = namecom_api_request_succeeded( relogin );
+
+	pthread_mutex_lock( &api->lock );
+	api->login_in_flight = false;
+	api->login_transport = NULL;
+
+	if( !result && api->session_cache_directory )
+	{
+		namecom_session_cache_remove( api->session_cache_directory, api->username, api->api_server );
+	}
+
+	pthread_cond_broadcast( &api->session_changed );
+	pthread_mutex_unlock( &api->lock );
+
+	namecom_api_request_destroy( relogin );
+	namecom_api_release_parked( transport, false );
+}
+
+/*
+ * Sessions expire (and a reused one may have been logged out elsewhere),
+ * so a request that was refused for its session logs in again and then
+ * runs once more.  Requests that fail together, on any thread, share a
+ * single login; the others are parked until it completes.
+ */
+static bool namecom_api_request_reauthenticate( namecom_api_request_t* request )
+{
+	namecom_api_t* api = request->api;
+	namecom_api_transport_t* transport = request->transport;
+	bool login = false;
+
+	if( (request->code != NAMECOM_API_RESPONSE_CODE_AUTHORIZATION_ERROR && request->code != NAMECOM_API_RESPONSE_CODE_AUTHENTICATION_ERROR) ||
+	    request->endpoint == NAMECOM_API_ENDPOINT_LOGIN || request->endpoint == NAMECOM_API_ENDPOINT_LOGOUT ||
+	    !request->with_session || request->reauthenticated ||
+	    (request->endpoint == NAMECOM_API_ENDPOINT_DNS_RECORD_LIST && namecom_record_decoder_count( request->decoder ) > 0) )
+	{
+		return false;
+	}
+
+	request->reauthenticated = true;
+
+	pthread_mutex_lock( &api->lock );
+
+	if( !api->login_in_flight && api->session_token && request->session_epoch != api->session_epoch )
+	{
+		/* The session was already renewed while this one was in flight. */
+		pthread_mutex_unlock( &api->lock );
+		namecom_api_request_resubmit( request );
+		return true;
+	}
+
+	if( !api->login_in_flight )
+	{
+		/* Log in with the account credentials rather than the stale token. */
+		if( !namecom_api_swap_session_token( api, NULL ) )
+		{
+			pthread_mutex_unlock( &api->lock );
+			return false;
+		}
+
+		api->login_in_flight = true;
+		api->login_transport = transport;
+		login = true;
+	}
+
+	pthread_mutex_unlock( &api->lock );
+
+	request->state = NAMECOM_API_REQUEST_AUTHENTICATING;
+	namecom_api_request_list_append( &transport->authenticating, request );
+
+	if( login )
+	{
+		namecom_api_request_t* relogin = namecom_api_transport_submit_login( transport, true, namecom_api_relogin_complete, NULL );
+
+		if( !relogin )
+		{
+			pthread_mutex_lock( &api->lock );
+			api->login_in_flight = false;
+			api->login_transport = NULL;
+			pthread_cond_broadcast( &api->session_changed );
+			pthread_mutex_unlock( &api->lock );
+
+			/* Parked requests, this one included, fail without a session. */
+			namecom_api_release_parked( transport, false );
+			return true;
+		}
+	}
+
+	return true;
+}
+
+/*
+ * Whether a failure may pass if the request is sent again and, through
+ * unsent, whether the server can't have acted on the request.
+ */
+static bool namecom_api_is_transient( CURLcode res, long http_status, int code, bool* unsent )
+{
+	switch( res )
+	{
+		case CURLE_COULDNT_RESOLVE_PROXY:
+		case CURLE_COULDNT_RESOLVE_HOST:
+		case CURLE_COULDNT_CONNECT:
+		case CURLE_SSL_CONNECT_ERROR:
+			*unsent = true;
+			return true;
+		case CURLE_OPERATION_TIMEDOUT:
+		case CURLE_SEND_ERROR:
+		case CURLE_RECV_ERROR:
+		case CURLE_GOT_NOTHING:
+		case CURLE_PARTIAL_FILE:
+		case CURLE_HTTP2:
+		case CURLE_HTTP2_STREAM:
+			*unsent = false;
+			return true;
+		default:
+			break;
+	}
+
+	*unsent = http_status == 429;
+
+	return http_status == 429 || http_status == 500 || http_status == 502 || http_status == 503 || http_status == 504 ||
+	       (res == CURLE_OK && code == NAMECOM_API_RESPONSE_CODE_UNEXPECTED_ERROR);
+}
+
+/*
+ * A xorshift64* generator; backoffs only need to be spread out, not
+ * unpredictable.  Called with the lock held.
+ */
+static unsigned long long namecom_api_jitter( namecom_api_t* api )
+{
+	api->jitter ^= api->jitter >> 12;
+	api->jitter ^= api->jitter << 25;
+	api->jitter ^= api->jitter >> 27;
+	return api->jitter * 0x2545f4914f6cdd1dULL;
+}
+
+/*
+ * Parks a request that failed transiently until its backoff is over, if
+ * the policy and the budget allow another attempt.
+ */
+static bool namecom_api_request_retry( namecom_api_request_t* request, CURLcode res, long http_status, long retry_after_ms )
+{
+	namecom_api_t* api = request->api;
+	namecom_api_transport_t* transport = request->transport;
+	bool unsent = false;
+
+	if( request->probe || !namecom_api_is_transient( res, http_status, request->code, &unsent ) ||
+	    (request->endpoint == NAMECOM_API_ENDPOINT_DNS_RECORD_ADD && !unsent) ||
+	    (request->endpoint == NAMECOM_API_ENDPOINT_DNS_RECORD_LIST && namecom_record_decoder_count( request->decoder ) > 0) )
+	{
+		return false;
+	}
+
+	pthread_mutex_lock( &api->lock );
+	const namecom_api_retry_policy_t* policy = &api->retry_policy;
+
+	if( request->retries + 1 >= policy->max_attempts || retry_after_ms > policy->max_delay_ms )
+	{
+		pthread_mutex_unlock( &api->lock );
+		return false;
+	}
+
+	/* Full jitter: anywhere between nothing and the exponential ceiling. */
+	long ceiling_ms = policy->base_delay_ms;
+
+	for( unsigned int i = 0; i < request->retries && ceiling_ms < policy->max_delay_ms; i++ )
+	{
+		ceiling_ms *= 2;
+	}
+
+	if( ceiling_ms > policy->max_delay_ms )
+	{
+		ceiling_ms = policy->max_delay_ms;
+	}
+
+	long delay_ms = (long) (namecom_api_jitter( api ) % (unsigned long long) (ceiling_ms + 1));
+
+	if( delay_ms < retry_after_ms )
+	{
+		delay_ms = retry_after_ms;
+	}
+
+	if( request->deadline_ms > 0 && namecom_api_now_ms() + delay_ms >= request->deadline_ms )
+	{
+		/* The retry couldn't be sent before the deadline. */
+		pthread_mutex_unlock( &api->lock );
+		return false;
+	}
+
+	if( api->retry_tokens < 1.0 )
+	{
+		api->connection_stats.retries_denied += 1;
+		pthread_mutex_unlock( &api->lock );
+		return false;
+	}
+
+	api->retry_tokens -= 1.0;
+	api->connection_stats.retries += 1;
+	pthread_mutex_unlock( &api->lock );
+
+	if( api->verbose )
+	{
+		if( res != CURLE_OK )
+			fprintf( stderr, "[WARNING] %s; retrying in %ld ms.\n", curl_easy_strerror(res), delay_ms );
+		else if( http_status >= 400 )
+			fprintf( stderr, "[WARNING] The server answered %ld; retrying in %ld ms.\n", http_status, delay_ms );
+		else
+			fprintf( stderr, "[WARNING] %s; retrying in %ld ms.\n", namecom_api_code_string(request->code), delay_ms );
+	}
+
+	request->retries    += 1;
+	request->retry_at_ms = namecom_api_now_ms() + delay_ms;
+	request->state       = NAMECOM_API_REQUEST_BACKING_OFF;
+	namecom_api_request_list_append( &transport->retrying, request );
+
+	return true;
+}
+
+/*
+ * Sends a duplicate of a read that is taking longer than usual.
+ */
+static void namecom_api_request_hedge( namecom_api_request_t* request )
+{
+	namecom_api_t* api = request->api;
+	namecom_api_transport_t* transport = request->transport;
+	namecom_api_request_t* hedge = namecom_api_transport_request_create( transport, request->endpoint, NULL, NULL );
+
+	if( !hedge )
+	{
+		return;
+	}
+
+	/* The original's deadline governs; when it runs out, the duplicate goes with it. */
+	hedge->internal    = true;
+	hedge->deadline_ms = 0;
+	hedge->zone_epoch  = request->zone_epoch;
+	snprintf( hedge->url, sizeof(hedge->url), "%s", request->url );
+	snprintf( hedge->domain, sizeof(hedge->domain), "%s", request->domain );
+
+	if( request->endpoint == NAMECOM_API_ENDPOINT_DNS_RECORD_LIST )
+	{
+		/* The duplicate collects into its own records, the same way as the original. */
+		namecom_api_dns_record_fxn_t on_record = NULL;
+
+		if( request->record_set )
+		{
+			hedge->record_set = namecom_record_set_create( 0 );
+		}
+		else
+		{
+			lc_vector_create( hedge->records, 5 );
+			on_record = namecom_api_collect_dns_record;
+		}
+
+		if( hedge->decoder )
+		{
+			namecom_record_decoder_reset( hedge->decoder, on_record, hedge );
+		}
+		else
+		{
+			hedge->decoder = namecom_record_decoder_create( on_record, hedge );
+			namecom_api_count_allocation( api );
+		}
+
+		if( !hedge->decoder || (!hedge->record_set && !hedge->records) )
+		{
+			namecom_api_request_destroy( hedge );
+			return;
+		}
 
-		char header_content_type[ 256 ];
-		snprintf( header_content_type, sizeof(header_content_type), "Content-Type: application/json" );
+		if( hedge->record_set )
+		{
+			namecom_record_decoder_collect( hedge->decoder, hedge->record_set );
+		}
+	}
 
-		char header_user_agent[ 256 ];
-		snprintf( header_user_agent, sizeof(header_user_agent), "User-Agent: %s v%s", NAMECOM_API_USERAGENT, NAMECOM_API_VERSION );
+	pthread_mutex_lock( &api->lock );
+	api->connection_stats.hedges += 1;
+	pthread_mutex_unlock( &api->lock );
 
+	hedge->hedge_of = request;
+	request->hedge  = hedge;
+	hedge->state    = NAMECOM_API_REQUEST_QUEUED;
+	namecom_api_request_list_append( &transport->queued, hedge );
+}
 
-		struct curl_slist* headers_list = NULL;
-		headers_list = curl_slist_append( headers_list, header_content_type );
-		headers_list = curl_slist_append( headers_list, header_user_agent );
-		namecom_api_set_authentication_headers( api, headers_list );
+/*
+ * Successful requests earn back part of a retry.
+ */
+static void namecom_api_earn_retry( namecom_api_t* api )
+{
+	pthread_mutex_lock( &api->lock );
+	api->retry_tokens += api->retry_policy.budget_ratio;
 
-		curl_easy_setopt( curl, CURLOPT_HTTPHEADER, headers_list );
+	if( api->retry_tokens > api->retry_policy.budget )
+	{
+		api->retry_tokens = api->retry_policy.budget;
+	}
+	pthread_mutex_unlock( &api->lock );
+}
 
-		response_body_t response_body = { .text = NULL, .len = 0 };
+/*
+ * The duplicate of a slow read has finished.  If it succeeded, its answer
+ * is moved to the original, whose transfer is cancelled; otherwise the
+ * original carries on by itself.
+ */
+static void namecom_api_hedge_complete( namecom_api_request_t* hedge )
+{
+	namecom_api_t* api = hedge->api;
+	namecom_api_request_t* request = hedge->hedge_of;
 
-		curl_easy_setopt( curl, CURLOPT_WRITEFUNCTION, namecom_api_writefunc );
-		curl_easy_setopt( curl, CURLOPT_WRITEDATA, &response_body );
+	request->hedge  = NULL;
+	hedge->hedge_of = NULL;
+	hedge->state    = NAMECOM_API_REQUEST_DONE;
 
-		curl_easy_setopt( curl, CURLOPT_VERBOSE, NAMECOM_API_VERBOSE );
+	if( hedge->result && request->state == NAMECOM_API_REQUEST_ACTIVE )
+	{
+		namecom_api_request_abort( request );
+
+		namecom_record_set_t* record_set = request->record_set;
+		namecom_api_dns_record_t** records = request->records;
+		namecom_record_decoder_t* decoder = request->decoder;
+		scratch_buffer_t response_body = request->response_body;
+
+		request->record_set    = hedge->record_set;
+		request->records       = hedge->records;
+		request->decoder       = hedge->decoder;
+		request->response_body = hedge->response_body;
+		request->code          = hedge->code;
+		request->result        = true;
+
+		hedge->record_set    = record_set;
+		hedge->records       = records;
+		hedge->decoder       = decoder;
+		hedge->response_body = response_body;
+
+		pthread_mutex_lock( &api->lock );
+		api->connection_stats.hedges_won += 1;
+		pthread_mutex_unlock( &api->lock );
+
+		namecom_api_request_destroy( hedge );
+		namecom_api_earn_retry( api );
+		namecom_api_request_finish( request );
+		return;
+	}
 
-		/*
-		 * If you want to connect to a site who isn't using a certificate that is
-		 * signed by one of the certs in the CA bundle you have, you can skip the
-		 * verification of the server's certificate. This makes the connection
-		 * A LOT LESS SECURE.
-		 *
-		 * If you have a CA cert for the server stored someplace else than in the
-		 * default bundle, then the CURLOPT_CAPATH option might come handy for
-		 * you.
-		 */
-		curl_easy_setopt( curl, CURLOPT_SSL_VERIFYPEER, 0L );
+	namecom_api_request_destroy( hedge );
+}
 
-		/*
-		 * If the site you're connecting to uses a different host name that what
-		 * they have mentioned in their server certificate's commonName (or
-		 * subjectAltName) fields, libcurl will refuse to connect. You can skip
-		 * this check, but this will make the connection less secure.
-		 */
-		curl_easy_setopt( curl, CURLOPT_SSL_VERIFYHOST, 0L );
+static void namecom_api_request_complete( namecom_api_request_t* request, CURLcode res )
+{
+	namecom_api_t* api = request->api;
+	namecom_api_transport_t* transport = request->transport;
+	long http_status = 0;
+	long retry_after_ms = 0;
+	double latency_ms = 0.0;
+	const char* timeout_phase = NULL;
+
+	if( request->curl )
+	{
+		if( res == CURLE_OPERATION_TIMEDOUT )
+		{
+			/*
+			 * The times are zero for the phases that never finished; a
+			 * reused connection goes straight to the transfer.
+			 */
+			curl_off_t connect_us = 0;
+			curl_off_t pretransfer_us = 0;
+			curl_easy_getinfo( request->curl, CURLINFO_CONNECT_TIME_T, &connect_us );
+			curl_easy_getinfo( request->curl, CURLINFO_PRETRANSFER_TIME_T, &pretransfer_us );
+
+			if( pretransfer_us > 0 )
+				timeout_phase = "waiting for the response";
+			else if( connect_us > 0 && strncmp( request->url, "https://", 8 ) == 0 )
+				timeout_phase = "during the TLS handshake";
+			else
+				timeout_phase = "while connecting";
+		}
 
-		CURLcode res = curl_easy_perform( curl );
+		/* A response may have arrived even if the transfer then failed. */
+		curl_off_t retry_after_s = 0;
+		curl_easy_getinfo( request->curl, CURLINFO_RESPONSE_CODE, &http_status );
+		curl_easy_getinfo( request->curl, CURLINFO_RETRY_AFTER, &retry_after_s );
+		retry_after_ms = retry_after_s > 0 ? (long) retry_after_s * 1000L : 0;
 
 		if( res == CURLE_OK )
 		{
-			//printf( "DEBUG: %s\n", response_body.text );
-
-			json_error_t error;
-			json_t* root = json_loads( response_body.text, 0, &error );
+			curl_off_t total_time_us = 0;
+			curl_easy_getinfo( request->curl, CURLINFO_TOTAL_TIME_T, &total_time_us );
+			latency_ms = (double) total_time_us / 1000.0;
 
-			if( root )
-			{
-				json_t* result_obj = json_object_get( root, "result" );
+			long new_connections = 0;
+			curl_easy_getinfo( request->curl, CURLINFO_NUM_CONNECTS, &new_connections );
 
-				if( json_is_object(result_obj) )
-				{
-					json_t* code_obj = json_object_get( result_obj, "code" );
+			long http_version = CURL_HTTP_VERSION_NONE;
+			curl_easy_getinfo( request->curl, CURLINFO_HTTP_VERSION, &http_version );
 
-					if( json_is_integer(code_obj) )
-					{
-						json_int_t code = json_integer_value( code_obj );
-						result = code == NAMECOM_API_RESPONSE_CODE_COMMAND_SUCCESSFUL;
+			pthread_mutex_lock( &api->lock );
 
-						if( !result && api->verbose )
-						{
-							fprintf( stderr, "[ERROR] %s\n", namecom_api_code_string(code) );
-						}
-					}
-					else
-					{
-						result = false;
-					}
-				}
-				else
-				{
-					result = false;
-				}
+			if( new_connections > 0 )
+			{
+				api->connection_stats.connections_created += new_connections;
 			}
 			else
 			{
-				result = false;
+				api->connection_stats.connections_reused += 1;
+			}
+
+			if( http_version == CURL_HTTP_VERSION_2_0 )
+			{
+				api->connection_stats.http2_requests += 1;
+			}
+
+			if( api->transport_cache )
+			{
+				namecom_transport_cache_observe( api->transport_cache, request->curl );
 			}
 
-			json_decref( root );
+			pthread_mutex_unlock( &api->lock );
 		}
-		else
-		{
-			fprintf(stderr, "[ERROR] %s\n", curl_easy_strerror(res));
 
-			result = false;
+		curl_multi_remove_handle( transport->multi, request->curl );
+		namecom_api_release_handle( transport, request->curl );
+		request->curl = NULL;
+	}
+
+	namecom_api_request_list_unlink( &transport->active, request );
+
+	pthread_mutex_lock( &api->lock );
+	api->connection_stats.requests += 1;
+	if( api->in_flight > 0 ) api->in_flight -= 1;
+	namecom_api_adapt( api, res, http_status, latency_ms );
+	namecom_api_headers_release( request->headers );
+	request->headers = NULL;
+	pthread_mutex_unlock( &api->lock );
+
+	request->result      = res == CURLE_OK && namecom_api_request_parse( request );
+	request->timed_out   = res == CURLE_OPERATION_TIMEDOUT;
+	/*
+	 * A 404 may only mean that the record is gone, so just the method
+	 * statuses and the API's own "invalid command" code count.
+	 */
+	request->unsupported = !request->result &&
+	                       (http_status == 405 || http_status == 501 || request->code == NAMECOM_API_RESPONSE_CODE_INVALID_COMMAND_URL);
+
+	if( request->unsupported && request->endpoint == NAMECOM_API_ENDPOINT_DNS_RECORD_UPDATE )
+	{
+		/* Later updates go straight to the caller's fallback. */
+		pthread_mutex_lock( &api->lock );
+		api->update_unsupported = true;
+		pthread_mutex_unlock( &api->lock );
+	}
+
+	namecom_record_decoder_error_t decoder_error = request->endpoint == NAMECOM_API_ENDPOINT_DNS_RECORD_LIST && request->decoder ?
+	                                               namecom_record_decoder_error( request->decoder ) : NAMECOM_RECORD_DECODER_ERROR_NONE;
+
+	/*
+	 * Throttling, running out of memory and a record callback that asked
+	 * to stop say nothing about the service's health.
+	 */
+	bool unsent = false;
+
+	if( http_status != 429 &&
+	    decoder_error != NAMECOM_RECORD_DECODER_ERROR_OUT_OF_MEMORY &&
+	    decoder_error != NAMECOM_RECORD_DECODER_ERROR_STOPPED )
+	{
+		namecom_api_breaker_record( request, !request->result && namecom_api_is_transient( res, http_status, request->code, &unsent ) );
+	}
+
+	if( request->result && latency_ms > 0.0 && namecom_api_request_can_hedge( request ) )
+	{
+		pthread_mutex_lock( &api->lock );
+		if( api->hedge_percentile > 0.0 ) namecom_api_sample_latency( api, request->endpoint, latency_ms );
+		pthread_mutex_unlock( &api->lock );
+	}
+
+	if( request->hedge_of )
+	{
+		namecom_api_hedge_complete( request );
+		return;
+	}
+
+	if( request->hedge )
+	{
+		/* The original answered first, so its duplicate is dropped. */
+		namecom_api_request_t* hedge = request->hedge;
+		request->hedge  = NULL;
+		hedge->hedge_of = NULL;
+		namecom_api_request_destroy( hedge );
+	}
+
+	if( !request->result &&
+	    (namecom_api_request_reauthenticate( request ) || namecom_api_request_retry( request, res, http_status, retry_after_ms )) )
+	{
+		return;
+	}
+
+	/*
+	 * Timeouts reach the caller through namecom_api_last_error(), so they
+	 * are only printed when verbose.  A record callback that asked to stop
+	 * isn't worth reporting.
+	 */
+	if( timeout_phase )
+	{
+		if( api->verbose )
+		{
+			fprintf( stderr, "[ERROR] Timed out %s.\n", timeout_phase );
+		}
+	}
+	else if( decoder_error != NAMECOM_RECORD_DECODER_ERROR_NONE )
+	{
+		if( decoder_error != NAMECOM_RECORD_DECODER_ERROR_STOPPED )
+		{
+			fprintf( stderr, "[ERROR] %s\n", namecom_record_decoder_error_string( decoder_error ) );
 		}
+	}
+	else if( res != CURLE_OK )
+	{
+		fprintf(stderr, "[ERROR] %s\n", curl_easy_strerror(res));
+	}
 
-		/* always cleanup */
-		curl_easy_cleanup( curl );
+	if( request->result )
+	{
+		namecom_api_earn_retry( api );
 	}
 
-	return result;
+	namecom_api_request_finish( request );
 }
 
-bool namecom_api_hello( namecom_api_t* api )
+static namecom_api_request_t* namecom_api_transport_submit_login( namecom_api_transport_t* transport, bool internal, namecom_api_completion_fxn_t on_complete, void* user_data )
 {
-	bool result = true;
-	CURL* curl = curl_easy_init();
+	namecom_api_t* api = transport->api;
 
-	if( curl )
+	if( api->auth_mode == NAMECOM_API_AUTH_STATELESS )
 	{
-		char url[ 256 ];
-		snprintf( url, sizeof(url), "https://%s/api/hello", api->api_server );
+		return NULL;
+	}
 
-		curl_easy_setopt( curl, CURLOPT_URL, url );
+	namecom_api_request_t* request = namecom_api_transport_request_create( transport, NAMECOM_API_ENDPOINT_LOGIN, on_complete, user_data );
 
-		char header_content_type[ 256 ];
-		snprintf( header_content_type, sizeof(header_content_type), "Content-Type: application/json" );
+	if( request )
+	{
+		if( !namecom_api_request_set_post_body( request, "{\"username\": \"%s\", \"api_token\": \"%s\"}", api->username, api->api_token ) )
+		{
+			namecom_api_request_destroy( request );
+			return NULL;
+		}
 
-		char header_user_agent[ 256 ];
-		snprintf( header_user_agent, sizeof(header_user_agent), "User-Agent: %s v%s", NAMECOM_API_USERAGENT, NAMECOM_API_VERSION );
 
-		struct curl_slist* headers_list = NULL;
-		headers_list = curl_slist_append( headers_list, header_content_type );
-		headers_list = curl_slist_append( headers_list, header_user_agent );
-		namecom_api_set_authentication_headers( api, headers_list );
+		snprintf( request->url, sizeof(request->url), NAMECOM_API_SCHEME "://%s/api/login", api->api_server );
+		request->internal = internal;
+		namecom_api_request_submit( request );
+	}
 
-		curl_easy_setopt( curl, CURLOPT_HTTPHEADER, headers_list );
+	return request;
+}
 
-		response_body_t response_body = { .text = NULL, .len = 0 };
+namecom_api_request_t* namecom_api_submit_login( namecom_api_t* api, namecom_api_completion_fxn_t on_complete, void* user_data )
+{
+	return namecom_api_transport_submit_login( namecom_api_current_transport( api ), false, on_complete, user_data );
+}
 
-		curl_easy_setopt( curl, CURLOPT_WRITEFUNCTION, namecom_api_writefunc );
-		curl_easy_setopt( curl, CURLOPT_WRITEDATA, &response_body );
+namecom_api_request_t* namecom_api_submit_logout( namecom_api_t* api, namecom_api_completion_fxn_t on_complete, void* user_data )
+{
+	if( api->auth_mode == NAMECOM_API_AUTH_STATELESS )
+	{
+		return NULL;
+	}
 
-		curl_easy_setopt( curl, CURLOPT_VERBOSE, NAMECOM_API_VERBOSE );
+	namecom_api_request_t* request = namecom_api_request_create( api, NAMECOM_API_ENDPOINT_LOGOUT, on_complete, user_data );
 
+	if( request )
+	{
+		snprintf( request->url, sizeof(request->url), NAMECOM_API_SCHEME "://%s/api/logout", api->api_server );
+		namecom_api_request_submit( request );
+	}
 
-		#ifdef SKIP_PEER_VERIFICATION
-		/*
-		 * If you want to connect to a site who isn't using a certificate that is
-		 * signed by one of the certs in the CA bundle you have, you can skip the
-		 * verification of the server's certificate. This makes the connection
-		 * A LOT LESS SECURE.
-		 *
-		 * If you have a CA cert for the server stored someplace else than in the
-		 * default bundle, then the CURLOPT_CAPATH option might come handy for
-		 * you.
-		 */
-		curl_easy_setopt( curl, CURLOPT_SSL_VERIFYPEER, 0L );
-		#endif
+	return request;
+}
 
-		#ifdef SKIP_HOSTNAME_VERIFICATION
-		/*
-		 * If the site you're connecting to uses a different host name that what
-		 * they have mentioned in their server certificate's commonName (or
-		 * subjectAltName) fields, libcurl will refuse to connect. You can skip
-		 * this check, but this will make the connection less secure.
-		 */
-		curl_easy_setopt( curl, CURLOPT_SSL_VERIFYHOST, 0L );
-		#endif
+namecom_api_request_t* namecom_api_submit_hello( namecom_api_t* api, namecom_api_completion_fxn_t on_complete, void* user_data )
+{
+	namecom_api_request_t* request = namecom_api_request_create( api, NAMECOM_API_ENDPOINT_HELLO, on_complete, user_data );
 
-		CURLcode res = curl_easy_perform( curl );
+	if( request )
+	{
+		snprintf( request->url, sizeof(request->url), NAMECOM_API_SCHEME "://%s/api/hello", api->api_server );
+		namecom_api_request_submit( request );
+	}
 
-		if( res == CURLE_OK )
-		{
-			//printf( "DEBUG: %s\n", response_body.text );
+	return request;
+}
 
-			json_error_t error;
-			json_t* root = json_loads( response_body.text, 0, &error );
+namecom_api_request_t* namecom_api_submit_domains_list( namecom_api_t* api, namecom_api_completion_fxn_t on_complete, void* user_data )
+{
+	namecom_api_request_t* request = namecom_api_request_create( api, NAMECOM_API_ENDPOINT_DOMAINS_LIST, on_complete, user_data );
 
-			if( root )
-			{
-				json_t* result_obj = json_object_get( root, "result" );
+	if( request )
+	{
+		snprintf( request->url, sizeof(request->url), NAMECOM_API_SCHEME "://%s/api/domain/list", api->api_server );
+		namecom_api_request_submit( request );
+	}
 
-				if( json_is_object(result_obj) )
-				{
-					json_t* code_obj = json_object_get( result_obj, "code" );
+	return request;
+}
 
-					if( json_is_integer(code_obj) )
-					{
-						json_int_t code = json_integer_value( code_obj );
-						result = code == NAMECOM_API_RESPONSE_CODE_COMMAND_SUCCESSFUL;
+namecom_api_request_t* namecom_api_submit_dns_record_list( namecom_api_t* api, const char* domain, namecom_api_completion_fxn_t on_complete, void* user_data )
+{
+	return namecom_api_submit_dns_record_stream( api, domain, NULL, NULL, on_complete, user_data );
+}
 
-						if( !result && api->verbose )
-						{
-							fprintf( stderr, "[ERROR] %s\n", namecom_api_code_string(code) );
-						}
-					}
-					else
-					{
-						result = false;
-					}
-				}
-				else
-				{
-					result = false;
-				}
-			}
-			else
-			{
-				result = false;
-			}
+/*
+ * Listings are decoded into one of three places: the record callback, a
+ * record set when one is given, or otherwise a vector of records for
+ * namecom_api_request_take_records().
+ */
+static namecom_api_request_t* namecom_api_submit_dns_record_listing( namecom_api_t* api, const char* domain, namecom_api_dns_record_fxn_t on_record, void* record_user_data, namecom_record_set_t* set, namecom_api_completion_fxn_t on_complete, void* user_data )
+{
+	namecom_api_request_t* request = namecom_api_request_create( api, NAMECOM_API_ENDPOINT_DNS_RECORD_LIST, on_complete, user_data );
+
+	if( request )
+	{
+		if( !on_record && !set )
+		{
+			lc_vector_create( request->records, 5 );
+			on_record        = namecom_api_collect_dns_record;
+			record_user_data = request;
+		}
 
-			json_decref( root );
+		if( request->decoder )
+		{
+			namecom_record_decoder_reset( request->decoder, on_record, record_user_data );
 		}
 		else
 		{
-			fprintf(stderr, "[ERROR] %s\n", curl_easy_strerror(res));
+			request->decoder = namecom_record_decoder_create( on_record, record_user_data );
+			namecom_api_count_allocation( api );
+		}
+
+		if( !request->decoder )
+		{
+			namecom_api_request_destroy( request );
+			return NULL;
+		}
 
-			result = false;
+		if( set )
+		{
+			request->record_set = set;
+			namecom_record_decoder_collect( request->decoder, set );
 		}
 
-		/* always cleanup */
-		curl_easy_cleanup(curl);
+		snprintf( request->url, sizeof(request->url), NAMECOM_API_SCHEME "://%s/api/dns/list/%s", api->api_server, domain );
+		snprintf( request->domain, sizeof(request->domain), "%s", domain );
+		pthread_mutex_lock( &api->lock );
+		request->zone_epoch = api->zone_epoch;
+		pthread_mutex_unlock( &api->lock );
+		namecom_api_request_submit( request );
 	}
 
-	return result;
+	return request;
 }
 
-bool namecom_api_domains_list( namecom_api_t* api )
+namecom_api_request_t* namecom_api_submit_dns_record_stream( namecom_api_t* api, const char* domain, namecom_api_dns_record_fxn_t on_record, void* record_user_data, namecom_api_completion_fxn_t on_complete, void* user_data )
 {
-	bool result = true;
-	CURL* curl = curl_easy_init();
+	return namecom_api_submit_dns_record_listing( api, domain, on_record, record_user_data, NULL, on_complete, user_data );
+}
 
-	if( curl )
-	{
-		char url[ 256 ];
-		snprintf( url, sizeof(url), "https://%s/api/domain/list", api->api_server );
+namecom_api_request_t* namecom_api_submit_dns_record_set( namecom_api_t* api, const char* domain, namecom_api_completion_fxn_t on_complete, void* user_data )
+{
+	namecom_record_set_t* set = namecom_record_set_create( 0 );
+	namecom_api_request_t* request = NULL;
 
-		curl_easy_setopt( curl, CURLOPT_URL, url );
+	if( set )
+	{
+		request = namecom_api_submit_dns_record_listing( api, domain, NULL, NULL, set, on_complete, user_data );
 
+		if( !request )
+		{
+			namecom_record_set_destroy( set );
+		}
+	}
 
-		char header_content_type[ 256 ];
-		snprintf( header_content_type, sizeof(header_content_type), "Content-Type: application/json" );
+	return request;
+}
 
-		char header_user_agent[ 256 ];
-		snprintf( header_user_agent, sizeof(header_user_agent), "User-Agent: %s v%s", NAMECOM_API_USERAGENT, NAMECOM_API_VERSION );
+namecom_api_request_t* namecom_api_submit_dns_record_add( namecom_api_t* api, const char* domain, const char* hostname, const char* type, const char* content, int ttl, int priority, namecom_api_completion_fxn_t on_complete, void* user_data )
+{
+	namecom_api_request_t* request = namecom_api_request_create( api, NAMECOM_API_ENDPOINT_DNS_RECORD_ADD, on_complete, user_data );
 
+	if( request )
+	{
+		if( !namecom_api_request_set_post_json( request, json_pack( "{s:s, s:s, s:s, s:i, s:i}",
+		                                                            "hostname", hostname, "type", type, "content", content,
+		                                                            "ttl", ttl, "priority", priority ) ) )
+		{
+			namecom_api_request_destroy( request );
+			return NULL;
+		}
 
-		struct curl_slist* headers_list = NULL;
-		headers_list = curl_slist_append( headers_list, header_content_type );
-		headers_list = curl_slist_append( headers_list, header_user_agent );
-		namecom_api_set_authentication_headers( api, headers_list );
 
-		curl_easy_setopt( curl, CURLOPT_HTTPHEADER, headers_list );
+		snprintf( request->url, sizeof(request->url), NAMECOM_API_SCHEME "://%s/api/dns/create/%s", api->api_server, domain );
+		snprintf( request->domain, sizeof(request->domain), "%s", domain );
+		namecom_api_request_submit( request );
+	}
 
-		response_body_t response_body = { .text = NULL, .len = 0 };
+	return request;
+}
 
-		curl_easy_setopt( curl, CURLOPT_WRITEFUNCTION, namecom_api_writefunc );
-		curl_easy_setopt( curl, CURLOPT_WRITEDATA, &response_body );
+namecom_api_request_t* namecom_api_submit_dns_record_remove( namecom_api_t* api, const char* domain, long id, namecom_api_completion_fxn_t on_complete, void* user_data )
+{
+	namecom_api_request_t* request = namecom_api_request_create( api, NAMECOM_API_ENDPOINT_DNS_RECORD_REMOVE, on_complete, user_data );
 
-		curl_easy_setopt( curl, CURLOPT_VERBOSE, NAMECOM_API_VERBOSE );
+	if( request )
+	{
+		if( !namecom_api_request_set_post_body( request, "{ \"record_id\": %ld}", id ) )
+		{
+			namecom_api_request_destroy( request );
+			return NULL;
+		}
 
 
-		/*
-		 * If you want to connect to a site who isn't using a certificate that is
-		 * signed by one of the certs in the CA bundle you have, you can skip the
-		 * verification of the server's certificate. This makes the connection
-		 * A LOT LESS SECURE.
-		 *
-		 * If you have a CA cert for the server stored someplace else than in the
-		 * default bundle, then the CURLOPT_CAPATH option might come handy for
-		 * you.
-		 */
-		curl_easy_setopt( curl, CURLOPT_SSL_VERIFYPEER, 0L );
+		snprintf( request->url, sizeof(request->url), NAMECOM_API_SCHEME "://%s/api/dns/delete/%s", api->api_server, domain );
+		snprintf( request->domain, sizeof(request->domain), "%s", domain );
+		namecom_api_request_submit( request );
+	}
 
-		/*
-		 * If the site you're connecting to uses a different host name that what
-		 * they have mentioned in their server certificate's commonName (or
-		 * subjectAltName) fields, libcurl will refuse to connect. You can skip
-		 * this check, but this will make the connection less secure.
-		 */
-		curl_easy_setopt( curl, CURLOPT_SSL_VERIFYHOST, 0L );
+	return request;
+}
 
-		CURLcode res = curl_easy_perform( curl );
+namecom_api_request_t* namecom_api_submit_dns_record_update( namecom_api_t* api, const char* domain, long id, const char* hostname, const char* type, const char* content, int ttl, int priority, namecom_api_completion_fxn_t on_complete, void* user_data )
+{
+	namecom_api_request_t* request = namecom_api_request_create( api, NAMECOM_API_ENDPOINT_DNS_RECORD_UPDATE, on_complete, user_data );
 
-		if( res == CURLE_OK )
+	if( request )
+	{
+		if( !namecom_api_request_set_post_json( request, json_pack( "{s:I, s:s, s:s, s:s, s:i, s:i}",
+		                                                            "record_id", (json_int_t) id, "hostname", hostname, "type", type,
+		                                                            "content", content, "ttl", ttl, "priority", priority ) ) )
 		{
-			//printf( "DEBUG: %s\n", response_body.text );
+			namecom_api_request_destroy( request );
+			return NULL;
+		}
 
-			json_error_t error;
-			json_t* root = json_loads( response_body.text, 0, &error );
+		snprintf( request->url, sizeof(request->url), NAMECOM_API_SCHEME "://%s/api/dns/update/%s", api->api_server, domain );
+		snprintf( request->domain, sizeof(request->domain), "%s", domain );
+		namecom_api_request_submit( request );
+	}
 
-			if( root )
-			{
-				json_t* result_obj = json_object_get( root, "result" );
+	return request;
+}
 
-				if( json_is_object(result_obj) )
-				{
-					json_t* code_obj = json_object_get( result_obj, "code" );
+/*
+ * The synchronous calls below are thin wrappers that submit a request
+ * and drive the transport until it has completed.
+ */
+/*
+ * Synchronous calls made by the thread that created the handle run on its
+ * own transport.  Any other thread takes a transport from the pool for the
+ * duration of the call, so threads share the session, caches and
+ * connection statistics but never a multi handle.
+ */
+static namecom_api_transport_t* namecom_api_enter( namecom_api_t* api )
+{
+	namecom_api_transport_t* transport = pthread_getspecific( api->current_transport );
 
-					if( json_is_integer(code_obj) )
-					{
-						json_int_t code = json_integer_value( code_obj );
-						result = code == NAMECOM_API_RESPONSE_CODE_COMMAND_SUCCESSFUL;
+	if( transport )
+	{
+		/* Called from within another call, e.g. from a record callback. */
+		transport->depth += 1;
+		return transport;
+	}
 
-						if( !result && api->verbose )
-						{
-							fprintf( stderr, "[ERROR] %s\n", namecom_api_code_string(code) );
-						}
-					}
-					else
-					{
-						result = false;
-					}
-				}
-				else
-				{
-					result = false;
-				}
-			}
-			else
-			{
-				result = false;
-			}
+	namecom_api_set_last_error( api, NAMECOM_API_ERROR_NONE );
 
-			json_decref( root );
-		}
-		else
-		{
-			fprintf(stderr, "[ERROR] %s\n", curl_easy_strerror(res));
+	if( pthread_equal( pthread_self(), api->owner ) )
+	{
+		return &api->transport;
+	}
+
+	pthread_mutex_lock( &api->lock );
+	transport = api->idle_transports;
+
+	if( transport )
+	{
+		api->idle_transports = transport->next_idle;
+	}
+	pthread_mutex_unlock( &api->lock );
+
+	if( !transport )
+	{
+		transport = malloc( sizeof(namecom_api_transport_t) );
 
-			result = false;
+		if( !transport || !namecom_api_transport_init( api, transport ) )
+		{
+			fprintf( stderr, "[ERROR] Unable to create a transport.\n" );
+			namecom_api_set_last_error( api, NAMECOM_API_ERROR_FAILED );
+			free( transport );
+			return NULL;
 		}
 
-		/* always cleanup */
-		curl_easy_cleanup(curl);
+		pthread_mutex_lock( &api->lock );
+		transport->next = api->transports;
+		api->transports = transport;
+		api->connection_stats.transport_allocations += 1;
+		pthread_mutex_unlock( &api->lock );
 	}
 
-	return result;
+	transport->depth = 1;
+	pthread_setspecific( api->current_transport, transport );
+
+	return transport;
 }
 
-namecom_api_dns_record_t* namecom_api_dns_record_create( long id, const char* fqdn, const char* type, const char* content, int ttl, const char* create_date )
+static void namecom_api_leave( namecom_api_t* api, namecom_api_transport_t* transport )
 {
-	namecom_api_dns_record_t* r = malloc( sizeof(namecom_api_dns_record_t) );
-
-	if( r )
+	if( transport && transport != &api->transport && --transport->depth == 0 )
 	{
-		r->id          = id;
-		r->fqdn        = string_dup(fqdn);
-		r->type        = string_dup(type);
-		r->content     = string_dup(content);
-		r->ttl         = ttl;
-		r->create_date = string_dup(create_date);
-	}
+		/* Nothing, such as a login other threads wait on, may be left behind. */
+		pthread_mutex_lock( &transport->mutex );
+		namecom_api_transport_wait( transport, NULL );
+		pthread_mutex_unlock( &transport->mutex );
 
-	return r;
+		pthread_setspecific( api->current_transport, NULL );
+
+		pthread_mutex_lock( &api->lock );
+		transport->next_idle = api->idle_transports;
+		api->idle_transports = transport;
+		pthread_mutex_unlock( &api->lock );
+	}
 }
 
-void namecom_api_dns_record_destroy( namecom_api_dns_record_t* r )
+static bool namecom_api_wait_and_destroy( namecom_api_t* api, namecom_api_request_t* request )
 {
-	if( r )
-	{
-		free( (char*) r->fqdn );
-		free( (char*) r->type );
-		free( (char*) r->content );
-		free( (char*) r->create_date );
+	bool result = false;
 
-		free( r );
+	if( request )
+	{
+		result = namecom_api_wait( api, request );
+		namecom_api_request_destroy( request );
 	}
+
+	return result;
 }
 
-namecom_api_dns_record_t** namecom_api_dns_record_list( namecom_api_t* api, const char* domain )
+/*
+ * With a session cache, a session saved by an earlier process is picked
+ * up instead of logging in, and logging out leaves it open for the next
+ * one.  Should the saved session have expired, the first request that is
+ * refused for it logs in again.
+ *
+ * Threads that log in at the same time share one login.  A login that
+ * a refused request queued on the caller's own transport is driven by
+ * the caller while it waits, since nothing else will.
+ */
+bool namecom_api_login( namecom_api_t* api )
 {
-	namecom_api_dns_record_t** records = NULL;
-	CURL* curl = curl_easy_init();
-
-	if( curl )
+	if( api->auth_mode == NAMECOM_API_AUTH_STATELESS )
 	{
-		char url[ 256 ];
-		snprintf( url, sizeof(url), "https://%s/api/dns/list/%s", api->api_server, domain );
+		return true;
+	}
 
-		curl_easy_setopt( curl, CURLOPT_URL, url );
+	namecom_api_transport_t* own = pthread_getspecific( api->current_transport );
 
+	if( !own && pthread_equal( pthread_self(), api->owner ) )
+	{
+		own = &api->transport;
+	}
 
-		char header_content_type[ 256 ];
-		snprintf( header_content_type, sizeof(header_content_type), "Content-Type: application/json" );
+	pthread_mutex_lock( &api->lock );
+	unsigned long session_epoch = api->session_epoch;
 
-		char header_user_agent[ 256 ];
-		snprintf( header_user_agent, sizeof(header_user_agent), "User-Agent: %s v%s", NAMECOM_API_USERAGENT, NAMECOM_API_VERSION );
+	while( api->login_in_flight )
+	{
+		if( !own || api->login_transport != own )
+		{
+			pthread_cond_wait( &api->session_changed, &api->lock );
+			continue;
+		}
 
+		pthread_mutex_unlock( &api->lock );
+		pthread_mutex_lock( &own->mutex );
 
-		struct curl_slist* headers_list = NULL;
-		headers_list = curl_slist_append( headers_list, header_content_type );
-		headers_list = curl_slist_append( headers_list, header_user_agent );
-		namecom_api_set_authentication_headers( api, headers_list );
+		if( own == &api->transport && namecom_api_is_event_driven( api ) )
+		{
+			/* Only the host's event loop may drive it. */
+			pthread_mutex_unlock( &own->mutex );
+			fprintf( stderr, "[ERROR] Blocking calls are not available when the transport is driven by an event loop.\n" );
+			namecom_api_set_last_error( api, NAMECOM_API_ERROR_FAILED );
+			return false;
+		}
 
-		curl_easy_setopt( curl, CURLOPT_HTTPHEADER, headers_list );
+		namecom_api_transport_run( own, 100 );
+		pthread_mutex_unlock( &own->mutex );
+		pthread_mutex_lock( &api->lock );
+	}
 
-		response_body_t response_body = { .text = NULL, .len = 0 };
+	if( api->session_token && api->session_epoch != session_epoch )
+	{
+		/* Another thread logged in while this one waited. */
+		pthread_mutex_unlock( &api->lock );
+		return true;
+	}
 
-		curl_easy_setopt( curl, CURLOPT_WRITEFUNCTION, namecom_api_writefunc );
-		curl_easy_setopt( curl, CURLOPT_WRITEDATA, &response_body );
+	if( api->session_cache_directory && !api->session_token )
+	{
+		char token[ 512 ];
 
-		curl_easy_setopt( curl, CURLOPT_VERBOSE, NAMECOM_API_VERBOSE );
+		if( namecom_session_cache_load( api->session_cache_directory, api->username, api->api_server, token, sizeof(token) ) &&
+		    namecom_api_swap_session_token( api, token ) )
+		{
+			pthread_mutex_unlock( &api->lock );
+			return true;
+		}
+	}
 
+	api->login_in_flight = true;
+	api->login_transport = NULL;
+	pthread_mutex_unlock( &api->lock );
 
-		/*
-		 * If you want to connect to a site who isn't using a certificate that is
-		 * signed by one of the certs in the CA bundle you have, you can skip the
-		 * verification of the server's certificate. This makes the connection
-		 * A LOT LESS SECURE.
-		 *
-		 * If you have a CA cert for the server stored someplace else than in the
-		 * default bundle, then the CURLOPT_CAPATH option might come handy for
-		 * you.
-		 */
-		curl_easy_setopt( curl, CURLOPT_SSL_VERIFYPEER, 0L );
+	namecom_api_transport_t* transport = namecom_api_enter( api );
 
-		/*
-		 * If the site you're connecting to uses a different host name that what
-		 * they have mentioned in their server certificate's commonName (or
-		 * subjectAltName) fields, libcurl will refuse to connect. You can skip
-		 * this check, but this will make the connection less secure.
-		 */
-		curl_easy_setopt( curl, CURLOPT_SSL_VERIFYHOST, 0L );
+	pthread_mutex_lock( &api->lock );
+	api->login_transport = transport;
+	pthread_mutex_unlock( &api->lock );
 
-		CURLcode res = curl_easy_perform( curl );
+	bool result = transport && namecom_api_wait_and_destroy( api, namecom_api_submit_login( api, NULL, NULL ) );
+	namecom_api_leave( api, transport );
 
-		if( res == CURLE_OK )
-		{
-			//printf( "DEBUG: %s\n", response_body.text );
+	pthread_mutex_lock( &api->lock );
+	api->login_in_flight = false;
+	api->login_transport = NULL;
+	pthread_cond_broadcast( &api->session_changed );
+	pthread_mutex_unlock( &api->lock );
 
-			json_error_t error;
-			json_t* root = json_loads( response_body.text, 0, &error );
+	return result;
+}
 
-			if( root )
-			{
-				json_t* result_obj = json_object_get( root, "result" );
+bool namecom_api_logout( namecom_api_t* api )
+{
+	pthread_mutex_lock( &api->lock );
+	bool keep_session = api->session_cache_directory && api->session_token;
+	pthread_mutex_unlock( &api->lock );
 
-				if( json_is_object(result_obj) )
-				{
-					json_t* code_obj = json_object_get( result_obj, "code" );
+	if( api->auth_mode == NAMECOM_API_AUTH_STATELESS || keep_session )
+	{
+		return true;
+	}
 
-					if( json_is_integer(code_obj) )
-					{
-						json_int_t code = json_integer_value( code_obj );
-
-						if( code == NAMECOM_API_RESPONSE_CODE_COMMAND_SUCCESSFUL )
-						{
-							json_t* records_obj = json_object_get( root, "records" );
-
-							if( json_is_array(records_obj) )
-							{
-								lc_vector_create( records, 5 );
-
-								for( size_t i = 0; i < json_array_size(records_obj); i++ )
-								{
-									json_t* record_obj = json_array_get( records_obj, i );
-
-									if( json_is_object(record_obj) )
-									{
-										json_t* record_id_obj   = json_object_get( record_obj, "record_id" );
-										json_t* name_obj        = json_object_get( record_obj, "name" );
-										json_t* type_obj        = json_object_get( record_obj, "type" );
-										json_t* content_obj     = json_object_get( record_obj, "content" );
-										json_t* ttl_obj         = json_object_get( record_obj, "ttl" );
-										json_t* create_date_obj = json_object_get( record_obj, "create_date" );
-
-
-										namecom_api_dns_record_t* r = namecom_api_dns_record_create(
-											atol(json_string_value(record_id_obj)),
-											json_string_value(name_obj),
-											json_string_value(type_obj),
-											json_string_value(content_obj),
-											atoi(json_string_value(ttl_obj)),
-											json_string_value(create_date_obj)
-										);
-
-										lc_vector_push( records, r );
-									}
-								}
-							}
-						}
-						else if( api->verbose )
-						{
-							fprintf( stderr, "[ERROR] %s\n", namecom_api_code_string(code) );
-						}
-					}
-				}
-			}
+	namecom_api_transport_t* transport = namecom_api_enter( api );
+	bool result = transport && namecom_api_wait_and_destroy( api, namecom_api_submit_logout( api, NULL, NULL ) );
+	namecom_api_leave( api, transport );
 
-			json_decref( root );
-		}
-		else
-		{
-			fprintf(stderr, "[ERROR] %s\n", curl_easy_strerror(res));
-		}
+	return result;
+}
 
-		/* always cleanup */
-		curl_easy_cleanup(curl);
-	}
+bool namecom_api_hello( namecom_api_t* api )
+{
+	namecom_api_transport_t* transport = namecom_api_enter( api );
+	bool result = transport && namecom_api_wait_and_destroy( api, namecom_api_submit_hello( api, NULL, NULL ) );
+	namecom_api_leave( api, transport );
 
-	return records;
+	return result;
 }
 
-bool namecom_api_dns_record_add( namecom_api_t* api, const char* domain, const char* hostname, const char* type, const char* content, int ttl, int priority, long* id )
+bool namecom_api_domains_list( namecom_api_t* api )
 {
-	bool result = true;
-	CURL* curl = curl_easy_init();
+	namecom_api_transport_t* transport = namecom_api_enter( api );
+	bool result = transport && namecom_api_wait_and_destroy( api, namecom_api_submit_domains_list( api, NULL, NULL ) );
+	namecom_api_leave( api, transport );
 
-	if( curl )
-	{
-		char url[ 256 ];
-		snprintf( url, sizeof(url), "https://%s/api/dns/create/%s", api->api_server, domain );
+	return result;
+}
 
-		curl_easy_setopt( curl, CURLOPT_URL, url );
+static const char* namecom_api_dns_record_pack( char** pool, const char* string )
+{
+	char* result = NULL;
 
+	if( string )
+	{
+		size_t len = strlen( string ) + 1;
+		result = memcpy( *pool, string, len );
+		*pool += len;
+	}
 
-		char header_content_type[ 256 ];
-		snprintf( header_content_type, sizeof(header_content_type), "Content-Type: application/json" );
+	return result;
+}
 
-		char header_user_agent[ 256 ];
-		snprintf( header_user_agent, sizeof(header_user_agent), "User-Agent: %s v%s", NAMECOM_API_USERAGENT, NAMECOM_API_VERSION );
+/*
+ * A record and its strings live in a single allocation; the string
+ * fields point into the space that follows the struct.
+ */
+namecom_api_dns_record_t* namecom_api_dns_record_create( long id, const char* fqdn, const char* type, const char* content, int ttl, const char* create_date )
+{
+	size_t size = sizeof(namecom_api_dns_record_t)
+	            + (fqdn ? strlen(fqdn) + 1 : 0)
+	            + (type ? strlen(type) + 1 : 0)
+	            + (content ? strlen(content) + 1 : 0)
+	            + (create_date ? strlen(create_date) + 1 : 0);
+	namecom_api_dns_record_t* r = malloc( size );
 
+	if( r )
+	{
+		char* pool = (char*) (r + 1);
 
-		struct curl_slist* headers_list = NULL;
-		headers_list = curl_slist_append( headers_list, header_content_type );
-		headers_list = curl_slist_append( headers_list, header_user_agent );
-		namecom_api_set_authentication_headers( api, headers_list );
+		r->id          = id;
+		r->fqdn        = namecom_api_dns_record_pack( &pool, fqdn );
+		r->type        = namecom_api_dns_record_pack( &pool, type );
+		r->content     = namecom_api_dns_record_pack( &pool, content );
+		r->ttl         = ttl;
+		r->create_date = namecom_api_dns_record_pack( &pool, create_date );
+	}
 
-		curl_easy_setopt( curl, CURLOPT_HTTPHEADER, headers_list );
+	return r;
+}
 
-		char post_body[ 1024 ];
-		snprintf( post_body, sizeof(post_body), "{\"hostname\": \"%s\", \"type\": \"%s\", \"content\": \"%s\", \"ttl\": %d, \"priority\": %d}", hostname, type, content, ttl, priority );
+void namecom_api_dns_record_destroy( namecom_api_dns_record_t* r )
+{
+	free( r );
+}
 
-		//printf( "DEBUG: %s\n", post_body );
+namecom_api_dns_record_t** namecom_api_dns_record_list( namecom_api_t* api, const char* domain )
+{
+	namecom_api_dns_record_t** records = NULL;
 
-		curl_easy_setopt( curl, CURLOPT_POSTFIELDS, post_body );
+	/* The caches and coalesced listings hold record sets, so go through one. */
+	namecom_record_set_t* set = namecom_api_dns_record_set( api, domain );
 
-		response_body_t response_body = { .text = NULL, .len = 0 };
+	if( set )
+	{
+		records = namecom_record_set_to_records( set );
+		namecom_record_set_destroy( set );
+	}
 
-		curl_easy_setopt( curl, CURLOPT_WRITEFUNCTION, namecom_api_writefunc );
-		curl_easy_setopt( curl, CURLOPT_WRITEDATA, &response_body );
+	return records;
+}
 
-		curl_easy_setopt( curl, CURLOPT_VERBOSE, NAMECOM_API_VERBOSE );
+/*
+ * Called with the lock held.
+ */
+static void namecom_api_flight_release( namecom_api_flight_t* flight )
+{
+	if( --flight->refs == 0 )
+	{
+		namecom_record_set_destroy( flight->set );
+		free( flight );
+	}
+}
 
+/*
+ * Joins an identical listing that is already in flight, waiting for it
+ * to land (or the calling thread's deadline to pass) and returning true
+ * with its result in *set.  Otherwise the caller's listing is put in
+ * flight and returned through *flight, to be landed once it is done; if
+ * it can't be (the domain is too long or memory ran out), *flight is NULL
+ * and the caller lists on its own.  A listing that started before a
+ * record was added or removed isn't joined, as its result may be stale.
+ */
+static bool namecom_api_flight_board( namecom_api_t* api, const char* domain, namecom_api_flight_t** boarded, namecom_record_set_t** set )
+{
+	namecom_api_flight_t* flight = NULL;
+	bool joined = false;
 
-		/*
-		 * If you want to connect to a site who isn't using a certificate that is
-		 * signed by one of the certs in the CA bundle you have, you can skip the
-		 * verification of the server's certificate. This makes the connection
-		 * A LOT LESS SECURE.
-		 *
-		 * If you have a CA cert for the server stored someplace else than in the
-		 * default bundle, then the CURLOPT_CAPATH option might come handy for
-		 * you.
-		 */
-		curl_easy_setopt( curl, CURLOPT_SSL_VERIFYPEER, 0L );
+	*boarded = NULL;
+	*set     = NULL;
 
-		/*
-		 * If the site you're connecting to uses a different host name that what
-		 * they have mentioned in their server certificate's commonName (or
-		 * subjectAltName) fields, libcurl will refuse to connect. You can skip
-		 * this check, but this will make the connection less secure.
-		 */
-		curl_easy_setopt( curl, CURLOPT_SSL_VERIFYHOST, 0L );
+	if( strlen( domain ) >= sizeof(flight->domain) )
+	{
+		return false;
+	}
 
-		CURLcode res = curl_easy_perform( curl );
+	pthread_mutex_lock( &api->lock );
 
-		if( res == CURLE_OK )
+	for( flight = api->flights; flight; flight = flight->next )
+	{
+		if( flight->zone_epoch == api->zone_epoch && strcmp( flight->domain, domain ) == 0 )
 		{
-			//printf( "DEBUG: %s\n", response_body.text );
+			break;
+		}
+	}
+
+	if( flight )
+	{
+		flight->refs += 1;
+		api->connection_stats.requests_coalesced += 1;
 
-			json_error_t error;
-			json_t* root = json_loads( response_body.text, 0, &error );
+		long long deadline_ms = namecom_api_deadline( api );
+		bool timed_out = false;
 
-			if( root )
+		while( !flight->landed && !timed_out )
+		{
+			if( deadline_ms > 0 )
 			{
-				json_t* result_obj = json_object_get( root, "result" );
+				/* The condition variable waits on the wall clock. */
+				long long remaining_ms = deadline_ms - namecom_api_now_ms();
+				struct timespec until;
+				clock_gettime( CLOCK_REALTIME, &until );
 
-				if( json_is_object(result_obj) )
+				if( remaining_ms > 0 )
 				{
-					json_t* code_obj = json_object_get( result_obj, "code" );
+					until.tv_sec  += remaining_ms / 1000;
+					until.tv_nsec += (remaining_ms % 1000) * 1000000L;
 
-					if( json_is_integer(code_obj) )
-					{
-						json_int_t code = json_integer_value( code_obj );
-						result = code == NAMECOM_API_RESPONSE_CODE_COMMAND_SUCCESSFUL;
-
-						if( result && id )
-						{
-							json_t* record_id_obj = json_object_get( root, "record_id" );
-
-							if( json_is_integer(record_id_obj) )
-							{
-								*id = json_integer_value(record_id_obj);
-							}
-
-						}
-						else if( api->verbose )
-						{
-							fprintf( stderr, "[ERROR] %s\n", namecom_api_code_string(code) );
-						}
-					}
-					else
+					if( until.tv_nsec >= 1000000000L )
 					{
-						result = false;
+						until.tv_sec  += 1;
+						until.tv_nsec -= 1000000000L;
 					}
 				}
-				else
-				{
-					result = false;
-				}
+
+				timed_out = remaining_ms <= 0 || pthread_cond_timedwait( &api->flight_landed, &api->lock, &until ) == ETIMEDOUT;
 			}
 			else
 			{
-				result = false;
+				pthread_cond_wait( &api->flight_landed, &api->lock );
 			}
+		}
 
-			json_decref( root );
+		if( flight->landed )
+		{
+			*set = namecom_record_set_retain( flight->set );
+			namecom_api_set_last_error( api, *set ? NAMECOM_API_ERROR_NONE : NAMECOM_API_ERROR_FAILED );
 		}
 		else
 		{
-			fprintf(stderr, "[ERROR] %s\n", curl_easy_strerror(res));
+			if( api->verbose )
+			{
+				fprintf( stderr, "[ERROR] The deadline passed while waiting for a listing already in flight.\n" );
+			}
 
-			result = false;
+			namecom_api_set_last_error( api, NAMECOM_API_ERROR_TIMEOUT );
 		}
 
-		/* always cleanup */
-		curl_easy_cleanup(curl);
+		namecom_api_flight_release( flight );
+		joined = true;
 	}
+	else
+	{
+		flight = malloc( sizeof(namecom_api_flight_t) );
 
-	return result;
-}
+		if( flight )
+		{
+			memset( flight, 0, sizeof(namecom_api_flight_t) );
+			strcpy( flight->domain, domain );
+			flight->zone_epoch = api->zone_epoch;
+			flight->refs       = 1;
+			flight->next       = api->flights;
+			api->flights       = flight;
+			*boarded           = flight;
+		}
+	}
 
+	pthread_mutex_unlock( &api->lock );
 
-bool namecom_api_dns_record_remove( namecom_api_t* api, const char* domain, long id )
+	return joined;
+}
+
+static void namecom_api_flight_land( namecom_api_t* api, namecom_api_flight_t* flight, namecom_record_set_t* set )
 {
-	bool result = true;
-	CURL* curl = curl_easy_init();
+	pthread_mutex_lock( &api->lock );
 
-	if( curl )
+	for( namecom_api_flight_t** link = &api->flights; *link; link = &(*link)->next )
 	{
-		char url[ 256 ];
-		snprintf( url, sizeof(url), "https://%s/api/dns/delete/%s", api->api_server, domain );
+		if( *link == flight )
+		{
+			*link = flight->next;
+			break;
+		}
+	}
 
-		curl_easy_setopt( curl, CURLOPT_URL, url );
+	flight->set    = namecom_record_set_retain( set );
+	flight->landed = true;
+	pthread_cond_broadcast( &api->flight_landed );
+	namecom_api_flight_release( flight );
 
+	pthread_mutex_unlock( &api->lock );
+}
 
-		char header_content_type[ 256 ];
-		snprintf( header_content_type, sizeof(header_content_type), "Content-Type: application/json" );
+namecom_record_set_t* namecom_api_dns_record_set( namecom_api_t* api, const char* domain )
+{
+	namecom_record_set_t* set = NULL;
 
-		char header_user_agent[ 256 ];
-		snprintf( header_user_agent, sizeof(header_user_agent), "User-Agent: %s v%s", NAMECOM_API_USERAGENT, NAMECOM_API_VERSION );
+	pthread_mutex_lock( &api->lock );
+	set = api->zone_cache ? namecom_record_set_retain( namecom_zone_cache_get( api->zone_cache, domain, time(NULL) ) ) : NULL;
+	pthread_mutex_unlock( &api->lock );
 
+	if( set )
+	{
+		namecom_api_set_last_error( api, NAMECOM_API_ERROR_NONE );
+		return set;
+	}
 
-		struct curl_slist* headers_list = NULL;
-		headers_list = curl_slist_append( headers_list, header_content_type );
-		headers_list = curl_slist_append( headers_list, header_user_agent );
-		namecom_api_set_authentication_headers( api, headers_list );
+	namecom_api_flight_t* flight = NULL;
 
-		curl_easy_setopt( curl, CURLOPT_HTTPHEADER, headers_list );
+	if( namecom_api_flight_board( api, domain, &flight, &set ) )
+	{
+		/* Shared the result of a listing that was already in flight. */
+		return set;
+	}
 
-		char post_body[ 1024 ];
-		snprintf( post_body, sizeof(post_body), "{ \"record_id\": %ld}", id );
+	namecom_api_transport_t* transport = namecom_api_enter( api );
+	namecom_api_request_t* request = transport ? namecom_api_submit_dns_record_set( api, domain, NULL, NULL ) : NULL;
 
-		//printf( "DEBUG: %s\n", post_body );
+	if( request )
+	{
+		if( namecom_api_wait( api, request ) )
+		{
+			set = namecom_api_request_take_record_set( request );
+		}
 
-		curl_easy_setopt( curl, CURLOPT_POSTFIELDS, post_body );
+		namecom_api_request_destroy( request );
+	}
 
-		response_body_t response_body = { .text = NULL, .len = 0 };
+	namecom_api_leave( api, transport );
 
-		curl_easy_setopt( curl, CURLOPT_WRITEFUNCTION, namecom_api_writefunc );
-		curl_easy_setopt( curl, CURLOPT_WRITEDATA, &response_body );
+	if( flight )
+	{
+		namecom_api_flight_land( api, flight, set );
+	}
 
-		curl_easy_setopt( curl, CURLOPT_VERBOSE, NAMECOM_API_VERBOSE );
+	return set;
+}
 
+bool namecom_api_dns_record_stream( namecom_api_t* api, const char* domain, namecom_api_dns_record_fxn_t on_record, void* user_data )
+{
+	namecom_api_transport_t* transport = namecom_api_enter( api );
+	bool result = transport && namecom_api_wait_and_destroy( api, namecom_api_submit_dns_record_stream( api, domain, on_record, user_data, NULL, NULL ) );
+	namecom_api_leave( api, transport );
 
-		/*
-		 * If you want to connect to a site who isn't using a certificate that is
-		 * signed by one of the certs in the CA bundle you have, you can skip the
-		 * verification of the server's certificate. This makes the connection
-		 * A LOT LESS SECURE.
-		 *
-		 * If you have a CA cert for the server stored someplace else than in the
-		 * default bundle, then the CURLOPT_CAPATH option might come handy for
-		 * you.
-		 */
-		curl_easy_setopt( curl, CURLOPT_SSL_VERIFYPEER, 0L );
+	return result;
+}
 
-		/*
-		 * If the site you're connecting to uses a different host name that what
-		 * they have mentioned in their server certificate's commonName (or
-		 * subjectAltName) fields, libcurl will refuse to connect. You can skip
-		 * this check, but this will make the connection less secure.
-		 */
-		curl_easy_setopt( curl, CURLOPT_SSL_VERIFYHOST, 0L );
+bool namecom_api_dns_record_add( namecom_api_t* api, const char* domain, const char* hostname, const char* type, const char* content, int ttl, int priority, long* id )
+{
+	bool result = false;
+	namecom_api_transport_t* transport = namecom_api_enter( api );
+	namecom_api_request_t* request = transport ? namecom_api_submit_dns_record_add( api, domain, hostname, type, content, ttl, priority, NULL, NULL ) : NULL;
 
-		CURLcode res = curl_easy_perform( curl );
+	if( request )
+	{
+		result = namecom_api_wait( api, request );
 
-		if( res == CURLE_OK )
+		if( result && id && request->record_id >= 0 )
 		{
-			//printf( "DEBUG: %s\n", response_body.text );
+			*id = request->record_id;
+		}
 
-			json_error_t error;
-			json_t* root = json_loads( response_body.text, 0, &error );
+		namecom_api_request_destroy( request );
+	}
 
-			if( root )
-			{
-				json_t* result_obj = json_object_get( root, "result" );
+	namecom_api_leave( api, transport );
 
-				if( json_is_object(result_obj) )
-				{
-					json_t* code_obj = json_object_get( result_obj, "code" );
+	return result;
+}
 
-					if( json_is_integer(code_obj) )
-					{
-						json_int_t code = json_integer_value( code_obj );
-						result = code == NAMECOM_API_RESPONSE_CODE_COMMAND_SUCCESSFUL;
+bool namecom_api_dns_record_update( namecom_api_t* api, const char* domain, long id, const char* hostname, const char* type, const char* content, int ttl, int priority )
+{
+	pthread_mutex_lock( &api->lock );
+	bool unsupported = api->update_unsupported;
+	pthread_mutex_unlock( &api->lock );
 
-						if( !result && api->verbose )
-						{
-							fprintf( stderr, "[ERROR] %s\n", namecom_api_code_string(code) );
-						}
-					}
-					else
-					{
-						result = false;
-					}
-				}
-				else
-				{
-					result = false;
-				}
-			}
-			else
-			{
-				result = false;
-			}
+	if( unsupported )
+	{
+		namecom_api_set_last_error( api, NAMECOM_API_ERROR_UNSUPPORTED );
+		return false;
+	}
 
-			json_decref( root );
-		}
-		else
-		{
-			fprintf(stderr, "[ERROR] %s\n", curl_easy_strerror(res));
+	namecom_api_transport_t* transport = namecom_api_enter( api );
+	bool result = transport && namecom_api_wait_and_destroy( api, namecom_api_submit_dns_record_update( api, domain, id, hostname, type, content, ttl, priority, NULL, NULL ) );
+	namecom_api_leave( api, transport );
 
-			result = false;
-		}
+	return result;
+}
 
-		/* always cleanup */
-		curl_easy_cleanup(curl);
-	}
+bool namecom_api_dns_record_remove( namecom_api_t* api, const char* domain, long id )
+{
+	namecom_api_transport_t* transport = namecom_api_enter( api );
+	bool result = transport && namecom_api_wait_and_destroy( api, namecom_api_submit_dns_record_remove( api, domain, id, NULL, NULL ) );
+	namecom_api_leave( api, transport );
 
 	return result;
 }
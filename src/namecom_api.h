@@ -23,6 +23,9 @@
 #define _NAMECOM_API_H_
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <curl/curl.h>
+#include "namecom_transport_cache.h"
 
 #define NAMECOM_API_VERSION  "1.0"
 
@@ -33,12 +36,280 @@ typedef struct namecom_api namecom_api_t;
 #define NAMECOM_API_VERBOSE 0L
 #endif
 
+typedef struct namecom_api_connection_stats {
+	unsigned long requests;
+	unsigned long connections_created;
+	unsigned long connections_reused;
+	unsigned long http2_requests;
+	unsigned long transport_allocations; /* heap allocations made for requests and their buffers */
+	unsigned long requests_coalesced;    /* listings that shared one already in flight */
+	unsigned long retries;               /* requests sent again after a transient failure */
+	unsigned long retries_denied;        /* transient failures not retried because the budget ran out */
+	unsigned long hedges;                /* duplicate requests sent for slow reads */
+	unsigned long hedges_won;            /* duplicates that answered before the original */
+} namecom_api_connection_stats_t;
+
+/*
+ * By default a handle works with a session: namecom_api_login() trades
+ * the account credentials for a session token that later requests carry.
+ * A stateless handle instead sends the username and API token with every
+ * request, so it never talks to /api/login or /api/logout; login and
+ * logout always succeed and submitting either returns NULL.
+ */
+typedef enum namecom_api_auth_mode {
+	NAMECOM_API_AUTH_SESSION = 0,
+	NAMECOM_API_AUTH_STATELESS,
+} namecom_api_auth_mode_t;
+
+/*
+ * A handle can be shared by threads once it has been configured.  The
+ * synchronous calls may be made from any thread: calls from the thread
+ * that created the handle use its own transport, while every other thread
+ * borrows a transport (with its own connections) from a pool for the
+ * duration of a call.  The session token, caches and connection stats are
+ * shared.  When requests on several threads are refused for an expired
+ * session, only one of them logs in again; the others wait for that login
+ * and then retry.  `make test` runs a stress test of this against a stub
+ * server.
+ *
+ * The setters must be called before the handle is shared, and the
+ * asynchronous interface (submit, run, wait and the event hooks) belongs
+ * to a single thread, on which its completion callbacks run.  The string
+ * returned by namecom_api_session_token() is replaced whenever the handle
+ * logs in again, so it is only stable while no other thread is using the
+ * handle.
+ */
 namecom_api_t* namecom_api_create        ( const char* username, const char* api_token, bool is_dev, bool verbose );
+namecom_api_t* namecom_api_create_with_auth ( const char* username, const char* api_token, bool is_dev, bool verbose, namecom_api_auth_mode_t auth_mode );
+namecom_api_auth_mode_t namecom_api_auth_mode ( const namecom_api_t* api );
 void           namecom_api_destroy       ( namecom_api_t* api );
 const char*    namecom_api_username      ( const namecom_api_t* api );
 const char*    namecom_api_token         ( const namecom_api_t* api );
 const char*    namecom_api_server        ( const namecom_api_t* api );
 const char*    namecom_api_session_token ( const namecom_api_t* api );
+void           namecom_api_connection_stats ( const namecom_api_t* api, namecom_api_connection_stats_t* stats );
+void           namecom_api_set_max_concurrency ( namecom_api_t* api, size_t max_concurrency );
+size_t         namecom_api_max_concurrency     ( const namecom_api_t* api );
+/*
+ * HTTP/2 is opt-in.  When enabled, in-flight requests are multiplexed as
+ * streams over a single connection (at most max_streams at once) and
+ * servers that won't negotiate HTTP/2 are spoken to over HTTP/1.1.  Raise
+ * the concurrency cap as well to keep more streams busy.
+ */
+void           namecom_api_set_http2           ( namecom_api_t* api, bool enabled, size_t max_streams );
+bool           namecom_api_http2               ( const namecom_api_t* api );
+bool           namecom_api_set_ca_bundle       ( namecom_api_t* api, const char* path );
+
+/*
+ * Pacing.  With a rate limit every request, on any thread, draws a token
+ * from a bucket that refills at rate tokens per second and holds up to
+ * burst of them; a request that finds the bucket empty stays queued until
+ * a token is due.  A rate of zero removes the limit.
+ *
+ * With adaptive concurrency the number of requests in flight on the whole
+ * handle is capped by an AIMD controller.  The cap starts at
+ * min_concurrency and grows by about one request per round trip while
+ * latency stays near the lowest seen and requests succeed, up to
+ * namecom_api_max_concurrency().  It is halved (at most once per round
+ * trip) when the server answers 429 or 503 or latency climbs to twice its
+ * baseline.
+ *
+ * namecom_api_limiter_stats() reports the state of both, including
+ * whether requests are currently being held back.
+ */
+typedef struct namecom_api_limiter_stats {
+	double rate;                       /* tokens per second, 0 when unlimited */
+	double burst;
+	double tokens;                     /* tokens available now */
+	size_t concurrency_limit;          /* cap on requests in flight */
+	size_t in_flight;
+	double latency_ms;                 /* smoothed request latency */
+	double baseline_latency_ms;        /* the latency the controller compares against */
+	unsigned long throttled;           /* times requests were held back waiting for a token */
+	unsigned long capped;              /* times requests were held back by the concurrency cap */
+	unsigned long increases;           /* times the concurrency cap was raised */
+	unsigned long decreases;           /* times the concurrency cap was halved */
+	bool at_cap;                       /* requests are being held back right now */
+	bool host_quota;                   /* a host-wide quota is in use */
+	double host_tokens;                /* tokens left in it, at this handle's rate */
+	unsigned long host_throttled;      /* times requests were held back by it */
+} namecom_api_limiter_stats_t;
+
+void           namecom_api_set_rate_limit      ( namecom_api_t* api, double rate, double burst );
+void           namecom_api_set_adaptive_concurrency ( namecom_api_t* api, bool enabled, size_t min_concurrency );
+void           namecom_api_limiter_stats       ( const namecom_api_t* api, namecom_api_limiter_stats_t* stats );
+
+/*
+ * Draws every request from a quota shared with all the processes on the
+ * host that use the same account (see namecom_host_quota.h), on top of
+ * any rate limit of the handle's own.  Fails where shared memory isn't
+ * available.  A rate of zero stops using it.
+ */
+bool           namecom_api_set_host_quota      ( namecom_api_t* api, double rate, double burst );
+
+/*
+ * Retries.  A request that fails in a way that may pass (a connection or
+ * transfer error, HTTP 429 or 5xx, or result code 250) is sent again after
+ * a backoff drawn at random between zero and
+ * min(max_delay_ms, base_delay_ms * 2^retries), or after the server's
+ * Retry-After when that is longer.  A Retry-After beyond max_delay_ms
+ * fails the request instead.  A retry keeps the request's buffers and goes
+ * back through the connection pool and the limiter.
+ *
+ * Lookups, login, logout and removing a record are safe to repeat.
+ * Adding a record is not, so it is only retried when the server can't
+ * have acted on it: the connection was never made, or it answered 429.  A
+ * listing that has already delivered records isn't retried either.
+ *
+ * Each retry spends a token from a budget that holds up to budget tokens
+ * and earns back budget_ratio of a token for every request that succeeds,
+ * so an outage costs a bounded number of extra requests instead of
+ * multiplying the load.  max_attempts counts the first attempt; 1 turns
+ * retries off.  Passing NULL restores the default policy of 3 attempts,
+ * 200 ms to 10 s of backoff and a budget of 10 earning 0.1 per success.
+ */
+typedef struct namecom_api_retry_policy {
+	unsigned int max_attempts;
+	long base_delay_ms;
+	long max_delay_ms;
+	double budget;
+	double budget_ratio;
+} namecom_api_retry_policy_t;
+
+void           namecom_api_set_retry_policy    ( namecom_api_t* api, const namecom_api_retry_policy_t* policy );
+void           namecom_api_retry_policy        ( const namecom_api_t* api, namecom_api_retry_policy_t* policy );
+
+/*
+ * Hedging is opt-in.  When an idempotent read (hello, domain/list or a
+ * dns/list whose records are collected rather than streamed) has had no
+ * answer within the hedge delay, a duplicate is sent, on another
+ * connection if the pool has one.  Whichever finishes first decides the
+ * outcome and the other is cancelled.  Nothing is hedged while requests
+ * are queued on the transport, so hedges only use spare capacity.
+ *
+ * The delay is the given percentile (e.g. 95) of the latencies of recent
+ * reads of the same endpoint, but never less than min_delay_ms, which is
+ * also the delay used until enough reads have been seen.  Extra load is
+ * roughly 100 - percentile per cent of reads; the connection stats count
+ * hedges sent and won, and namecom_api_hedge_delay() reports the delay
+ * currently applied to listings.  A percentile of zero turns hedging off.
+ */
+void           namecom_api_set_hedging         ( namecom_api_t* api, double percentile, long min_delay_ms );
+long           namecom_api_hedge_delay         ( const namecom_api_t* api );
+
+/*
+ * Timeouts and deadlines.  Every request is bounded by the handle's
+ * timeouts: connect_timeout_ms covers resolving, connecting and the TLS
+ * handshake (libcurl treats them as one phase), and timeout_ms the whole
+ * request.  They default to 10 and 60 seconds; zero removes a limit.
+ *
+ * namecom_api_set_deadline() sets an absolute deadline, on the clock of
+ * namecom_api_clock_ms(), for the calls the calling thread makes until
+ * it is cleared with 0.  Everything those calls send, including retries
+ * and logging in again, shares it: each request's timeouts are cut to
+ * what is left, and a request still waiting once the deadline passes
+ * fails without being sent.  This is how a sequence like removing a record
+ * and adding it again gets a single end-to-end budget.
+ *
+ * namecom_api_last_error() tells why the calling thread's last
+ * synchronous call failed, and namecom_api_request_error() does the same
+ * for a request; NAMECOM_API_ERROR_TIMEOUT means a timeout or the
+ * deadline ran out.  Timeouts are only printed by a verbose handle.
+ */
+typedef enum namecom_api_error {
+	NAMECOM_API_ERROR_NONE = 0,
+	NAMECOM_API_ERROR_FAILED,          /* a transport error, or the server refused the request */
+	NAMECOM_API_ERROR_TIMEOUT,
+	NAMECOM_API_ERROR_UNAVAILABLE,     /* refused by the circuit breaker; nothing was sent */
+	NAMECOM_API_ERROR_UNSUPPORTED,     /* the server doesn't offer the command */
+	NAMECOM_API_ERROR_MALFORMED,       /* a record listing couldn't be decoded */
+	NAMECOM_API_ERROR_OUT_OF_MEMORY,
+} namecom_api_error_t;
+
+void           namecom_api_set_timeouts        ( namecom_api_t* api, long connect_timeout_ms, long timeout_ms );
+long long      namecom_api_clock_ms            ( void );
+void           namecom_api_set_deadline        ( namecom_api_t* api, long long deadline_ms );
+long long      namecom_api_deadline            ( const namecom_api_t* api );
+namecom_api_error_t namecom_api_last_error     ( const namecom_api_t* api );
+
+/*
+ * The circuit breaker.  Every attempt that fails in a way that points at
+ * the service rather than the request (a connection or transfer error, a
+ * timeout, HTTP 5xx or result code 250) counts against it, and anything
+ * else the server answers counts for it.  It opens once
+ * consecutive_failures attempts in a row have failed, or once error_rate
+ * of the last window attempts (at most 64) have.  Zero ignores either.
+ *
+ * While open, requests fail at once with NAMECOM_API_ERROR_UNAVAILABLE
+ * instead of waiting out their timeouts, and retries that come due are
+ * refused the same way.  Opening is always reported; only a verbose
+ * handle prints each refusal.  After open_ms the next request to come
+ * along makes it half-open: a single /api/hello is sent as a probe
+ * while requests wait behind it.  If the probe is answered the breaker closes
+ * and they go ahead; otherwise it opens again for another open_ms.
+ *
+ * namecom_api_breaker_stats() reports the state, the transitions so far
+ * and how long until the next probe, so callers can shed or defer work
+ * rather than queue it.  Passing NULL restores the default policy of 5
+ * failures in a row or half of the last 20 attempts, open for 30 seconds.
+ */
+typedef enum namecom_api_breaker_state {
+	NAMECOM_API_BREAKER_CLOSED = 0,
+	NAMECOM_API_BREAKER_OPEN,
+	NAMECOM_API_BREAKER_HALF_OPEN,
+} namecom_api_breaker_state_t;
+
+typedef struct namecom_api_breaker_policy {
+	unsigned int consecutive_failures;
+	double error_rate;
+	unsigned int window;
+	long open_ms;
+} namecom_api_breaker_policy_t;
+
+typedef struct namecom_api_breaker_stats {
+	namecom_api_breaker_state_t state;
+	unsigned long opened;              /* times it opened, including after a failed probe */
+	unsigned long half_opened;         /* probes sent */
+	unsigned long closed;              /* probes answered */
+	unsigned long rejected;            /* requests refused while it wasn't closed */
+	unsigned int consecutive_failures;
+	double error_rate;                 /* over the attempts in the window so far */
+	long probe_in_ms;                  /* until the next probe may be sent, 0 unless open */
+} namecom_api_breaker_stats_t;
+
+void           namecom_api_set_breaker_policy  ( namecom_api_t* api, const namecom_api_breaker_policy_t* policy );
+namecom_api_breaker_state_t namecom_api_breaker_state ( const namecom_api_t* api );
+void           namecom_api_breaker_stats       ( const namecom_api_t* api, namecom_api_breaker_stats_t* stats );
+void           namecom_api_set_transport_cache ( namecom_api_t* api, namecom_transport_cache_t* cache );
+
+/*
+ * Optional read-through cache for zone listings.  Listings fetched with
+ * namecom_api_dns_record_list() or namecom_api_dns_record_set() are kept
+ * for ttl seconds, within a budget of max_bytes, and served from memory
+ * until they go stale.  Adding or removing a record through this handle
+ * drops the listing for that domain.  A ttl or budget of zero disables
+ * the cache.  Cached sets are shared with the callers they are handed to
+ * rather than copied, which is one more reason to treat them as read
+ * only.
+ */
+struct namecom_zone_cache_stats;
+bool           namecom_api_set_zone_cache      ( namecom_api_t* api, long ttl, size_t max_bytes );
+bool           namecom_api_zone_cache_stats    ( const namecom_api_t* api, struct namecom_zone_cache_stats* stats );
+
+/*
+ * When a directory is set, every successful listing of a domain is also
+ * written there as an on-disk snapshot (see namecom_zone_snapshot.h) for
+ * other processes to read, and adding or removing a record through this
+ * handle deletes the domain's snapshot.  NULL turns snapshots off.
+ */
+bool           namecom_api_set_zone_snapshots  ( namecom_api_t* api, const char* directory );
+
+/*
+ * Keeps the session token in directory (see namecom_session_cache.h) so
+ * that later processes for the same account can reuse it.  In this mode
+ * namecom_api_logout() leaves the session open.  NULL turns it off.
+ */
+bool           namecom_api_set_session_cache   ( namecom_api_t* api, const char* directory );
 
 
 bool           namecom_api_login            ( namecom_api_t* api );
@@ -60,9 +331,114 @@ typedef struct namecom_api_dns_record {
 namecom_api_dns_record_t* namecom_api_dns_record_create( long id, const char* fqdn, const char* type, const char* content, int ttl, const char* create_date );
 void namecom_api_dns_record_destroy( namecom_api_dns_record_t* dns_record );
 
+/*
+ * Called for each record of a streamed listing as soon as it has been
+ * decoded.  The callback owns the record and returns false to stop.
+ */
+typedef bool (*namecom_api_dns_record_fxn_t)( namecom_api_dns_record_t* record, void* user_data );
+
 
 namecom_api_dns_record_t** namecom_api_dns_record_list   ( namecom_api_t* api, const char* domain );
 bool                       namecom_api_dns_record_add    ( namecom_api_t* api, const char* domain, const char* hostname, const char* type, const char* content, int ttl, int priority, long* id );
 bool                       namecom_api_dns_record_remove ( namecom_api_t* api, const char* domain, long id );
+bool                       namecom_api_dns_record_stream ( namecom_api_t* api, const char* domain, namecom_api_dns_record_fxn_t on_record, void* user_data );
+
+/*
+ * Changes a record in place with a single request, so it keeps its id
+ * and never stops resolving, unlike removing it and adding it again.
+ * Should the server not offer the update command (HTTP 405 or 501, or
+ * result code 211; a 404 may just mean the record is gone and is an
+ * ordinary failure), this fails with namecom_api_last_error() returning
+ * NAMECOM_API_ERROR_UNSUPPORTED (or namecom_api_request_error() for a
+ * submitted update) and the caller may fall back to removing and adding
+ * the record.  Once the server has turned an update down this way, later
+ * calls fail the same way without sending one.
+ */
+bool                       namecom_api_dns_record_update ( namecom_api_t* api, const char* domain, long id, const char* hostname, const char* type, const char* content, int ttl, int priority );
+
+/*
+ * Lists a zone into a columnar record set (see namecom_record_set.h),
+ * which the caller releases with namecom_record_set_destroy().
+ *
+ * Listings of the same domain made while one is already in flight on
+ * another thread don't send requests of their own; they wait for it and
+ * are handed the same set (counted in requests_coalesced), so a set from
+ * this call must be treated as read only.  namecom_api_dns_record_list()
+ * coalesces the same way and copies the shared set into records.
+ */
+struct namecom_record_set;
+struct namecom_record_set* namecom_api_dns_record_set    ( namecom_api_t* api, const char* domain );
+
+
+/*
+ * Asynchronous requests
+ *
+ * The namecom_api_submit_* functions queue a request and return a handle
+ * to it without blocking.  Up to namecom_api_max_concurrency() requests
+ * are in flight at once and the rest wait in submission order.  The
+ * transport is driven by namecom_api_run() or namecom_api_wait(), and
+ * the completion callback (if any) is invoked from within those calls.
+ *
+ * Requests are owned by the caller and must be released with
+ * namecom_api_request_destroy(), which cancels them if they are still
+ * pending.  It is safe to destroy a request from its own callback as
+ * long as nobody is waiting on it.
+ */
+struct namecom_api_request;
+typedef struct namecom_api_request namecom_api_request_t;
+
+typedef void (*namecom_api_completion_fxn_t)( namecom_api_t* api, namecom_api_request_t* request, void* user_data );
+
+namecom_api_request_t* namecom_api_submit_login             ( namecom_api_t* api, namecom_api_completion_fxn_t on_complete, void* user_data );
+namecom_api_request_t* namecom_api_submit_logout            ( namecom_api_t* api, namecom_api_completion_fxn_t on_complete, void* user_data );
+namecom_api_request_t* namecom_api_submit_hello             ( namecom_api_t* api, namecom_api_completion_fxn_t on_complete, void* user_data );
+namecom_api_request_t* namecom_api_submit_domains_list      ( namecom_api_t* api, namecom_api_completion_fxn_t on_complete, void* user_data );
+namecom_api_request_t* namecom_api_submit_dns_record_list   ( namecom_api_t* api, const char* domain, namecom_api_completion_fxn_t on_complete, void* user_data );
+namecom_api_request_t* namecom_api_submit_dns_record_add    ( namecom_api_t* api, const char* domain, const char* hostname, const char* type, const char* content, int ttl, int priority, namecom_api_completion_fxn_t on_complete, void* user_data );
+namecom_api_request_t* namecom_api_submit_dns_record_remove ( namecom_api_t* api, const char* domain, long id, namecom_api_completion_fxn_t on_complete, void* user_data );
+namecom_api_request_t* namecom_api_submit_dns_record_update ( namecom_api_t* api, const char* domain, long id, const char* hostname, const char* type, const char* content, int ttl, int priority, namecom_api_completion_fxn_t on_complete, void* user_data );
+namecom_api_request_t* namecom_api_submit_dns_record_set    ( namecom_api_t* api, const char* domain, namecom_api_completion_fxn_t on_complete, void* user_data );
+namecom_api_request_t* namecom_api_submit_dns_record_stream ( namecom_api_t* api, const char* domain, namecom_api_dns_record_fxn_t on_record, void* record_user_data, namecom_api_completion_fxn_t on_complete, void* user_data );
+
+size_t                     namecom_api_run                  ( namecom_api_t* api, int timeout_ms );
+bool                       namecom_api_wait                 ( namecom_api_t* api, namecom_api_request_t* request );
+size_t                     namecom_api_pending              ( const namecom_api_t* api );
+
+/*
+ * Event loop integration
+ *
+ * Instead of calling namecom_api_run(), a host with its own event loop
+ * (epoll, kqueue, libuv, ...) can drive the transport.  Once the event
+ * callbacks are set, socket_fxn is told which descriptors to watch
+ * (NAMECOM_API_EVENT_REMOVE means stop watching) and timer_fxn is told
+ * when the next timeout fires (-1 cancels it).  The host then reports
+ * readiness with namecom_api_on_socket_event() and expired timers with
+ * namecom_api_on_timeout().  Both return the number of pending requests.
+ *
+ * The blocking calls (namecom_api_login(), namecom_api_wait(), ...)
+ * can't be used while the transport is event driven.  The callbacks can
+ * only be changed while no requests are pending.
+ */
+#define NAMECOM_API_EVENT_NONE    0x00
+#define NAMECOM_API_EVENT_IN      0x01
+#define NAMECOM_API_EVENT_OUT     0x02
+#define NAMECOM_API_EVENT_ERROR   0x04
+#define NAMECOM_API_EVENT_REMOVE  0x08
+
+typedef void (*namecom_api_socket_fxn_t)( namecom_api_t* api, curl_socket_t fd, int events, void* user_data );
+typedef void (*namecom_api_timer_fxn_t)( namecom_api_t* api, long timeout_ms, void* user_data );
+
+bool   namecom_api_set_event_callbacks ( namecom_api_t* api, namecom_api_socket_fxn_t socket_fxn, namecom_api_timer_fxn_t timer_fxn, void* user_data );
+bool   namecom_api_is_event_driven     ( const namecom_api_t* api );
+size_t namecom_api_on_socket_event     ( namecom_api_t* api, curl_socket_t fd, int events );
+size_t namecom_api_on_timeout          ( namecom_api_t* api );
+
+void                       namecom_api_request_destroy      ( namecom_api_request_t* request );
+bool                       namecom_api_request_is_done      ( const namecom_api_request_t* request );
+bool                       namecom_api_request_succeeded    ( const namecom_api_request_t* request );
+long                       namecom_api_request_record_id    ( const namecom_api_request_t* request );
+namecom_api_dns_record_t** namecom_api_request_take_records ( namecom_api_request_t* request );
+struct namecom_record_set*  namecom_api_request_take_record_set ( namecom_api_request_t* request );
+namecom_api_error_t        namecom_api_request_error        ( const namecom_api_request_t* request );
 
 #endif /* _NAMECOM_API_H_ */
@@ -0,0 +1,226 @@
+/*
+ * Copyright (C) 2016-2025 by Joseph A. Marrero. http://www.joemarrero.com/
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#ifndef _WIN32
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#endif
+#include "namecom_host_quota.h"
+
+#define NAMECOM_HOST_QUOTA_MAGIC  0x4e435131u   /* "NCQ1", also the layout version */
+
+/*
+ * The shared segment.  A new segment is all zeros, which is a valid,
+ * full bucket, so it needs no initialization that a crash could
+ * interrupt.
+ */
+typedef struct namecom_host_quota_segment {
+	uint32_t magic;
+	uint32_t reserved;
+	int64_t full_at_ns;                /* when the bucket is next full; earlier means it is */
+	uint64_t taken;
+	uint64_t throttled;
+} namecom_host_quota_segment_t;
+
+struct namecom_host_quota {
+	namecom_host_quota_segment_t* segment;
+	int64_t interval_ns;               /* between tokens at this process's rate */
+	int64_t capacity_ns;               /* burst * interval_ns */
+};
+
+#ifndef _WIN32
+static int64_t namecom_host_quota_now_ns( void )
+{
+	struct timespec now;
+	clock_gettime( CLOCK_MONOTONIC, &now );
+	return (int64_t) now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+/*
+ * Named after a hash of the account and server, like the session cache.
+ */
+static bool namecom_host_quota_name( char* name, size_t size, const char* username, const char* server )
+{
+	uint64_t hash = 14695981039346656037ULL;
+
+	for( const char* s = username; *s; s++ )
+	{
+		hash = (hash ^ (unsigned char) *s) * 1099511628211ULL;
+	}
+
+	hash = (hash ^ (unsigned char) '\n') * 1099511628211ULL;
+
+	for( const char* s = server; *s; s++ )
+	{
+		hash = (hash ^ (unsigned char) *s) * 1099511628211ULL;
+	}
+
+	int len = snprintf( name, size, "/namecom-quota-%016llx", (unsigned long long) hash );
+
+	return len > 0 && (size_t) len < size;
+}
+#endif
+
+namecom_host_quota_t* namecom_host_quota_open( const char* username, const char* server, double rate, double burst )
+{
+#ifdef _WIN32
+	return NULL;
+#else
+	namecom_host_quota_t* quota = NULL;
+	void* mapping = MAP_FAILED;
+	char name[ 64 ];
+	int fd = -1;
+
+	if( rate <= 0.0 || !namecom_host_quota_name( name, sizeof(name), username, server ) )
+	{
+		goto failed;
+	}
+
+	fd = shm_open( name, O_RDWR | O_CREAT, 0600 );
+
+	if( fd < 0 )
+	{
+		goto failed;
+	}
+
+	struct stat info;
+
+	/* Growing the segment zero fills it; racing processes grow it to the same size. */
+	if( fstat( fd, &info ) != 0 ||
+	    ((size_t) info.st_size < sizeof(namecom_host_quota_segment_t) && ftruncate( fd, sizeof(namecom_host_quota_segment_t) ) != 0) )
+	{
+		goto failed;
+	}
+
+	mapping = mmap( NULL, sizeof(namecom_host_quota_segment_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+	close( fd );
+	fd = -1;
+
+	if( mapping == MAP_FAILED )
+	{
+		goto failed;
+	}
+
+	namecom_host_quota_segment_t* segment = mapping;
+	uint32_t magic = 0;
+
+	if( !__atomic_compare_exchange_n( &segment->magic, &magic, NAMECOM_HOST_QUOTA_MAGIC, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE ) &&
+	    magic != NAMECOM_HOST_QUOTA_MAGIC )
+	{
+		/* Made by an incompatible version. */
+		goto failed;
+	}
+
+	quota = malloc( sizeof(namecom_host_quota_t) );
+
+	if( !quota )
+	{
+		goto failed;
+	}
+
+	quota->segment     = segment;
+	quota->interval_ns = (int64_t) (1000000000.0 / rate);
+	quota->capacity_ns = (int64_t) ((burst >= 1.0 ? burst : 1.0) * (double) quota->interval_ns);
+
+	if( quota->interval_ns < 1 )
+	{
+		quota->interval_ns = 1;
+	}
+
+	return quota;
+
+failed:
+	if( fd >= 0 ) close( fd );
+	if( mapping != MAP_FAILED ) munmap( mapping, sizeof(namecom_host_quota_segment_t) );
+	return NULL;
+#endif
+}
+
+void namecom_host_quota_close( namecom_host_quota_t* quota )
+{
+#ifndef _WIN32
+	if( quota )
+	{
+		/* The segment stays for the other processes; it is tiny. */
+		munmap( quota->segment, sizeof(namecom_host_quota_segment_t) );
+		free( quota );
+	}
+#endif
+}
+
+/*
+ * Takes a token, returning 0, or returns how many milliseconds until one
+ * is due.
+ */
+long namecom_host_quota_take( namecom_host_quota_t* quota )
+{
+#ifdef _WIN32
+	return 0;
+#else
+	namecom_host_quota_segment_t* segment = quota->segment;
+	int64_t now = namecom_host_quota_now_ns();
+	int64_t full_at = __atomic_load_n( &segment->full_at_ns, __ATOMIC_ACQUIRE );
+
+	for( ;; )
+	{
+		int64_t next = (full_at > now ? full_at : now) + quota->interval_ns;
+		int64_t wait = next - now - quota->capacity_ns;
+
+		if( wait > 0 )
+		{
+			__atomic_add_fetch( &segment->throttled, 1, __ATOMIC_RELAXED );
+			return (long) (wait / 1000000) + 1;
+		}
+
+		/* On failure full_at is reloaded and the token is priced again. */
+		if( __atomic_compare_exchange_n( &segment->full_at_ns, &full_at, next, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE ) )
+		{
+			__atomic_add_fetch( &segment->taken, 1, __ATOMIC_RELAXED );
+			return 0;
+		}
+	}
+#endif
+}
+
+void namecom_host_quota_stats( const namecom_host_quota_t* quota, namecom_host_quota_stats_t* stats )
+{
+	memset( stats, 0, sizeof(namecom_host_quota_stats_t) );
+
+#ifndef _WIN32
+	namecom_host_quota_segment_t* segment = quota->segment;
+	int64_t now = namecom_host_quota_now_ns();
+	int64_t full_at = __atomic_load_n( &segment->full_at_ns, __ATOMIC_ACQUIRE );
+	int64_t used = full_at > now ? full_at - now : 0;
+
+	stats->tokens    = used < quota->capacity_ns ? (double) (quota->capacity_ns - used) / (double) quota->interval_ns : 0.0;
+	stats->taken     = __atomic_load_n( &segment->taken, __ATOMIC_RELAXED );
+	stats->throttled = __atomic_load_n( &segment->throttled, __ATOMIC_RELAXED );
+#endif
+}
@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2016-2025 by Joseph A. Marrero. http://www.joemarrero.com/
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef _NAMECOM_HOST_QUOTA_H_
+#define _NAMECOM_HOST_QUOTA_H_
+
+#include <stdbool.h>
+
+/*
+ * A request quota shared by every process on the host that uses the same
+ * account and server.  The bucket lives in POSIX shared memory and is a
+ * single word (the time at which the bucket will next be full, as in
+ * GCRA) that is updated with compare-and-swap.  Tokens are never held, so
+ * there is no lock or lease that a crashed process could leave behind, and
+ * no daemon is needed.  Processes may pass different rates; each draws
+ * from the shared bucket at its own.
+ *
+ * Not available on Windows, where opening a quota fails.
+ */
+struct namecom_host_quota;
+typedef struct namecom_host_quota namecom_host_quota_t;
+
+typedef struct namecom_host_quota_stats {
+	double tokens;                     /* available now, at this process's rate */
+	unsigned long long taken;          /* by every process on the host */
+	unsigned long long throttled;      /* requests turned away, by every process on the host */
+} namecom_host_quota_stats_t;
+
+namecom_host_quota_t* namecom_host_quota_open  ( const char* username, const char* server, double rate, double burst );
+void                  namecom_host_quota_close ( namecom_host_quota_t* quota );
+long                  namecom_host_quota_take  ( namecom_host_quota_t* quota );
+void                  namecom_host_quota_stats ( const namecom_host_quota_t* quota, namecom_host_quota_stats_t* stats );
+
+#endif /* _NAMECOM_HOST_QUOTA_H_ */
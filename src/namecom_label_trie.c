@@ -0,0 +1,466 @@
+/*
+ * Copyright (C) 2016-2025 by Joseph A. Marrero. http://www.joemarrero.com/
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "namecom_label_trie.h"
+
+#define NAMECOM_LABEL_TRIE_NONE           UINT32_MAX
+#define NAMECOM_LABEL_TRIE_MAX_LABELS     128
+#define NAMECOM_LABEL_TRIE_MIN_NODES      64
+#define NAMECOM_LABEL_TRIE_MIN_CHILDREN   128
+
+typedef struct namecom_label_trie_node {
+	const char* label;         /* points into the record set's string pool */
+	uint32_t label_len;
+	uint32_t parent;
+	uint32_t first_child;
+	uint32_t next_sibling;
+	long first_record;         /* records named exactly by this node, or -1 */
+} namecom_label_trie_node_t;
+
+typedef struct namecom_label_trie_child {
+	uint32_t hash;
+	uint32_t node;             /* node index + 1, 0 is empty */
+} namecom_label_trie_child_t;
+
+struct namecom_label_trie {
+	const namecom_record_set_t* set;
+	namecom_label_trie_node_t* nodes;
+	size_t nodes_count;
+	size_t nodes_capacity;
+
+	/* (parent, label) -> child, so a descent doesn't walk sibling lists. */
+	namecom_label_trie_child_t* children;
+	size_t children_capacity;
+
+	long* next_record;         /* next record with the same name, or -1 */
+};
+
+typedef struct namecom_label_trie_label {
+	const char* text;
+	size_t len;
+} namecom_label_trie_label_t;
+
+static inline char namecom_label_trie_lower( char c )
+{
+	return (c >= 'A' && c <= 'Z') ? (char) (c - 'A' + 'a') : c;
+}
+
+static uint32_t namecom_label_trie_hash( uint32_t parent, const char* label, size_t len )
+{
+	/* FNV-1a over the parent index and the lower cased label. */
+	uint32_t hash = 2166136261u;
+
+	for( int i = 0; i < 4; i++ )
+	{
+		hash ^= (parent >> (i * 8)) & 0xFF;
+		hash *= 16777619u;
+	}
+
+	for( size_t i = 0; i < len; i++ )
+	{
+		hash ^= (unsigned char) namecom_label_trie_lower( label[ i ] );
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+static bool namecom_label_trie_label_equal( const char* a, size_t a_len, const char* b, size_t b_len )
+{
+	if( a_len != b_len )
+	{
+		return false;
+	}
+
+	for( size_t i = 0; i < a_len; i++ )
+	{
+		if( namecom_label_trie_lower( a[ i ] ) != namecom_label_trie_lower( b[ i ] ) )
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*
+ * Splits name into labels ordered from the right; a trailing dot is
+ * ignored.  Returns the number of labels or -1 if there are too many.
+ */
+static int namecom_label_trie_split( const char* name, namecom_label_trie_label_t* labels )
+{
+	size_t end = strlen( name );
+	int count = 0;
+
+	if( end > 0 && name[ end - 1 ] == '.' )
+	{
+		end -= 1;
+	}
+
+	while( end > 0 )
+	{
+		size_t start = end;
+
+		while( start > 0 && name[ start - 1 ] != '.' )
+		{
+			start -= 1;
+		}
+
+		if( count == NAMECOM_LABEL_TRIE_MAX_LABELS )
+		{
+			return -1;
+		}
+
+		labels[ count ].text = name + start;
+		labels[ count ].len  = end - start;
+		count += 1;
+
+		end = start > 0 ? start - 1 : 0;
+	}
+
+	return count;
+}
+
+static uint32_t namecom_label_trie_child( const namecom_label_trie_t* trie, uint32_t parent, const char* label, size_t len )
+{
+	uint32_t hash = namecom_label_trie_hash( parent, label, len );
+	size_t mask = trie->children_capacity - 1;
+	size_t i = hash & mask;
+
+	while( trie->children[ i ].node )
+	{
+		const namecom_label_trie_child_t* child = &trie->children[ i ];
+		const namecom_label_trie_node_t* node = &trie->nodes[ child->node - 1 ];
+
+		if( child->hash == hash && node->parent == parent && namecom_label_trie_label_equal( node->label, node->label_len, label, len ) )
+		{
+			return child->node - 1;
+		}
+
+		i = (i + 1) & mask;
+	}
+
+	return NAMECOM_LABEL_TRIE_NONE;
+}
+
+static bool namecom_label_trie_grow_children( namecom_label_trie_t* trie )
+{
+	size_t capacity = trie->children_capacity * 2;
+	namecom_label_trie_child_t* children = calloc( capacity, sizeof(namecom_label_trie_child_t) );
+
+	if( !children )
+	{
+		return false;
+	}
+
+	for( size_t i = 0; i < trie->children_capacity; i++ )
+	{
+		if( trie->children[ i ].node )
+		{
+			size_t j = trie->children[ i ].hash & (capacity - 1);
+
+			while( children[ j ].node )
+			{
+				j = (j + 1) & (capacity - 1);
+			}
+
+			children[ j ] = trie->children[ i ];
+		}
+	}
+
+	free( trie->children );
+	trie->children          = children;
+	trie->children_capacity = capacity;
+
+	return true;
+}
+
+static uint32_t namecom_label_trie_add_child( namecom_label_trie_t* trie, uint32_t parent, const char* label, size_t len )
+{
+	if( trie->nodes_count == trie->nodes_capacity )
+	{
+		size_t capacity = trie->nodes_capacity * 2;
+		namecom_label_trie_node_t* nodes = realloc( trie->nodes, capacity * sizeof(namecom_label_trie_node_t) );
+
+		if( !nodes )
+		{
+			return NAMECOM_LABEL_TRIE_NONE;
+		}
+
+		trie->nodes          = nodes;
+		trie->nodes_capacity = capacity;
+	}
+
+	/* Children are nodes other than the root; keep the table half empty. */
+	if( trie->nodes_count * 2 >= trie->children_capacity && !namecom_label_trie_grow_children( trie ) )
+	{
+		return NAMECOM_LABEL_TRIE_NONE;
+	}
+
+	uint32_t index = (uint32_t) trie->nodes_count++;
+	namecom_label_trie_node_t* node = &trie->nodes[ index ];
+
+	node->label        = label;
+	node->label_len    = (uint32_t) len;
+	node->parent       = parent;
+	node->first_child  = NAMECOM_LABEL_TRIE_NONE;
+	node->next_sibling = trie->nodes[ parent ].first_child;
+	node->first_record = -1;
+	trie->nodes[ parent ].first_child = index;
+
+	uint32_t hash = namecom_label_trie_hash( parent, label, len );
+	size_t mask = trie->children_capacity - 1;
+	size_t i = hash & mask;
+
+	while( trie->children[ i ].node )
+	{
+		i = (i + 1) & mask;
+	}
+
+	trie->children[ i ].hash = hash;
+	trie->children[ i ].node = index + 1;
+
+	return index;
+}
+
+namecom_label_trie_t* namecom_label_trie_build( const namecom_record_set_t* set )
+{
+	namecom_label_trie_t* trie = calloc( 1, sizeof(namecom_label_trie_t) );
+
+	if( !trie )
+	{
+		goto failed;
+	}
+
+	trie->set               = set;
+	trie->nodes_capacity    = NAMECOM_LABEL_TRIE_MIN_NODES;
+	trie->nodes             = malloc( trie->nodes_capacity * sizeof(namecom_label_trie_node_t) );
+	trie->children_capacity = NAMECOM_LABEL_TRIE_MIN_CHILDREN;
+	trie->children          = calloc( trie->children_capacity, sizeof(namecom_label_trie_child_t) );
+	trie->next_record       = malloc( (set->count > 0 ? set->count : 1) * sizeof(long) );
+
+	if( !trie->nodes || !trie->children || !trie->next_record )
+	{
+		goto failed;
+	}
+
+	/* The root stands for the empty name. */
+	trie->nodes[ 0 ].label        = "";
+	trie->nodes[ 0 ].label_len    = 0;
+	trie->nodes[ 0 ].parent       = NAMECOM_LABEL_TRIE_NONE;
+	trie->nodes[ 0 ].first_child  = NAMECOM_LABEL_TRIE_NONE;
+	trie->nodes[ 0 ].next_sibling = NAMECOM_LABEL_TRIE_NONE;
+	trie->nodes[ 0 ].first_record = -1;
+	trie->nodes_count = 1;
+
+	namecom_label_trie_label_t labels[ NAMECOM_LABEL_TRIE_MAX_LABELS ];
+
+	/* Walking backwards leaves each name's records in listing order. */
+	for( size_t r = set->count; r-- > 0; )
+	{
+		const char* fqdn = namecom_record_set_fqdn( set, r );
+		int count = fqdn ? namecom_label_trie_split( fqdn, labels ) : -1;
+
+		trie->next_record[ r ] = -1;
+
+		if( count < 0 )
+		{
+			continue;
+		}
+
+		uint32_t node = 0;
+
+		for( int l = 0; l < count; l++ )
+		{
+			uint32_t child = namecom_label_trie_child( trie, node, labels[ l ].text, labels[ l ].len );
+
+			if( child == NAMECOM_LABEL_TRIE_NONE )
+			{
+				child = namecom_label_trie_add_child( trie, node, labels[ l ].text, labels[ l ].len );
+
+				if( child == NAMECOM_LABEL_TRIE_NONE )
+				{
+					goto failed;
+				}
+			}
+
+			node = child;
+		}
+
+		trie->next_record[ r ] = trie->nodes[ node ].first_record;
+		trie->nodes[ node ].first_record = (long) r;
+	}
+
+	return trie;
+
+failed:
+	namecom_label_trie_destroy( trie );
+	return NULL;
+}
+
+void namecom_label_trie_destroy( namecom_label_trie_t* trie )
+{
+	if( trie )
+	{
+		free( trie->nodes );
+		free( trie->children );
+		free( trie->next_record );
+		free( trie );
+	}
+}
+
+typedef struct namecom_label_trie_walk {
+	const namecom_label_trie_t* trie;
+	namecom_label_trie_fxn_t fxn;
+	void* user_data;
+	size_t visited;
+	bool stopped;
+} namecom_label_trie_walk_t;
+
+static void namecom_label_trie_visit_records( namecom_label_trie_walk_t* walk, uint32_t node )
+{
+	for( long r = walk->trie->nodes[ node ].first_record; r >= 0 && !walk->stopped; r = walk->trie->next_record[ r ] )
+	{
+		walk->visited += 1;
+
+		if( !walk->fxn( (size_t) r, walk->user_data ) )
+		{
+			walk->stopped = true;
+		}
+	}
+}
+
+static void namecom_label_trie_visit_subtree( namecom_label_trie_walk_t* walk, uint32_t node )
+{
+	namecom_label_trie_visit_records( walk, node );
+
+	for( uint32_t child = walk->trie->nodes[ node ].first_child; child != NAMECOM_LABEL_TRIE_NONE && !walk->stopped; child = walk->trie->nodes[ child ].next_sibling )
+	{
+		namecom_label_trie_visit_subtree( walk, child );
+	}
+}
+
+/*
+ * Matches a label against a glob where '*' is any run of characters and
+ * '?' any single character.
+ */
+static bool namecom_label_trie_glob( const char* pattern, size_t pattern_len, const char* label, size_t label_len )
+{
+	size_t p = 0, l = 0;
+	size_t star = (size_t) -1, resume = 0;
+
+	while( l < label_len )
+	{
+		if( p < pattern_len && (pattern[ p ] == '?' || namecom_label_trie_lower( pattern[ p ] ) == namecom_label_trie_lower( label[ l ] )) )
+		{
+			p += 1;
+			l += 1;
+		}
+		else if( p < pattern_len && pattern[ p ] == '*' )
+		{
+			star   = p++;
+			resume = l;
+		}
+		else if( star != (size_t) -1 )
+		{
+			p = star + 1;
+			l = ++resume;
+		}
+		else
+		{
+			return false;
+		}
+	}
+
+	while( p < pattern_len && pattern[ p ] == '*' )
+	{
+		p += 1;
+	}
+
+	return p == pattern_len;
+}
+
+static void namecom_label_trie_visit_matches( namecom_label_trie_walk_t* walk, uint32_t node, const namecom_label_trie_label_t* labels, int count, bool subtree )
+{
+	if( count == 0 )
+	{
+		if( subtree )
+		{
+			namecom_label_trie_visit_subtree( walk, node );
+		}
+		else
+		{
+			namecom_label_trie_visit_records( walk, node );
+		}
+	}
+	else if( memchr( labels->text, '*', labels->len ) || memchr( labels->text, '?', labels->len ) )
+	{
+		for( uint32_t child = walk->trie->nodes[ node ].first_child; child != NAMECOM_LABEL_TRIE_NONE && !walk->stopped; child = walk->trie->nodes[ child ].next_sibling )
+		{
+			const namecom_label_trie_node_t* n = &walk->trie->nodes[ child ];
+
+			if( namecom_label_trie_glob( labels->text, labels->len, n->label, n->label_len ) )
+			{
+				namecom_label_trie_visit_matches( walk, child, labels + 1, count - 1, subtree );
+			}
+		}
+	}
+	else
+	{
+		uint32_t child = namecom_label_trie_child( walk->trie, node, labels->text, labels->len );
+
+		if( child != NAMECOM_LABEL_TRIE_NONE )
+		{
+			namecom_label_trie_visit_matches( walk, child, labels + 1, count - 1, subtree );
+		}
+	}
+}
+
+/*
+ * Visits the records whose names match pattern (and, with subtree set,
+ * everything below them).  Returns the number of records visited.
+ */
+size_t namecom_label_trie_match( const namecom_label_trie_t* trie, const char* pattern, bool subtree, namecom_label_trie_fxn_t fxn, void* user_data )
+{
+	namecom_label_trie_label_t labels[ NAMECOM_LABEL_TRIE_MAX_LABELS ];
+	int count = namecom_label_trie_split( pattern, labels );
+	namecom_label_trie_walk_t walk = {
+		.trie      = trie,
+		.fxn       = fxn,
+		.user_data = user_data,
+		.visited   = 0,
+		.stopped   = false
+	};
+
+	if( count >= 0 )
+	{
+		namecom_label_trie_visit_matches( &walk, 0, labels, count, subtree );
+	}
+
+	return walk.visited;
+}
+
+size_t namecom_label_trie_subtree( const namecom_label_trie_t* trie, const char* name, namecom_label_trie_fxn_t fxn, void* user_data )
+{
+	return namecom_label_trie_match( trie, name, true, fxn, user_data );
+}
@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2016-2025 by Joseph A. Marrero. http://www.joemarrero.com/
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef _NAMECOM_LABEL_TRIE_H_
+#define _NAMECOM_LABEL_TRIE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "namecom_record_set.h"
+
+/*
+ * A trie over the names of a fetched zone, keyed on DNS labels from the
+ * right (com -> example -> edge -> pop-1).  Everything below a name is
+ * one subtree, so subtree queries cost a walk down the name plus the size
+ * of the answer rather than a scan of the zone.
+ *
+ * Patterns are names whose labels may contain the glob characters '*'
+ * (any run of characters) and '?' (any one character), for example
+ * "pop-*.edge.example.com".  Each pattern label matches exactly one
+ * label of a name; with subtree set, the records at or below every
+ * matching name are visited.  Labels compare case-insensitively.
+ *
+ * The callback receives record indexes into the set and returns false
+ * to stop the walk.  The record set must outlive the trie and must not
+ * be appended to while the trie is in use.
+ */
+struct namecom_label_trie;
+typedef struct namecom_label_trie namecom_label_trie_t;
+
+typedef bool (*namecom_label_trie_fxn_t)( size_t record, void* user_data );
+
+namecom_label_trie_t* namecom_label_trie_build   ( const namecom_record_set_t* set );
+void                  namecom_label_trie_destroy ( namecom_label_trie_t* trie );
+size_t                namecom_label_trie_match   ( const namecom_label_trie_t* trie, const char* pattern, bool subtree, namecom_label_trie_fxn_t fxn, void* user_data );
+size_t                namecom_label_trie_subtree ( const namecom_label_trie_t* trie, const char* name, namecom_label_trie_fxn_t fxn, void* user_data );
+
+#endif /* _NAMECOM_LABEL_TRIE_H_ */
@@ -0,0 +1,935 @@
+/*
+ * Copyright (C) 2016-2025 by Joseph A. Marrero. http://www.joemarrero.com/
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <jansson.h>
+#include "namecom_record_decoder.h"
+
+/*
+ * The scanner skips over runs of uninteresting bytes 32 or 16 at a time
+ * when AVX2 or SSE2 is available.  Define NAMECOM_RECORD_DECODER_SCALAR
+ * to force the portable byte loop.
+ */
+#if !defined(NAMECOM_RECORD_DECODER_SCALAR) && defined(__AVX2__)
+#define NAMECOM_RECORD_DECODER_AVX2
+#include <immintrin.h>
+#elif !defined(NAMECOM_RECORD_DECODER_SCALAR) && (defined(__SSE2__) || defined(_M_X64))
+#define NAMECOM_RECORD_DECODER_SSE2
+#include <emmintrin.h>
+#endif
+
+#define NAMECOM_RECORD_DECODER_KEY_LENGTH        32
+#define NAMECOM_RECORD_DECODER_MIN_CAPTURE       512
+
+typedef enum namecom_record_decoder_capture {
+	NAMECOM_RECORD_DECODER_CAPTURE_NONE = 0,
+	NAMECOM_RECORD_DECODER_CAPTURE_RECORD,
+	NAMECOM_RECORD_DECODER_CAPTURE_RESULT,
+} namecom_record_decoder_capture_t;
+
+struct namecom_record_decoder {
+	namecom_api_dns_record_fxn_t on_record;
+	void* user_data;
+	namecom_record_set_t* set;
+
+	/* Structural state of the document. */
+	int depth;
+	bool in_string;
+	bool escaped;
+	bool expect_key;
+	bool reading_key;
+	bool in_records;
+	bool complete;
+	namecom_record_decoder_error_t error;
+
+	/* The most recent key of the top level object. */
+	char key[ NAMECOM_RECORD_DECODER_KEY_LENGTH ];
+	size_t key_len;
+
+	/* The object currently being collected, if any. */
+	namecom_record_decoder_capture_t capture;
+	int capture_depth;
+	bool capture_nested;
+	char* capture_text;
+	size_t capture_len;
+	size_t capture_capacity;
+
+	int result_code;
+	size_t count;
+};
+
+namecom_record_decoder_t* namecom_record_decoder_create( namecom_api_dns_record_fxn_t on_record, void* user_data )
+{
+	namecom_record_decoder_t* decoder = malloc( sizeof(namecom_record_decoder_t) );
+
+	if( decoder )
+	{
+		memset( decoder, 0, sizeof(namecom_record_decoder_t) );
+		namecom_record_decoder_reset( decoder, on_record, user_data );
+	}
+
+	return decoder;
+}
+
+void namecom_record_decoder_destroy( namecom_record_decoder_t* decoder )
+{
+	if( decoder )
+	{
+		free( decoder->capture_text );
+		free( decoder );
+	}
+}
+
+void namecom_record_decoder_reset( namecom_record_decoder_t* decoder, namecom_api_dns_record_fxn_t on_record, void* user_data )
+{
+	/* The capture buffer is kept so a reused decoder doesn't reallocate it. */
+	char* capture_text      = decoder->capture_text;
+	size_t capture_capacity = decoder->capture_capacity;
+
+	memset( decoder, 0, sizeof(namecom_record_decoder_t) );
+
+	decoder->on_record        = on_record;
+	decoder->user_data        = user_data;
+	decoder->capture_text     = capture_text;
+	decoder->capture_capacity = capture_capacity;
+	decoder->result_code      = -1;
+}
+
+/*
+ * Decoded records are appended to set instead of being handed to the
+ * record callback.  The set is owned by the caller.
+ */
+void namecom_record_decoder_collect( namecom_record_decoder_t* decoder, namecom_record_set_t* set )
+{
+	decoder->set = set;
+}
+
+/*
+ * Starts over on a new response with the same callback or set.
+ */
+void namecom_record_decoder_rewind( namecom_record_decoder_t* decoder )
+{
+	namecom_record_set_t* set = decoder->set;
+
+	namecom_record_decoder_reset( decoder, decoder->on_record, decoder->user_data );
+	decoder->set = set;
+}
+
+/*
+ * Always leaves room for a terminating nul after the captured text.
+ */
+static bool namecom_record_decoder_capture_append( namecom_record_decoder_t* decoder, const char* data, size_t len )
+{
+	if( decoder->capture_len + len + 1 > decoder->capture_capacity )
+	{
+		size_t capacity = decoder->capture_capacity ? decoder->capture_capacity : NAMECOM_RECORD_DECODER_MIN_CAPTURE;
+
+		while( decoder->capture_len + len + 1 > capacity )
+		{
+			capacity *= 2;
+		}
+
+		char* text = realloc( decoder->capture_text, capacity );
+
+		if( !text )
+		{
+			decoder->error = NAMECOM_RECORD_DECODER_ERROR_OUT_OF_MEMORY;
+			return false;
+		}
+
+		decoder->capture_text     = text;
+		decoder->capture_capacity = capacity;
+	}
+
+	memcpy( decoder->capture_text + decoder->capture_len, data, len );
+	decoder->capture_len += len;
+
+	return true;
+}
+
+/*
+ * Returns the length of the leading run of bytes that can't change the
+ * decoder's state: anything but a quote or backslash inside a string,
+ * and anything but a quote or structural character outside of one.
+ */
+static size_t namecom_record_decoder_scan( const char* data, size_t len, bool in_string )
+{
+	size_t i = 0;
+
+#if defined(NAMECOM_RECORD_DECODER_AVX2)
+	const __m256i quote     = _mm256_set1_epi8( '"' );
+	const __m256i backslash = _mm256_set1_epi8( '\\' );
+	const __m256i colon     = _mm256_set1_epi8( ':' );
+	const __m256i comma     = _mm256_set1_epi8( ',' );
+	/* '[' | 0x20 == '{' and ']' | 0x20 == '}' */
+	const __m256i fold      = _mm256_set1_epi8( 0x20 );
+	const __m256i lbrace    = _mm256_set1_epi8( '{' );
+	const __m256i rbrace    = _mm256_set1_epi8( '}' );
+
+	for( ; i + 32 <= len; i += 32 )
+	{
+		__m256i chunk = _mm256_loadu_si256( (const __m256i*) (data + i) );
+		__m256i hits  = _mm256_or_si256( _mm256_cmpeq_epi8( chunk, quote ), _mm256_cmpeq_epi8( chunk, backslash ) );
+
+		if( !in_string )
+		{
+			__m256i folded = _mm256_or_si256( chunk, fold );
+			hits = _mm256_or_si256( hits, _mm256_or_si256( _mm256_cmpeq_epi8( chunk, colon ), _mm256_cmpeq_epi8( chunk, comma ) ) );
+			hits = _mm256_or_si256( hits, _mm256_or_si256( _mm256_cmpeq_epi8( folded, lbrace ), _mm256_cmpeq_epi8( folded, rbrace ) ) );
+		}
+
+		unsigned int mask = (unsigned int) _mm256_movemask_epi8( hits );
+
+		if( mask )
+		{
+			return i + (size_t) __builtin_ctz( mask );
+		}
+	}
+#elif defined(NAMECOM_RECORD_DECODER_SSE2)
+	const __m128i quote     = _mm_set1_epi8( '"' );
+	const __m128i backslash = _mm_set1_epi8( '\\' );
+	const __m128i colon     = _mm_set1_epi8( ':' );
+	const __m128i comma     = _mm_set1_epi8( ',' );
+	/* '[' | 0x20 == '{' and ']' | 0x20 == '}' */
+	const __m128i fold      = _mm_set1_epi8( 0x20 );
+	const __m128i lbrace    = _mm_set1_epi8( '{' );
+	const __m128i rbrace    = _mm_set1_epi8( '}' );
+
+	for( ; i + 16 <= len; i += 16 )
+	{
+		__m128i chunk = _mm_loadu_si128( (const __m128i*) (data + i) );
+		__m128i hits  = _mm_or_si128( _mm_cmpeq_epi8( chunk, quote ), _mm_cmpeq_epi8( chunk, backslash ) );
+
+		if( !in_string )
+		{
+			__m128i folded = _mm_or_si128( chunk, fold );
+			hits = _mm_or_si128( hits, _mm_or_si128( _mm_cmpeq_epi8( chunk, colon ), _mm_cmpeq_epi8( chunk, comma ) ) );
+			hits = _mm_or_si128( hits, _mm_or_si128( _mm_cmpeq_epi8( folded, lbrace ), _mm_cmpeq_epi8( folded, rbrace ) ) );
+		}
+
+		unsigned int mask = (unsigned int) _mm_movemask_epi8( hits );
+
+		if( mask )
+		{
+			return i + (size_t) __builtin_ctz( mask );
+		}
+	}
+#endif
+
+	for( ; i < len; i++ )
+	{
+		char c = data[ i ];
+
+		if( c == '"' || c == '\\' )
+		{
+			break;
+		}
+
+		if( !in_string && (c == ':' || c == ',' || (c | 0x20) == '{' || (c | 0x20) == '}') )
+		{
+			break;
+		}
+	}
+
+	return i;
+}
+
+static const char* namecom_record_decoder_string( json_t* object, const char* key )
+{
+	json_t* value = json_object_get( object, key );
+	return json_is_string(value) ? json_string_value( value ) : NULL;
+}
+
+/*
+ * The API sends numbers as strings, but be lenient in case that changes.
+ */
+static long namecom_record_decoder_long( json_t* object, const char* key )
+{
+	json_t* value = json_object_get( object, key );
+
+	if( json_is_integer(value) )
+	{
+		return (long) json_integer_value( value );
+	}
+	else if( json_is_string(value) )
+	{
+		return atol( json_string_value(value) );
+	}
+
+	return 0;
+}
+
+static bool namecom_record_decoder_emit( namecom_record_decoder_t* decoder, long id, const char* fqdn, const char* type, const char* content, int ttl, const char* create_date )
+{
+	if( decoder->set )
+	{
+		if( !namecom_record_set_append( decoder->set, id, fqdn, type, content, ttl, create_date ) )
+		{
+			decoder->error = NAMECOM_RECORD_DECODER_ERROR_OUT_OF_MEMORY;
+			return false;
+		}
+
+		decoder->count += 1;
+		return true;
+	}
+
+	namecom_api_dns_record_t* record = namecom_api_dns_record_create( id, fqdn, type, content, ttl, create_date );
+
+	if( !record )
+	{
+		decoder->error = NAMECOM_RECORD_DECODER_ERROR_OUT_OF_MEMORY;
+		return false;
+	}
+
+	decoder->count += 1;
+
+	if( decoder->on_record && !decoder->on_record( record, decoder->user_data ) )
+	{
+		decoder->error = NAMECOM_RECORD_DECODER_ERROR_STOPPED;
+		return false;
+	}
+	else if( decoder->on_record )
+	{
+		return true;
+	}
+
+	namecom_api_dns_record_destroy( record );
+
+	return true;
+}
+
+#ifndef NAMECOM_RECORD_DECODER_JANSSON
+static void namecom_record_decoder_put_utf8( char** out, unsigned long cp )
+{
+	char* d = *out;
+
+	if( cp < 0x80 )
+	{
+		*d++ = (char) cp;
+	}
+	else if( cp < 0x800 )
+	{
+		*d++ = (char) (0xC0 | (cp >> 6));
+		*d++ = (char) (0x80 | (cp & 0x3F));
+	}
+	else if( cp < 0x10000 )
+	{
+		*d++ = (char) (0xE0 | (cp >> 12));
+		*d++ = (char) (0x80 | ((cp >> 6) & 0x3F));
+		*d++ = (char) (0x80 | (cp & 0x3F));
+	}
+	else
+	{
+		*d++ = (char) (0xF0 | (cp >> 18));
+		*d++ = (char) (0x80 | ((cp >> 12) & 0x3F));
+		*d++ = (char) (0x80 | ((cp >> 6) & 0x3F));
+		*d++ = (char) (0x80 | (cp & 0x3F));
+	}
+
+	*out = d;
+}
+
+static bool namecom_record_decoder_hex4( const char* p, const char* end, unsigned long* value )
+{
+	*value = 0;
+
+	if( end - p < 4 )
+	{
+		return false;
+	}
+
+	for( int i = 0; i < 4; i++ )
+	{
+		char c = p[ i ];
+		*value <<= 4;
+
+		if( c >= '0' && c <= '9' )      *value |= (unsigned long) (c - '0');
+		else if( c >= 'a' && c <= 'f' ) *value |= (unsigned long) (c - 'a' + 10);
+		else if( c >= 'A' && c <= 'F' ) *value |= (unsigned long) (c - 'A' + 10);
+		else return false;
+	}
+
+	return true;
+}
+
+/*
+ * Unescapes the string that starts at the opening quote *p in place and
+ * nul terminates it.  An unescaped string is never longer than its
+ * escaped form, so it always fits.
+ */
+static char* namecom_record_decoder_string_view( char** p, const char* end )
+{
+	char* start = *p + 1;
+	char* src   = start;
+	char* dst   = start;
+
+	while( src < end )
+	{
+		char c = *src++;
+
+		if( c == '"' )
+		{
+			*dst = '\0';
+			*p   = src;
+			return start;
+		}
+		else if( (unsigned char) c < 0x20 )
+		{
+			/* Control characters have to be escaped. */
+			return NULL;
+		}
+		else if( c != '\\' )
+		{
+			*dst++ = c;
+			continue;
+		}
+		else if( src >= end )
+		{
+			break;
+		}
+
+		switch( *src++ )
+		{
+			case '"':  *dst++ = '"'; break;
+			case '\\': *dst++ = '\\'; break;
+			case '/':  *dst++ = '/'; break;
+			case 'b':  *dst++ = '\b'; break;
+			case 'f':  *dst++ = '\f'; break;
+			case 'n':  *dst++ = '\n'; break;
+			case 'r':  *dst++ = '\r'; break;
+			case 't':  *dst++ = '\t'; break;
+			case 'u':
+			{
+				unsigned long cp;
+
+				if( !namecom_record_decoder_hex4( src, end, &cp ) )
+				{
+					return NULL;
+				}
+
+				src += 4;
+
+				if( cp >= 0xD800 && cp <= 0xDBFF )
+				{
+					unsigned long low;
+
+					if( end - src < 6 || src[ 0 ] != '\\' || src[ 1 ] != 'u' ||
+					    !namecom_record_decoder_hex4( src + 2, end, &low ) || low < 0xDC00 || low > 0xDFFF )
+					{
+						return NULL;
+					}
+
+					src += 6;
+					cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+				}
+				else if( cp >= 0xDC00 && cp <= 0xDFFF )
+				{
+					return NULL;
+				}
+
+				if( cp == 0 )
+				{
+					return NULL;
+				}
+
+				namecom_record_decoder_put_utf8( &dst, cp );
+				break;
+			}
+			default:
+				return NULL;
+		}
+	}
+
+	return NULL;
+}
+
+static char* namecom_record_decoder_skip_space( char* p, const char* end )
+{
+	while( p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r') )
+	{
+		p++;
+	}
+
+	return p;
+}
+
+typedef enum namecom_record_decoder_scalar {
+	NAMECOM_RECORD_DECODER_SCALAR_INVALID = 0,
+	NAMECOM_RECORD_DECODER_SCALAR_INTEGER,
+	NAMECOM_RECORD_DECODER_SCALAR_OTHER,       /* a real, true, false or null */
+} namecom_record_decoder_scalar_t;
+
+/*
+ * Classifies a bare token the way a JSON parser would.
+ */
+static namecom_record_decoder_scalar_t namecom_record_decoder_scalar( const char* token )
+{
+	const char* p = token;
+
+	if( strcmp( token, "true" ) == 0 || strcmp( token, "false" ) == 0 || strcmp( token, "null" ) == 0 )
+	{
+		return NAMECOM_RECORD_DECODER_SCALAR_OTHER;
+	}
+
+	if( *p == '-' ) p++;
+
+	if( *p == '0' ) p++;
+	else if( *p >= '1' && *p <= '9' ) while( *p >= '0' && *p <= '9' ) p++;
+	else return NAMECOM_RECORD_DECODER_SCALAR_INVALID;
+
+	if( *p == '\0' )
+	{
+		return NAMECOM_RECORD_DECODER_SCALAR_INTEGER;
+	}
+
+	if( *p == '.' )
+	{
+		p++;
+		if( *p < '0' || *p > '9' ) return NAMECOM_RECORD_DECODER_SCALAR_INVALID;
+		while( *p >= '0' && *p <= '9' ) p++;
+	}
+
+	if( *p == 'e' || *p == 'E' )
+	{
+		p++;
+		if( *p == '+' || *p == '-' ) p++;
+		if( *p < '0' || *p > '9' ) return NAMECOM_RECORD_DECODER_SCALAR_INVALID;
+		while( *p >= '0' && *p <= '9' ) p++;
+	}
+
+	return *p == '\0' ? NAMECOM_RECORD_DECODER_SCALAR_OTHER : NAMECOM_RECORD_DECODER_SCALAR_INVALID;
+}
+
+/*
+ * Decodes a flat record object directly out of the capture buffer.
+ * Strings are unescaped in place and the record is built from views
+ * into the buffer, so nothing is allocated besides the record itself.
+ */
+static bool namecom_record_decoder_emit_flat( namecom_record_decoder_t* decoder )
+{
+	char* p         = decoder->capture_text;
+	const char* end = decoder->capture_text + decoder->capture_len;
+	const char* record_id   = NULL;
+	const char* name        = NULL;
+	const char* type        = NULL;
+	const char* content     = NULL;
+	const char* ttl         = NULL;
+	const char* create_date = NULL;
+
+	decoder->capture_text[ decoder->capture_len ] = '\0';
+
+	p = namecom_record_decoder_skip_space( p, end );
+	if( p >= end || *p != '{' ) return false;
+	p = namecom_record_decoder_skip_space( p + 1, end );
+
+	char next = p < end ? *p : '\0';
+
+	if( next == '}' )
+	{
+		goto emit;
+	}
+
+	for( ;; )
+	{
+		if( p >= end || *p != '"' ) return false;
+		const char* key = namecom_record_decoder_string_view( &p, end );
+		if( !key ) return false;
+
+		p = namecom_record_decoder_skip_space( p, end );
+		if( p >= end || *p != ':' ) return false;
+		p = namecom_record_decoder_skip_space( p + 1, end );
+		if( p >= end ) return false;
+
+		const char* string = NULL;
+		const char* number = NULL;
+
+		if( *p == '"' )
+		{
+			string = namecom_record_decoder_string_view( &p, end );
+			if( !string ) return false;
+			number = string;
+			p = namecom_record_decoder_skip_space( p, end );
+			if( p >= end ) return false;
+			next = *p++;
+		}
+		else
+		{
+			/* A number, true, false or null; the token is terminated in place. */
+			char* token = p;
+			namecom_record_decoder_scalar_t scalar;
+
+			while( p < end && *p != ',' && *p != '}' && *p != ' ' && *p != '\t' && *p != '\n' && *p != '\r' )
+			{
+				p++;
+			}
+
+			if( p == token || p >= end ) return false;
+
+			next = *p;
+			*p++ = '\0';
+
+			if( next != ',' && next != '}' )
+			{
+				p = namecom_record_decoder_skip_space( p, end );
+				if( p >= end ) return false;
+				next = *p++;
+			}
+
+			scalar = namecom_record_decoder_scalar( token );
+			if( scalar == NAMECOM_RECORD_DECODER_SCALAR_INVALID ) return false;
+			number = scalar == NAMECOM_RECORD_DECODER_SCALAR_INTEGER ? token : NULL;
+		}
+
+		/*
+		 * As on the jansson path, the text fields only take strings and
+		 * the numeric ones a string or an integer; any other value reads
+		 * as missing.
+		 */
+		if( strcmp( key, "record_id" ) == 0 )        record_id   = number;
+		else if( strcmp( key, "name" ) == 0 )        name        = string;
+		else if( strcmp( key, "type" ) == 0 )        type        = string;
+		else if( strcmp( key, "content" ) == 0 )     content     = string;
+		else if( strcmp( key, "ttl" ) == 0 )         ttl         = number;
+		else if( strcmp( key, "create_date" ) == 0 ) create_date = string;
+
+		if( next == '}' )
+		{
+			break;
+		}
+		else if( next != ',' )
+		{
+			return false;
+		}
+
+		p = namecom_record_decoder_skip_space( p, end );
+	}
+
+emit:
+	return namecom_record_decoder_emit( decoder,
+		record_id ? atol( record_id ) : 0,
+		name, type, content,
+		ttl ? atoi( ttl ) : 0,
+		create_date
+	);
+}
+
+#endif
+
+static bool namecom_record_decoder_end_capture( namecom_record_decoder_t* decoder )
+{
+	bool result = false;
+
+#ifndef NAMECOM_RECORD_DECODER_JANSSON
+	if( decoder->capture == NAMECOM_RECORD_DECODER_CAPTURE_RECORD && !decoder->capture_nested )
+	{
+		result = namecom_record_decoder_emit_flat( decoder );
+
+		decoder->capture       = NAMECOM_RECORD_DECODER_CAPTURE_NONE;
+		decoder->capture_depth = 0;
+		decoder->capture_len   = 0;
+
+		return result;
+	}
+#endif
+
+	json_error_t error;
+	json_t* object = json_loadb( decoder->capture_text, decoder->capture_len, 0, &error );
+
+	if( json_is_object(object) )
+	{
+		if( decoder->capture == NAMECOM_RECORD_DECODER_CAPTURE_RESULT )
+		{
+			json_t* code_obj = json_object_get( object, "code" );
+
+			if( json_is_integer(code_obj) )
+			{
+				decoder->result_code = (int) json_integer_value( code_obj );
+			}
+
+			result = true;
+		}
+		else
+		{
+			result = namecom_record_decoder_emit( decoder,
+				namecom_record_decoder_long( object, "record_id" ),
+				namecom_record_decoder_string( object, "name" ),
+				namecom_record_decoder_string( object, "type" ),
+				namecom_record_decoder_string( object, "content" ),
+				(int) namecom_record_decoder_long( object, "ttl" ),
+				namecom_record_decoder_string( object, "create_date" )
+			);
+		}
+	}
+
+	json_decref( object );
+
+	decoder->capture       = NAMECOM_RECORD_DECODER_CAPTURE_NONE;
+	decoder->capture_depth = 0;
+	decoder->capture_len   = 0;
+
+	return result;
+}
+
+static bool namecom_record_decoder_begin_value( namecom_record_decoder_t* decoder, char c )
+{
+	namecom_record_decoder_capture_t capture = NAMECOM_RECORD_DECODER_CAPTURE_NONE;
+
+	if( decoder->depth == 1 && !decoder->expect_key )
+	{
+		if( c == '[' && decoder->key_len == 7 && memcmp( decoder->key, "records", 7 ) == 0 )
+		{
+			decoder->in_records = true;
+		}
+		else if( c == '{' && decoder->key_len == 6 && memcmp( decoder->key, "result", 6 ) == 0 )
+		{
+			capture = NAMECOM_RECORD_DECODER_CAPTURE_RESULT;
+		}
+	}
+	else if( decoder->depth == 2 && decoder->in_records && c == '{' )
+	{
+		capture = NAMECOM_RECORD_DECODER_CAPTURE_RECORD;
+	}
+
+	if( capture != NAMECOM_RECORD_DECODER_CAPTURE_NONE )
+	{
+		decoder->capture        = capture;
+		decoder->capture_depth  = decoder->depth + 1;
+		decoder->capture_nested = false;
+		decoder->capture_len    = 0;
+
+		return namecom_record_decoder_capture_append( decoder, &c, 1 );
+	}
+	else if( decoder->capture != NAMECOM_RECORD_DECODER_CAPTURE_NONE )
+	{
+		decoder->capture_nested = true;
+	}
+
+	return true;
+}
+
+static bool namecom_record_decoder_step( namecom_record_decoder_t* decoder, char c )
+{
+	if( decoder->capture != NAMECOM_RECORD_DECODER_CAPTURE_NONE )
+	{
+		if( !namecom_record_decoder_capture_append( decoder, &c, 1 ) )
+		{
+			return false;
+		}
+	}
+
+	if( decoder->in_string )
+	{
+		if( decoder->escaped )
+		{
+			decoder->escaped = false;
+		}
+		else if( c == '\\' )
+		{
+			decoder->escaped = true;
+		}
+		else if( c == '"' )
+		{
+			decoder->in_string   = false;
+			decoder->reading_key = false;
+			return true;
+		}
+
+		/* Keys we care about are plain ASCII, so escapes are kept verbatim. */
+		if( decoder->reading_key && decoder->key_len < sizeof(decoder->key) )
+		{
+			decoder->key[ decoder->key_len++ ] = c;
+		}
+
+		return true;
+	}
+
+	switch( c )
+	{
+		case '"':
+			decoder->in_string = true;
+
+			if( decoder->depth == 1 && decoder->expect_key )
+			{
+				decoder->reading_key = true;
+				decoder->key_len     = 0;
+			}
+			break;
+		case ':':
+			if( decoder->depth == 1 )
+			{
+				decoder->expect_key = false;
+			}
+			break;
+		case ',':
+			if( decoder->depth == 1 )
+			{
+				decoder->expect_key = true;
+			}
+			break;
+		case '{':
+		case '[':
+			if( decoder->complete )
+			{
+				return false;
+			}
+			else if( decoder->depth == 0 )
+			{
+				if( c != '{' )
+				{
+					return false;
+				}
+
+				decoder->expect_key = true;
+			}
+			else if( !namecom_record_decoder_begin_value( decoder, c ) )
+			{
+				return false;
+			}
+
+			decoder->depth += 1;
+			break;
+		case '}':
+		case ']':
+			if( decoder->depth == 0 )
+			{
+				return false;
+			}
+
+			decoder->depth -= 1;
+
+			if( decoder->capture != NAMECOM_RECORD_DECODER_CAPTURE_NONE && decoder->depth + 1 == decoder->capture_depth )
+			{
+				if( !namecom_record_decoder_end_capture( decoder ) )
+				{
+					return false;
+				}
+			}
+
+			if( decoder->depth == 1 )
+			{
+				decoder->in_records = false;
+			}
+			else if( decoder->depth == 0 )
+			{
+				decoder->complete = true;
+			}
+			break;
+		default:
+			break;
+	}
+
+	return true;
+}
+
+bool namecom_record_decoder_feed( namecom_record_decoder_t* decoder, const char* data, size_t len )
+{
+	size_t i = 0;
+
+	while( i < len && decoder->error == NAMECOM_RECORD_DECODER_ERROR_NONE )
+	{
+		size_t run = decoder->escaped ? 0 : namecom_record_decoder_scan( data + i, len - i, decoder->in_string );
+
+		if( run > 0 )
+		{
+			if( decoder->capture != NAMECOM_RECORD_DECODER_CAPTURE_NONE )
+			{
+				namecom_record_decoder_capture_append( decoder, data + i, run );
+			}
+
+			if( decoder->reading_key )
+			{
+				size_t n = sizeof(decoder->key) - decoder->key_len;
+				n = run < n ? run : n;
+				memcpy( decoder->key + decoder->key_len, data + i, n );
+				decoder->key_len += n;
+			}
+
+			i += run;
+		}
+		else if( namecom_record_decoder_step( decoder, data[ i ] ) )
+		{
+			i += 1;
+		}
+		else if( decoder->error == NAMECOM_RECORD_DECODER_ERROR_NONE )
+		{
+			decoder->error = NAMECOM_RECORD_DECODER_ERROR_MALFORMED;
+		}
+	}
+
+	return decoder->error == NAMECOM_RECORD_DECODER_ERROR_NONE;
+}
+
+/*
+ * Returns true if a complete document was decoded without errors.
+ */
+bool namecom_record_decoder_finish( namecom_record_decoder_t* decoder )
+{
+	if( !decoder->complete && decoder->error == NAMECOM_RECORD_DECODER_ERROR_NONE )
+	{
+		decoder->error = NAMECOM_RECORD_DECODER_ERROR_TRUNCATED;
+	}
+
+	return decoder->error == NAMECOM_RECORD_DECODER_ERROR_NONE;
+}
+
+int namecom_record_decoder_result_code( const namecom_record_decoder_t* decoder )
+{
+	return decoder->result_code;
+}
+
+size_t namecom_record_decoder_count( const namecom_record_decoder_t* decoder )
+{
+	return decoder->count;
+}
+
+namecom_record_decoder_error_t namecom_record_decoder_error( const namecom_record_decoder_t* decoder )
+{
+	return decoder->error;
+}
+
+const char* namecom_record_decoder_error_string( namecom_record_decoder_error_t error )
+{
+	const char* message = "Unknown";
+
+	switch( error )
+	{
+		case NAMECOM_RECORD_DECODER_ERROR_NONE:
+			message = "No error";
+			break;
+		case NAMECOM_RECORD_DECODER_ERROR_MALFORMED:
+			message = "Record listing is malformed";
+			break;
+		case NAMECOM_RECORD_DECODER_ERROR_TRUNCATED:
+			message = "Record listing ended early";
+			break;
+		case NAMECOM_RECORD_DECODER_ERROR_OUT_OF_MEMORY:
+			message = "Out of memory while decoding the record listing";
+			break;
+		case NAMECOM_RECORD_DECODER_ERROR_STOPPED:
+			message = "Decoding was stopped";
+			break;
+		default:
+			break;
+	}
+
+	return message;
+}
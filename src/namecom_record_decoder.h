@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2016-2025 by Joseph A. Marrero. http://www.joemarrero.com/
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef _NAMECOM_RECORD_DECODER_H_
+#define _NAMECOM_RECORD_DECODER_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "namecom_api.h"
+#include "namecom_record_set.h"
+
+/*
+ * An incremental decoder for /api/dns/list responses.  Bytes are fed in
+ * as they arrive from the network and each entry of the "records" array
+ * is handed to the callback as soon as its closing brace is seen, so
+ * only one record's worth of JSON is ever held in memory.  The callback
+ * takes ownership of the record and returns false to stop decoding.
+ *
+ * The "result" object is picked up along the way; its code is available
+ * from namecom_record_decoder_result_code() once decoding has finished
+ * (-1 if the response didn't carry one).
+ *
+ * Alternatively, namecom_record_decoder_collect() makes the decoder
+ * append records to a namecom_record_set_t, which skips building a
+ * namecom_api_dns_record_t for each one.
+ *
+ * Flat record objects are decoded directly from the capture buffer
+ * without building a jansson tree; records with nested values fall back
+ * to jansson.  Both read a text field that isn't a string, or an id or
+ * TTL that is neither a string nor an integer, as missing.  Building with
+ * NAMECOM_RECORD_DECODER_JANSSON uses jansson for every record and
+ * NAMECOM_RECORD_DECODER_SCALAR disables the SSE2/AVX2 scanner;
+ * `make test` checks that every build decodes the same records.
+ *
+ * Once feeding or finishing fails, namecom_record_decoder_error() tells
+ * why: the response wasn't a listing, it ended early, memory ran out, or
+ * the record callback asked to stop.
+ */
+typedef enum namecom_record_decoder_error {
+	NAMECOM_RECORD_DECODER_ERROR_NONE = 0,
+	NAMECOM_RECORD_DECODER_ERROR_MALFORMED,
+	NAMECOM_RECORD_DECODER_ERROR_TRUNCATED,
+	NAMECOM_RECORD_DECODER_ERROR_OUT_OF_MEMORY,
+	NAMECOM_RECORD_DECODER_ERROR_STOPPED,
+} namecom_record_decoder_error_t;
+
+struct namecom_record_decoder;
+typedef struct namecom_record_decoder namecom_record_decoder_t;
+
+namecom_record_decoder_t* namecom_record_decoder_create      ( namecom_api_dns_record_fxn_t on_record, void* user_data );
+void                      namecom_record_decoder_destroy     ( namecom_record_decoder_t* decoder );
+void                      namecom_record_decoder_reset       ( namecom_record_decoder_t* decoder, namecom_api_dns_record_fxn_t on_record, void* user_data );
+void                      namecom_record_decoder_collect     ( namecom_record_decoder_t* decoder, namecom_record_set_t* set );
+void                      namecom_record_decoder_rewind      ( namecom_record_decoder_t* decoder );
+bool                      namecom_record_decoder_feed        ( namecom_record_decoder_t* decoder, const char* data, size_t len );
+bool                      namecom_record_decoder_finish      ( namecom_record_decoder_t* decoder );
+int                       namecom_record_decoder_result_code ( const namecom_record_decoder_t* decoder );
+size_t                    namecom_record_decoder_count       ( const namecom_record_decoder_t* decoder );
+namecom_record_decoder_error_t namecom_record_decoder_error  ( const namecom_record_decoder_t* decoder );
+const char*               namecom_record_decoder_error_string ( namecom_record_decoder_error_t error );
+
+#endif /* _NAMECOM_RECORD_DECODER_H_ */
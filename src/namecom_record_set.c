@@ -0,0 +1,416 @@
+/*
+ * Copyright (C) 2016-2025 by Joseph A. Marrero. http://www.joemarrero.com/
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <collections/vector.h>
+#include "namecom_record_set.h"
+
+#define NAMECOM_RECORD_SET_MIN_CAPACITY       16
+#define NAMECOM_RECORD_SET_MIN_POOL           1024
+#define NAMECOM_RECORD_SET_MIN_INTERNED       64
+
+static const char* namecom_record_type_strings[] = {
+	[NAMECOM_RECORD_TYPE_UNKNOWN] = "",
+	[NAMECOM_RECORD_TYPE_A]       = "A",
+	[NAMECOM_RECORD_TYPE_AAAA]    = "AAAA",
+	[NAMECOM_RECORD_TYPE_CNAME]   = "CNAME",
+	[NAMECOM_RECORD_TYPE_MX]      = "MX",
+	[NAMECOM_RECORD_TYPE_NS]      = "NS",
+	[NAMECOM_RECORD_TYPE_SRV]     = "SRV",
+	[NAMECOM_RECORD_TYPE_TXT]     = "TXT",
+};
+
+namecom_record_type_t namecom_record_type_parse( const char* type )
+{
+	if( type )
+	{
+		for( size_t i = 1; i < sizeof(namecom_record_type_strings) / sizeof(namecom_record_type_strings[0]); i++ )
+		{
+			if( strcmp( type, namecom_record_type_strings[ i ] ) == 0 )
+			{
+				return (namecom_record_type_t) i;
+			}
+		}
+	}
+
+	return NAMECOM_RECORD_TYPE_UNKNOWN;
+}
+
+const char* namecom_record_type_string( namecom_record_type_t type )
+{
+	if( type < sizeof(namecom_record_type_strings) / sizeof(namecom_record_type_strings[0]) )
+	{
+		return namecom_record_type_strings[ type ];
+	}
+
+	return "";
+}
+
+static bool namecom_record_set_reserve( namecom_record_set_t* set, size_t capacity )
+{
+	#define GROW_COLUMN(column) \
+		do { \
+			void* p = realloc( set->column, capacity * sizeof(*set->column) ); \
+			if( !p ) return false; \
+			set->column = p; \
+		} while( 0 )
+
+	GROW_COLUMN( ids );
+	GROW_COLUMN( ttls );
+	GROW_COLUMN( types );
+	GROW_COLUMN( type_names );
+	GROW_COLUMN( fqdns );
+	GROW_COLUMN( contents );
+	GROW_COLUMN( create_dates );
+
+	#undef GROW_COLUMN
+
+	set->capacity = capacity;
+
+	return true;
+}
+
+namecom_record_set_t* namecom_record_set_create( size_t capacity )
+{
+	namecom_record_set_t* set = malloc( sizeof(namecom_record_set_t) );
+
+	if( set )
+	{
+		memset( set, 0, sizeof(namecom_record_set_t) );
+		set->refs = 1;
+
+		if( !namecom_record_set_reserve( set, capacity > 0 ? capacity : NAMECOM_RECORD_SET_MIN_CAPACITY ) )
+		{
+			namecom_record_set_destroy( set );
+			set = NULL;
+		}
+	}
+
+	return set;
+}
+
+/*
+ * Sets may be released on different threads, so the count is updated
+ * atomically.
+ */
+void namecom_record_set_destroy( namecom_record_set_t* set )
+{
+	if( set && __atomic_sub_fetch( &set->refs, 1, __ATOMIC_ACQ_REL ) == 0 )
+	{
+		free( set->ids );
+		free( set->ttls );
+		free( set->types );
+		free( set->type_names );
+		free( set->fqdns );
+		free( set->contents );
+		free( set->create_dates );
+		free( set->pool );
+		free( set->interned );
+		free( set );
+	}
+}
+
+namecom_record_set_t* namecom_record_set_retain( namecom_record_set_t* set )
+{
+	if( set )
+	{
+		__atomic_add_fetch( &set->refs, 1, __ATOMIC_RELAXED );
+	}
+
+	return set;
+}
+
+/*
+ * Returns a copy sized to fit; the copy can still be appended to.
+ */
+namecom_record_set_t* namecom_record_set_clone( const namecom_record_set_t* set )
+{
+	namecom_record_set_t* copy = namecom_record_set_create( set->count );
+
+	if( !copy )
+	{
+		goto failed;
+	}
+
+	copy->pool     = malloc( set->pool_len > 0 ? set->pool_len : 1 );
+	copy->interned = malloc( set->interned_capacity * sizeof(uint32_t) );
+
+	if( !copy->pool || (set->interned_capacity > 0 && !copy->interned) )
+	{
+		goto failed;
+	}
+
+	memcpy( copy->ids, set->ids, set->count * sizeof(*set->ids) );
+	memcpy( copy->ttls, set->ttls, set->count * sizeof(*set->ttls) );
+	memcpy( copy->types, set->types, set->count * sizeof(*set->types) );
+	memcpy( copy->type_names, set->type_names, set->count * sizeof(*set->type_names) );
+	memcpy( copy->fqdns, set->fqdns, set->count * sizeof(*set->fqdns) );
+	memcpy( copy->contents, set->contents, set->count * sizeof(*set->contents) );
+	memcpy( copy->create_dates, set->create_dates, set->count * sizeof(*set->create_dates) );
+	if( set->pool_len > 0 ) memcpy( copy->pool, set->pool, set->pool_len );
+	if( set->interned_capacity > 0 ) memcpy( copy->interned, set->interned, set->interned_capacity * sizeof(uint32_t) );
+
+	copy->count             = set->count;
+	copy->pool_len          = set->pool_len;
+	copy->pool_capacity     = set->pool_len > 0 ? set->pool_len : 1;
+	copy->interned_capacity = set->interned_capacity;
+	copy->interned_count    = set->interned_count;
+
+	return copy;
+
+failed:
+	namecom_record_set_destroy( copy );
+	return NULL;
+}
+
+/*
+ * Returns the number of bytes of heap the set holds on to.
+ */
+size_t namecom_record_set_memory( const namecom_record_set_t* set )
+{
+	size_t row = sizeof(*set->ids) + sizeof(*set->ttls) + sizeof(*set->types) +
+	             sizeof(*set->type_names) + sizeof(*set->fqdns) + sizeof(*set->contents) +
+	             sizeof(*set->create_dates);
+
+	return sizeof(namecom_record_set_t) + set->capacity * row + set->pool_capacity + set->interned_capacity * sizeof(uint32_t);
+}
+
+static uint32_t namecom_record_set_hash( const char* s, size_t len )
+{
+	/* FNV-1a */
+	uint32_t hash = 2166136261u;
+
+	for( size_t i = 0; i < len; i++ )
+	{
+		hash ^= (unsigned char) s[ i ];
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+static bool namecom_record_set_rehash( namecom_record_set_t* set, size_t capacity )
+{
+	uint32_t* interned = calloc( capacity, sizeof(uint32_t) );
+
+	if( !interned )
+	{
+		return false;
+	}
+
+	for( size_t i = 0; i < set->interned_capacity; i++ )
+	{
+		uint32_t slot = set->interned[ i ];
+
+		if( slot )
+		{
+			const char* s = set->pool + slot - 1;
+			size_t j = namecom_record_set_hash( s, strlen(s) ) & (capacity - 1);
+
+			while( interned[ j ] )
+			{
+				j = (j + 1) & (capacity - 1);
+			}
+
+			interned[ j ] = slot;
+		}
+	}
+
+	free( set->interned );
+	set->interned          = interned;
+	set->interned_capacity = capacity;
+
+	return true;
+}
+
+/*
+ * Returns the pool offset of string, adding it to the pool the first
+ * time it is seen.  Host names, types and dates repeat a lot within a
+ * zone, so most lookups don't grow the pool.
+ */
+static bool namecom_record_set_intern( namecom_record_set_t* set, const char* string, uint32_t* offset )
+{
+	if( !string )
+	{
+		*offset = NAMECOM_RECORD_SET_NULL;
+		return true;
+	}
+
+	if( (set->interned_count + 1) * 4 > set->interned_capacity * 3 )
+	{
+		size_t capacity = set->interned_capacity ? set->interned_capacity * 2 : NAMECOM_RECORD_SET_MIN_INTERNED;
+
+		if( !namecom_record_set_rehash( set, capacity ) )
+		{
+			return false;
+		}
+	}
+
+	size_t len = strlen( string );
+	size_t mask = set->interned_capacity - 1;
+	size_t i = namecom_record_set_hash( string, len ) & mask;
+
+	while( set->interned[ i ] )
+	{
+		const char* s = set->pool + set->interned[ i ] - 1;
+
+		if( strcmp( s, string ) == 0 )
+		{
+			*offset = set->interned[ i ] - 1;
+			return true;
+		}
+
+		i = (i + 1) & mask;
+	}
+
+	if( set->pool_len + len + 1 >= NAMECOM_RECORD_SET_NULL )
+	{
+		return false;
+	}
+
+	if( set->pool_len + len + 1 > set->pool_capacity )
+	{
+		size_t capacity = set->pool_capacity ? set->pool_capacity : NAMECOM_RECORD_SET_MIN_POOL;
+
+		while( set->pool_len + len + 1 > capacity )
+		{
+			capacity *= 2;
+		}
+
+		char* pool = realloc( set->pool, capacity );
+
+		if( !pool )
+		{
+			return false;
+		}
+
+		set->pool          = pool;
+		set->pool_capacity = capacity;
+	}
+
+	*offset = (uint32_t) set->pool_len;
+	memcpy( set->pool + set->pool_len, string, len + 1 );
+	set->pool_len += len + 1;
+
+	set->interned[ i ] = *offset + 1;
+	set->interned_count += 1;
+
+	return true;
+}
+
+bool namecom_record_set_append( namecom_record_set_t* set, long id, const char* fqdn, const char* type, const char* content, int ttl, const char* create_date )
+{
+	if( set->count == set->capacity && !namecom_record_set_reserve( set, set->capacity * 2 ) )
+	{
+		return false;
+	}
+
+	size_t i = set->count;
+
+	if( !namecom_record_set_intern( set, type, &set->type_names[ i ] ) ||
+	    !namecom_record_set_intern( set, fqdn, &set->fqdns[ i ] ) ||
+	    !namecom_record_set_intern( set, content, &set->contents[ i ] ) ||
+	    !namecom_record_set_intern( set, create_date, &set->create_dates[ i ] ) )
+	{
+		return false;
+	}
+
+	set->ids[ i ]   = id;
+	set->ttls[ i ]  = ttl;
+	set->types[ i ] = (uint8_t) namecom_record_type_parse( type );
+	set->count += 1;
+
+	return true;
+}
+
+static const char* namecom_record_set_string( const namecom_record_set_t* set, uint32_t offset )
+{
+	return offset == NAMECOM_RECORD_SET_NULL ? NULL : set->pool + offset;
+}
+
+size_t namecom_record_set_count( const namecom_record_set_t* set )
+{
+	return set->count;
+}
+
+long namecom_record_set_id( const namecom_record_set_t* set, size_t i )
+{
+	return set->ids[ i ];
+}
+
+int namecom_record_set_ttl( const namecom_record_set_t* set, size_t i )
+{
+	return set->ttls[ i ];
+}
+
+namecom_record_type_t namecom_record_set_type( const namecom_record_set_t* set, size_t i )
+{
+	return (namecom_record_type_t) set->types[ i ];
+}
+
+const char* namecom_record_set_type_name( const namecom_record_set_t* set, size_t i )
+{
+	return namecom_record_set_string( set, set->type_names[ i ] );
+}
+
+const char* namecom_record_set_fqdn( const namecom_record_set_t* set, size_t i )
+{
+	return namecom_record_set_string( set, set->fqdns[ i ] );
+}
+
+const char* namecom_record_set_content( const namecom_record_set_t* set, size_t i )
+{
+	return namecom_record_set_string( set, set->contents[ i ] );
+}
+
+const char* namecom_record_set_create_date( const namecom_record_set_t* set, size_t i )
+{
+	return namecom_record_set_string( set, set->create_dates[ i ] );
+}
+
+namecom_api_dns_record_t** namecom_record_set_to_records( const namecom_record_set_t* set )
+{
+	namecom_api_dns_record_t** records = NULL;
+	lc_vector_create( records, set->count > 0 ? set->count : 1 );
+
+	if( records )
+	{
+		for( size_t i = 0; i < set->count; i++ )
+		{
+			namecom_api_dns_record_t* r = namecom_api_dns_record_create(
+				set->ids[ i ],
+				namecom_record_set_fqdn( set, i ),
+				namecom_record_set_type_name( set, i ),
+				namecom_record_set_content( set, i ),
+				set->ttls[ i ],
+				namecom_record_set_create_date( set, i )
+			);
+
+			if( r )
+			{
+				lc_vector_push( records, r );
+			}
+		}
+	}
+
+	return records;
+}
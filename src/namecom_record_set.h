@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2016-2025 by Joseph A. Marrero. http://www.joemarrero.com/
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef _NAMECOM_RECORD_SET_H_
+#define _NAMECOM_RECORD_SET_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "namecom_api.h"
+
+typedef enum namecom_record_type {
+	NAMECOM_RECORD_TYPE_UNKNOWN = 0,
+	NAMECOM_RECORD_TYPE_A,
+	NAMECOM_RECORD_TYPE_AAAA,
+	NAMECOM_RECORD_TYPE_CNAME,
+	NAMECOM_RECORD_TYPE_MX,
+	NAMECOM_RECORD_TYPE_NS,
+	NAMECOM_RECORD_TYPE_SRV,
+	NAMECOM_RECORD_TYPE_TXT,
+} namecom_record_type_t;
+
+namecom_record_type_t namecom_record_type_parse  ( const char* type );
+const char*           namecom_record_type_string ( namecom_record_type_t type );
+
+/*
+ * A set of DNS records stored column by column.  Numeric fields live in
+ * parallel arrays and the strings are interned into a single pool, so a
+ * listing costs a handful of allocations no matter how many records it
+ * has, scans touch only the columns they need, and the whole set is
+ * released with one call.
+ *
+ * The fields are public for fast scans but should be treated as read
+ * only; string columns hold offsets into the pool (use the accessors,
+ * which map NAMECOM_RECORD_SET_NULL to NULL).
+ *
+ * Sets are reference counted so that one listing can be handed to several
+ * callers: namecom_record_set_retain() adds a reference and
+ * namecom_record_set_destroy() drops one, freeing the set with the last.
+ * A set that may be shared must not be appended to; clone it instead.
+ */
+#define NAMECOM_RECORD_SET_NULL  UINT32_MAX
+
+typedef struct namecom_record_set {
+	size_t count;
+	size_t capacity;
+
+	long* ids;
+	int* ttls;
+	uint8_t* types;            /* namecom_record_type_t */
+	uint32_t* type_names;
+	uint32_t* fqdns;
+	uint32_t* contents;
+	uint32_t* create_dates;
+
+	char* pool;
+	size_t pool_len;
+	size_t pool_capacity;
+
+	uint32_t* interned;        /* open addressing; pool offset + 1, 0 is empty */
+	size_t interned_capacity;
+	size_t interned_count;
+
+	size_t refs;
+} namecom_record_set_t;
+
+namecom_record_set_t* namecom_record_set_create      ( size_t capacity );
+void                  namecom_record_set_destroy     ( namecom_record_set_t* set );
+namecom_record_set_t* namecom_record_set_retain      ( namecom_record_set_t* set );
+namecom_record_set_t* namecom_record_set_clone       ( const namecom_record_set_t* set );
+size_t                namecom_record_set_memory      ( const namecom_record_set_t* set );
+bool                  namecom_record_set_append      ( namecom_record_set_t* set, long id, const char* fqdn, const char* type, const char* content, int ttl, const char* create_date );
+size_t                namecom_record_set_count       ( const namecom_record_set_t* set );
+long                  namecom_record_set_id          ( const namecom_record_set_t* set, size_t i );
+int                   namecom_record_set_ttl         ( const namecom_record_set_t* set, size_t i );
+namecom_record_type_t namecom_record_set_type        ( const namecom_record_set_t* set, size_t i );
+const char*           namecom_record_set_type_name   ( const namecom_record_set_t* set, size_t i );
+const char*           namecom_record_set_fqdn        ( const namecom_record_set_t* set, size_t i );
+const char*           namecom_record_set_content     ( const namecom_record_set_t* set, size_t i );
+const char*           namecom_record_set_create_date ( const namecom_record_set_t* set, size_t i );
+
+/*
+ * Adapter for code written against namecom_api_dns_record_list(); the
+ * result is an lc_vector of records that the caller owns.
+ */
+namecom_api_dns_record_t** namecom_record_set_to_records ( const namecom_record_set_t* set );
+
+#endif /* _NAMECOM_RECORD_SET_H_ */
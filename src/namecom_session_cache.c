@@ -0,0 +1,210 @@
+/*
+ * Copyright (C) 2016-2025 by Joseph A. Marrero. http://www.joemarrero.com/
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include "namecom_session_cache.h"
+
+#define NAMECOM_SESSION_CACHE_MAGIC     "namecom-session"
+#define NAMECOM_SESSION_CACHE_VERSION   1
+#define NAMECOM_SESSION_CACHE_MAX_LINE  1024
+
+static bool namecom_session_cache_mkdir( const char* path )
+{
+#ifdef _WIN32
+	int rc = mkdir( path );
+#else
+	int rc = mkdir( path, 0700 );
+#endif
+	return rc == 0 || errno == EEXIST;
+}
+
+/*
+ * The file is named after a hash of the account and server; both are
+ * also stored in the file so that a collision can't hand out somebody
+ * else's token.
+ */
+static bool namecom_session_cache_path( char* path, size_t size, const char* directory, const char* username, const char* server )
+{
+	uint64_t hash = 14695981039346656037ULL;
+
+	for( const char* s = username; *s; s++ )
+	{
+		hash = (hash ^ (unsigned char) *s) * 1099511628211ULL;
+	}
+
+	hash = (hash ^ (unsigned char) '\n') * 1099511628211ULL;
+
+	for( const char* s = server; *s; s++ )
+	{
+		hash = (hash ^ (unsigned char) *s) * 1099511628211ULL;
+	}
+
+	int len = snprintf( path, size, "%s/session-%016llx", directory, (unsigned long long) hash );
+
+	return len > 0 && (size_t) len < size;
+}
+
+static bool namecom_session_cache_read_line( FILE* file, char* line, size_t size )
+{
+	if( !fgets( line, (int) size, file ) )
+	{
+		return false;
+	}
+
+	size_t len = strlen( line );
+
+	if( len == 0 || line[ len - 1 ] != '\n' )
+	{
+		return false;
+	}
+
+	line[ len - 1 ] = '\0';
+
+	return true;
+}
+
+bool namecom_session_cache_load( const char* directory, const char* username, const char* server, char* token, size_t size )
+{
+	bool result = false;
+	char path[ 1100 ];
+	char line[ NAMECOM_SESSION_CACHE_MAX_LINE ];
+	char header[ 64 ];
+
+	if( !namecom_session_cache_path( path, sizeof(path), directory, username, server ) )
+	{
+		return false;
+	}
+
+	FILE* file = fopen( path, "r" );
+
+	if( !file )
+	{
+		return false;
+	}
+
+	snprintf( header, sizeof(header), "%s %d", NAMECOM_SESSION_CACHE_MAGIC, NAMECOM_SESSION_CACHE_VERSION );
+
+	if( !namecom_session_cache_read_line( file, line, sizeof(line) ) || strcmp( line, header ) != 0 )
+	{
+		goto done;
+	}
+
+	if( !namecom_session_cache_read_line( file, line, sizeof(line) ) || strcmp( line, username ) != 0 )
+	{
+		goto done;
+	}
+
+	if( !namecom_session_cache_read_line( file, line, sizeof(line) ) || strcmp( line, server ) != 0 )
+	{
+		goto done;
+	}
+
+	if( !namecom_session_cache_read_line( file, line, sizeof(line) ) || *line == '\0' || strlen( line ) >= size )
+	{
+		goto done;
+	}
+
+	strcpy( token, line );
+	result = true;
+
+done:
+	fclose( file );
+	return result;
+}
+
+bool namecom_session_cache_save( const char* directory, const char* username, const char* server, const char* token )
+{
+	bool result = false;
+	char path[ 1100 ];
+	char tmp_path[ 1200 ];
+
+	if( strpbrk( username, "\r\n" ) || strpbrk( token, "\r\n" ) ||
+	    !namecom_session_cache_path( path, sizeof(path), directory, username, server ) )
+	{
+		return false;
+	}
+
+	if( !namecom_session_cache_mkdir( directory ) )
+	{
+		fprintf( stderr, "[ERROR] Unable to create cache directory %s.\n", directory );
+		return false;
+	}
+
+	snprintf( tmp_path, sizeof(tmp_path), "%s.%ld.tmp", path, (long) getpid() );
+
+	/* The token is as good as a password while it lasts. */
+	int fd = open( tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0600 );
+
+	if( fd < 0 )
+	{
+		fprintf( stderr, "[ERROR] Unable to write session file %s.\n", tmp_path );
+		return false;
+	}
+
+	FILE* file = fdopen( fd, "w" );
+
+	if( !file )
+	{
+		close( fd );
+		goto done;
+	}
+
+	fprintf( file, "%s %d\n%s\n%s\n%s\n", NAMECOM_SESSION_CACHE_MAGIC, NAMECOM_SESSION_CACHE_VERSION, username, server, token );
+
+	result = fclose( file ) == 0;
+
+	if( result )
+	{
+#ifdef _WIN32
+		remove( path );
+#endif
+		result = rename( tmp_path, path ) == 0;
+	}
+
+done:
+	if( !result )
+	{
+		remove( tmp_path );
+	}
+
+	return result;
+}
+
+bool namecom_session_cache_remove( const char* directory, const char* username, const char* server )
+{
+	char path[ 1100 ];
+
+	if( !namecom_session_cache_path( path, sizeof(path), directory, username, server ) )
+	{
+		return false;
+	}
+
+	return remove( path ) == 0 || errno == ENOENT;
+}
@@ -0,0 +1,38 @@
+/*
+ * Copyright (C) 2016-2025 by Joseph A. Marrero. http://www.joemarrero.com/
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef _NAMECOM_SESSION_CACHE_H_
+#define _NAMECOM_SESSION_CACHE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Keeps an API session token on disk so that the next process for the
+ * same account and server can pick it up instead of logging in again.
+ * Each username and server pair gets its own file, readable only by its
+ * owner, in the given directory.
+ */
+bool namecom_session_cache_load   ( const char* directory, const char* username, const char* server, char* token, size_t size );
+bool namecom_session_cache_save   ( const char* directory, const char* username, const char* server, const char* token );
+bool namecom_session_cache_remove ( const char* directory, const char* username, const char* server );
+
+#endif /* _NAMECOM_SESSION_CACHE_H_ */
@@ -0,0 +1,668 @@
+/*
+ * Copyright (C) 2016-2025 by Joseph A. Marrero. http://www.joemarrero.com/
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <pthread.h>
+#include <curl/curl.h>
+#include "namecom_transport_cache.h"
+
+#define NAMECOM_TRANSPORT_CACHE_MAGIC     "namecom-transport-cache"
+#define NAMECOM_TRANSPORT_CACHE_VERSION   1
+#define NAMECOM_TRANSPORT_CACHE_FILENAME  "transport.cache"
+#define NAMECOM_TRANSPORT_CACHE_DNS_TTL   300L
+#define NAMECOM_TRANSPORT_CACHE_MAX_LINE  (32 * 1024)
+
+#if LIBCURL_VERSION_NUM >= 0x080c00
+#define NAMECOM_TRANSPORT_CACHE_HAVE_SSLS 1
+#endif
+
+typedef struct dns_entry {
+	char host[ 256 ];
+	long port;
+	char address[ 64 ];
+	time_t expires;
+	bool from_disk;
+} dns_entry_t;
+
+typedef struct tls_entry {
+	char* session_key;
+	unsigned char* shmac;
+	size_t shmac_len;
+	unsigned char* sdata;
+	size_t sdata_len;
+	long long valid_until;
+} tls_entry_t;
+
+struct namecom_transport_cache {
+	char path[ 1024 ];
+	long dns_ttl;
+	CURLSH* share;
+	pthread_mutex_t share_locks[ CURL_LOCK_DATA_LAST ];
+	struct curl_slist* resolve_list;
+
+	dns_entry_t* dns_entries;
+	size_t dns_entries_count;
+	size_t dns_entries_capacity;
+
+	tls_entry_t* tls_entries;
+	size_t tls_entries_count;
+	size_t tls_entries_capacity;
+	bool tls_imported;
+
+	namecom_transport_cache_stats_t stats;
+};
+
+static bool namecom_transport_cache_mkdir( const char* path )
+{
+#ifdef _WIN32
+	int rc = mkdir( path );
+#else
+	int rc = mkdir( path, 0700 );
+#endif
+	return rc == 0 || errno == EEXIST;
+}
+
+bool namecom_transport_cache_default_directory( char* directory, size_t size )
+{
+	const char* xdg_cache_home = getenv( "XDG_CACHE_HOME" );
+
+	if( xdg_cache_home && *xdg_cache_home )
+	{
+		if( !namecom_transport_cache_mkdir( xdg_cache_home ) )
+		{
+			return false;
+		}
+
+		snprintf( directory, size, "%s/namecom", xdg_cache_home );
+	}
+	else
+	{
+		const char* home = getenv( "HOME" );
+
+		if( !home || *home == '\0' )
+		{
+			return false;
+		}
+
+		char cache_home[ 1024 ];
+		snprintf( cache_home, sizeof(cache_home), "%s/.cache", home );
+
+		if( !namecom_transport_cache_mkdir( cache_home ) )
+		{
+			return false;
+		}
+
+		snprintf( directory, size, "%s/namecom", cache_home );
+	}
+
+	return true;
+}
+
+static char* hex_encode( const unsigned char* data, size_t len )
+{
+	static const char digits[] = "0123456789abcdef";
+	char* hex = malloc( 2 * len + 1 );
+
+	if( hex )
+	{
+		for( size_t i = 0; i < len; i++ )
+		{
+			hex[ 2 * i ]     = digits[ data[ i ] >> 4 ];
+			hex[ 2 * i + 1 ] = digits[ data[ i ] & 0x0f ];
+		}
+
+		hex[ 2 * len ] = '\0';
+	}
+
+	return hex;
+}
+
+static int hex_value( char c )
+{
+	if( c >= '0' && c <= '9' ) return c - '0';
+	if( c >= 'a' && c <= 'f' ) return c - 'a' + 10;
+	if( c >= 'A' && c <= 'F' ) return c - 'A' + 10;
+	return -1;
+}
+
+static unsigned char* hex_decode( const char* hex, size_t* len )
+{
+	size_t hex_len = strlen( hex );
+
+	if( hex_len % 2 != 0 )
+	{
+		return NULL;
+	}
+
+	unsigned char* data = malloc( hex_len / 2 + 1 );
+
+	if( data )
+	{
+		for( size_t i = 0; i < hex_len / 2; i++ )
+		{
+			int hi = hex_value( hex[ 2 * i ] );
+			int lo = hex_value( hex[ 2 * i + 1 ] );
+
+			if( hi < 0 || lo < 0 )
+			{
+				free( data );
+				return NULL;
+			}
+
+			data[ i ] = (unsigned char) ((hi << 4) | lo);
+		}
+
+		*len = hex_len / 2;
+	}
+
+	return data;
+}
+
+static dns_entry_t* namecom_transport_cache_find_dns( namecom_transport_cache_t* cache, const char* host, long port )
+{
+	for( size_t i = 0; i < cache->dns_entries_count; i++ )
+	{
+		dns_entry_t* entry = &cache->dns_entries[ i ];
+
+		if( entry->port == port && strcmp( entry->host, host ) == 0 )
+		{
+			return entry;
+		}
+	}
+
+	return NULL;
+}
+
+static dns_entry_t* namecom_transport_cache_add_dns( namecom_transport_cache_t* cache, const char* host, long port )
+{
+	if( cache->dns_entries_count == cache->dns_entries_capacity )
+	{
+		size_t capacity = cache->dns_entries_capacity ? 2 * cache->dns_entries_capacity : 4;
+		dns_entry_t* entries = realloc( cache->dns_entries, sizeof(dns_entry_t) * capacity );
+
+		if( !entries )
+		{
+			return NULL;
+		}
+
+		cache->dns_entries          = entries;
+		cache->dns_entries_capacity = capacity;
+	}
+
+	dns_entry_t* entry = &cache->dns_entries[ cache->dns_entries_count++ ];
+	memset( entry, 0, sizeof(dns_entry_t) );
+	snprintf( entry->host, sizeof(entry->host), "%s", host );
+	entry->port = port;
+
+	return entry;
+}
+
+static bool namecom_transport_cache_add_tls( namecom_transport_cache_t* cache, const char* session_key, const unsigned char* shmac, size_t shmac_len, const unsigned char* sdata, size_t sdata_len, long long valid_until )
+{
+	if( cache->tls_entries_count == cache->tls_entries_capacity )
+	{
+		size_t capacity = cache->tls_entries_capacity ? 2 * cache->tls_entries_capacity : 4;
+		tls_entry_t* entries = realloc( cache->tls_entries, sizeof(tls_entry_t) * capacity );
+
+		if( !entries )
+		{
+			return false;
+		}
+
+		cache->tls_entries          = entries;
+		cache->tls_entries_capacity = capacity;
+	}
+
+	tls_entry_t* entry = &cache->tls_entries[ cache->tls_entries_count ];
+	entry->session_key = session_key ? strdup( session_key ) : NULL;
+	entry->shmac       = malloc( shmac_len + 1 );
+	entry->sdata       = malloc( sdata_len + 1 );
+	entry->shmac_len   = shmac_len;
+	entry->sdata_len   = sdata_len;
+	entry->valid_until = valid_until;
+
+	if( !entry->shmac || !entry->sdata || (session_key && !entry->session_key) )
+	{
+		free( entry->session_key );
+		free( entry->shmac );
+		free( entry->sdata );
+		return false;
+	}
+
+	memcpy( entry->shmac, shmac, shmac_len );
+	memcpy( entry->sdata, sdata, sdata_len );
+	cache->tls_entries_count += 1;
+
+	return true;
+}
+
+static void namecom_transport_cache_clear_tls( namecom_transport_cache_t* cache )
+{
+	for( size_t i = 0; i < cache->tls_entries_count; i++ )
+	{
+		free( cache->tls_entries[ i ].session_key );
+		free( cache->tls_entries[ i ].shmac );
+		free( cache->tls_entries[ i ].sdata );
+	}
+
+	cache->tls_entries_count = 0;
+}
+
+static void namecom_transport_cache_load( namecom_transport_cache_t* cache )
+{
+	FILE* file = fopen( cache->path, "r" );
+
+	if( !file )
+	{
+		return;
+	}
+
+	char* line = malloc( NAMECOM_TRANSPORT_CACHE_MAX_LINE );
+	time_t now = time( NULL );
+	int version = 0;
+
+	if( !line )
+	{
+		goto done;
+	}
+
+	if( !fgets( line, NAMECOM_TRANSPORT_CACHE_MAX_LINE, file ) ||
+	    sscanf( line, NAMECOM_TRANSPORT_CACHE_MAGIC " %d", &version ) != 1 ||
+	    version != NAMECOM_TRANSPORT_CACHE_VERSION )
+	{
+		/* Unknown or older format; it will be rewritten on save. */
+		goto done;
+	}
+
+	while( fgets( line, NAMECOM_TRANSPORT_CACHE_MAX_LINE, file ) )
+	{
+		char kind[ 8 ];
+
+		if( sscanf( line, "%7s", kind ) != 1 )
+		{
+			continue;
+		}
+
+		if( strcmp( kind, "dns" ) == 0 )
+		{
+			char host[ 256 ];
+			char address[ 64 ];
+			long port = 0;
+			long long expires = 0;
+
+			if( sscanf( line, "dns %255s %ld %63s %lld", host, &port, address, &expires ) == 4 && expires > now )
+			{
+				dns_entry_t* entry = namecom_transport_cache_add_dns( cache, host, port );
+
+				if( entry )
+				{
+					snprintf( entry->address, sizeof(entry->address), "%s", address );
+					entry->expires   = (time_t) expires;
+					entry->from_disk = true;
+					cache->stats.dns_entries_loaded += 1;
+				}
+			}
+		}
+		else if( strcmp( kind, "tls" ) == 0 )
+		{
+			char* saveptr = NULL;
+			strtok_r( line, " \n", &saveptr );
+			char* session_key = strtok_r( NULL, " \n", &saveptr );
+			char* shmac_hex   = strtok_r( NULL, " \n", &saveptr );
+			char* sdata_hex   = strtok_r( NULL, " \n", &saveptr );
+			char* valid_until = strtok_r( NULL, " \n", &saveptr );
+
+			if( session_key && shmac_hex && sdata_hex && valid_until && atoll( valid_until ) > (long long) now )
+			{
+				size_t shmac_len = 0;
+				size_t sdata_len = 0;
+				unsigned char* shmac = hex_decode( shmac_hex, &shmac_len );
+				unsigned char* sdata = hex_decode( sdata_hex, &sdata_len );
+
+				if( shmac && sdata &&
+				    namecom_transport_cache_add_tls( cache, strcmp( session_key, "-" ) == 0 ? NULL : session_key, shmac, shmac_len, sdata, sdata_len, atoll( valid_until ) ) )
+				{
+					cache->stats.tls_sessions_loaded += 1;
+				}
+
+				free( shmac );
+				free( sdata );
+			}
+		}
+	}
+
+done:
+	free( line );
+	fclose( file );
+}
+
+static void namecom_transport_cache_lock( CURL* curl, curl_lock_data data, curl_lock_access access, void* userptr )
+{
+	namecom_transport_cache_t* cache = userptr;
+	pthread_mutex_lock( &cache->share_locks[ data ] );
+}
+
+static void namecom_transport_cache_unlock( CURL* curl, curl_lock_data data, void* userptr )
+{
+	namecom_transport_cache_t* cache = userptr;
+	pthread_mutex_unlock( &cache->share_locks[ data ] );
+}
+
+namecom_transport_cache_t* namecom_transport_cache_open( const char* directory, long dns_ttl )
+{
+	char default_directory[ 1024 ];
+
+	if( !directory )
+	{
+		if( !namecom_transport_cache_default_directory( default_directory, sizeof(default_directory) ) )
+		{
+			return NULL;
+		}
+
+		directory = default_directory;
+	}
+
+	if( !namecom_transport_cache_mkdir( directory ) )
+	{
+		fprintf( stderr, "[ERROR] Unable to create cache directory %s.\n", directory );
+		return NULL;
+	}
+
+	namecom_transport_cache_t* cache = malloc( sizeof(namecom_transport_cache_t) );
+
+	if( cache )
+	{
+		memset( cache, 0, sizeof(namecom_transport_cache_t) );
+
+		if( strlen( directory ) + sizeof(NAMECOM_TRANSPORT_CACHE_FILENAME) + 1 > sizeof(cache->path) )
+		{
+			free( cache );
+			return NULL;
+		}
+
+		strcpy( cache->path, directory );
+		strcat( cache->path, "/" NAMECOM_TRANSPORT_CACHE_FILENAME );
+		cache->dns_ttl = dns_ttl > 0 ? dns_ttl : NAMECOM_TRANSPORT_CACHE_DNS_TTL;
+		cache->share   = curl_share_init();
+
+		if( !cache->share )
+		{
+			free( cache );
+			return NULL;
+		}
+
+		/* Easy handles on different threads use the share at once. */
+		for( int i = 0; i < CURL_LOCK_DATA_LAST; i++ )
+		{
+			pthread_mutex_init( &cache->share_locks[ i ], NULL );
+		}
+
+		curl_share_setopt( cache->share, CURLSHOPT_LOCKFUNC, namecom_transport_cache_lock );
+		curl_share_setopt( cache->share, CURLSHOPT_UNLOCKFUNC, namecom_transport_cache_unlock );
+		curl_share_setopt( cache->share, CURLSHOPT_USERDATA, cache );
+		curl_share_setopt( cache->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS );
+		curl_share_setopt( cache->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION );
+
+		namecom_transport_cache_load( cache );
+
+		for( size_t i = 0; i < cache->dns_entries_count; i++ )
+		{
+			dns_entry_t* entry = &cache->dns_entries[ i ];
+			bool is_ipv6 = strchr( entry->address, ':' ) != NULL;
+			char resolve[ 512 ];
+
+			/* The '+' lets these entries expire like resolved ones. */
+			snprintf( resolve, sizeof(resolve), is_ipv6 ? "+%s:%ld:[%s]" : "+%s:%ld:%s", entry->host, entry->port, entry->address );
+
+			struct curl_slist* resolve_list = curl_slist_append( cache->resolve_list, resolve );
+
+			if( resolve_list )
+			{
+				cache->resolve_list = resolve_list;
+			}
+		}
+	}
+
+	return cache;
+}
+
+void namecom_transport_cache_close( namecom_transport_cache_t* cache )
+{
+	if( cache )
+	{
+		namecom_transport_cache_clear_tls( cache );
+		free( cache->tls_entries );
+		free( cache->dns_entries );
+		if( cache->resolve_list ) curl_slist_free_all( cache->resolve_list );
+		if( cache->share ) curl_share_cleanup( cache->share );
+
+		for( int i = 0; i < CURL_LOCK_DATA_LAST; i++ )
+		{
+			pthread_mutex_destroy( &cache->share_locks[ i ] );
+		}
+
+		free( cache );
+	}
+}
+
+/*
+ * Attaches an easy handle to the cache's share handle.  The easy handle
+ * must be detached (or cleaned up) before the cache is closed.
+ */
+void namecom_transport_cache_attach( namecom_transport_cache_t* cache, CURL* curl )
+{
+	curl_easy_setopt( curl, CURLOPT_SHARE, cache->share );
+
+	if( cache->resolve_list )
+	{
+		curl_easy_setopt( curl, CURLOPT_RESOLVE, cache->resolve_list );
+	}
+
+#ifdef NAMECOM_TRANSPORT_CACHE_HAVE_SSLS
+	if( !cache->tls_imported )
+	{
+		/* Imported sessions land in the share, so once is enough. */
+		for( size_t i = 0; i < cache->tls_entries_count; i++ )
+		{
+			tls_entry_t* entry = &cache->tls_entries[ i ];
+			curl_easy_ssls_import( curl, entry->session_key, entry->shmac, entry->shmac_len, entry->sdata, entry->sdata_len );
+		}
+
+		cache->tls_imported = true;
+	}
+#endif
+}
+
+/*
+ * Learns from a finished transfer: remembers the address the host
+ * resolved to and notes whether the cached state was put to use.
+ */
+void namecom_transport_cache_observe( namecom_transport_cache_t* cache, CURL* curl )
+{
+	char* url = NULL;
+	char* primary_ip = NULL;
+	long primary_port = 0;
+	long new_connections = 0;
+
+	curl_easy_getinfo( curl, CURLINFO_EFFECTIVE_URL, &url );
+	curl_easy_getinfo( curl, CURLINFO_PRIMARY_IP, &primary_ip );
+	curl_easy_getinfo( curl, CURLINFO_PRIMARY_PORT, &primary_port );
+	curl_easy_getinfo( curl, CURLINFO_NUM_CONNECTS, &new_connections );
+
+	if( !url || !primary_ip || *primary_ip == '\0' )
+	{
+		return;
+	}
+
+	CURLU* parsed = curl_url();
+	char* host = NULL;
+	char* scheme = NULL;
+
+	if( parsed && curl_url_set( parsed, CURLUPART_URL, url, 0 ) == CURLUE_OK &&
+	    curl_url_get( parsed, CURLUPART_HOST, &host, 0 ) == CURLUE_OK &&
+	    curl_url_get( parsed, CURLUPART_SCHEME, &scheme, 0 ) == CURLUE_OK )
+	{
+		dns_entry_t* entry = namecom_transport_cache_find_dns( cache, host, primary_port );
+
+		if( new_connections > 0 )
+		{
+			if( entry && entry->from_disk && strcmp( entry->address, primary_ip ) == 0 )
+			{
+				cache->stats.dns_cache_used = true;
+			}
+
+			if( strcmp( scheme, "https" ) == 0 && cache->tls_imported && cache->stats.tls_sessions_loaded > 0 )
+			{
+				cache->stats.tls_resumption_attempted = true;
+			}
+		}
+
+		if( !entry )
+		{
+			entry = namecom_transport_cache_add_dns( cache, host, primary_port );
+		}
+
+		if( entry && (strcmp( entry->address, primary_ip ) != 0 || !entry->from_disk) )
+		{
+			/* Only fresh lookups extend the lifetime of an entry. */
+			snprintf( entry->address, sizeof(entry->address), "%s", primary_ip );
+			entry->expires   = time( NULL ) + cache->dns_ttl;
+			entry->from_disk = false;
+		}
+	}
+
+	curl_free( host );
+	curl_free( scheme );
+	curl_url_cleanup( parsed );
+}
+
+#ifdef NAMECOM_TRANSPORT_CACHE_HAVE_SSLS
+static CURLcode namecom_transport_cache_export( CURL* curl, void* userptr, const char* session_key,
+                                                const unsigned char* shmac, size_t shmac_len,
+                                                const unsigned char* sdata, size_t sdata_len,
+                                                curl_off_t valid_until, int ietf_tls_id,
+                                                const char* alpn, size_t earlydata_max )
+{
+	namecom_transport_cache_t* cache = userptr;
+
+	namecom_transport_cache_add_tls( cache, session_key, shmac, shmac_len, sdata, sdata_len, (long long) valid_until );
+
+	return CURLE_OK;
+}
+#endif
+
+bool namecom_transport_cache_save( namecom_transport_cache_t* cache )
+{
+	bool result = false;
+	char tmp_path[ 1100 ];
+	snprintf( tmp_path, sizeof(tmp_path), "%s.%ld.tmp", cache->path, (long) getpid() );
+
+#ifdef NAMECOM_TRANSPORT_CACHE_HAVE_SSLS
+	CURL* curl = curl_easy_init();
+
+	if( curl )
+	{
+		namecom_transport_cache_clear_tls( cache );
+		curl_easy_setopt( curl, CURLOPT_SHARE, cache->share );
+		curl_easy_ssls_export( curl, namecom_transport_cache_export, cache );
+		curl_easy_cleanup( curl );
+	}
+#endif
+
+	/* Session tickets are secrets, so the file is only readable by us. */
+	int fd = open( tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0600 );
+
+	if( fd < 0 )
+	{
+		fprintf( stderr, "[ERROR] Unable to write cache file %s.\n", tmp_path );
+		return false;
+	}
+
+	FILE* file = fdopen( fd, "w" );
+
+	if( !file )
+	{
+		close( fd );
+		goto done;
+	}
+
+	time_t now = time( NULL );
+	fprintf( file, "%s %d\n", NAMECOM_TRANSPORT_CACHE_MAGIC, NAMECOM_TRANSPORT_CACHE_VERSION );
+
+	for( size_t i = 0; i < cache->dns_entries_count; i++ )
+	{
+		dns_entry_t* entry = &cache->dns_entries[ i ];
+
+		if( entry->expires > now )
+		{
+			fprintf( file, "dns %s %ld %s %lld\n", entry->host, entry->port, entry->address, (long long) entry->expires );
+		}
+	}
+
+	for( size_t i = 0; i < cache->tls_entries_count; i++ )
+	{
+		tls_entry_t* entry = &cache->tls_entries[ i ];
+		char* shmac_hex = hex_encode( entry->shmac, entry->shmac_len );
+		char* sdata_hex = hex_encode( entry->sdata, entry->sdata_len );
+
+		if( shmac_hex && sdata_hex && entry->valid_until > (long long) now &&
+		    (!entry->session_key || strpbrk( entry->session_key, " \t\r\n" ) == NULL) &&
+		    2 * (entry->shmac_len + entry->sdata_len) + 512 < NAMECOM_TRANSPORT_CACHE_MAX_LINE )
+		{
+			fprintf( file, "tls %s %s %s %lld\n", entry->session_key ? entry->session_key : "-", shmac_hex, sdata_hex, entry->valid_until );
+		}
+
+		free( shmac_hex );
+		free( sdata_hex );
+	}
+
+	result = fclose( file ) == 0;
+
+	if( result )
+	{
+#ifdef _WIN32
+		remove( cache->path );
+#endif
+		result = rename( tmp_path, cache->path ) == 0;
+	}
+
+done:
+	if( !result )
+	{
+		remove( tmp_path );
+	}
+
+	return result;
+}
+
+void namecom_transport_cache_stats( const namecom_transport_cache_t* cache, namecom_transport_cache_stats_t* stats )
+{
+	*stats = cache->stats;
+}
@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2016-2025 by Joseph A. Marrero. http://www.joemarrero.com/
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef _NAMECOM_TRANSPORT_CACHE_H_
+#define _NAMECOM_TRANSPORT_CACHE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <curl/curl.h>
+
+/*
+ * A small on-disk cache that lets short-lived processes (e.g. cron
+ * driven dyndns runs) skip the name resolution and, with a libcurl 8.12
+ * or newer that was built with SSL session export, the full TLS handshake
+ * that a cold start would otherwise pay for.  Resolved addresses and TLS session tickets are loaded into
+ * a curl share handle when the cache is opened and written back, with
+ * 0600 permissions, when it is saved.
+ *
+ * The cache lives in $XDG_CACHE_HOME/namecom (or ~/.cache/namecom) unless
+ * another directory is given.
+ */
+struct namecom_transport_cache;
+typedef struct namecom_transport_cache namecom_transport_cache_t;
+
+typedef struct namecom_transport_cache_stats {
+	unsigned int dns_entries_loaded;
+	unsigned int tls_sessions_loaded;
+	/* A new connection went to an address that came from the cache. */
+	bool dns_cache_used;
+	/*
+	 * A new TLS connection was made to a host that had a persisted
+	 * session ticket to offer.  libcurl doesn't expose a backend neutral
+	 * "session reused" flag, so this reports the attempt.
+	 */
+	bool tls_resumption_attempted;
+} namecom_transport_cache_stats_t;
+
+namecom_transport_cache_t* namecom_transport_cache_open    ( const char* directory, long dns_ttl );
+void                       namecom_transport_cache_close   ( namecom_transport_cache_t* cache );
+bool                       namecom_transport_cache_save    ( namecom_transport_cache_t* cache );
+void                       namecom_transport_cache_attach  ( namecom_transport_cache_t* cache, CURL* curl );
+void                       namecom_transport_cache_observe ( namecom_transport_cache_t* cache, CURL* curl );
+void                       namecom_transport_cache_stats   ( const namecom_transport_cache_t* cache, namecom_transport_cache_stats_t* stats );
+
+/* Resolves $XDG_CACHE_HOME/namecom (or ~/.cache/namecom) for other on-disk caches. */
+bool                       namecom_transport_cache_default_directory ( char* directory, size_t size );
+
+#endif /* _NAMECOM_TRANSPORT_CACHE_H_ */
@@ -0,0 +1,212 @@
+/*
+ * Copyright (C) 2016-2025 by Joseph A. Marrero. http://www.joemarrero.com/
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <xtd/string.h>
+#include "namecom_zone_cache.h"
+
+typedef struct namecom_zone_cache_entry {
+	char* domain;
+	namecom_record_set_t* set;
+	size_t bytes;
+	time_t fetched;
+	struct namecom_zone_cache_entry* prev;
+	struct namecom_zone_cache_entry* next;
+} namecom_zone_cache_entry_t;
+
+struct namecom_zone_cache {
+	long ttl;
+	size_t max_bytes;
+
+	/* Most recently used first.  Only a handful of domains are expected. */
+	namecom_zone_cache_entry_t* head;
+	namecom_zone_cache_entry_t* tail;
+
+	namecom_zone_cache_stats_t stats;
+};
+
+namecom_zone_cache_t* namecom_zone_cache_create( long ttl, size_t max_bytes )
+{
+	namecom_zone_cache_t* cache = malloc( sizeof(namecom_zone_cache_t) );
+
+	if( cache )
+	{
+		memset( cache, 0, sizeof(namecom_zone_cache_t) );
+		cache->ttl       = ttl;
+		cache->max_bytes = max_bytes;
+	}
+
+	return cache;
+}
+
+static void namecom_zone_cache_unlink( namecom_zone_cache_t* cache, namecom_zone_cache_entry_t* entry )
+{
+	if( entry->prev ) entry->prev->next = entry->next;
+	else              cache->head = entry->next;
+
+	if( entry->next ) entry->next->prev = entry->prev;
+	else              cache->tail = entry->prev;
+
+	entry->prev = NULL;
+	entry->next = NULL;
+}
+
+static void namecom_zone_cache_push_front( namecom_zone_cache_t* cache, namecom_zone_cache_entry_t* entry )
+{
+	entry->prev = NULL;
+	entry->next = cache->head;
+
+	if( cache->head ) cache->head->prev = entry;
+	else              cache->tail = entry;
+
+	cache->head = entry;
+}
+
+static void namecom_zone_cache_remove( namecom_zone_cache_t* cache, namecom_zone_cache_entry_t* entry )
+{
+	namecom_zone_cache_unlink( cache, entry );
+
+	cache->stats.entries -= 1;
+	cache->stats.bytes   -= entry->bytes;
+
+	namecom_record_set_destroy( entry->set );
+	free( entry->domain );
+	free( entry );
+}
+
+static namecom_zone_cache_entry_t* namecom_zone_cache_find( namecom_zone_cache_t* cache, const char* domain )
+{
+	for( namecom_zone_cache_entry_t* entry = cache->head; entry; entry = entry->next )
+	{
+		if( strcmp( entry->domain, domain ) == 0 )
+		{
+			return entry;
+		}
+	}
+
+	return NULL;
+}
+
+void namecom_zone_cache_destroy( namecom_zone_cache_t* cache )
+{
+	if( cache )
+	{
+		while( cache->head )
+		{
+			namecom_zone_cache_remove( cache, cache->head );
+		}
+
+		free( cache );
+	}
+}
+
+/*
+ * Returns the cached listing for domain if it is still fresh.  The set
+ * belongs to the cache and is only valid until the next call, unless the
+ * caller retains it.
+ */
+namecom_record_set_t* namecom_zone_cache_get( namecom_zone_cache_t* cache, const char* domain, time_t now )
+{
+	namecom_zone_cache_entry_t* entry = namecom_zone_cache_find( cache, domain );
+
+	if( entry && difftime( now, entry->fetched ) >= (double) cache->ttl )
+	{
+		namecom_zone_cache_remove( cache, entry );
+		cache->stats.expirations += 1;
+		entry = NULL;
+	}
+
+	if( !entry )
+	{
+		cache->stats.misses += 1;
+		return NULL;
+	}
+
+	namecom_zone_cache_unlink( cache, entry );
+	namecom_zone_cache_push_front( cache, entry );
+	cache->stats.hits += 1;
+
+	return entry->set;
+}
+
+/*
+ * Takes ownership of a reference to set, replacing any entry for domain, and evicts
+ * the least recently used entries until the cache fits its budget.  A
+ * set that wouldn't fit on its own is not cached.
+ */
+bool namecom_zone_cache_put( namecom_zone_cache_t* cache, const char* domain, namecom_record_set_t* set, time_t now )
+{
+	namecom_zone_cache_entry_t* entry = namecom_zone_cache_find( cache, domain );
+	size_t bytes = namecom_record_set_memory( set );
+
+	if( entry )
+	{
+		namecom_zone_cache_remove( cache, entry );
+	}
+
+	if( bytes > cache->max_bytes )
+	{
+		namecom_record_set_destroy( set );
+		return false;
+	}
+
+	entry = malloc( sizeof(namecom_zone_cache_entry_t) );
+
+	if( !entry || !(entry->domain = string_dup( domain )) )
+	{
+		free( entry );
+		namecom_record_set_destroy( set );
+		return false;
+	}
+
+	while( cache->tail && cache->stats.bytes + bytes > cache->max_bytes )
+	{
+		namecom_zone_cache_remove( cache, cache->tail );
+		cache->stats.evictions += 1;
+	}
+
+	entry->set     = set;
+	entry->bytes   = bytes;
+	entry->fetched = now;
+	namecom_zone_cache_push_front( cache, entry );
+
+	cache->stats.entries += 1;
+	cache->stats.bytes   += bytes;
+
+	return true;
+}
+
+void namecom_zone_cache_invalidate( namecom_zone_cache_t* cache, const char* domain )
+{
+	namecom_zone_cache_entry_t* entry = namecom_zone_cache_find( cache, domain );
+
+	if( entry )
+	{
+		namecom_zone_cache_remove( cache, entry );
+		cache->stats.invalidations += 1;
+	}
+}
+
+void namecom_zone_cache_stats( const namecom_zone_cache_t* cache, namecom_zone_cache_stats_t* stats )
+{
+	*stats = cache->stats;
+}
@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2016-2025 by Joseph A. Marrero. http://www.joemarrero.com/
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef _NAMECOM_ZONE_CACHE_H_
+#define _NAMECOM_ZONE_CACHE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <time.h>
+#include "namecom_record_set.h"
+
+/*
+ * An in-memory cache of zone listings keyed by domain.  Entries are
+ * fresh for ttl seconds and the least recently used ones are evicted
+ * once the cached record sets take up more than max_bytes.
+ */
+struct namecom_zone_cache;
+typedef struct namecom_zone_cache namecom_zone_cache_t;
+
+typedef struct namecom_zone_cache_stats {
+	unsigned long hits;
+	unsigned long misses;
+	unsigned long expirations;
+	unsigned long evictions;
+	unsigned long invalidations;
+	size_t entries;
+	size_t bytes;
+} namecom_zone_cache_stats_t;
+
+namecom_zone_cache_t*       namecom_zone_cache_create     ( long ttl, size_t max_bytes );
+void                        namecom_zone_cache_destroy    ( namecom_zone_cache_t* cache );
+namecom_record_set_t*       namecom_zone_cache_get        ( namecom_zone_cache_t* cache, const char* domain, time_t now );
+bool                        namecom_zone_cache_put        ( namecom_zone_cache_t* cache, const char* domain, namecom_record_set_t* set, time_t now );
+void                        namecom_zone_cache_invalidate ( namecom_zone_cache_t* cache, const char* domain );
+void                        namecom_zone_cache_stats      ( const namecom_zone_cache_t* cache, namecom_zone_cache_stats_t* stats );
+
+#endif /* _NAMECOM_ZONE_CACHE_H_ */
@@ -0,0 +1,191 @@
+/*
+ * Copyright (C) 2016-2025 by Joseph A. Marrero. http://www.joemarrero.com/
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "namecom_zone_index.h"
+
+#define NAMECOM_ZONE_INDEX_MIN_SLOTS   16
+
+typedef struct namecom_zone_index_slot {
+	uint32_t hash;
+	uint32_t head;             /* first record with this name + 1, 0 is empty */
+} namecom_zone_index_slot_t;
+
+struct namecom_zone_index {
+	const namecom_record_set_t* set;
+	namecom_zone_index_slot_t* slots;
+	size_t mask;
+	long* next;                /* next record with the same name, or -1 */
+};
+
+static uint32_t namecom_zone_index_hash( const char* s )
+{
+	/* FNV-1a */
+	uint32_t hash = 2166136261u;
+
+	while( *s )
+	{
+		hash ^= (unsigned char) *s++;
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+namecom_zone_index_t* namecom_zone_index_build( const namecom_record_set_t* set )
+{
+	namecom_zone_index_t* index = malloc( sizeof(namecom_zone_index_t) );
+
+	if( !index )
+	{
+		goto failed;
+	}
+
+	size_t capacity = NAMECOM_ZONE_INDEX_MIN_SLOTS;
+
+	while( capacity < set->count * 2 )
+	{
+		capacity *= 2;
+	}
+
+	index->set   = set;
+	index->mask  = capacity - 1;
+	index->slots = calloc( capacity, sizeof(namecom_zone_index_slot_t) );
+	index->next  = malloc( (set->count > 0 ? set->count : 1) * sizeof(long) );
+
+	if( !index->slots || !index->next )
+	{
+		goto failed;
+	}
+
+	/*
+	 * Walk backwards and push each record onto the front of its name's
+	 * chain, so chains end up in listing order.  Names are interned in the
+	 * set, so records with the same name share a pool offset.
+	 */
+	for( size_t i = set->count; i-- > 0; )
+	{
+		uint32_t fqdn = set->fqdns[ i ];
+
+		index->next[ i ] = -1;
+
+		if( fqdn == NAMECOM_RECORD_SET_NULL )
+		{
+			continue;
+		}
+
+		uint32_t hash = namecom_zone_index_hash( set->pool + fqdn );
+		size_t s = hash & index->mask;
+
+		while( index->slots[ s ].head && set->fqdns[ index->slots[ s ].head - 1 ] != fqdn )
+		{
+			s = (s + 1) & index->mask;
+		}
+
+		if( index->slots[ s ].head )
+		{
+			index->next[ i ] = (long) index->slots[ s ].head - 1;
+		}
+
+		index->slots[ s ].hash = hash;
+		index->slots[ s ].head = (uint32_t) i + 1;
+	}
+
+	return index;
+
+failed:
+	namecom_zone_index_destroy( index );
+	return NULL;
+}
+
+void namecom_zone_index_destroy( namecom_zone_index_t* index )
+{
+	if( index )
+	{
+		free( index->slots );
+		free( index->next );
+		free( index );
+	}
+}
+
+static long namecom_zone_index_match( const namecom_zone_index_t* index, long record, namecom_record_type_t type )
+{
+	while( record >= 0 && type != NAMECOM_RECORD_TYPE_UNKNOWN && index->set->types[ record ] != type )
+	{
+		record = index->next[ record ];
+	}
+
+	return record;
+}
+
+/*
+ * Returns the first record named fqdn of the given type, or -1.
+ */
+long namecom_zone_index_find( const namecom_zone_index_t* index, const char* fqdn, namecom_record_type_t type )
+{
+	uint32_t hash = namecom_zone_index_hash( fqdn );
+	size_t s = hash & index->mask;
+
+	while( index->slots[ s ].head )
+	{
+		const namecom_zone_index_slot_t* slot = &index->slots[ s ];
+
+		if( slot->hash == hash )
+		{
+			long record = (long) slot->head - 1;
+
+			if( strcmp( index->set->pool + index->set->fqdns[ record ], fqdn ) == 0 )
+			{
+				return namecom_zone_index_match( index, record, type );
+			}
+		}
+
+		s = (s + 1) & index->mask;
+	}
+
+	return -1;
+}
+
+/*
+ * Returns the next record after record with the same name and the given
+ * type, or -1.
+ */
+long namecom_zone_index_next( const namecom_zone_index_t* index, long record, namecom_record_type_t type )
+{
+	return record >= 0 ? namecom_zone_index_match( index, index->next[ record ], type ) : -1;
+}
+
+/*
+ * Returns the last record named fqdn of the given type in listing order,
+ * or -1.  This is the one the tools act on when a name has several.
+ */
+long namecom_zone_index_find_last( const namecom_zone_index_t* index, const char* fqdn, namecom_record_type_t type )
+{
+	long last = -1;
+
+	for( long record = namecom_zone_index_find( index, fqdn, type ); record >= 0; record = namecom_zone_index_next( index, record, type ) )
+	{
+		last = record;
+	}
+
+	return last;
+}
@@ -0,0 +1,46 @@
+/*
+ * Copyright (C) 2016-2025 by Joseph A. Marrero. http://www.joemarrero.com/
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef _NAMECOM_ZONE_INDEX_H_
+#define _NAMECOM_ZONE_INDEX_H_
+
+#include "namecom_record_set.h"
+
+/*
+ * A hash index over a fetched zone for looking records up by name.  The
+ * table uses open addressing on precomputed name hashes; records that
+ * share a name are chained in listing order, so a lookup costs one probe
+ * sequence plus a walk over that name's few records.
+ *
+ * The record set must outlive the index and must not be appended to
+ * while the index is in use.  Passing NAMECOM_RECORD_TYPE_UNKNOWN as the
+ * type matches records of any type.
+ */
+struct namecom_zone_index;
+typedef struct namecom_zone_index namecom_zone_index_t;
+
+namecom_zone_index_t* namecom_zone_index_build   ( const namecom_record_set_t* set );
+void                  namecom_zone_index_destroy ( namecom_zone_index_t* index );
+long                  namecom_zone_index_find    ( const namecom_zone_index_t* index, const char* fqdn, namecom_record_type_t type );
+long                  namecom_zone_index_next    ( const namecom_zone_index_t* index, long record, namecom_record_type_t type );
+long                  namecom_zone_index_find_last ( const namecom_zone_index_t* index, const char* fqdn, namecom_record_type_t type );
+
+#endif /* _NAMECOM_ZONE_INDEX_H_ */
@@ -0,0 +1,431 @@
+/*
+ * Copyright (C) 2016-2025 by Joseph A. Marrero. http://www.joemarrero.com/
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+#include "namecom_zone_snapshot.h"
+
+#define NAMECOM_ZONE_SNAPSHOT_MAGIC       "NCZSNAP"
+#define NAMECOM_ZONE_SNAPSHOT_VERSION     1
+#define NAMECOM_ZONE_SNAPSHOT_BYTE_ORDER  0x01020304u
+
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
+
+typedef struct namecom_zone_snapshot_header {
+	char magic[ 8 ];
+	uint32_t version;
+	uint32_t byte_order;
+	uint8_t long_size;
+	uint8_t int_size;
+	uint8_t reserved[ 6 ];
+	int64_t created;
+	uint64_t file_size;
+	uint64_t count;
+	uint64_t pool_len;
+
+	/* Section offsets from the start of the file. */
+	uint64_t ids;
+	uint64_t ttls;
+	uint64_t types;
+	uint64_t type_names;
+	uint64_t fqdns;
+	uint64_t contents;
+	uint64_t create_dates;
+	uint64_t pool;
+} namecom_zone_snapshot_header_t;
+
+struct namecom_zone_snapshot {
+	unsigned char* data;
+	size_t size;
+	time_t created;
+	namecom_record_set_t records;   /* points into data */
+};
+
+static size_t align8( size_t n )
+{
+	return (n + 7) & ~(size_t) 7;
+}
+
+static bool namecom_zone_snapshot_mkdir( const char* path )
+{
+#ifdef _WIN32
+	int rc = mkdir( path );
+#else
+	int rc = mkdir( path, 0700 );
+#endif
+	return rc == 0 || errno == EEXIST;
+}
+
+static bool namecom_zone_snapshot_path( char* path, size_t size, const char* directory, const char* domain )
+{
+	/* The domain becomes a file name, so it has to stay inside the directory. */
+	if( !domain || *domain == '\0' || *domain == '.' || strpbrk( domain, "/\\" ) )
+	{
+		return false;
+	}
+
+	int len = snprintf( path, size, "%s/%s.zone", directory, domain );
+
+	return len > 0 && (size_t) len < size;
+}
+
+static void namecom_zone_snapshot_layout( namecom_zone_snapshot_header_t* header, size_t count, size_t pool_len )
+{
+	size_t offset = align8( sizeof(namecom_zone_snapshot_header_t) );
+
+	header->ids          = offset; offset = align8( offset + count * sizeof(long) );
+	header->ttls         = offset; offset = align8( offset + count * sizeof(int) );
+	header->types        = offset; offset = align8( offset + count * sizeof(uint8_t) );
+	header->type_names   = offset; offset = align8( offset + count * sizeof(uint32_t) );
+	header->fqdns        = offset; offset = align8( offset + count * sizeof(uint32_t) );
+	header->contents     = offset; offset = align8( offset + count * sizeof(uint32_t) );
+	header->create_dates = offset; offset = align8( offset + count * sizeof(uint32_t) );
+	header->pool         = offset; offset = align8( offset + pool_len );
+	header->file_size    = offset;
+	header->count        = count;
+	header->pool_len     = pool_len;
+}
+
+static bool namecom_zone_snapshot_write_section( FILE* file, size_t* position, size_t offset, const void* data, size_t len )
+{
+	static const char padding[ 8 ] = { 0 };
+
+	while( *position < offset )
+	{
+		size_t n = offset - *position < sizeof(padding) ? offset - *position : sizeof(padding);
+
+		if( fwrite( padding, 1, n, file ) != n )
+		{
+			return false;
+		}
+
+		*position += n;
+	}
+
+	if( len > 0 && fwrite( data, 1, len, file ) != len )
+	{
+		return false;
+	}
+
+	*position += len;
+
+	return true;
+}
+
+bool namecom_zone_snapshot_write( const char* directory, const char* domain, const namecom_record_set_t* set, time_t created )
+{
+	bool result = false;
+	char path[ 1024 ];
+	char tmp_path[ 1100 ];
+
+	if( !namecom_zone_snapshot_path( path, sizeof(path), directory, domain ) )
+	{
+		return false;
+	}
+
+	if( !namecom_zone_snapshot_mkdir( directory ) )
+	{
+		fprintf( stderr, "[ERROR] Unable to create cache directory %s.\n", directory );
+		return false;
+	}
+
+	/* Concurrent writers, in this process or another, each get their own temporary file. */
+	static unsigned long writes = 0;
+	unsigned long write = __atomic_add_fetch( &writes, 1, __ATOMIC_RELAXED );
+	snprintf( tmp_path, sizeof(tmp_path), "%s.%ld.%lu.tmp", path, (long) getpid(), write );
+
+	namecom_zone_snapshot_header_t header;
+	memset( &header, 0, sizeof(header) );
+	memcpy( header.magic, NAMECOM_ZONE_SNAPSHOT_MAGIC, sizeof(NAMECOM_ZONE_SNAPSHOT_MAGIC) );
+	header.version    = NAMECOM_ZONE_SNAPSHOT_VERSION;
+	header.byte_order = NAMECOM_ZONE_SNAPSHOT_BYTE_ORDER;
+	header.long_size  = sizeof(long);
+	header.int_size   = sizeof(int);
+	header.created    = (int64_t) created;
+	namecom_zone_snapshot_layout( &header, set->count, set->pool_len );
+
+	int fd = open( tmp_path, O_WRONLY | O_CREAT | O_TRUNC | O_BINARY, 0600 );
+
+	if( fd < 0 )
+	{
+		fprintf( stderr, "[ERROR] Unable to write zone snapshot %s.\n", tmp_path );
+		return false;
+	}
+
+	FILE* file = fdopen( fd, "wb" );
+
+	if( !file )
+	{
+		close( fd );
+		goto done;
+	}
+
+	size_t position = 0;
+	size_t count = set->count;
+
+	result = namecom_zone_snapshot_write_section( file, &position, 0, &header, sizeof(header) ) &&
+	         namecom_zone_snapshot_write_section( file, &position, header.ids, set->ids, count * sizeof(long) ) &&
+	         namecom_zone_snapshot_write_section( file, &position, header.ttls, set->ttls, count * sizeof(int) ) &&
+	         namecom_zone_snapshot_write_section( file, &position, header.types, set->types, count * sizeof(uint8_t) ) &&
+	         namecom_zone_snapshot_write_section( file, &position, header.type_names, set->type_names, count * sizeof(uint32_t) ) &&
+	         namecom_zone_snapshot_write_section( file, &position, header.fqdns, set->fqdns, count * sizeof(uint32_t) ) &&
+	         namecom_zone_snapshot_write_section( file, &position, header.contents, set->contents, count * sizeof(uint32_t) ) &&
+	         namecom_zone_snapshot_write_section( file, &position, header.create_dates, set->create_dates, count * sizeof(uint32_t) ) &&
+	         namecom_zone_snapshot_write_section( file, &position, header.pool, set->pool, set->pool_len ) &&
+	         namecom_zone_snapshot_write_section( file, &position, header.file_size, NULL, 0 );
+
+	result = fclose( file ) == 0 && result;
+
+	if( result )
+	{
+#ifdef _WIN32
+		remove( path );
+#endif
+		result = rename( tmp_path, path ) == 0;
+	}
+
+done:
+	if( !result )
+	{
+		remove( tmp_path );
+	}
+
+	return result;
+}
+
+bool namecom_zone_snapshot_remove( const char* directory, const char* domain )
+{
+	char path[ 1024 ];
+
+	if( !namecom_zone_snapshot_path( path, sizeof(path), directory, domain ) )
+	{
+		return false;
+	}
+
+	return remove( path ) == 0 || errno == ENOENT;
+}
+
+static bool namecom_zone_snapshot_load( namecom_zone_snapshot_t* snapshot, long max_age, time_t now )
+{
+	namecom_zone_snapshot_header_t header;
+	namecom_zone_snapshot_header_t expected;
+
+	if( snapshot->size < sizeof(header) )
+	{
+		return false;
+	}
+
+	memcpy( &header, snapshot->data, sizeof(header) );
+
+	if( memcmp( header.magic, NAMECOM_ZONE_SNAPSHOT_MAGIC, sizeof(NAMECOM_ZONE_SNAPSHOT_MAGIC) ) != 0 ||
+	    header.version != NAMECOM_ZONE_SNAPSHOT_VERSION ||
+	    header.byte_order != NAMECOM_ZONE_SNAPSHOT_BYTE_ORDER ||
+	    header.long_size != sizeof(long) ||
+	    header.int_size != sizeof(int) ||
+	    header.file_size != snapshot->size ||
+	    header.count > snapshot->size ||
+	    header.pool_len > snapshot->size )
+	{
+		return false;
+	}
+
+	snapshot->created = (time_t) header.created;
+
+	if( max_age > 0 && (snapshot->created > now || now - snapshot->created > max_age) )
+	{
+		return false;
+	}
+
+	/* The sections always follow the one layout, so anything else is corrupt. */
+	namecom_zone_snapshot_layout( &expected, (size_t) header.count, (size_t) header.pool_len );
+
+	if( header.ids != expected.ids || header.ttls != expected.ttls || header.types != expected.types ||
+	    header.type_names != expected.type_names || header.fqdns != expected.fqdns ||
+	    header.contents != expected.contents || header.create_dates != expected.create_dates ||
+	    header.pool != expected.pool || header.file_size != expected.file_size )
+	{
+		return false;
+	}
+
+	namecom_record_set_t* records = &snapshot->records;
+	unsigned char* data = snapshot->data;
+
+	records->count         = (size_t) header.count;
+	records->capacity      = records->count;
+	records->ids           = (long*) (data + header.ids);
+	records->ttls          = (int*) (data + header.ttls);
+	records->types         = (uint8_t*) (data + header.types);
+	records->type_names    = (uint32_t*) (data + header.type_names);
+	records->fqdns         = (uint32_t*) (data + header.fqdns);
+	records->contents      = (uint32_t*) (data + header.contents);
+	records->create_dates  = (uint32_t*) (data + header.create_dates);
+	records->pool          = (char*) (data + header.pool);
+	records->pool_len      = (size_t) header.pool_len;
+	records->pool_capacity = records->pool_len;
+
+	if( records->pool_len > 0 && records->pool[ records->pool_len - 1 ] != '\0' )
+	{
+		return false;
+	}
+
+	/*
+	 * Strings are read straight out of the pool, so one pass over the
+	 * offsets keeps a damaged file from sending readers past the end.
+	 */
+	for( size_t i = 0; i < records->count; i++ )
+	{
+		uint32_t strings[] = { records->type_names[ i ], records->fqdns[ i ], records->contents[ i ], records->create_dates[ i ] };
+
+		if( records->types[ i ] > NAMECOM_RECORD_TYPE_TXT )
+		{
+			return false;
+		}
+
+		for( size_t j = 0; j < sizeof(strings) / sizeof(strings[ 0 ]); j++ )
+		{
+			if( strings[ j ] != NAMECOM_RECORD_SET_NULL && strings[ j ] >= records->pool_len )
+			{
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+namecom_zone_snapshot_t* namecom_zone_snapshot_open( const char* directory, const char* domain, long max_age, time_t now )
+{
+	char path[ 1024 ];
+
+	if( !namecom_zone_snapshot_path( path, sizeof(path), directory, domain ) )
+	{
+		return NULL;
+	}
+
+	int fd = open( path, O_RDONLY | O_BINARY );
+
+	if( fd < 0 )
+	{
+		return NULL;
+	}
+
+	namecom_zone_snapshot_t* snapshot = malloc( sizeof(namecom_zone_snapshot_t) );
+	struct stat st;
+
+	if( !snapshot )
+	{
+		goto failed;
+	}
+
+	memset( snapshot, 0, sizeof(namecom_zone_snapshot_t) );
+
+	if( fstat( fd, &st ) != 0 || st.st_size <= 0 || (uintmax_t) st.st_size > SIZE_MAX )
+	{
+		goto failed;
+	}
+
+#ifdef _WIN32
+	/* No mmap here, so the file is read in one go instead. */
+	snapshot->data = malloc( (size_t) st.st_size );
+
+	if( !snapshot->data )
+	{
+		goto failed;
+	}
+
+	snapshot->size = (size_t) st.st_size;
+
+	for( size_t offset = 0; offset < snapshot->size; )
+	{
+		int n = read( fd, snapshot->data + offset, snapshot->size - offset );
+
+		if( n <= 0 )
+		{
+			goto failed;
+		}
+
+		offset += (size_t) n;
+	}
+#else
+	void* data = mmap( NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+
+	if( data == MAP_FAILED )
+	{
+		goto failed;
+	}
+
+	snapshot->data = data;
+	snapshot->size = (size_t) st.st_size;
+#endif
+
+	if( !namecom_zone_snapshot_load( snapshot, max_age, now ) )
+	{
+		goto failed;
+	}
+
+	close( fd );
+	return snapshot;
+
+failed:
+	close( fd );
+	namecom_zone_snapshot_close( snapshot );
+	return NULL;
+}
+
+void namecom_zone_snapshot_close( namecom_zone_snapshot_t* snapshot )
+{
+	if( snapshot )
+	{
+		if( snapshot->data )
+		{
+#ifdef _WIN32
+			free( snapshot->data );
+#else
+			munmap( snapshot->data, snapshot->size );
+#endif
+		}
+
+		free( snapshot );
+	}
+}
+
+const namecom_record_set_t* namecom_zone_snapshot_records( const namecom_zone_snapshot_t* snapshot )
+{
+	return &snapshot->records;
+}
+
+time_t namecom_zone_snapshot_created( const namecom_zone_snapshot_t* snapshot )
+{
+	return snapshot->created;
+}
@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2016-2025 by Joseph A. Marrero. http://www.joemarrero.com/
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef _NAMECOM_ZONE_SNAPSHOT_H_
+#define _NAMECOM_ZONE_SNAPSHOT_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <time.h>
+#include "namecom_record_set.h"
+
+/*
+ * A per-domain snapshot of a zone listing kept on disk so that several
+ * short-lived processes on one host can share a single fetch.
+ *
+ * The file is <directory>/<domain>.zone and is laid out exactly like a
+ * namecom_record_set_t in memory: a versioned header, the record table
+ * (one column per field) and the string pool, each section 8 byte
+ * aligned.  Opening a snapshot maps the file and points a read only
+ * record set at it, so there is nothing to parse.  Snapshots are written
+ * to a temporary file and renamed into place, so readers never see a
+ * partial one.
+ *
+ * Snapshots use the host's byte order and type sizes; a file from a
+ * different kind of machine is rejected like any other invalid one.
+ */
+struct namecom_zone_snapshot;
+typedef struct namecom_zone_snapshot namecom_zone_snapshot_t;
+
+bool                        namecom_zone_snapshot_write   ( const char* directory, const char* domain, const namecom_record_set_t* set, time_t created );
+bool                        namecom_zone_snapshot_remove  ( const char* directory, const char* domain );
+
+/*
+ * Returns NULL if there is no snapshot for the domain or it is invalid
+ * or older than max_age seconds.  A max_age of zero or less accepts a
+ * snapshot of any age.
+ */
+namecom_zone_snapshot_t*    namecom_zone_snapshot_open    ( const char* directory, const char* domain, long max_age, time_t now );
+void                        namecom_zone_snapshot_close   ( namecom_zone_snapshot_t* snapshot );
+const namecom_record_set_t* namecom_zone_snapshot_records ( const namecom_zone_snapshot_t* snapshot );
+time_t                      namecom_zone_snapshot_created ( const namecom_zone_snapshot_t* snapshot );
+
+#endif /* _NAMECOM_ZONE_SNAPSHOT_H_ */
@@ -0,0 +1,898 @@
+/*
+ * Copyright (C) 2016-2025 by Joseph A. Marrero. http://www.joemarrero.com/
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+/*
+ * Behaviour tests for the pacing and failure handling of the API handle,
+ * against a stub of the API that runs in this process (see test_stub.h).
+ * The stub scripts delays and failures for the requests each part sends
+ * and logs when they arrived, and the parts check what the handle did
+ * about them.  Each part uses a handle of its own; the host quota part
+ * forks processes that share a quota with it, and the update part runs
+ * the DNS tool, built against the same stub.
+ *
+ *     api_behaviour_test
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <curl/curl.h>
+#include "namecom_api.h"
+#include "namecom_host_quota.h"
+#include "namecom_record_set.h"
+#include "namecom_zone_cache.h"
+#include "test_stub.h"
+
+#define TEST_TIMEOUT_S    120
+#define TEST_DOMAIN       TEST_STUB_DOMAIN
+#define TEST_SLACK_MS     50     /* allowed for scheduling on a busy machine */
+#define TEST_DNS_BIN      "./bin/test_namecom_dns"
+
+static unsigned long test_failures = 0;
+
+#define test_check( condition, what ) \
+	do { if( !(condition) ) { test_failures += 1; fprintf( stderr, "[ERROR] %s (line %d)\n", what, __LINE__ ); } } while( 0 )
+
+static void test_sleep_ms( int delay_ms )
+{
+	struct timespec delay = { delay_ms / 1000, (delay_ms % 1000) * 1000000L };
+	nanosleep( &delay, NULL );
+}
+
+/*
+ * A logged in handle that neither retries nor trips its breaker unless a
+ * part asks for that.
+ */
+static namecom_api_t* test_api_create( void )
+{
+	namecom_api_retry_policy_t no_retries = { 1, 0, 0, 0.0, 0.0 };
+	namecom_api_breaker_policy_t no_breaker = { 0, 0.0, 1, 0 };
+	namecom_api_t* api = namecom_api_create( "user", "token", true, false );
+
+	if( !api || !namecom_api_login( api ) )
+	{
+		test_check( false, "Unable to log in." );
+		if( api ) namecom_api_destroy( api );
+		return NULL;
+	}
+
+	namecom_api_set_retry_policy( api, &no_retries );
+	namecom_api_set_breaker_policy( api, &no_breaker );
+	test_stub_reset( );
+
+	return api;
+}
+
+static void test_api_destroy( namecom_api_t* api )
+{
+	test_stub_reset( );
+	namecom_api_logout( api );
+	namecom_api_destroy( api );
+}
+
+/*
+ * Submits count hellos at once and waits for them, returning how many
+ * succeeded.
+ */
+static size_t test_submit_hellos( namecom_api_t* api, size_t count )
+{
+	namecom_api_request_t* requests[ 64 ];
+	size_t succeeded = 0;
+
+	if( count > sizeof(requests) / sizeof(requests[ 0 ]) )
+	{
+		count = sizeof(requests) / sizeof(requests[ 0 ]);
+	}
+
+	for( size_t i = 0; i < count; i++ )
+	{
+		requests[ i ] = namecom_api_submit_hello( api, NULL, NULL );
+	}
+
+	for( size_t i = 0; i < count; i++ )
+	{
+		if( requests[ i ] && namecom_api_wait( api, requests[ i ] ) && namecom_api_request_succeeded( requests[ i ] ) )
+		{
+			succeeded += 1;
+		}
+
+		namecom_api_request_destroy( requests[ i ] );
+	}
+
+	return succeeded;
+}
+
+/*
+ * The token bucket: a burst goes out at once and the rest at the rate.
+ */
+static void test_rate_limit( void )
+{
+	namecom_api_t* api = test_api_create( );
+	namecom_api_limiter_stats_t stats;
+	long long arrivals[ 25 ];
+
+	if( !api ) return;
+
+	namecom_api_set_rate_limit( api, 20.0, 5.0 );
+
+	long long started_ms = test_stub_now_ms( );
+
+	for( int i = 0; i < 25; i++ )
+	{
+		test_check( namecom_api_hello( api ), "A paced hello failed." );
+	}
+
+	long long elapsed_ms = test_stub_now_ms( ) - started_ms;
+
+	namecom_api_limiter_stats( api, &stats );
+	size_t count = test_stub_arrivals( "/api/hello", arrivals, 25 );
+
+	printf( "rate limit: 25 hellos at 20/s with a burst of 5 took %lld ms, throttled %lu times\n", elapsed_ms, stats.throttled );
+
+	test_check( count == 25, "The stub did not see every hello." );
+	test_check( stats.rate == 20.0 && stats.burst == 5.0, "The limiter reported another rate." );
+	test_check( stats.throttled > 0, "No request was held back." );
+	test_check( stats.tokens < 1.0, "The bucket was not drained." );
+
+	/* The first five share the burst; every later one waited for a token. */
+	for( size_t i = 5; i < count && i < 25; i++ )
+	{
+		test_check( arrivals[ i ] - arrivals[ 0 ] >= (long long) (i - 4) * 50 - TEST_SLACK_MS / 2, "A hello was sent ahead of its token." );
+	}
+
+	test_check( elapsed_ms >= 1000 - TEST_SLACK_MS, "The hellos went out faster than the rate." );
+	test_check( elapsed_ms < 2000, "The hellos were held back for longer than the rate needs." );
+
+	/* A rate of zero lifts the limit. */
+	namecom_api_set_rate_limit( api, 0.0, 0.0 );
+	started_ms = test_stub_now_ms( );
+
+	for( int i = 0; i < 25; i++ )
+	{
+		test_check( namecom_api_hello( api ), "An unpaced hello failed." );
+	}
+
+	test_check( test_stub_now_ms( ) - started_ms < 500, "The hellos were paced with the limit lifted." );
+
+	test_api_destroy( api );
+}
+
+/*
+ * The AIMD controller: the cap grows from the minimum while requests
+ * succeed quickly, is never exceeded, and is halved when the server
+ * answers 503.
+ */
+static void test_adaptive_concurrency( void )
+{
+	namecom_api_t* api = test_api_create( );
+	namecom_api_limiter_stats_t stats;
+
+	if( !api ) return;
+
+	namecom_api_set_max_concurrency( api, 8 );
+	namecom_api_set_adaptive_concurrency( api, true, 1 );
+
+	namecom_api_limiter_stats( api, &stats );
+	test_check( stats.concurrency_limit == 1, "The cap did not start at the minimum." );
+
+	/* Slow enough that the stub sees the requests that overlap. */
+	test_stub_push( "/api/hello", 64, 20, 0, 0, 0 );
+	test_check( test_submit_hellos( api, 64 ) == 64, "A hello under the cap failed." );
+
+	namecom_api_limiter_stats( api, &stats );
+	size_t grown = stats.concurrency_limit;
+	int max_active = test_stub_max_active( );
+
+	printf( "adaptive concurrency: the cap grew to %zu (%lu increases), %d requests at once at most, held back %lu times\n",
+	        grown, stats.increases, max_active, stats.capped );
+
+	test_check( stats.increases > 0 && grown > 1, "The cap did not grow while requests succeeded." );
+	test_check( grown <= 8, "The cap grew past the handle's concurrency." );
+	test_check( max_active <= (int) grown, "More requests were in flight than the cap allowed." );
+	test_check( stats.capped > 0, "No request was held back by the cap." );
+	test_check( stats.in_flight == 0, "Requests were left in flight." );
+
+	test_stub_push( "/api/hello", 8, 0, 503, 0, 0 );
+	test_submit_hellos( api, 8 );
+
+	namecom_api_limiter_stats( api, &stats );
+
+	printf( "adaptive concurrency: after 503s the cap is %zu (%lu decreases)\n", stats.concurrency_limit, stats.decreases );
+
+	test_check( stats.decreases > 0 && stats.concurrency_limit <= grown / 2 + 1, "The cap was not halved on 503." );
+	test_check( stats.concurrency_limit >= 1, "The cap fell below the minimum." );
+
+	test_api_destroy( api );
+}
+
+/*
+ * The host quota is left behind by earlier runs; this waits for it to
+ * fill up again.
+ */
+static void test_quota_wait_full( namecom_host_quota_t* quota, double burst )
+{
+	namecom_host_quota_stats_t stats;
+
+	for( int i = 0; i < 100; i++ )
+	{
+		namecom_host_quota_stats( quota, &stats );
+
+		if( stats.tokens >= burst - 0.01 )
+		{
+			return;
+		}
+
+		test_sleep_ms( 20 );
+	}
+}
+
+/*
+ * A process sharing the host quota: it sends hellos through a handle of
+ * its own and exits with 0 if they all succeeded and some were held back.
+ */
+static void test_quota_process( int hellos )
+{
+	namecom_api_t* api = namecom_api_create( "user", "token", true, false );
+	namecom_api_limiter_stats_t stats;
+	int failed = 0;
+
+	if( !api || !namecom_api_login( api ) || !namecom_api_set_host_quota( api, 10.0, 5.0 ) )
+	{
+		_exit( 2 );
+	}
+
+	for( int i = 0; i < hellos; i++ )
+	{
+		failed += namecom_api_hello( api ) ? 0 : 1;
+	}
+
+	namecom_api_limiter_stats( api, &stats );
+	namecom_api_set_host_quota( api, 0.0, 0.0 );
+	namecom_api_logout( api );
+	namecom_api_destroy( api );
+
+	_exit( failed == 0 && stats.host_quota && stats.host_throttled > 0 ? 0 : 1 );
+}
+
+/*
+ * The host quota: a bucket in shared memory that two processes draw from
+ * together at its rate, and that a process killed after draining it
+ * can't keep from filling up again.
+ */
+static void test_host_quota( void )
+{
+	char server[ 64 ];
+	namecom_host_quota_stats_t stats;
+	namecom_host_quota_t* quota = NULL;
+	long long arrivals[ 20 ];
+	pid_t children[ 2 ];
+	int status = 0;
+
+	/* Keyed by the account and server, as the handles' quotas are. */
+	snprintf( server, sizeof(server), "127.0.0.1:%d", TEST_STUB_PORT );
+	quota = namecom_host_quota_open( "user", server, 10.0, 5.0 );
+
+	if( !quota )
+	{
+		test_check( false, "Unable to open the host quota." );
+		return;
+	}
+
+	/* GCRA: the burst is taken at once and the next token is an interval away. */
+	test_quota_wait_full( quota, 5.0 );
+
+	for( int i = 0; i < 5; i++ )
+	{
+		test_check( namecom_host_quota_take( quota ) == 0, "A token of the burst was refused." );
+	}
+
+	long wait_ms = namecom_host_quota_take( quota );
+	test_check( wait_ms > 0 && wait_ms <= 101, "The next token was not due within an interval." );
+
+	/* Two processes with 10 hellos each share 5 tokens and 10 per second. */
+	test_quota_wait_full( quota, 5.0 );
+	test_stub_reset( );
+
+	long long started_ms = test_stub_now_ms( );
+
+	for( int i = 0; i < 2; i++ )
+	{
+		children[ i ] = fork( );
+
+		if( children[ i ] == 0 )
+		{
+			test_quota_process( 10 );
+		}
+	}
+
+	for( int i = 0; i < 2; i++ )
+	{
+		test_check( children[ i ] > 0 && waitpid( children[ i ], &status, 0 ) == children[ i ] &&
+		            WIFEXITED(status) && WEXITSTATUS(status) == 0, "A process drawing from the host quota failed." );
+	}
+
+	long long elapsed_ms = test_stub_now_ms( ) - started_ms;
+	size_t count = test_stub_arrivals( "/api/hello", arrivals, 20 );
+
+	printf( "host quota: 2 processes sent 20 hellos at 10/s with a burst of 5 in %lld ms\n", elapsed_ms );
+
+	test_check( count == 20, "The stub did not see every hello." );
+
+	for( size_t i = 5; i < count && i < 20; i++ )
+	{
+		test_check( arrivals[ i ] - arrivals[ 0 ] >= (long long) (i - 4) * 100 - TEST_SLACK_MS / 2, "The processes went past the shared rate." );
+	}
+
+	test_check( elapsed_ms >= 1500 - TEST_SLACK_MS, "The processes did not share the quota." );
+
+	/* A process killed after draining the bucket leaves nothing held. */
+	test_quota_wait_full( quota, 5.0 );
+	pid_t holder = fork( );
+
+	if( holder == 0 )
+	{
+		namecom_host_quota_t* drained = namecom_host_quota_open( "user", server, 10.0, 5.0 );
+
+		while( drained && namecom_host_quota_take( drained ) == 0 )
+		{
+		}
+
+		raise( SIGKILL );
+		_exit( 1 );
+	}
+
+	test_check( holder > 0 && waitpid( holder, &status, 0 ) == holder && WIFSIGNALED(status), "The holder was not killed." );
+
+	namecom_host_quota_stats( quota, &stats );
+	test_check( stats.tokens < 1.0, "The killed holder's draws were not shared." );
+
+	test_sleep_ms( 500 + TEST_SLACK_MS );
+	namecom_host_quota_stats( quota, &stats );
+
+	printf( "host quota: %.2f tokens back within the refill time after the holder was killed\n", stats.tokens );
+
+	test_check( stats.tokens >= 4.99, "The killed holder kept tokens from the bucket." );
+
+	for( int i = 0; i < 5; i++ )
+	{
+		test_check( namecom_host_quota_take( quota ) == 0, "A token was refused after the holder was killed." );
+	}
+
+	namecom_host_quota_close( quota );
+}
+
+/*
+ * Retries: backoffs stay within the full jitter bounds and honour
+ * Retry-After, adds are only sent again when the server can't have acted
+ * on them, and the budget stops retries once it has been spent.
+ */
+static void test_retries( void )
+{
+	namecom_api_t* api = test_api_create( );
+	namecom_api_connection_stats_t before;
+	namecom_api_connection_stats_t stats;
+	long long arrivals[ 3 ];
+	long longest_ms[ 2 ] = { 0, 0 };
+	long shortest_ms[ 2 ] = { 1000, 1000 };
+	long id = -1;
+
+	if( !api ) return;
+
+	/* Each backoff is drawn between nothing and 100 ms, then 200 ms. */
+	namecom_api_retry_policy_t bounded = { 3, 100, 400, 100.0, 0.0 };
+	namecom_api_set_retry_policy( api, &bounded );
+	namecom_api_connection_stats( api, &before );
+
+	for( int trial = 0; trial < 10; trial++ )
+	{
+		test_stub_reset( );
+		test_stub_push( "/api/hello", 2, 0, 503, 0, 0 );
+		test_check( namecom_api_hello( api ), "A hello that failed twice was not retried." );
+		test_check( test_stub_arrivals( "/api/hello", arrivals, 3 ) == 3, "The stub did not see three attempts." );
+
+		for( int i = 0; i < 2; i++ )
+		{
+			long gap_ms = (long) (arrivals[ i + 1 ] - arrivals[ i ]);
+			test_check( gap_ms <= (100L << i) + TEST_SLACK_MS, "A backoff went past its ceiling." );
+			if( gap_ms > longest_ms[ i ] ) longest_ms[ i ] = gap_ms;
+			if( gap_ms < shortest_ms[ i ] ) shortest_ms[ i ] = gap_ms;
+		}
+	}
+
+	namecom_api_connection_stats( api, &stats );
+
+	printf( "retries: backoffs of %ld-%ld ms under a 100 ms ceiling and %ld-%ld ms under 200 ms\n",
+	        shortest_ms[ 0 ], longest_ms[ 0 ], shortest_ms[ 1 ], longest_ms[ 1 ] );
+
+	test_check( longest_ms[ 0 ] > shortest_ms[ 0 ] || longest_ms[ 1 ] > shortest_ms[ 1 ], "The backoffs were not jittered." );
+	test_check( stats.retries - before.retries == 20, "The retries were not counted." );
+	test_check( stats.connections_created == before.connections_created, "A retry did not reuse the connection." );
+
+	/* The last attempt's failure is the caller's. */
+	test_stub_reset( );
+	test_stub_push( "/api/hello", 3, 0, 503, 0, 0 );
+	test_check( !namecom_api_hello( api ), "A hello succeeded past its attempts." );
+	test_check( test_stub_count( "/api/hello" ) == 3, "More attempts were sent than the policy allows." );
+
+	/* Result code 250 is as transient as a 503. */
+	test_stub_reset( );
+	test_stub_push( "/api/hello", 1, 0, 200, 250, 0 );
+	test_check( namecom_api_hello( api ), "A hello answered with code 250 was not retried." );
+
+	/* An add is sent again after a 429 but not after a 503. */
+	test_stub_reset( );
+	test_stub_push( "/api/dns/create/", 1, 0, 503, 0, 0 );
+	test_check( !namecom_api_dns_record_add( api, TEST_DOMAIN, "retry", "A", "10.0.2.1", 300, 10, &id ), "An add was retried after a 503." );
+	test_check( test_stub_count( "/api/dns/create/" ) == 1, "An add the server may have acted on was sent again." );
+
+	test_stub_reset( );
+	test_stub_push( "/api/dns/create/", 1, 0, 429, 0, 0 );
+	test_check( namecom_api_dns_record_add( api, TEST_DOMAIN, "retry", "A", "10.0.2.1", 300, 10, &id ), "An add was not retried after a 429." );
+	test_check( test_stub_count( "/api/dns/create/" ) == 2, "The throttled add was not sent again." );
+
+	/* A longer Retry-After wins over the drawn backoff; one past the cap fails the request. */
+	test_stub_reset( );
+	test_stub_push( "/api/hello", 1, 0, 503, 0, 1 );
+	test_check( !namecom_api_hello( api ), "A Retry-After past the longest backoff was waited out." );
+	test_check( test_stub_count( "/api/hello" ) == 1, "A Retry-After past the longest backoff was waited out." );
+
+	namecom_api_retry_policy_t patient = { 3, 100, 2000, 100.0, 0.0 };
+	namecom_api_set_retry_policy( api, &patient );
+	test_stub_reset( );
+	test_stub_push( "/api/hello", 1, 0, 503, 0, 1 );
+	test_check( namecom_api_hello( api ), "A hello was not retried after its Retry-After." );
+	test_check( test_stub_arrivals( "/api/hello", arrivals, 2 ) == 2 && arrivals[ 1 ] - arrivals[ 0 ] >= 1000 - TEST_SLACK_MS,
+	            "A retry was sent before the Retry-After." );
+
+	/* A budget of one retry that earns back half a retry per success. */
+	namecom_api_retry_policy_t budgeted = { 3, 10, 10, 1.0, 0.5 };
+	namecom_api_set_retry_policy( api, &budgeted );
+	namecom_api_connection_stats( api, &before );
+	test_stub_reset( );
+
+	test_stub_push( "/api/hello", 1, 0, 503, 0, 0 );
+	test_check( namecom_api_hello( api ), "A retry within the budget was refused." );
+
+	test_stub_push( "/api/hello", 1, 0, 503, 0, 0 );
+	test_check( !namecom_api_hello( api ), "A retry was sent with half a retry left in the budget." );
+
+	test_check( namecom_api_hello( api ), "A hello failed." );
+	test_stub_push( "/api/hello", 1, 0, 503, 0, 0 );
+	test_check( namecom_api_hello( api ), "A retry earned back by successes was refused." );
+
+	namecom_api_connection_stats( api, &stats );
+
+	printf( "retries: a budget of 1 earning 0.5 per success allowed %lu retries and denied %lu\n",
+	        stats.retries - before.retries, stats.retries_denied - before.retries_denied );
+
+	test_check( test_stub_count( "/api/hello" ) == 6, "The stub did not see the attempts the budget allows." );
+	test_check( stats.retries - before.retries == 2 && stats.retries_denied - before.retries_denied == 1, "The budget was not kept." );
+
+	test_api_destroy( api );
+}
+
+/*
+ * Lists the zone and returns the second octet of the first record, which
+ * the stub numbers each listing with, or -1.
+ */
+static long test_listing( namecom_api_t* api, long long* elapsed_ms )
+{
+	long long started_ms = test_stub_now_ms( );
+	namecom_record_set_t* set = namecom_api_dns_record_set( api, TEST_DOMAIN );
+	long listing = -1;
+
+	if( elapsed_ms )
+	{
+		*elapsed_ms = test_stub_now_ms( ) - started_ms;
+	}
+
+	if( set && namecom_record_set_count( set ) == TEST_STUB_RECORDS )
+	{
+		listing = strtol( namecom_record_set_content( set, 0 ) + 3, NULL, 10 );
+	}
+
+	namecom_record_set_destroy( set );
+
+	return listing;
+}
+
+static unsigned long test_stub_listings( void )
+{
+	pthread_mutex_lock( &test_stub.lock );
+	unsigned long listings = test_stub.listings % 256;
+	pthread_mutex_unlock( &test_stub.lock );
+
+	return listings;
+}
+
+/*
+ * Hedging: a slow listing is raced by a duplicate, the first answer is
+ * the one returned and cached, and the other request is cancelled rather
+ * than landing in the cache later.
+ */
+static void test_hedging( void )
+{
+	namecom_api_connection_stats_t stats;
+	namecom_zone_cache_stats_t cache_stats;
+	long long elapsed_ms = 0;
+
+	for( int duplicate_wins = 1; duplicate_wins >= 0; duplicate_wins-- )
+	{
+		namecom_api_t* api = test_api_create( );
+
+		if( !api ) return;
+
+		namecom_api_set_hedging( api, 95.0, 50 );
+		namecom_api_set_zone_cache( api, 60, 1024 * 1024 );
+
+		/* The original is held for 600 ms, or answered at 100 ms ahead of a duplicate held for 800 ms. */
+		if( duplicate_wins )
+		{
+			test_stub_push( "/api/dns/list/", 1, 600, 0, 0, 0 );
+		}
+		else
+		{
+			test_stub_push( "/api/dns/list/", 1, 100, 0, 0, 0 );
+			test_stub_push( "/api/dns/list/", 1, 800, 0, 0, 0 );
+		}
+
+		long listing = test_listing( api, &elapsed_ms );
+		long answered = (long) test_stub_listings( );
+
+		namecom_api_connection_stats( api, &stats );
+
+		printf( "hedging: the %s answered a listing in %lld ms (%lu hedges, %lu won)\n",
+		        duplicate_wins ? "duplicate" : "original", elapsed_ms, stats.hedges, stats.hedges_won );
+
+		test_check( listing >= 0 && listing == answered, "The listing was not the first answer." );
+		test_check( test_stub_count( "/api/dns/list/" ) == 2, "The slow listing was not hedged." );
+		test_check( stats.hedges == 1 && stats.hedges_won == (duplicate_wins ? 1 : 0), "The hedges were not counted." );
+		test_check( elapsed_ms < (duplicate_wins ? 600 : 800), "The listing waited for the slower request." );
+
+		/* Let the slower request's answer come and go; the cache keeps the winner's. */
+		test_sleep_ms( 800 + TEST_SLACK_MS );
+
+		test_check( test_listing( api, NULL ) == listing, "The cache did not keep the first answer." );
+		test_check( test_stub_count( "/api/dns/list/" ) == 2, "The cached listing was sent again." );
+
+		namecom_api_zone_cache_stats( api, &cache_stats );
+		test_check( cache_stats.hits == 1 && cache_stats.entries == 1, "The listing was not served from the cache." );
+
+		test_api_destroy( api );
+	}
+}
+
+/*
+ * Timeouts and deadlines: a slow answer times out after the handle's
+ * timeout, a remove and an add made under one deadline share it, and
+ * nothing is sent once it has passed.
+ */
+static void test_deadlines( void )
+{
+	namecom_api_t* api = test_api_create( );
+	long long started_ms = 0;
+	long long elapsed_ms = 0;
+	long id = -1;
+
+	if( !api ) return;
+
+	/* The handle's own timeout. */
+	namecom_api_set_timeouts( api, 0, 200 );
+	test_stub_push( "/api/hello", 1, 500, 0, 0, 0 );
+
+	started_ms = test_stub_now_ms( );
+	test_check( !namecom_api_hello( api ), "A hello slower than the timeout succeeded." );
+	elapsed_ms = test_stub_now_ms( ) - started_ms;
+
+	printf( "deadlines: a 500 ms answer timed out after %lld ms with a timeout of 200 ms\n", elapsed_ms );
+
+	test_check( namecom_api_last_error( api ) == NAMECOM_API_ERROR_TIMEOUT, "A timeout was not reported as one." );
+	test_check( elapsed_ms >= 200 - TEST_SLACK_MS && elapsed_ms < 200 + 2 * TEST_SLACK_MS, "The hello did not time out after the handle's timeout." );
+
+	/* A remove taking 300 ms leaves the add 200 ms of a 500 ms deadline. */
+	namecom_api_set_timeouts( api, 10000, 60000 );
+	test_stub_reset( );
+	test_stub_push( "/api/dns/delete/", 1, 300, 0, 0, 0 );
+	test_stub_push( "/api/dns/create/", 1, 300, 0, 0, 0 );
+
+	started_ms = namecom_api_clock_ms( );
+	namecom_api_set_deadline( api, started_ms + 500 );
+
+	test_check( namecom_api_dns_record_remove( api, TEST_DOMAIN, 1 ), "A remove within the deadline failed." );
+	test_check( !namecom_api_dns_record_add( api, TEST_DOMAIN, "deadline", "A", "10.0.3.1", 300, 10, &id ), "An add past the deadline succeeded." );
+	test_check( namecom_api_last_error( api ) == NAMECOM_API_ERROR_TIMEOUT, "An add past the deadline did not time out." );
+
+	elapsed_ms = namecom_api_clock_ms( ) - started_ms;
+
+	printf( "deadlines: a remove and an add of 300 ms each gave up after %lld ms of a 500 ms deadline\n", elapsed_ms );
+
+	test_check( test_stub_count( "/api/dns/create/" ) == 1, "The add was not sent with what was left of the deadline." );
+	test_check( elapsed_ms >= 500 - TEST_SLACK_MS && elapsed_ms < 500 + 2 * TEST_SLACK_MS, "The remove and the add did not share the deadline." );
+
+	/* Once it has passed, nothing more is sent. */
+	test_check( !namecom_api_hello( api ), "A hello past the deadline succeeded." );
+	test_check( namecom_api_last_error( api ) == NAMECOM_API_ERROR_TIMEOUT, "A hello past the deadline did not time out." );
+	test_check( test_stub_count( "/api/hello" ) == 0, "A hello was sent past the deadline." );
+
+	/* A retry that couldn't go out before the deadline isn't waited for. */
+	namecom_api_retry_policy_t patient = { 3, 100, 2000, 10.0, 0.0 };
+	namecom_api_set_retry_policy( api, &patient );
+	test_stub_push( "/api/hello", 1, 0, 503, 0, 1 );
+
+	started_ms = namecom_api_clock_ms( );
+	namecom_api_set_deadline( api, started_ms + 300 );
+	test_check( !namecom_api_hello( api ), "A hello retried past the deadline succeeded." );
+	test_check( namecom_api_clock_ms( ) - started_ms < 300, "A retry due after the deadline was waited for." );
+	test_check( test_stub_count( "/api/hello" ) == 1, "A retry was sent past the deadline." );
+
+	/* Clearing the deadline lifts it. */
+	namecom_api_set_deadline( api, 0 );
+	test_check( namecom_api_deadline( api ) == 0, "The deadline was not cleared." );
+	test_check( namecom_api_hello( api ), "A hello failed with the deadline cleared." );
+
+	test_api_destroy( api );
+}
+
+/*
+ * The circuit breaker: it opens after failures in a row or a high error
+ * rate, refuses requests without sending them while open, and lets a
+ * single probe decide whether it closes or opens again.
+ */
+static void test_breaker( void )
+{
+	namecom_api_t* api = test_api_create( );
+	namecom_api_breaker_stats_t stats;
+
+	if( !api ) return;
+
+	namecom_api_breaker_policy_t policy = { 3, 0.0, 20, 300 };
+	namecom_api_set_breaker_policy( api, &policy );
+
+	/* Throttling and refusals say nothing about the service's health. */
+	test_stub_push( "/api/hello", 5, 0, 429, 0, 0 );
+	test_stub_push( "/api/hello", 5, 0, 404, 211, 0 );
+
+	for( int i = 0; i < 10; i++ )
+	{
+		test_check( !namecom_api_hello( api ), "A scripted failure succeeded." );
+	}
+
+	test_check( namecom_api_breaker_state( api ) == NAMECOM_API_BREAKER_CLOSED, "The breaker opened on answers that don't count against it." );
+
+	/* Three failures in a row open it. */
+	test_stub_push( "/api/hello", 3, 0, 503, 0, 0 );
+
+	for( int i = 0; i < 3; i++ )
+	{
+		test_check( !namecom_api_hello( api ), "A scripted failure succeeded." );
+	}
+
+	namecom_api_breaker_stats( api, &stats );
+	test_check( stats.state == NAMECOM_API_BREAKER_OPEN && stats.opened == 1, "The breaker did not open after three failures in a row." );
+	test_check( stats.probe_in_ms > 0 && stats.probe_in_ms <= 300, "The time until the probe was not reported." );
+
+	/* While open, nothing is sent. */
+	test_stub_reset( );
+	test_check( !namecom_api_hello( api ), "A hello went through an open breaker." );
+	test_check( namecom_api_last_error( api ) == NAMECOM_API_ERROR_UNAVAILABLE, "A refusal was not reported as one." );
+	test_check( test_stub_count( "/api/hello" ) == 0, "A hello was sent through an open breaker." );
+
+	/* A failed probe opens it again and the request behind it is refused. */
+	test_sleep_ms( 300 + TEST_SLACK_MS );
+	test_stub_push( "/api/hello", 1, 0, 503, 0, 0 );
+	test_check( !namecom_api_hello( api ), "A hello behind a failed probe succeeded." );
+	test_check( namecom_api_last_error( api ) == NAMECOM_API_ERROR_UNAVAILABLE, "A hello behind a failed probe was not refused." );
+	test_check( test_stub_count( "/api/hello" ) == 1, "More than the probe was sent while half open." );
+
+	namecom_api_breaker_stats( api, &stats );
+	test_check( stats.state == NAMECOM_API_BREAKER_OPEN && stats.opened == 2 && stats.half_opened == 1, "A failed probe did not open the breaker again." );
+
+	/* An answered probe closes it and the request behind it goes ahead. */
+	test_sleep_ms( 300 + TEST_SLACK_MS );
+	test_stub_reset( );
+	test_check( namecom_api_hello( api ), "A hello behind an answered probe failed." );
+	test_check( test_stub_count( "/api/hello" ) == 2, "The probe and the hello behind it were not both sent." );
+
+	namecom_api_breaker_stats( api, &stats );
+
+	printf( "breaker: opened %lu times, probed %lu times, closed %lu times, refused %lu requests\n",
+	        stats.opened, stats.half_opened, stats.closed, stats.rejected );
+
+	test_check( stats.state == NAMECOM_API_BREAKER_CLOSED && stats.closed == 1 && stats.half_opened == 2, "An answered probe did not close the breaker." );
+	test_check( stats.rejected == 2, "The refusals were not counted." );
+
+	/* Half of a window of four opens it, however the failures are spread. */
+	namecom_api_breaker_policy_t by_rate = { 0, 0.5, 4, 300 };
+	namecom_api_set_breaker_policy( api, &by_rate );
+
+	for( int i = 0; i < 4; i++ )
+	{
+		if( i % 2 == 0 )
+		{
+			test_stub_push( "/api/hello", 1, 0, 503, 0, 0 );
+		}
+
+		namecom_api_hello( api );
+		test_check( namecom_api_breaker_state( api ) == (i < 3 ? NAMECOM_API_BREAKER_CLOSED : NAMECOM_API_BREAKER_OPEN),
+		            "The breaker did not open once half the window had failed." );
+	}
+
+	test_api_destroy( api );
+}
+
+/*
+ * Runs the DNS tool, built against the stub, to set h0, keeping what it
+ * printed in output.
+ */
+static bool test_dns_set( char* output, size_t size )
+{
+	FILE* tool = popen( TEST_DNS_BIN " -u user -t token -s A h0." TEST_DOMAIN " 10.0.4.1 300 2>&1", "r" );
+	size_t len = 0;
+
+	output[ 0 ] = '\0';
+
+	if( !tool )
+	{
+		return false;
+	}
+
+	while( len < size - 1 && fgets( output + len, (int) (size - len), tool ) )
+	{
+		len += strlen( output + len );
+	}
+
+	return pclose( tool ) != -1;
+}
+
+/*
+ * Sets h0 with the DNS tool while the stub answers the update with
+ * status and code (as usual when status is 0), and checks what the tool
+ * sent and whether it succeeded.
+ */
+static void test_dns_set_sends( int status, int code, size_t removes, size_t adds, bool succeeded, const char* what )
+{
+	unsigned long failures = test_failures;
+	char output[ 4096 ];
+
+	test_stub_reset( );
+
+	if( status != 0 )
+	{
+		test_stub_push( "/api/dns/update/", 1, 0, status, code, 0 );
+	}
+
+	test_check( test_dns_set( output, sizeof(output) ) &&
+	            strstr( output, succeeded ? "Record updated." : "Failed to update record." ), what );
+	test_check( test_stub_count( "/api/dns/update/" ) == 1 &&
+	            test_stub_count( "/api/dns/delete/" ) == removes &&
+	            test_stub_count( "/api/dns/create/" ) == adds, what );
+
+	if( test_failures > failures )
+	{
+		fputs( output, stderr );
+	}
+}
+
+/*
+ * Updates: a server that turns the command down (405, 501 or result code
+ * 211) makes it fail as unsupported, and then without being sent again,
+ * while a 404 is an ordinary failure.  The DNS tool falls back to
+ * removing and adding the record only in the first case.
+ */
+static void test_updates( void )
+{
+	namecom_api_t* api = NULL;
+	long id = -1;
+
+	/* Supported: one request, and the record keeps its id. */
+	if( !(api = test_api_create( )) ) return;
+
+	test_check( namecom_api_dns_record_update( api, TEST_DOMAIN, 1, "h0", "A", "10.0.4.1", 300, 10 ), "An update failed." );
+	test_check( test_stub_count( "/api/dns/" ) == 1, "An update took more than one request." );
+	test_api_destroy( api );
+
+	/* Turned down, and remembered. */
+	if( !(api = test_api_create( )) ) return;
+
+	test_stub_push( "/api/dns/update/", 1, 0, 405, 0, 0 );
+	test_check( !namecom_api_dns_record_update( api, TEST_DOMAIN, 1, "h0", "A", "10.0.4.1", 300, 10 ), "An update the server turned down succeeded." );
+	test_check( namecom_api_last_error( api ) == NAMECOM_API_ERROR_UNSUPPORTED, "A 405 was not reported as unsupported." );
+	test_check( !namecom_api_dns_record_update( api, TEST_DOMAIN, 1, "h0", "A", "10.0.4.1", 300, 10 ), "An update succeeded after the server turned one down." );
+	test_check( namecom_api_last_error( api ) == NAMECOM_API_ERROR_UNSUPPORTED, "A later update was not reported as unsupported." );
+	test_check( test_stub_count( "/api/dns/update/" ) == 1, "An update was sent after the server turned one down." );
+
+	/* The caller's fallback still works on the same handle. */
+	test_check( namecom_api_dns_record_remove( api, TEST_DOMAIN, 1 ) &&
+	            namecom_api_dns_record_add( api, TEST_DOMAIN, "h0", "A", "10.0.4.1", 300, 10, &id ), "Removing and adding the record failed." );
+	test_api_destroy( api );
+
+	/* The same for a submitted update turned down with 501 or code 211. */
+	for( int i = 0; i < 2; i++ )
+	{
+		if( !(api = test_api_create( )) ) return;
+
+		test_stub_push( "/api/dns/update/", 1, 0, i == 0 ? 501 : 404, i == 0 ? 0 : 211, 0 );
+		namecom_api_request_t* update = namecom_api_submit_dns_record_update( api, TEST_DOMAIN, 1, "h0", "A", "10.0.4.1", 300, 10, NULL, NULL );
+
+		test_check( update && !namecom_api_wait( api, update ) && namecom_api_request_is_done( update ) &&
+		            namecom_api_request_error( update ) == NAMECOM_API_ERROR_UNSUPPORTED, "A submitted update turned down was not reported as unsupported." );
+
+		namecom_api_request_destroy( update );
+		test_api_destroy( api );
+	}
+
+	/* A 404 may just mean the record is gone: an ordinary failure, and not remembered. */
+	if( !(api = test_api_create( )) ) return;
+
+	test_stub_push( "/api/dns/update/", 1, 0, 404, 240, 0 );
+	test_check( !namecom_api_dns_record_update( api, TEST_DOMAIN, 1, "h0", "A", "10.0.4.1", 300, 10 ), "An update answered with 404 succeeded." );
+	test_check( namecom_api_last_error( api ) == NAMECOM_API_ERROR_FAILED, "A 404 was reported as unsupported." );
+	test_check( namecom_api_dns_record_update( api, TEST_DOMAIN, 1, "h0", "A", "10.0.4.1", 300, 10 ), "An update after a 404 was not sent." );
+	test_check( test_stub_count( "/api/dns/update/" ) == 2, "An update after a 404 was not sent." );
+	test_api_destroy( api );
+
+	/* The DNS tool: updates in place, falls back on a 405 and gives up on a 404. */
+	test_dns_set_sends( 0, 0, 0, 0, true, "The DNS tool did not update the record in place." );
+	test_dns_set_sends( 405, 0, 1, 1, true, "The DNS tool did not fall back to removing and adding the record." );
+	test_dns_set_sends( 404, 240, 0, 0, false, "The DNS tool fell back after a 404." );
+
+	printf( "updates: in place when offered, as unsupported after 405, 501 or code 211, and the DNS tool falls back only then\n" );
+
+	test_stub_reset( );
+}
+
+int main( void )
+{
+	/* The breaker's warnings go to stderr in between. */
+	setvbuf( stdout, NULL, _IOLBF, 0 );
+	alarm( TEST_TIMEOUT_S );
+	curl_global_init( CURL_GLOBAL_DEFAULT );
+
+	if( !test_stub_start( ) )
+	{
+		return 1;
+	}
+
+	test_rate_limit( );
+	test_adaptive_concurrency( );
+	test_host_quota( );
+	test_retries( );
+	test_hedging( );
+	test_deadlines( );
+	test_breaker( );
+	test_updates( );
+
+	curl_global_cleanup( );
+
+	if( test_failures )
+	{
+		fprintf( stderr, "[ERROR] %lu checks failed.\n", test_failures );
+		return 1;
+	}
+
+	return 0;
+}
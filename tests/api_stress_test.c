@@ -0,0 +1,353 @@
+/*
+ * Copyright (C) 2016-2025 by Joseph A. Marrero. http://www.joemarrero.com/
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+/*
+ * Stress test for a handle shared by threads.  The library is built
+ * against a stub of the API that runs in this process (see test_stub.h),
+ * and the stub expires every session now and then so that requests on
+ * many threads are refused together and have to share one login.  Listings of the same zone coalesce while records are
+ * added and removed underneath them.
+ *
+ * The second part covers a login that a refused request queued on the
+ * transport of the thread that created the handle, which is only driven
+ * through the asynchronous interface: namecom_api_login() on that thread
+ * must drive it rather than wait for it.  A hang is reported by the alarm.
+ *
+ * The third part checks that requests are served from recycled buffers
+ * once the threads have warmed up: the transport_allocations counter must
+ * not move while they keep going.
+ *
+ *     api_stress_test
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <curl/curl.h>
+#include "namecom_api.h"
+#include "namecom_record_set.h"
+#include "test_stub.h"
+
+#define TEST_THREADS      8
+#define TEST_ITERATIONS   200
+#define TEST_EXPIRE_EVERY 25
+#define TEST_RECORDS      TEST_STUB_RECORDS
+#define TEST_TIMEOUT_S    120
+#define TEST_WARMUP       10
+#define TEST_STEADY       100
+#define TEST_DOMAIN       TEST_STUB_DOMAIN
+
+static unsigned long test_failures = 0;
+static pthread_mutex_t test_failures_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void test_fail( const char* what )
+{
+	pthread_mutex_lock( &test_failures_lock );
+	test_failures += 1;
+	pthread_mutex_unlock( &test_failures_lock );
+	fprintf( stderr, "[ERROR] %s\n", what );
+}
+
+/*
+ * Part one: every thread lists the zone, says hello and now and then adds
+ * and removes a record, while the first thread expires the sessions.
+ */
+static void* test_worker( void* arg )
+{
+	namecom_api_t* api = arg;
+	static unsigned long next_worker = 0;
+	unsigned long worker = __atomic_fetch_add( &next_worker, 1, __ATOMIC_RELAXED );
+
+	for( int i = 0; i < TEST_ITERATIONS; i++ )
+	{
+		if( worker == 0 && i % TEST_EXPIRE_EVERY == 0 )
+		{
+			test_stub_expire( );
+		}
+
+		namecom_record_set_t* set = namecom_api_dns_record_set( api, TEST_DOMAIN );
+
+		if( !set || namecom_record_set_count( set ) != TEST_RECORDS )
+		{
+			test_fail( "A listing failed." );
+		}
+
+		namecom_record_set_destroy( set );
+
+		if( !namecom_api_hello( api ) )
+		{
+			test_fail( "A hello failed." );
+		}
+
+		if( i % 10 == (int) worker % 10 )
+		{
+			long id = -1;
+
+			if( !namecom_api_dns_record_add( api, TEST_DOMAIN, "stress", "A", "10.0.1.1", 300, 10, &id ) ||
+			    !namecom_api_dns_record_remove( api, TEST_DOMAIN, id ) )
+			{
+				test_fail( "A record change failed." );
+			}
+		}
+	}
+
+	return NULL;
+}
+
+static void test_shared_handle( void )
+{
+	namecom_api_t* api = namecom_api_create( "user", "token", true, false );
+	pthread_t threads[ TEST_THREADS ];
+
+	if( !api || !namecom_api_login( api ) )
+	{
+		test_fail( "Unable to log in." );
+		if( api ) namecom_api_destroy( api );
+		return;
+	}
+
+	unsigned long logins_before = test_stub.logins;
+
+	for( int i = 0; i < TEST_THREADS; i++ )
+	{
+		pthread_create( &threads[ i ], NULL, test_worker, api );
+	}
+
+	for( int i = 0; i < TEST_THREADS; i++ )
+	{
+		pthread_join( threads[ i ], NULL );
+	}
+
+	unsigned long expirations = (TEST_ITERATIONS + TEST_EXPIRE_EVERY - 1) / TEST_EXPIRE_EVERY;
+	unsigned long logins = test_stub.logins - logins_before;
+
+	namecom_api_connection_stats_t stats;
+	namecom_api_connection_stats( api, &stats );
+
+	printf( "%d threads: %lu requests, %lu coalesced listings, %lu logins for %lu expirations, %lu refusals\n",
+	        TEST_THREADS, stats.requests, stats.requests_coalesced, logins, expirations, test_stub.refused );
+
+	if( logins > expirations )
+	{
+		test_fail( "Requests refused together did not share a login." );
+	}
+
+	namecom_api_logout( api );
+	namecom_api_destroy( api );
+}
+
+/*
+ * Part two: a hello submitted on the creating thread is refused, which
+ * queues a login on that thread's transport, and the thread then logs in
+ * while another thread waits on the same login.
+ */
+static void* test_parked_hello( void* arg )
+{
+	if( !namecom_api_hello( arg ) )
+	{
+		test_fail( "A hello waiting on another thread's login failed." );
+	}
+
+	return NULL;
+}
+
+static void test_login_on_own_transport( void )
+{
+	namecom_api_t* api = namecom_api_create( "user", "token", true, false );
+	pthread_t thread;
+
+	if( !api || !namecom_api_login( api ) )
+	{
+		test_fail( "Unable to log in." );
+		if( api ) namecom_api_destroy( api );
+		return;
+	}
+
+	test_stub_expire( );
+
+	pthread_mutex_lock( &test_stub.lock );
+	test_stub.login_delay_ms = 200;
+	pthread_mutex_unlock( &test_stub.lock );
+
+	namecom_api_request_t* hello = namecom_api_submit_hello( api, NULL, NULL );
+
+	/* Run until the refusal has queued the login next to the hello. */
+	while( hello && namecom_api_pending( api ) == 1 && namecom_api_run( api, 10 ) > 0 )
+	{
+	}
+
+	if( !hello || namecom_api_pending( api ) < 2 )
+	{
+		test_fail( "The hello did not queue a login." );
+	}
+
+	pthread_create( &thread, NULL, test_parked_hello, api );
+
+	if( !namecom_api_login( api ) )
+	{
+		test_fail( "Logging in while a login was queued on this thread's transport failed." );
+	}
+
+	if( hello && !namecom_api_wait( api, hello ) )
+	{
+		test_fail( "The refused hello failed after the login." );
+	}
+
+	pthread_join( thread, NULL );
+
+	pthread_mutex_lock( &test_stub.lock );
+	test_stub.login_delay_ms = 0;
+	pthread_mutex_unlock( &test_stub.lock );
+
+	printf( "login on the creating thread's transport: done\n" );
+
+	namecom_api_request_destroy( hello );
+	namecom_api_logout( api );
+	namecom_api_destroy( api );
+}
+
+/*
+ * Part three: the threads warm up, the allocation counter is read while
+ * they wait at a barrier, and then they keep going with no allocations.
+ */
+typedef struct test_steady {
+	namecom_api_t* api;
+	pthread_barrier_t barrier;
+} test_steady_t;
+
+static void test_steady_round( namecom_api_t* api )
+{
+	namecom_record_set_t* set = namecom_api_dns_record_set( api, TEST_DOMAIN );
+	long id = -1;
+
+	if( !set || namecom_record_set_count( set ) != TEST_RECORDS )
+	{
+		test_fail( "A listing failed." );
+	}
+
+	namecom_record_set_destroy( set );
+
+	if( !namecom_api_hello( api ) )
+	{
+		test_fail( "A hello failed." );
+	}
+
+	if( !namecom_api_dns_record_add( api, TEST_DOMAIN, "steady", "A", "10.0.1.2", 300, 10, &id ) ||
+	    !namecom_api_dns_record_remove( api, TEST_DOMAIN, id ) )
+	{
+		test_fail( "A record change failed." );
+	}
+}
+
+static void* test_steady_worker( void* arg )
+{
+	test_steady_t* steady = arg;
+
+	for( int i = 0; i < TEST_WARMUP; i++ )
+	{
+		test_steady_round( steady->api );
+	}
+
+	/* The counter is read between these two. */
+	pthread_barrier_wait( &steady->barrier );
+	pthread_barrier_wait( &steady->barrier );
+
+	for( int i = 0; i < TEST_STEADY; i++ )
+	{
+		test_steady_round( steady->api );
+	}
+
+	return NULL;
+}
+
+static void test_steady_state( void )
+{
+	test_steady_t steady = { namecom_api_create( "user", "token", true, false ) };
+	pthread_t threads[ TEST_THREADS ];
+	namecom_api_connection_stats_t warm;
+	namecom_api_connection_stats_t stats;
+
+	if( !steady.api || !namecom_api_login( steady.api ) )
+	{
+		test_fail( "Unable to log in." );
+		if( steady.api ) namecom_api_destroy( steady.api );
+		return;
+	}
+
+	pthread_barrier_init( &steady.barrier, NULL, TEST_THREADS + 1 );
+
+	for( int i = 0; i < TEST_THREADS; i++ )
+	{
+		pthread_create( &threads[ i ], NULL, test_steady_worker, &steady );
+	}
+
+	pthread_barrier_wait( &steady.barrier );
+	namecom_api_connection_stats( steady.api, &warm );
+	pthread_barrier_wait( &steady.barrier );
+
+	for( int i = 0; i < TEST_THREADS; i++ )
+	{
+		pthread_join( threads[ i ], NULL );
+	}
+
+	namecom_api_connection_stats( steady.api, &stats );
+
+	printf( "steady state: %lu allocations after %lu requests, %lu after %lu\n",
+	        warm.transport_allocations, warm.requests, stats.transport_allocations, stats.requests );
+
+	if( stats.transport_allocations > warm.transport_allocations )
+	{
+		test_fail( "Requests allocated once the threads had warmed up." );
+	}
+
+	pthread_barrier_destroy( &steady.barrier );
+	namecom_api_logout( steady.api );
+	namecom_api_destroy( steady.api );
+}
+
+int main( void )
+{
+	alarm( TEST_TIMEOUT_S );
+	curl_global_init( CURL_GLOBAL_DEFAULT );
+
+	if( !test_stub_start( ) )
+	{
+		return 1;
+	}
+
+	test_shared_handle( );
+	test_login_on_own_transport( );
+	test_steady_state( );
+
+	curl_global_cleanup( );
+
+	if( test_failures )
+	{
+		fprintf( stderr, "[ERROR] %lu checks failed.\n", test_failures );
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,781 @@
+/*
+ * Copyright (C) 2016-2025 by Joseph A. Marrero. http://www.joemarrero.com/
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+/*
+ * Differential test for the record decoder.  The same randomized
+ * listings are decoded by each build of the decoder (scalar, SSE2, AVX2
+ * and jansson only; see the test target in the Makefile), and every build
+ * must produce the records the generator put in, whether a listing is fed
+ * whole, split in two at every byte, or one byte at a time.  The decoded
+ * records are also dumped so that the builds can be compared with each
+ * other byte for byte.
+ *
+ * The listings cover escapes of every kind, \uXXXX surrogate pairs,
+ * nested values (which take the jansson path even in the flat builds),
+ * non-string scalars, duplicate and escaped keys within records, and
+ * decoys that look like records or results but sit deeper in the
+ * document.  The top level keys are always spelled plainly, as the
+ * scanner matches them without unescaping.
+ *
+ *     record_decoder_test [dump file]
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <string.h>
+#include "namecom_record_decoder.h"
+#include "namecom_record_set.h"
+
+#define TEST_LISTINGS     200
+#define TEST_MAX_RECORDS  5
+#define TEST_SEED         0x9E3779B97F4A7C15ULL
+
+typedef struct test_text {
+	char* data;
+	size_t len;
+	size_t capacity;
+} test_text_t;
+
+typedef struct test_record {
+	long id;
+	int ttl;
+	char* fqdn;
+	char* type;
+	char* content;
+	char* create_date;
+} test_record_t;
+
+typedef struct test_listing {
+	test_text_t json;
+	int code;
+	size_t count;
+	test_record_t records[ TEST_MAX_RECORDS ];
+} test_listing_t;
+
+static uint64_t test_state = TEST_SEED;
+static unsigned long test_failures = 0;
+
+static uint32_t test_below( uint32_t n )
+{
+	/* xorshift64* */
+	test_state ^= test_state >> 12;
+	test_state ^= test_state << 25;
+	test_state ^= test_state >> 27;
+	return (uint32_t) ((test_state * 0x2545F4914F6CDD1DULL) >> 32) % n;
+}
+
+static void test_put( test_text_t* text, const char* data, size_t len )
+{
+	if( text->len + len + 1 > text->capacity )
+	{
+		text->capacity = (text->len + len + 1) * 2;
+		text->data     = realloc( text->data, text->capacity );
+
+		if( !text->data )
+		{
+			fprintf( stderr, "[ERROR] Out of memory.\n" );
+			exit( 1 );
+		}
+	}
+
+	memcpy( text->data + text->len, data, len );
+	text->len += len;
+	text->data[ text->len ] = '\0';
+}
+
+static void test_puts( test_text_t* text, const char* s )
+{
+	test_put( text, s, strlen(s) );
+}
+
+static void test_printf( test_text_t* text, const char* format, ... )
+{
+	char buffer[ 64 ];
+	va_list args;
+
+	va_start( args, format );
+	int len = vsnprintf( buffer, sizeof(buffer), format, args );
+	va_end( args );
+
+	test_put( text, buffer, (size_t) len );
+}
+
+static char* test_take( test_text_t* text )
+{
+	char* data = text->data ? text->data : calloc( 1, 1 );
+	memset( text, 0, sizeof(test_text_t) );
+	return data;
+}
+
+static void test_space( test_text_t* json )
+{
+	static const char space[] = { ' ', '\t', '\n', '\r' };
+
+	while( test_below( 4 ) == 0 )
+	{
+		test_put( json, &space[ test_below( 4 ) ], 1 );
+	}
+}
+
+static void test_utf8( test_text_t* text, uint32_t cp )
+{
+	char bytes[ 4 ];
+	size_t n = 0;
+
+	if( cp < 0x80 )
+	{
+		bytes[ n++ ] = (char) cp;
+	}
+	else if( cp < 0x800 )
+	{
+		bytes[ n++ ] = (char) (0xC0 | (cp >> 6));
+		bytes[ n++ ] = (char) (0x80 | (cp & 0x3F));
+	}
+	else if( cp < 0x10000 )
+	{
+		bytes[ n++ ] = (char) (0xE0 | (cp >> 12));
+		bytes[ n++ ] = (char) (0x80 | ((cp >> 6) & 0x3F));
+		bytes[ n++ ] = (char) (0x80 | (cp & 0x3F));
+	}
+	else
+	{
+		bytes[ n++ ] = (char) (0xF0 | (cp >> 18));
+		bytes[ n++ ] = (char) (0x80 | ((cp >> 12) & 0x3F));
+		bytes[ n++ ] = (char) (0x80 | ((cp >> 6) & 0x3F));
+		bytes[ n++ ] = (char) (0x80 | (cp & 0x3F));
+	}
+
+	test_put( text, bytes, n );
+}
+
+static void test_escape_u( test_text_t* json, uint32_t unit )
+{
+	test_printf( json, test_below( 2 ) ? "\\u%04x" : "\\u%04X", (unsigned int) unit );
+}
+
+/*
+ * Writes one code point into a JSON string, picking at random between
+ * every way it can be spelled.
+ */
+static void test_encode( test_text_t* json, uint32_t cp )
+{
+	static const char shorts[] = { '\b', 'b', '\f', 'f', '\n', 'n', '\r', 'r', '\t', 't', '"', '"', '\\', '\\', '/', '/' };
+
+	for( size_t i = 0; i < sizeof(shorts); i += 2 )
+	{
+		if( (uint32_t) shorts[ i ] == cp && test_below( 2 ) )
+		{
+			char escape[ 2 ] = { '\\', shorts[ i + 1 ] };
+			test_put( json, escape, 2 );
+			return;
+		}
+	}
+
+	if( cp < 0x20 || cp == '"' || cp == '\\' || test_below( 8 ) == 0 )
+	{
+		if( cp < 0x10000 )
+		{
+			test_escape_u( json, cp );
+		}
+		else
+		{
+			test_escape_u( json, 0xD800 + ((cp - 0x10000) >> 10) );
+			test_escape_u( json, 0xDC00 + ((cp - 0x10000) & 0x3FF) );
+		}
+		return;
+	}
+
+	test_utf8( json, cp );
+}
+
+static uint32_t test_codepoint( void )
+{
+	switch( test_below( 10 ) )
+	{
+		case 0:  return 1 + test_below( 0x1F );
+		case 1:  return "\"\\/{}[]:,"[ test_below( 9 ) ];
+		case 2:  return 0x80 + test_below( 0x800 - 0x80 );
+		case 3:
+		{
+			uint32_t cp = 0x800 + test_below( 0x10000 - 0x800 - 0x800 );
+			return cp >= 0xD800 ? cp + 0x800 : cp;
+		}
+		case 4:  return 0x10000 + test_below( 0x110000 - 0x10000 );
+		default: return 0x20 + test_below( 0x7F - 0x20 );
+	}
+}
+
+/*
+ * Appends a random JSON string to json and its decoded form to text.
+ */
+static void test_string( test_text_t* json, test_text_t* text )
+{
+	size_t len = test_below( 12 );
+
+	test_put( json, "\"", 1 );
+
+	for( size_t i = 0; i < len; i++ )
+	{
+		uint32_t cp = test_codepoint( );
+		test_encode( json, cp );
+		if( text ) test_utf8( text, cp );
+	}
+
+	test_put( json, "\"", 1 );
+}
+
+/*
+ * Appends a known string (a key, or the text of a field) with random
+ * spellings of its characters.
+ */
+static void test_literal( test_text_t* json, const char* literal )
+{
+	test_put( json, "\"", 1 );
+
+	for( const char* c = literal; *c; c++ )
+	{
+		test_encode( json, (unsigned char) *c );
+	}
+
+	test_put( json, "\"", 1 );
+}
+
+static void test_scalar( test_text_t* json )
+{
+	static const char* scalars[] = { "true", "false", "null", "0", "-7", "42", "5.5", "-0.25", "1e3", "2E-2", "12345678901" };
+	test_printf( json, "%s", scalars[ test_below( sizeof(scalars) / sizeof(scalars[0]) ) ] );
+}
+
+static void test_nested( test_text_t* json, int depth )
+{
+	int choice = depth < 3 ? test_below( 4 ) : 2 + test_below( 2 );
+
+	if( choice == 0 )
+	{
+		int members = test_below( 3 );
+		test_put( json, "{", 1 );
+		for( int i = 0; i < members; i++ )
+		{
+			if( i ) test_put( json, ",", 1 );
+			test_space( json );
+			test_literal( json, i % 2 ? "records" : "result" );
+			test_space( json );
+			test_put( json, ":", 1 );
+			test_space( json );
+			test_nested( json, depth + 1 );
+			test_space( json );
+		}
+		test_put( json, "}", 1 );
+	}
+	else if( choice == 1 )
+	{
+		int elements = test_below( 4 );
+		test_put( json, "[", 1 );
+		for( int i = 0; i < elements; i++ )
+		{
+			if( i ) test_put( json, ",", 1 );
+			test_space( json );
+			test_nested( json, depth + 1 );
+			test_space( json );
+		}
+		test_put( json, "]", 1 );
+	}
+	else if( choice == 2 )
+	{
+		test_string( json, NULL );
+	}
+	else
+	{
+		test_scalar( json );
+	}
+}
+
+/*
+ * The text fields only take strings; anything else reads as missing.
+ */
+static char* test_text_field( test_text_t* json, const char* field )
+{
+	static const char* types[] = { "A", "AAAA", "CNAME", "MX", "NS", "TXT", "SRV" };
+	test_text_t text = { 0 };
+
+	if( test_below( 4 ) == 0 )
+	{
+		test_scalar( json );
+		return NULL;
+	}
+	else if( strcmp( field, "type" ) == 0 && test_below( 5 ) )
+	{
+		const char* type = types[ test_below( sizeof(types) / sizeof(types[0]) ) ];
+		test_literal( json, type );
+		test_put( &text, type, strlen(type) );
+	}
+	else
+	{
+		test_string( json, &text );
+	}
+
+	return test_take( &text );
+}
+
+/*
+ * The numeric fields take a string or an integer; anything else reads
+ * as zero.
+ */
+static long test_number_field( test_text_t* json )
+{
+	char digits[ 16 ];
+	long value = (long) test_below( 100000 );
+
+	snprintf( digits, sizeof(digits), "%ld", value );
+
+	switch( test_below( 5 ) )
+	{
+		case 0:
+		case 1:
+			test_literal( json, digits );
+			return value;
+		case 2:
+		case 3:
+			test_printf( json, "%ld", value );
+			return value;
+		default:
+		{
+			static const char* others[] = { "true", "false", "null", "5.5", "1e3", "-0.0" };
+			test_printf( json, "%s", others[ test_below( sizeof(others) / sizeof(others[0]) ) ] );
+			return 0;
+		}
+	}
+}
+
+static void test_record( test_text_t* json, test_record_t* record )
+{
+	static const char* fields[] = { "record_id", "name", "type", "content", "ttl", "create_date", "priority", "extra" };
+	size_t order[ 8 ] = { 0, 1, 2, 3, 4, 5, 6, 7 };
+	bool first = true;
+
+	memset( record, 0, sizeof(test_record_t) );
+
+	for( size_t i = 7; i > 0; i-- )
+	{
+		size_t j = test_below( (uint32_t) i + 1 );
+		size_t t = order[ i ]; order[ i ] = order[ j ]; order[ j ] = t;
+	}
+
+	test_put( json, "{", 1 );
+
+	for( size_t i = 0; i < 8; i++ )
+	{
+		const char* field = fields[ order[ i ] ];
+		/* Duplicated keys are decoded as the last one seen. */
+		int copies = test_below( 8 ) == 0 ? 0 : test_below( 12 ) == 0 ? 2 : 1;
+
+		for( int copy = 0; copy < copies; copy++ )
+		{
+			if( !first ) test_put( json, ",", 1 );
+			first = false;
+
+			test_space( json );
+			test_literal( json, field );
+			test_space( json );
+			test_put( json, ":", 1 );
+			test_space( json );
+
+			switch( order[ i ] )
+			{
+				case 0: record->id = test_number_field( json ); break;
+				case 1: free( record->fqdn ); record->fqdn = test_text_field( json, field ); break;
+				case 2: free( record->type ); record->type = test_text_field( json, field ); break;
+				case 3: free( record->content ); record->content = test_text_field( json, field ); break;
+				case 4: record->ttl = (int) test_number_field( json ); break;
+				case 5: free( record->create_date ); record->create_date = test_text_field( json, field ); break;
+				case 6: test_scalar( json ); break;
+				default:
+					/* A nested value sends the record down the jansson path. */
+					if( test_below( 3 ) == 0 ) test_nested( json, 1 );
+					else test_string( json, NULL );
+					break;
+			}
+
+			test_space( json );
+		}
+	}
+
+	test_put( json, "}", 1 );
+}
+
+static void test_listing( test_listing_t* listing )
+{
+	bool records_first = test_below( 2 );
+
+	memset( listing, 0, sizeof(test_listing_t) );
+	listing->code  = test_below( 4 ) ? 100 : 200 + (int) test_below( 100 );
+	listing->count = test_below( TEST_MAX_RECORDS + 1 );
+
+	test_space( &listing->json );
+	test_put( &listing->json, "{", 1 );
+
+	for( int part = 0; part < 2; part++ )
+	{
+		if( part ) test_put( &listing->json, ",", 1 );
+		test_space( &listing->json );
+
+		if( (part == 0) == records_first )
+		{
+			test_puts( &listing->json, "\"records\"" );
+			test_space( &listing->json );
+			test_put( &listing->json, ":", 1 );
+			test_space( &listing->json );
+			test_put( &listing->json, "[", 1 );
+
+			for( size_t i = 0; i < listing->count; i++ )
+			{
+				if( i ) test_put( &listing->json, ",", 1 );
+				test_space( &listing->json );
+				test_record( &listing->json, &listing->records[ i ] );
+				test_space( &listing->json );
+			}
+
+			test_put( &listing->json, "]", 1 );
+		}
+		else
+		{
+			test_puts( &listing->json, "\"result\"" );
+			test_space( &listing->json );
+			test_put( &listing->json, ":", 1 );
+			test_space( &listing->json );
+			test_printf( &listing->json, "{\"code\":%d,\"message\":", listing->code );
+			test_string( &listing->json, NULL );
+			test_put( &listing->json, "}", 1 );
+		}
+
+		test_space( &listing->json );
+	}
+
+	/* Decoys below the top level must be left alone. */
+	if( test_below( 2 ) )
+	{
+		test_put( &listing->json, ",", 1 );
+		test_literal( &listing->json, "meta" );
+		test_puts( &listing->json, ":{\"records\":[{\"record_id\":\"1\",\"name\":\"decoy\"}],\"result\":{\"code\":999},\"note\":\"records:[{\\\"a\\\":1}]\"}" );
+	}
+
+	test_put( &listing->json, "}", 1 );
+	test_space( &listing->json );
+}
+
+static void test_listing_free( test_listing_t* listing )
+{
+	for( size_t i = 0; i < listing->count; i++ )
+	{
+		free( listing->records[ i ].fqdn );
+		free( listing->records[ i ].type );
+		free( listing->records[ i ].content );
+		free( listing->records[ i ].create_date );
+	}
+
+	free( listing->json.data );
+}
+
+static bool test_same( const char* a, const char* b )
+{
+	return a == b || (a && b && strcmp( a, b ) == 0);
+}
+
+static void test_fail( int listing, const char* how, const char* what )
+{
+	if( test_failures++ < 20 )
+	{
+		fprintf( stderr, "[ERROR] Listing %d, %s: %s\n", listing, how, what );
+	}
+}
+
+/*
+ * Feeds the listing in pieces that end at the given offsets (the last
+ * piece runs to the end) and checks the decoded set against what the
+ * generator expects.
+ */
+static void test_decode( int index, const test_listing_t* listing, const size_t* cuts, size_t cut_count, const char* how, test_text_t* dump )
+{
+	namecom_record_set_t* set         = namecom_record_set_create( 0 );
+	namecom_record_decoder_t* decoder = namecom_record_decoder_create( NULL, NULL );
+	size_t offset = 0;
+
+	if( !set || !decoder )
+	{
+		fprintf( stderr, "[ERROR] Out of memory.\n" );
+		exit( 1 );
+	}
+
+	namecom_record_decoder_collect( decoder, set );
+
+	for( size_t i = 0; i <= cut_count; i++ )
+	{
+		size_t cut = i < cut_count ? cuts[ i ] : listing->json.len;
+
+		if( !namecom_record_decoder_feed( decoder, listing->json.data + offset, cut - offset ) )
+		{
+			break;
+		}
+
+		offset = cut;
+	}
+
+	if( !namecom_record_decoder_finish( decoder ) )
+	{
+		test_fail( index, how, namecom_record_decoder_error_string( namecom_record_decoder_error( decoder ) ) );
+	}
+	else if( namecom_record_decoder_result_code( decoder ) != listing->code )
+	{
+		test_fail( index, how, "wrong result code" );
+	}
+	else if( namecom_record_set_count( set ) != listing->count || namecom_record_decoder_count( decoder ) != listing->count )
+	{
+		test_fail( index, how, "wrong number of records" );
+	}
+	else
+	{
+		for( size_t i = 0; i < listing->count; i++ )
+		{
+			const test_record_t* expected = &listing->records[ i ];
+
+			if( namecom_record_set_id( set, i ) != expected->id ||
+			    namecom_record_set_ttl( set, i ) != expected->ttl ||
+			    !test_same( namecom_record_set_fqdn( set, i ), expected->fqdn ) ||
+			    !test_same( namecom_record_set_type_name( set, i ), expected->type ) ||
+			    namecom_record_set_type( set, i ) != namecom_record_type_parse( expected->type ) ||
+			    !test_same( namecom_record_set_content( set, i ), expected->content ) ||
+			    !test_same( namecom_record_set_create_date( set, i ), expected->create_date ) )
+			{
+				test_fail( index, how, "records differ" );
+				break;
+			}
+		}
+	}
+
+	if( dump )
+	{
+		const char* fields[ 4 ];
+
+		test_printf( dump, "listing %d code %d count %zu\n", index, namecom_record_decoder_result_code( decoder ), namecom_record_set_count( set ) );
+
+		for( size_t i = 0; i < namecom_record_set_count( set ); i++ )
+		{
+			test_printf( dump, "%ld %d %d", namecom_record_set_id( set, i ), namecom_record_set_ttl( set, i ), (int) namecom_record_set_type( set, i ) );
+
+			fields[ 0 ] = namecom_record_set_fqdn( set, i );
+			fields[ 1 ] = namecom_record_set_type_name( set, i );
+			fields[ 2 ] = namecom_record_set_content( set, i );
+			fields[ 3 ] = namecom_record_set_create_date( set, i );
+
+			for( int f = 0; f < 4; f++ )
+			{
+				if( !fields[ f ] )
+				{
+					test_put( dump, " -", 2 );
+					continue;
+				}
+
+				test_put( dump, " \"", 2 );
+				for( const unsigned char* c = (const unsigned char*) fields[ f ]; *c; c++ )
+				{
+					test_printf( dump, "%02x", *c );
+				}
+				test_put( dump, "\"", 1 );
+			}
+
+			test_put( dump, "\n", 1 );
+		}
+	}
+
+	namecom_record_decoder_destroy( decoder );
+	namecom_record_set_destroy( set );
+}
+
+static bool test_on_record( namecom_api_dns_record_t* record, void* user_data )
+{
+	size_t* seen = user_data;
+
+	*seen += 1;
+	namecom_api_dns_record_destroy( record );
+
+	/* Ask to stop after the first record. */
+	return false;
+}
+
+/*
+ * Documents that should fail, and how.
+ */
+static void test_errors( void )
+{
+	static const struct {
+		const char* json;
+		namecom_record_decoder_error_t error;
+	} cases[] = {
+		{ "[{\"records\":[]}]",                                       NAMECOM_RECORD_DECODER_ERROR_MALFORMED },
+		{ "{\"records\":[{\"name\":tru}]}",                           NAMECOM_RECORD_DECODER_ERROR_MALFORMED },
+		{ "{\"records\":[{\"name\":\"a\tb\"}]}",                      NAMECOM_RECORD_DECODER_ERROR_MALFORMED },
+		{ "{\"records\":[{\"name\":\"\\ud800\"}]}",                   NAMECOM_RECORD_DECODER_ERROR_MALFORMED },
+		{ "{\"records\":[{\"name\":\"\\q\"}]}",                       NAMECOM_RECORD_DECODER_ERROR_MALFORMED },
+		{ "{\"records\":[{\"name\":\"a\"",                            NAMECOM_RECORD_DECODER_ERROR_TRUNCATED },
+		{ "{\"records\":[{\"name\":\"a\"},{\"name\":\"b\"}]}",        NAMECOM_RECORD_DECODER_ERROR_STOPPED },
+	};
+
+	for( size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++ )
+	{
+		size_t seen = 0;
+		namecom_record_decoder_t* decoder = namecom_record_decoder_create( test_on_record, &seen );
+
+		if( !decoder )
+		{
+			fprintf( stderr, "[ERROR] Out of memory.\n" );
+			exit( 1 );
+		}
+
+		bool fed      = namecom_record_decoder_feed( decoder, cases[ i ].json, strlen( cases[ i ].json ) );
+		bool finished = namecom_record_decoder_finish( decoder );
+
+		if( finished || fed != (cases[ i ].error == NAMECOM_RECORD_DECODER_ERROR_TRUNCATED) ||
+		    namecom_record_decoder_error( decoder ) != cases[ i ].error ||
+		    (cases[ i ].error == NAMECOM_RECORD_DECODER_ERROR_STOPPED && seen != 1) )
+		{
+			test_fail( (int) i, "error case", cases[ i ].json );
+		}
+
+		namecom_record_decoder_destroy( decoder );
+	}
+}
+
+/*
+ * Pins down how values of the wrong kind are read, on both paths: the
+ * second record is nested and so is decoded by jansson.
+ */
+static void test_scalars( void )
+{
+	static const char* json =
+		"{\"result\":{\"code\":100},\"records\":["
+		"{\"record_id\":7,\"name\":5,\"type\":null,\"content\":true,\"ttl\":5.5,\"create_date\":false},"
+		"{\"record_id\":7,\"name\":5,\"type\":null,\"content\":true,\"ttl\":5.5,\"create_date\":false,\"x\":[1]},"
+		"{\"record_id\":\"12\",\"name\":\"a\",\"type\":\"A\",\"content\":\"\\ud83d\\ude00\",\"ttl\":\"300\"}"
+		"]}";
+	namecom_record_set_t* set         = namecom_record_set_create( 0 );
+	namecom_record_decoder_t* decoder = namecom_record_decoder_create( NULL, NULL );
+
+	if( !set || !decoder )
+	{
+		fprintf( stderr, "[ERROR] Out of memory.\n" );
+		exit( 1 );
+	}
+
+	namecom_record_decoder_collect( decoder, set );
+	namecom_record_decoder_feed( decoder, json, strlen(json) );
+
+	if( !namecom_record_decoder_finish( decoder ) || namecom_record_set_count( set ) != 3 )
+	{
+		test_fail( 0, "scalars", "not decoded" );
+	}
+	else
+	{
+		for( size_t i = 0; i < 2; i++ )
+		{
+			if( namecom_record_set_id( set, i ) != 7 || namecom_record_set_ttl( set, i ) != 0 ||
+			    namecom_record_set_fqdn( set, i ) || namecom_record_set_type_name( set, i ) ||
+			    namecom_record_set_content( set, i ) || namecom_record_set_create_date( set, i ) )
+			{
+				test_fail( (int) i, "scalars", "non-string values should read as missing" );
+			}
+		}
+
+		if( namecom_record_set_id( set, 2 ) != 12 || namecom_record_set_ttl( set, 2 ) != 300 ||
+		    !test_same( namecom_record_set_content( set, 2 ), "\xF0\x9F\x98\x80" ) )
+		{
+			test_fail( 2, "scalars", "strings decoded wrongly" );
+		}
+	}
+
+	namecom_record_decoder_destroy( decoder );
+	namecom_record_set_destroy( set );
+}
+
+int main( int argc, char* argv[] )
+{
+	test_text_t dump = { 0 };
+	unsigned long decodes = 0;
+
+	test_errors( );
+	test_scalars( );
+
+	for( int i = 0; i < TEST_LISTINGS; i++ )
+	{
+		test_listing_t listing;
+		size_t len;
+
+		test_listing( &listing );
+		len = listing.json.len;
+
+		test_decode( i, &listing, NULL, 0, "whole", &dump );
+		decodes += 1;
+
+		for( size_t cut = 0; cut <= len; cut++ )
+		{
+			char how[ 32 ];
+			snprintf( how, sizeof(how), "split at %zu", cut );
+			test_decode( i, &listing, &cut, 1, how, NULL );
+			decodes += 1;
+		}
+
+		size_t* cuts = malloc( sizeof(size_t) * (len + 1) );
+
+		if( cuts )
+		{
+			for( size_t cut = 0; cut < len; cut++ ) cuts[ cut ] = cut + 1;
+			test_decode( i, &listing, cuts, len, "byte by byte", NULL );
+			decodes += 1;
+			free( cuts );
+		}
+
+		test_listing_free( &listing );
+	}
+
+	if( argc > 1 )
+	{
+		FILE* file = fopen( argv[ 1 ], "wb" );
+
+		if( !file || fwrite( dump.data, 1, dump.len, file ) != dump.len )
+		{
+			fprintf( stderr, "[ERROR] Unable to write %s.\n", argv[ 1 ] );
+			test_failures += 1;
+		}
+
+		if( file ) fclose( file );
+	}
+
+	free( dump.data );
+
+	if( test_failures )
+	{
+		fprintf( stderr, "[ERROR] %lu checks failed.\n", test_failures );
+		return 1;
+	}
+
+	printf( "%d listings decoded %lu ways, all matching.\n", TEST_LISTINGS, decodes );
+	return 0;
+}
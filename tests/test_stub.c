@@ -0,0 +1,739 @@
+/*
+ * Copyright (C) 2016-2025 by Joseph A. Marrero. http://www.joemarrero.com/
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#ifdef TEST_STUB_TLS
+#include <openssl/ssl.h>
+#include <openssl/pem.h>
+#include <openssl/x509v3.h>
+#endif
+#include "test_stub.h"
+
+test_stub_t test_stub = { .lock = PTHREAD_MUTEX_INITIALIZER, .valid_from = 1, .next_record_id = 1000 };
+
+long long test_stub_now_ms( void )
+{
+	struct timespec now;
+	clock_gettime( CLOCK_MONOTONIC, &now );
+	return (long long) now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+static void test_stub_sleep_ms( int delay_ms )
+{
+	struct timespec delay = { delay_ms / 1000, (delay_ms % 1000) * 1000000L };
+	nanosleep( &delay, NULL );
+}
+
+void test_stub_expire( void )
+{
+	pthread_mutex_lock( &test_stub.lock );
+	test_stub.valid_from = test_stub.sessions + 1;
+	pthread_mutex_unlock( &test_stub.lock );
+}
+
+/*
+ * Drops the rules and the log of arrivals.  Sessions stay valid.
+ */
+void test_stub_reset( void )
+{
+	pthread_mutex_lock( &test_stub.lock );
+	test_stub.rule_count    = 0;
+	test_stub.arrival_count = 0;
+	test_stub.max_active    = test_stub.active;
+	pthread_mutex_unlock( &test_stub.lock );
+}
+
+/*
+ * Scripts the answers to the next count requests whose path starts with
+ * path: each is held for delay_ms and then, unless status is 0, answered
+ * with that status and result code (and a Retry-After if retry_after_s
+ * isn't 0) instead of as usual.  Rules apply in the order they were
+ * pushed; a request takes the first one left for its path.
+ */
+void test_stub_push( const char* path, int count, int delay_ms, int status, int code, int retry_after_s )
+{
+	pthread_mutex_lock( &test_stub.lock );
+
+	if( test_stub.rule_count < TEST_STUB_RULES )
+	{
+		test_stub_rule_t* rule = &test_stub.rules[ test_stub.rule_count++ ];
+
+		snprintf( rule->path, sizeof(rule->path), "%s", path );
+		rule->count         = count;
+		rule->delay_ms      = delay_ms;
+		rule->status        = status;
+		rule->code          = code;
+		rule->retry_after_s = retry_after_s;
+	}
+
+	pthread_mutex_unlock( &test_stub.lock );
+}
+
+/*
+ * The requests that arrived for paths starting with path.
+ */
+size_t test_stub_count( const char* path )
+{
+	return test_stub_arrivals( path, NULL, 0 );
+}
+
+/*
+ * Copies up to max of the times at which requests for paths starting
+ * with path arrived, in order, and returns how many there were.
+ */
+size_t test_stub_arrivals( const char* path, long long* at_ms, size_t max )
+{
+	size_t count = 0;
+
+	pthread_mutex_lock( &test_stub.lock );
+
+	for( size_t i = 0; i < test_stub.arrival_count; i++ )
+	{
+		if( strncmp( test_stub.arrivals[ i ].path, path, strlen(path) ) == 0 )
+		{
+			if( count < max ) at_ms[ count ] = test_stub.arrivals[ i ].at_ms;
+			count += 1;
+		}
+	}
+
+	pthread_mutex_unlock( &test_stub.lock );
+
+	return count;
+}
+
+/*
+ * The most requests answered at once since the last reset.
+ */
+int test_stub_max_active( void )
+{
+	pthread_mutex_lock( &test_stub.lock );
+	int max_active = test_stub.max_active;
+	pthread_mutex_unlock( &test_stub.lock );
+
+	return max_active;
+}
+
+static const char* test_stub_reason( int status )
+{
+	switch( status )
+	{
+		case 200: return "OK";
+		case 404: return "Not Found";
+		case 405: return "Method Not Allowed";
+		case 429: return "Too Many Requests";
+		case 500: return "Internal Server Error";
+		case 501: return "Not Implemented";
+		case 503: return "Service Unavailable";
+		default:  return "Unknown";
+	}
+}
+
+/*
+ * A connection, with its TLS session when the stub is built with
+ * TEST_STUB_TLS.
+ */
+typedef struct test_stub_conn {
+	int fd;
+#ifdef TEST_STUB_TLS
+	SSL* ssl;
+#endif
+} test_stub_conn_t;
+
+static ssize_t test_stub_read( test_stub_conn_t* conn, void* buffer, size_t len )
+{
+#ifdef TEST_STUB_TLS
+	return SSL_read( conn->ssl, buffer, (int) len );
+#else
+	return recv( conn->fd, buffer, len, 0 );
+#endif
+}
+
+static bool test_stub_write( test_stub_conn_t* conn, const void* buffer, size_t len )
+{
+#ifdef TEST_STUB_TLS
+	return len == 0 || SSL_write( conn->ssl, buffer, (int) len ) == (int) len;
+#else
+	return send( conn->fd, buffer, len, MSG_NOSIGNAL ) == (ssize_t) len;
+#endif
+}
+
+static bool test_stub_send( test_stub_conn_t* conn, int status, int retry_after_s, const char* body )
+{
+	char head[ 256 ];
+	char retry_after[ 32 ] = "";
+	size_t body_len = strlen( body );
+
+	if( retry_after_s > 0 )
+	{
+		snprintf( retry_after, sizeof(retry_after), "Retry-After: %d\r\n", retry_after_s );
+	}
+
+	int head_len = snprintf( head, sizeof(head), "HTTP/1.1 %d %s\r\nContent-Type: application/json\r\n%sContent-Length: %zu\r\n\r\n",
+	                         status, test_stub_reason( status ), retry_after, body_len );
+
+	return test_stub_write( conn, head, head_len ) &&
+	       test_stub_write( conn, body, body_len );
+}
+
+/*
+ * Logs the request and takes the rule that applies to it, if any.
+ * Called with the lock held.
+ */
+static bool test_stub_arrive( const char* path, test_stub_rule_t* rule )
+{
+	if( test_stub.arrival_count < TEST_STUB_ARRIVALS )
+	{
+		test_stub_arrival_t* arrival = &test_stub.arrivals[ test_stub.arrival_count++ ];
+		snprintf( arrival->path, sizeof(arrival->path), "%s", path );
+		arrival->at_ms = test_stub_now_ms();
+	}
+
+	for( size_t i = 0; i < test_stub.rule_count; i++ )
+	{
+		test_stub_rule_t* candidate = &test_stub.rules[ i ];
+
+		if( candidate->count > 0 && strncmp( path, candidate->path, strlen(candidate->path) ) == 0 )
+		{
+			candidate->count -= 1;
+			*rule = *candidate;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static bool test_stub_respond( test_stub_conn_t* conn, const char* method, const char* path, const char* token )
+{
+	static const char ok[] = "\"result\":{\"code\":100,\"message\":\"Command Successful\"}";
+	char body[ 1024 ];
+	test_stub_rule_t rule;
+
+	(void) method;
+	pthread_mutex_lock( &test_stub.lock );
+
+	if( test_stub_arrive( path, &rule ) )
+	{
+		pthread_mutex_unlock( &test_stub.lock );
+
+		if( rule.delay_ms > 0 )
+		{
+			test_stub_sleep_ms( rule.delay_ms );
+		}
+
+		if( rule.status != 0 )
+		{
+			snprintf( body, sizeof(body), "{\"result\":{\"code\":%d,\"message\":\"Scripted\"}}", rule.code );
+			return test_stub_send( conn, rule.status, rule.retry_after_s, body );
+		}
+
+		pthread_mutex_lock( &test_stub.lock );
+	}
+
+	if( strcmp( path, "/api/login" ) == 0 )
+	{
+		unsigned long session = ++test_stub.sessions;
+		int delay_ms = test_stub.login_delay_ms;
+		test_stub.logins += 1;
+		pthread_mutex_unlock( &test_stub.lock );
+
+		if( delay_ms > 0 )
+		{
+			test_stub_sleep_ms( delay_ms );
+		}
+
+		snprintf( body, sizeof(body), "{%s,\"session_token\":\"session%lu\"}", ok, session );
+		return test_stub_send( conn, 200, 0, body );
+	}
+
+	if( token && (strncmp( token, "session", 7 ) != 0 || strtoul( token + 7, NULL, 10 ) < test_stub.valid_from) )
+	{
+		test_stub.refused += 1;
+		pthread_mutex_unlock( &test_stub.lock );
+		return test_stub_send( conn, 200, 0, "{\"result\":{\"code\":221,\"message\":\"Authorization Error\"}}" );
+	}
+
+	if( strcmp( path, "/api/hello" ) == 0 || strcmp( path, "/api/logout" ) == 0 ||
+	    strcmp( path, "/api/dns/delete/" TEST_STUB_DOMAIN ) == 0 )
+	{
+		snprintf( body, sizeof(body), "{%s}", ok );
+	}
+	else if( strcmp( path, "/api/dns/create/" TEST_STUB_DOMAIN ) == 0 )
+	{
+		snprintf( body, sizeof(body), "{%s,\"record_id\":%lu}", ok, test_stub.next_record_id++ );
+	}
+	else if( strcmp( path, "/api/dns/update/" TEST_STUB_DOMAIN ) == 0 )
+	{
+		snprintf( body, sizeof(body), "{%s,\"record_id\":1}", ok );
+	}
+	else if( strcmp( path, "/api/dns/list/" TEST_STUB_DOMAIN ) == 0 )
+	{
+		/* The second octet tells the listings apart. */
+		unsigned long listing = ++test_stub.listings % 256;
+		int len = snprintf( body, sizeof(body), "{%s,\"records\":[", ok );
+
+		for( int i = 0; i < TEST_STUB_RECORDS; i++ )
+		{
+			len += snprintf( body + len, sizeof(body) - len,
+			                 "%s{\"record_id\":\"%d\",\"name\":\"h%d." TEST_STUB_DOMAIN "\",\"type\":\"A\",\"content\":\"10.%lu.0.%d\",\"ttl\":\"300\",\"create_date\":\"2016-01-01 00:00:00\"}",
+			                 i ? "," : "", i + 1, i, listing, i + 1 );
+		}
+
+		snprintf( body + len, sizeof(body) - len, "]}" );
+	}
+	else
+	{
+		pthread_mutex_unlock( &test_stub.lock );
+		return test_stub_send( conn, 404, 0, "{\"result\":{\"code\":211,\"message\":\"Invalid Command URL\"}}" );
+	}
+
+	pthread_mutex_unlock( &test_stub.lock );
+	return test_stub_send( conn, 200, 0, body );
+}
+
+/*
+ * HTTP/2, for connections that open with its preface.  The
+ * stub doesn't decode the header blocks (HPACK), so it can't tell the
+ * paths apart: every stream is answered 200 with a body that passes for
+ * any of the API's answers, and rules, sessions and the log don't apply.
+ * Frames are read and answered in order on the connection's thread.
+ */
+#define TEST_STUB_H2_PREFACE     "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n"
+#define TEST_STUB_H2_DATA          0x0
+#define TEST_STUB_H2_HEADERS       0x1
+#define TEST_STUB_H2_SETTINGS      0x4
+#define TEST_STUB_H2_PING          0x6
+#define TEST_STUB_H2_GOAWAY        0x7
+#define TEST_STUB_H2_WINDOW_UPDATE 0x8
+#define TEST_STUB_H2_END_STREAM    0x1
+#define TEST_STUB_H2_ACK           0x1
+#define TEST_STUB_H2_END_HEADERS   0x4
+
+static bool test_stub_h2_send( test_stub_conn_t* conn, int type, int flags, unsigned long stream, const void* payload, size_t len )
+{
+	unsigned char frame[ 9 + 256 ];
+
+	if( len > sizeof(frame) - 9 )
+	{
+		return false;
+	}
+
+	frame[ 0 ] = (unsigned char) (len >> 16);
+	frame[ 1 ] = (unsigned char) (len >> 8);
+	frame[ 2 ] = (unsigned char) len;
+	frame[ 3 ] = (unsigned char) type;
+	frame[ 4 ] = (unsigned char) flags;
+	frame[ 5 ] = (unsigned char) ((stream >> 24) & 0x7f);
+	frame[ 6 ] = (unsigned char) (stream >> 16);
+	frame[ 7 ] = (unsigned char) (stream >> 8);
+	frame[ 8 ] = (unsigned char) stream;
+	if( len > 0 ) memcpy( frame + 9, payload, len );
+
+	return test_stub_write( conn, frame, 9 + len );
+}
+
+/*
+ * Fills buffer with exactly len bytes, starting with the pending ones
+ * that were read ahead.
+ */
+static bool test_stub_h2_read( test_stub_conn_t* conn, unsigned char* buffer, size_t len, const char** pending, size_t* pending_len )
+{
+	size_t have = len < *pending_len ? len : *pending_len;
+
+	memcpy( buffer, *pending, have );
+	*pending     += have;
+	*pending_len -= have;
+
+	while( have < len )
+	{
+		ssize_t n = test_stub_read( conn, buffer + have, len - have );
+
+		if( n <= 0 )
+		{
+			return false;
+		}
+
+		have += n;
+	}
+
+	return true;
+}
+
+static void test_stub_h2_serve( test_stub_conn_t* conn, const char* pending, size_t pending_len )
+{
+	static const char body[] = "{\"result\":{\"code\":100,\"message\":\"Command Successful\"},\"session_token\":\"session1\",\"record_id\":1}";
+	static const unsigned char status_200[] = { 0x88 };   /* :status 200 from the static table */
+	static const unsigned char settings[] = { 0x00, 0x03, 0x00, 0x00, 0x03, 0xe8 };   /* at most 1000 streams */
+	unsigned char preface[ sizeof(TEST_STUB_H2_PREFACE) - 1 ];
+	unsigned char payload[ 16384 ];
+
+	if( !test_stub_h2_read( conn, preface, sizeof(preface), &pending, &pending_len ) ||
+	    memcmp( preface, TEST_STUB_H2_PREFACE, sizeof(preface) ) != 0 ||
+	    !test_stub_h2_send( conn, TEST_STUB_H2_SETTINGS, 0, 0, settings, sizeof(settings) ) )
+	{
+		return;
+	}
+
+	for( ;; )
+	{
+		unsigned char head[ 9 ];
+
+		if( !test_stub_h2_read( conn, head, sizeof(head), &pending, &pending_len ) )
+		{
+			return;
+		}
+
+		size_t len = ((size_t) head[ 0 ] << 16) | ((size_t) head[ 1 ] << 8) | head[ 2 ];
+		int type = head[ 3 ];
+		int flags = head[ 4 ];
+		unsigned long stream = ((unsigned long) (head[ 5 ] & 0x7f) << 24) | ((unsigned long) head[ 6 ] << 16) | ((unsigned long) head[ 7 ] << 8) | head[ 8 ];
+
+		if( len > sizeof(payload) || !test_stub_h2_read( conn, payload, len, &pending, &pending_len ) )
+		{
+			return;
+		}
+
+		bool answered = true;
+
+		switch( type )
+		{
+			case TEST_STUB_H2_SETTINGS:
+				if( !(flags & TEST_STUB_H2_ACK) )
+				{
+					answered = test_stub_h2_send( conn, TEST_STUB_H2_SETTINGS, TEST_STUB_H2_ACK, 0, NULL, 0 );
+				}
+				break;
+			case TEST_STUB_H2_PING:
+				if( !(flags & TEST_STUB_H2_ACK) )
+				{
+					answered = test_stub_h2_send( conn, TEST_STUB_H2_PING, TEST_STUB_H2_ACK, 0, payload, len );
+				}
+				break;
+			case TEST_STUB_H2_GOAWAY:
+				return;
+			case TEST_STUB_H2_DATA:
+				if( len > 0 )
+				{
+					/* Give the connection's window back; the streams' are big enough for a request. */
+					unsigned char increment[ 4 ] = { (unsigned char) (len >> 24), (unsigned char) (len >> 16), (unsigned char) (len >> 8), (unsigned char) len };
+					answered = test_stub_h2_send( conn, TEST_STUB_H2_WINDOW_UPDATE, 0, 0, increment, sizeof(increment) );
+				}
+				/* fall through */
+			case TEST_STUB_H2_HEADERS:
+				if( answered && (flags & TEST_STUB_H2_END_STREAM) )
+				{
+					answered = test_stub_h2_send( conn, TEST_STUB_H2_HEADERS, TEST_STUB_H2_END_HEADERS, stream, status_200, sizeof(status_200) ) &&
+					           test_stub_h2_send( conn, TEST_STUB_H2_DATA, TEST_STUB_H2_END_STREAM, stream, body, sizeof(body) - 1 );
+				}
+				break;
+			default:
+				break;
+		}
+
+		if( !answered )
+		{
+			return;
+		}
+	}
+}
+
+#ifdef TEST_STUB_TLS
+/*
+ * TLS, for clients that only multiplex HTTP/2 over it, with a key and a
+ * certificate for 127.0.0.1 made up at start.  The certificate is written
+ * to a file for the client to trust; see test_stub_certificate().
+ */
+static SSL_CTX* test_stub_tls = NULL;
+static char test_stub_tls_certificate[ 64 ] = "";
+
+static int test_stub_tls_alpn( SSL* ssl, const unsigned char** out, unsigned char* out_len, const unsigned char* in, unsigned int in_len, void* arg )
+{
+	static const unsigned char protocols[] = "\x02h2\x08http/1.1";
+	unsigned char* selected = NULL;
+
+	(void) ssl;
+	(void) arg;
+
+	if( SSL_select_next_proto( &selected, out_len, protocols, sizeof(protocols) - 1, in, in_len ) != OPENSSL_NPN_NEGOTIATED )
+	{
+		return SSL_TLSEXT_ERR_NOACK;
+	}
+
+	*out = selected;
+	return SSL_TLSEXT_ERR_OK;
+}
+
+static bool test_stub_tls_start( void )
+{
+	bool result = false;
+	EVP_PKEY_CTX* key_ctx = EVP_PKEY_CTX_new_id( EVP_PKEY_EC, NULL );
+	EVP_PKEY* key = NULL;
+	X509* certificate = X509_new( );
+	X509_EXTENSION* alt_name = NULL;
+	FILE* file = NULL;
+	int fd = -1;
+
+	if( !key_ctx || !certificate ||
+	    EVP_PKEY_keygen_init( key_ctx ) <= 0 ||
+	    EVP_PKEY_CTX_set_ec_paramgen_curve_nid( key_ctx, NID_X9_62_prime256v1 ) <= 0 ||
+	    EVP_PKEY_keygen( key_ctx, &key ) <= 0 )
+	{
+		goto done;
+	}
+
+	X509_NAME* name = X509_get_subject_name( certificate );
+	X509_set_version( certificate, 2 );
+	ASN1_INTEGER_set( X509_get_serialNumber( certificate ), 1 );
+	X509_gmtime_adj( X509_getm_notBefore( certificate ), -60 );
+	X509_gmtime_adj( X509_getm_notAfter( certificate ), 24 * 60 * 60 );
+	X509_NAME_add_entry_by_txt( name, "CN", MBSTRING_ASC, (const unsigned char*) "127.0.0.1", -1, -1, 0 );
+	X509_set_issuer_name( certificate, name );
+	X509_set_pubkey( certificate, key );
+
+	if( !(alt_name = X509V3_EXT_conf_nid( NULL, NULL, NID_subject_alt_name, "IP:127.0.0.1" )) ||
+	    !X509_add_ext( certificate, alt_name, -1 ) ||
+	    !X509_sign( certificate, key, EVP_sha256() ) )
+	{
+		goto done;
+	}
+
+	snprintf( test_stub_tls_certificate, sizeof(test_stub_tls_certificate), "/tmp/test_stub_XXXXXX" );
+
+	if( (fd = mkstemp( test_stub_tls_certificate )) < 0 ||
+	    !(file = fdopen( fd, "w" )) ||
+	    !PEM_write_X509( file, certificate ) )
+	{
+		goto done;
+	}
+
+	if( !(test_stub_tls = SSL_CTX_new( TLS_server_method() )) ||
+	    SSL_CTX_use_certificate( test_stub_tls, certificate ) != 1 ||
+	    SSL_CTX_use_PrivateKey( test_stub_tls, key ) != 1 )
+	{
+		goto done;
+	}
+
+	SSL_CTX_set_alpn_select_cb( test_stub_tls, test_stub_tls_alpn, NULL );
+	result = true;
+
+done:
+	if( file ) fclose( file );
+	else if( fd >= 0 ) close( fd );
+	if( alt_name ) X509_EXTENSION_free( alt_name );
+	if( certificate ) X509_free( certificate );
+	if( key ) EVP_PKEY_free( key );
+	if( key_ctx ) EVP_PKEY_CTX_free( key_ctx );
+	return result;
+}
+
+const char* test_stub_certificate( void )
+{
+	return test_stub_tls_certificate;
+}
+#endif
+
+static void* test_stub_connection( void* arg )
+{
+	test_stub_conn_t conn = { .fd = (int) (long) arg };
+	char buffer[ 8192 ] = "";
+	size_t len = 0;
+	int one = 1;
+
+	setsockopt( conn.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one) );
+
+#ifdef TEST_STUB_TLS
+	/* ALPN picks the protocol; HTTP/2 is still told apart by its preface. */
+	if( !(conn.ssl = SSL_new( test_stub_tls )) ||
+	    SSL_set_fd( conn.ssl, conn.fd ) != 1 ||
+	    SSL_accept( conn.ssl ) != 1 )
+	{
+		goto done;
+	}
+#endif
+
+	for( ;; )
+	{
+		char* end = NULL;
+
+		while( !(end = strstr( buffer, "\r\n\r\n" )) )
+		{
+			if( len >= sizeof(buffer) - 1 )
+			{
+				goto done;
+			}
+
+			ssize_t n = test_stub_read( &conn, buffer + len, sizeof(buffer) - 1 - len );
+
+			if( n <= 0 )
+			{
+				goto done;
+			}
+
+			len += n;
+			buffer[ len ] = '\0';
+
+			if( len >= 4 && strncmp( buffer, "PRI ", 4 ) == 0 )
+			{
+				test_stub_h2_serve( &conn, buffer, len );
+				goto done;
+			}
+		}
+
+		char method[ 16 ] = "";
+		char path[ 256 ] = "";
+		char token[ 128 ] = "";
+		size_t content_length = 0;
+		size_t head_len = end + 4 - buffer;
+
+		*end = '\0';
+		sscanf( buffer, "%15s %255s", method, path );
+
+		for( char* line = strstr( buffer, "\r\n" ); line; line = strstr( line + 2, "\r\n" ) )
+		{
+			if( strncmp( line + 2, "Content-Length:", 15 ) == 0 )
+			{
+				content_length = strtoul( line + 17, NULL, 10 );
+			}
+			else if( strncmp( line + 2, "Api-Session-Token:", 18 ) == 0 )
+			{
+				sscanf( line + 20, "%127s", token );
+			}
+		}
+
+		/* The bodies don't matter to the stub; skip them. */
+		size_t used = head_len + content_length;
+
+		while( len < used )
+		{
+			size_t skip = used - len < sizeof(buffer) - 1 ? used - len : sizeof(buffer) - 1;
+			ssize_t n = test_stub_read( &conn, buffer, skip );
+
+			if( n <= 0 )
+			{
+				goto done;
+			}
+
+			used -= n;
+		}
+
+		pthread_mutex_lock( &test_stub.lock );
+		test_stub.active += 1;
+		if( test_stub.active > test_stub.max_active ) test_stub.max_active = test_stub.active;
+		pthread_mutex_unlock( &test_stub.lock );
+
+		bool answered = test_stub_respond( &conn, method, path, token[ 0 ] ? token : NULL );
+
+		pthread_mutex_lock( &test_stub.lock );
+		test_stub.active -= 1;
+		pthread_mutex_unlock( &test_stub.lock );
+
+		if( !answered )
+		{
+			goto done;
+		}
+
+		memmove( buffer, buffer + used, len - used );
+		len -= used;
+		buffer[ len ] = '\0';
+	}
+
+done:
+#ifdef TEST_STUB_TLS
+	if( conn.ssl )
+	{
+		SSL_shutdown( conn.ssl );
+		SSL_free( conn.ssl );
+	}
+#endif
+	close( conn.fd );
+	return NULL;
+}
+
+static void* test_stub_serve( void* arg )
+{
+	int listener = (int) (long) arg;
+
+	for( ;; )
+	{
+		int fd = accept( listener, NULL, NULL );
+		pthread_t thread;
+
+		if( fd < 0 )
+		{
+			continue;
+		}
+
+		if( pthread_create( &thread, NULL, test_stub_connection, (void*) (long) fd ) != 0 )
+		{
+			close( fd );
+			continue;
+		}
+
+		pthread_detach( thread );
+	}
+
+	return NULL;
+}
+
+bool test_stub_start( void )
+{
+	struct sockaddr_in address;
+	int listener = socket( AF_INET, SOCK_STREAM, 0 );
+	int one = 1;
+	pthread_t thread;
+
+#ifdef TEST_STUB_TLS
+	if( !test_stub_tls_start( ) )
+	{
+		fprintf( stderr, "[ERROR] Unable to set up TLS.\n" );
+		return false;
+	}
+#endif
+
+	memset( &address, 0, sizeof(address) );
+	address.sin_family      = AF_INET;
+	address.sin_port        = htons( TEST_STUB_PORT );
+	address.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+
+	if( listener < 0 ||
+	    setsockopt( listener, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one) ) != 0 ||
+	    bind( listener, (struct sockaddr*) &address, sizeof(address) ) != 0 ||
+	    listen( listener, 64 ) != 0 ||
+	    pthread_create( &thread, NULL, test_stub_serve, (void*) (long) listener ) != 0 )
+	{
+		fprintf( stderr, "[ERROR] Unable to serve on port %d.\n", TEST_STUB_PORT );
+		return false;
+	}
+
+	pthread_detach( thread );
+	return true;
+}
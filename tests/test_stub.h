@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2016-2025 by Joseph A. Marrero. http://www.joemarrero.com/
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef _TEST_STUB_H_
+#define _TEST_STUB_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <pthread.h>
+
+/*
+ * A stub of the API for the tests, served from a thread of the test's
+ * own process on TEST_STUB_PORT, against which the library is built with
+ * the dev server pointed at it (see the test targets in the Makefile).
+ * One thread per connection, keep-alive, and just enough of the API for
+ * TEST_STUB_DOMAIN, whose listing holds TEST_STUB_RECORDS A records.
+ *
+ * Sessions are numbered; expiring them invalidates every session handed
+ * out so far.  Rules script the answers to the next requests for a path:
+ * see test_stub_push().  Every request is logged with the time it
+ * arrived, on the clock of test_stub_now_ms().
+ *
+ * Connections that open with the HTTP/2 preface are served too, but only
+ * generically: every request is answered with a success that passes for
+ * any of the API's answers.  Built with TEST_STUB_TLS (and linked with
+ * OpenSSL), the stub serves both protocols over TLS, negotiated by ALPN,
+ * with a certificate for 127.0.0.1 it writes to test_stub_certificate().
+ */
+#define TEST_STUB_DOMAIN   "example.com"
+#define TEST_STUB_RECORDS  3
+#define TEST_STUB_RULES    16
+#define TEST_STUB_ARRIVALS 4096
+
+typedef struct test_stub_rule {
+	char path[ 64 ];              /* a prefix of the paths it applies to */
+	int count;                    /* requests left to apply it to */
+	int delay_ms;                 /* before answering */
+	int status;                   /* 0 answers as usual */
+	int code;                     /* the result code sent with status */
+	int retry_after_s;            /* a Retry-After header, unless 0 */
+} test_stub_rule_t;
+
+typedef struct test_stub_arrival {
+	char path[ 64 ];
+	long long at_ms;
+} test_stub_arrival_t;
+
+typedef struct test_stub {
+	pthread_mutex_t lock;
+	unsigned long sessions;       /* sessions handed out */
+	unsigned long valid_from;     /* the first session still valid */
+	unsigned long logins;
+	unsigned long refused;
+	unsigned long next_record_id;
+	unsigned long listings;       /* numbers the contents of each listing */
+	int login_delay_ms;
+	int active;                   /* requests being answered right now */
+	int max_active;
+	test_stub_rule_t rules[ TEST_STUB_RULES ];
+	size_t rule_count;
+	test_stub_arrival_t arrivals[ TEST_STUB_ARRIVALS ];
+	size_t arrival_count;
+} test_stub_t;
+
+extern test_stub_t test_stub;
+
+bool      test_stub_start    ( void );
+long long test_stub_now_ms   ( void );
+void      test_stub_expire   ( void );
+void      test_stub_reset    ( void );
+void      test_stub_push     ( const char* path, int count, int delay_ms, int status, int code, int retry_after_s );
+size_t    test_stub_count    ( const char* path );
+size_t    test_stub_arrivals ( const char* path, long long* at_ms, size_t max );
+int       test_stub_max_active ( void );
+#ifdef TEST_STUB_TLS
+const char* test_stub_certificate ( void );
+#endif
+
+#endif /* _TEST_STUB_H_ */